@@ -0,0 +1,94 @@
+#ifndef _ARCHIVE_ARCHIVE_FORMAT_H_
+#define _ARCHIVE_ARCHIVE_FORMAT_H_
+
+#include <endian.h>
+#include <stdint.h>
+#include <string.h>
+
+// .ckba block archive, every integer is little endian
+//
+//   file header  magic "CKBARCH1", u32 version, u32 chunk_blocks, u64 start_height, u64 reserved
+//   records      u32 body size + record body, one per height, chunk_blocks records per chunk
+//   chunk table  per chunk: u64 offset, u64 size, u32 crc32 of the chunk bytes, u32 blocks
+//   index        per block: u64 offset of its record
+//   footer       u64 start_height, u64 block_count, u64 chunk_table_offset, u64 index_offset,
+//                u32 chunk_count, u32 chunk_blocks, magic "CKBAIDX1"
+//
+// Record body
+//   fixed part   u64 number, hash[32], packed Header[208], u32 transaction_count,
+//                u32 uncle_count, u32 proposal_count, u32 extension_size, u32 flags, u32 reserved
+//   tx table     per transaction: hash[32], witness_hash[32], u32 offset, u32 size
+//   uncle table  per uncle: hash[32], u32 offset, u32 size
+//   proposals    proposal_count short ids of 10 bytes
+//   extension    the extension as stored in the database (molecule Bytes)
+//   blobs        packed Transaction and UncleBlock values, offsets are relative to the body
+
+const char ARCHIVE_MAGIC[8] = {'C', 'K', 'B', 'A', 'R', 'C', 'H', '1'};
+const char ARCHIVE_FOOTER_MAGIC[8] = {'C', 'K', 'B', 'A', 'I', 'D', 'X', '1'};
+const uint32_t ARCHIVE_VERSION = 1;
+const uint32_t ARCHIVE_DEFAULT_CHUNK_BLOCKS = 1024;
+
+const size_t ARCHIVE_FILE_HEADER_SIZE = 32;
+const size_t ARCHIVE_CHUNK_ENTRY_SIZE = 24;
+const size_t ARCHIVE_INDEX_ENTRY_SIZE = 8;
+const size_t ARCHIVE_FOOTER_SIZE = 48;
+
+const size_t ARCHIVE_RECORD_NUMBER = 0;
+const size_t ARCHIVE_RECORD_HASH = 8;
+const size_t ARCHIVE_RECORD_HEADER = 40;
+const size_t ARCHIVE_RECORD_TX_COUNT = 248;
+const size_t ARCHIVE_RECORD_UNCLE_COUNT = 252;
+const size_t ARCHIVE_RECORD_PROPOSAL_COUNT = 256;
+const size_t ARCHIVE_RECORD_EXTENSION_SIZE = 260;
+const size_t ARCHIVE_RECORD_FLAGS = 264;
+const size_t ARCHIVE_RECORD_FIXED_SIZE = 272;
+const size_t ARCHIVE_TX_ENTRY_SIZE = 72;
+const size_t ARCHIVE_UNCLE_ENTRY_SIZE = 40;
+const size_t ARCHIVE_PROPOSAL_SIZE = 10;
+const uint32_t ARCHIVE_FLAG_EXTENSION = 1;
+
+// Field offsets inside the packed 208 byte Header
+const size_t HEADER_VERSION = 0;
+const size_t HEADER_COMPACT_TARGET = 4;
+const size_t HEADER_TIMESTAMP = 8;
+const size_t HEADER_NUMBER = 16;
+const size_t HEADER_EPOCH = 24;
+const size_t HEADER_PARENT_HASH = 32;
+const size_t HEADER_TRANSACTIONS_ROOT = 64;
+const size_t HEADER_PROPOSALS_HASH = 96;
+const size_t HEADER_EXTRA_HASH = 128;
+const size_t HEADER_DAO = 160;
+// dao: C total issuance, AR accumulate rate, S secondary issuance, U occupied capacity, u64 each
+const size_t HEADER_DAO_C = 160;
+const size_t HEADER_DAO_AR = 168;
+const size_t HEADER_DAO_S = 176;
+const size_t HEADER_DAO_U = 184;
+const size_t HEADER_NONCE = 192;
+
+inline uint32_t LoadLe32(const char *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return le32toh(value);
+}
+
+inline uint64_t LoadLe64(const char *p)
+{
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return le64toh(value);
+}
+
+inline void StoreLe32(char *p, uint32_t value)
+{
+    value = htole32(value);
+    memcpy(p, &value, sizeof(value));
+}
+
+inline void StoreLe64(char *p, uint64_t value)
+{
+    value = htole64(value);
+    memcpy(p, &value, sizeof(value));
+}
+
+#endif
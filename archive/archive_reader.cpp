@@ -0,0 +1,161 @@
+#include "archive_reader.h"
+#include "log/logging.h"
+#include "utils/parallel_for.hpp"
+#include <atomic>
+#include <sys/mman.h>
+#include <zlib.h>
+
+bool ArchiveBlockView::Parse(std::string_view body)
+{
+    if (body.size() < ARCHIVE_RECORD_FIXED_SIZE)
+    {
+        return false;
+    }
+    body_ = body;
+    const char *data = body.data();
+    tx_count_ = LoadLe32(data + ARCHIVE_RECORD_TX_COUNT);
+    uncle_count_ = LoadLe32(data + ARCHIVE_RECORD_UNCLE_COUNT);
+    proposal_count_ = LoadLe32(data + ARCHIVE_RECORD_PROPOSAL_COUNT);
+    extension_size_ = LoadLe32(data + ARCHIVE_RECORD_EXTENSION_SIZE);
+    has_extension_ = 0 != (LoadLe32(data + ARCHIVE_RECORD_FLAGS) & ARCHIVE_FLAG_EXTENSION);
+
+    uint64_t offset = ARCHIVE_RECORD_FIXED_SIZE + (uint64_t)tx_count_ * ARCHIVE_TX_ENTRY_SIZE;
+    uncle_table_ = offset;
+    offset += (uint64_t)uncle_count_ * ARCHIVE_UNCLE_ENTRY_SIZE;
+    proposals_ = offset;
+    offset += (uint64_t)proposal_count_ * ARCHIVE_PROPOSAL_SIZE;
+    extension_ = offset;
+    offset += extension_size_;
+    if (offset > body.size())
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < tx_count_; ++i)
+    {
+        size_t entry = TxEntry(i) + 64;
+        if ((uint64_t)LoadLe32(data + entry) + LoadLe32(data + entry + 4) > body.size())
+        {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < uncle_count_; ++i)
+    {
+        size_t entry = UncleEntry(i) + 32;
+        if ((uint64_t)LoadLe32(data + entry) + LoadLe32(data + entry + 4) > body.size())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ArchiveReader::Open(const std::string &path)
+{
+    Close();
+    if (!file_.Open(path))
+    {
+        return false;
+    }
+    const char *data = file_.Data();
+    uint64_t size = file_.Size();
+    if (size < ARCHIVE_FILE_HEADER_SIZE + ARCHIVE_FOOTER_SIZE || 0 != memcmp(data, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)))
+    {
+        ERRORLOG("{} is not an archive", path);
+        Close();
+        return false;
+    }
+    const char *footer = data + size - ARCHIVE_FOOTER_SIZE;
+    if (0 != memcmp(footer + 40, ARCHIVE_FOOTER_MAGIC, sizeof(ARCHIVE_FOOTER_MAGIC)))
+    {
+        ERRORLOG("{} has no footer, the export did not finish", path);
+        Close();
+        return false;
+    }
+    start_height_ = LoadLe64(footer);
+    block_count_ = LoadLe64(footer + 8);
+    uint64_t chunk_table_offset = LoadLe64(footer + 16);
+    uint64_t index_offset = LoadLe64(footer + 24);
+    chunk_count_ = LoadLe32(footer + 32);
+    if (chunk_table_offset < ARCHIVE_FILE_HEADER_SIZE ||
+        chunk_table_offset + (uint64_t)chunk_count_ * ARCHIVE_CHUNK_ENTRY_SIZE != index_offset ||
+        index_offset + block_count_ * ARCHIVE_INDEX_ENTRY_SIZE != size - ARCHIVE_FOOTER_SIZE)
+    {
+        ERRORLOG("{} has a broken footer", path);
+        Close();
+        return false;
+    }
+    records_end_ = chunk_table_offset;
+    chunks_ = data + chunk_table_offset;
+    index_ = data + index_offset;
+    return true;
+}
+
+void ArchiveReader::Close()
+{
+    file_.Close();
+    chunks_ = nullptr;
+    index_ = nullptr;
+    start_height_ = 0;
+    block_count_ = 0;
+    records_end_ = 0;
+    chunk_count_ = 0;
+}
+
+bool ArchiveReader::Get(uint64_t height, ArchiveBlockView &view) const
+{
+    if (!Contains(height))
+    {
+        return false;
+    }
+    uint64_t offset = LoadLe64(index_ + (height - start_height_) * ARCHIVE_INDEX_ENTRY_SIZE);
+    if (offset + 4 > records_end_)
+    {
+        return false;
+    }
+    uint64_t size = LoadLe32(file_.Data() + offset);
+    if (offset + 4 + size > records_end_)
+    {
+        return false;
+    }
+    return view.Parse(std::string_view(file_.Data() + offset + 4, size));
+}
+
+bool ArchiveReader::VerifyChunks(uint32_t threads, uint64_t &bad_chunk) const
+{
+    std::atomic<uint64_t> first_bad(UINT64_MAX);
+    ParallelFor(0, chunk_count_, 1, threads, [&](uint64_t begin, uint64_t end, uint32_t)
+                {
+                    for (uint64_t i = begin; i < end; ++i)
+                    {
+                        const char *entry = chunks_ + i * ARCHIVE_CHUNK_ENTRY_SIZE;
+                        uint64_t offset = LoadLe64(entry);
+                        uint64_t size = LoadLe64(entry + 8);
+                        bool ok = offset + size <= records_end_;
+                        if (ok)
+                        {
+                            uint32_t crc = crc32_z(crc32(0, nullptr, 0), (const Bytef *)file_.Data() + offset, size);
+                            ok = crc == LoadLe32(entry + 16);
+                        }
+                        if (!ok)
+                        {
+                            uint64_t current = first_bad.load();
+                            while (i < current && !first_bad.compare_exchange_weak(current, i))
+                            {
+                            }
+                        }
+                    }
+                    return true;
+                });
+    bad_chunk = first_bad.load();
+    return UINT64_MAX == bad_chunk;
+}
+
+void ArchiveReader::AdviseSequential() const
+{
+    file_.Advise(MADV_SEQUENTIAL);
+}
+
+void ArchiveReader::AdviseRandom() const
+{
+    file_.Advise(MADV_RANDOM);
+}
@@ -0,0 +1,101 @@
+#ifndef _ARCHIVE_ARCHIVE_READER_H_
+#define _ARCHIVE_ARCHIVE_READER_H_
+
+#include "archive/archive_format.h"
+#include "utils/mmap_file.h"
+#include <string>
+#include <string_view>
+
+// Typed accessors over one archive record. Every string_view points into the mapping, so a
+// view stays valid as long as its reader is open.
+class ArchiveBlockView
+{
+public:
+    // Checks the record layout once so the accessors need no bounds checks
+    bool Parse(std::string_view body);
+
+    uint64_t Number() const { return LoadLe64(body_.data() + ARCHIVE_RECORD_NUMBER); }
+    std::string_view Hash() const { return body_.substr(ARCHIVE_RECORD_HASH, 32); }
+    // Packed molecule Header
+    std::string_view Header() const { return body_.substr(ARCHIVE_RECORD_HEADER, 208); }
+    uint32_t Version() const { return LoadLe32(HeaderField(HEADER_VERSION)); }
+    uint32_t CompactTarget() const { return LoadLe32(HeaderField(HEADER_COMPACT_TARGET)); }
+    uint64_t Timestamp() const { return LoadLe64(HeaderField(HEADER_TIMESTAMP)); }
+    uint64_t Epoch() const { return LoadLe64(HeaderField(HEADER_EPOCH)); }
+    std::string_view ParentHash() const { return Header().substr(HEADER_PARENT_HASH, 32); }
+    std::string_view TransactionsRoot() const { return Header().substr(HEADER_TRANSACTIONS_ROOT, 32); }
+    std::string_view ProposalsHash() const { return Header().substr(HEADER_PROPOSALS_HASH, 32); }
+    std::string_view ExtraHash() const { return Header().substr(HEADER_EXTRA_HASH, 32); }
+    std::string_view Dao() const { return Header().substr(HEADER_DAO, 32); }
+    std::string_view Nonce() const { return Header().substr(HEADER_NONCE, 16); }
+
+    uint32_t TransactionCount() const { return tx_count_; }
+    std::string_view TransactionHash(uint32_t i) const { return body_.substr(TxEntry(i), 32); }
+    std::string_view WitnessHash(uint32_t i) const { return body_.substr(TxEntry(i) + 32, 32); }
+    // Packed molecule Transaction
+    std::string_view Transaction(uint32_t i) const { return Blob(TxEntry(i) + 64); }
+
+    uint32_t UncleCount() const { return uncle_count_; }
+    std::string_view UncleHash(uint32_t i) const { return body_.substr(UncleEntry(i), 32); }
+    // Packed molecule UncleBlock
+    std::string_view Uncle(uint32_t i) const { return Blob(UncleEntry(i) + 32); }
+
+    uint32_t ProposalCount() const { return proposal_count_; }
+    std::string_view Proposal(uint32_t i) const { return body_.substr(proposals_ + i * ARCHIVE_PROPOSAL_SIZE, ARCHIVE_PROPOSAL_SIZE); }
+    bool HasExtension() const { return has_extension_; }
+    // The extension as molecule Bytes
+    std::string_view Extension() const { return body_.substr(extension_, extension_size_); }
+
+    std::string_view Body() const { return body_; }
+
+private:
+    const char *HeaderField(size_t offset) const { return body_.data() + ARCHIVE_RECORD_HEADER + offset; }
+    size_t TxEntry(uint32_t i) const { return ARCHIVE_RECORD_FIXED_SIZE + i * ARCHIVE_TX_ENTRY_SIZE; }
+    size_t UncleEntry(uint32_t i) const { return uncle_table_ + i * ARCHIVE_UNCLE_ENTRY_SIZE; }
+    std::string_view Blob(size_t entry) const
+    {
+        return body_.substr(LoadLe32(body_.data() + entry), LoadLe32(body_.data() + entry + 4));
+    }
+
+    std::string_view body_;
+    uint32_t tx_count_ = 0;
+    uint32_t uncle_count_ = 0;
+    uint32_t proposal_count_ = 0;
+    size_t uncle_table_ = 0;
+    size_t proposals_ = 0;
+    size_t extension_ = 0;
+    uint32_t extension_size_ = 0;
+    bool has_extension_ = false;
+};
+
+class ArchiveReader
+{
+public:
+    bool Open(const std::string &path);
+    void Close();
+
+    uint64_t StartHeight() const { return start_height_; }
+    uint64_t EndHeight() const { return start_height_ + block_count_; }
+    uint64_t BlockCount() const { return block_count_; }
+    uint32_t ChunkCount() const { return chunk_count_; }
+    bool Contains(uint64_t height) const { return height >= start_height_ && height - start_height_ < block_count_; }
+
+    // One index lookup, no copy
+    bool Get(uint64_t height, ArchiveBlockView &view) const;
+    // Checks the crc32 of every chunk, bad_chunk is the first failing one
+    bool VerifyChunks(uint32_t threads, uint64_t &bad_chunk) const;
+    // Hints the kernel for a full replay or for random lookups
+    void AdviseSequential() const;
+    void AdviseRandom() const;
+
+private:
+    MmapFile file_;
+    const char *chunks_ = nullptr;
+    const char *index_ = nullptr;
+    uint64_t start_height_ = 0;
+    uint64_t block_count_ = 0;
+    uint64_t records_end_ = 0;
+    uint32_t chunk_count_ = 0;
+};
+
+#endif
@@ -0,0 +1,307 @@
+#include "archive_writer.h"
+#include "log/logging.h"
+#include "molecule/block_molecule.h"
+#include "utils/mmap_file.h"
+#include <array>
+#include <zlib.h>
+
+bool EncodeArchiveRecord(const RawBlock &block, std::string &record)
+{
+    std::string_view hash, header, uncle_hashes, uncle_vec;
+    if (!SplitHeaderView(block.header, hash, header) || !SplitUncleBlockVecView(block.uncles, uncle_hashes, uncle_vec))
+    {
+        return false;
+    }
+    thread_local std::vector<std::string_view> hashes;
+    thread_local std::vector<std::string_view> uncles;
+    if (!GetByte32VecItems(uncle_hashes, hashes) || !GetUncleBlocks(uncle_vec, uncles) || hashes.size() != uncles.size())
+    {
+        return false;
+    }
+    // ProposalShortIdVec: u32 item count followed by 10 byte items
+    if (block.proposals.size() < 4)
+    {
+        return false;
+    }
+    uint32_t proposal_count = LoadLe32(block.proposals.data());
+    if (block.proposals.size() != 4 + (size_t)proposal_count * ARCHIVE_PROPOSAL_SIZE)
+    {
+        return false;
+    }
+
+    thread_local std::vector<std::array<std::string_view, 3>> txs;
+    txs.resize(block.transactions.size());
+    size_t body_size = ARCHIVE_RECORD_FIXED_SIZE + txs.size() * ARCHIVE_TX_ENTRY_SIZE + uncles.size() * ARCHIVE_UNCLE_ENTRY_SIZE +
+                       proposal_count * ARCHIVE_PROPOSAL_SIZE + (block.has_extension ? block.extension.size() : 0);
+    for (size_t i = 0; i < txs.size(); ++i)
+    {
+        if (!SplitTransactionView(block.transactions[i], txs[i][0], txs[i][1], txs[i][2]))
+        {
+            return false;
+        }
+        body_size += txs[i][2].size();
+    }
+    for (auto &uncle : uncles)
+    {
+        body_size += uncle.size();
+    }
+    if (body_size > UINT32_MAX)
+    {
+        ERRORLOG("block {} is too large for an archive record", block.number);
+        return false;
+    }
+
+    record.resize(4 + body_size);
+    StoreLe32(&record[0], body_size);
+    char *body = &record[4];
+    StoreLe64(body + ARCHIVE_RECORD_NUMBER, block.number);
+    memcpy(body + ARCHIVE_RECORD_HASH, hash.data(), hash.size());
+    memcpy(body + ARCHIVE_RECORD_HEADER, header.data(), header.size());
+    StoreLe32(body + ARCHIVE_RECORD_TX_COUNT, txs.size());
+    StoreLe32(body + ARCHIVE_RECORD_UNCLE_COUNT, uncles.size());
+    StoreLe32(body + ARCHIVE_RECORD_PROPOSAL_COUNT, proposal_count);
+    StoreLe32(body + ARCHIVE_RECORD_EXTENSION_SIZE, block.has_extension ? block.extension.size() : 0);
+    StoreLe32(body + ARCHIVE_RECORD_FLAGS, block.has_extension ? ARCHIVE_FLAG_EXTENSION : 0);
+    StoreLe32(body + ARCHIVE_RECORD_FLAGS + 4, 0);
+
+    size_t table = ARCHIVE_RECORD_FIXED_SIZE;
+    size_t blob = body_size;
+    for (auto &uncle : uncles)
+    {
+        blob -= uncle.size();
+    }
+    for (auto &tx : txs)
+    {
+        blob -= tx[2].size();
+    }
+    for (auto &tx : txs)
+    {
+        memcpy(body + table, tx[0].data(), tx[0].size());
+        memcpy(body + table + 32, tx[1].data(), tx[1].size());
+        StoreLe32(body + table + 64, blob);
+        StoreLe32(body + table + 68, tx[2].size());
+        memcpy(body + blob, tx[2].data(), tx[2].size());
+        table += ARCHIVE_TX_ENTRY_SIZE;
+        blob += tx[2].size();
+    }
+    for (size_t i = 0; i < uncles.size(); ++i)
+    {
+        memcpy(body + table, hashes[i].data(), hashes[i].size());
+        StoreLe32(body + table + 32, blob);
+        StoreLe32(body + table + 36, uncles[i].size());
+        memcpy(body + blob, uncles[i].data(), uncles[i].size());
+        table += ARCHIVE_UNCLE_ENTRY_SIZE;
+        blob += uncles[i].size();
+    }
+    memcpy(body + table, block.proposals.data() + 4, block.proposals.size() - 4);
+    table += block.proposals.size() - 4;
+    if (block.has_extension)
+    {
+        memcpy(body + table, block.extension.data(), block.extension.size());
+    }
+    return true;
+}
+
+int EncodeArchiveBlock(RocksDBReadOnly &db, uint64_t height, std::string &record)
+{
+    thread_local RawBlock block;
+    rocksdb::Status status;
+    if (!ReadRawBlock(db, height, block, status))
+    {
+        ERRORLOG("read block {} failed", height);
+        return -2;
+    }
+    if (!EncodeArchiveRecord(block, record))
+    {
+        ERRORLOG("encode block {} failed", height);
+        return -3;
+    }
+    return 0;
+}
+
+PipelineStages ArchivePipelineStages()
+{
+    PipelineStages stages;
+    stages.fetch = [](RocksDBReadOnly &db, PipelineItem &item)
+    {
+        rocksdb::Status status;
+        return ReadRawBlock(db, item.height, item.source.block, status) ? 0 : -2;
+    };
+    stages.decode = [](PipelineItem &item)
+    {
+        return EncodeArchiveRecord(item.source.block, item.record) ? 0 : -3;
+    };
+    stages.serialize = [](PipelineItem &item)
+    {
+        return 0;
+    };
+    return stages;
+}
+
+ArchiveSink::ArchiveSink(const std::string &path, uint32_t chunk_blocks, bool append, const WriterOptions &options)
+    : path_(path), chunk_blocks_(std::max<uint32_t>(chunk_blocks, 1)), file_(new FileSink(path, append, options)),
+      started_(false), closed_(false), start_height_(0), bytes_(0), chunk_offset_(0), chunk_crc_(0), chunk_records_(0)
+{
+}
+
+bool ArchiveSink::IsOpen() const
+{
+    return file_->IsOpen();
+}
+
+bool ArchiveSink::WriteFileHeader(uint64_t start_height)
+{
+    char header[ARCHIVE_FILE_HEADER_SIZE] = {};
+    memcpy(header, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+    StoreLe32(header + 8, ARCHIVE_VERSION);
+    StoreLe32(header + 12, chunk_blocks_);
+    StoreLe64(header + 16, start_height);
+    if (!file_->Write(start_height, std::string(header, sizeof(header))))
+    {
+        return false;
+    }
+    started_ = true;
+    start_height_ = start_height;
+    bytes_ = sizeof(header);
+    return true;
+}
+
+void ArchiveSink::AddRecord(const char *data, size_t size)
+{
+    if (0 == chunk_records_)
+    {
+        chunk_offset_ = bytes_;
+        chunk_crc_ = crc32(0, nullptr, 0);
+    }
+    offsets_.push_back(bytes_);
+    chunk_crc_ = crc32(chunk_crc_, (const Bytef *)data, size);
+    bytes_ += size;
+    if (++chunk_records_ == chunk_blocks_)
+    {
+        FinishChunk();
+    }
+}
+
+void ArchiveSink::FinishChunk()
+{
+    if (0 == chunk_records_)
+    {
+        return;
+    }
+    char entry[ARCHIVE_CHUNK_ENTRY_SIZE];
+    StoreLe64(entry, chunk_offset_);
+    StoreLe64(entry + 8, bytes_ - chunk_offset_);
+    StoreLe32(entry + 16, chunk_crc_);
+    StoreLe32(entry + 20, chunk_records_);
+    chunk_table_.append(entry, sizeof(entry));
+    chunk_records_ = 0;
+}
+
+bool ArchiveSink::Write(uint64_t height, const std::string &record)
+{
+    if (!started_ && !WriteFileHeader(height))
+    {
+        return false;
+    }
+    if (height != start_height_ + offsets_.size())
+    {
+        ERRORLOG("archive {} expects block {} but got {}", path_, start_height_ + offsets_.size(), height);
+        return false;
+    }
+    if (!file_->Write(height, record))
+    {
+        return false;
+    }
+    AddRecord(record.data(), record.size());
+    return true;
+}
+
+bool ArchiveSink::Close()
+{
+    if (closed_)
+    {
+        return true;
+    }
+    if (!started_ && !WriteFileHeader(0))
+    {
+        return false;
+    }
+    FinishChunk();
+    uint64_t chunk_table_offset = bytes_;
+    uint64_t index_offset = chunk_table_offset + chunk_table_.size();
+    std::string tail = chunk_table_;
+    tail.reserve(tail.size() + offsets_.size() * ARCHIVE_INDEX_ENTRY_SIZE + ARCHIVE_FOOTER_SIZE);
+    char value[8];
+    for (uint64_t offset : offsets_)
+    {
+        StoreLe64(value, offset);
+        tail.append(value, sizeof(value));
+    }
+    char footer[ARCHIVE_FOOTER_SIZE];
+    StoreLe64(footer, start_height_);
+    StoreLe64(footer + 8, offsets_.size());
+    StoreLe64(footer + 16, chunk_table_offset);
+    StoreLe64(footer + 24, index_offset);
+    StoreLe32(footer + 32, chunk_table_.size() / ARCHIVE_CHUNK_ENTRY_SIZE);
+    StoreLe32(footer + 36, chunk_blocks_);
+    memcpy(footer + 40, ARCHIVE_FOOTER_MAGIC, sizeof(ARCHIVE_FOOTER_MAGIC));
+    tail.append(footer, sizeof(footer));
+    closed_ = true;
+    if (!file_->Write(start_height_ + offsets_.size(), tail) || !file_->Close())
+    {
+        ERRORLOG("finish archive {} failed", path_);
+        return false;
+    }
+    return true;
+}
+
+bool ArchiveSink::Checkpoint(SinkPosition &position)
+{
+    return file_->Checkpoint(position);
+}
+
+bool ArchiveSink::Resume(const SinkPosition &position)
+{
+    SinkPosition target = position;
+    if (target.file.empty())
+    {
+        target.file = path_;
+        target.offset = 0;
+    }
+    MmapFile map;
+    if (!map.Open(path_) || map.Size() < target.offset)
+    {
+        ERRORLOG("{} is shorter than the checkpoint offset {}", path_, target.offset);
+        return false;
+    }
+    started_ = false;
+    offsets_.clear();
+    chunk_table_.clear();
+    chunk_records_ = 0;
+    bytes_ = 0;
+    if (target.offset > 0)
+    {
+        const char *data = map.Data();
+        if (target.offset < ARCHIVE_FILE_HEADER_SIZE || 0 != memcmp(data, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)))
+        {
+            ERRORLOG("{} is not an archive", path_);
+            return false;
+        }
+        chunk_blocks_ = LoadLe32(data + 12);
+        start_height_ = LoadLe64(data + 16);
+        started_ = true;
+        bytes_ = ARCHIVE_FILE_HEADER_SIZE;
+        while (bytes_ < target.offset)
+        {
+            uint64_t size = bytes_ + 4 <= target.offset ? 4 + (uint64_t)LoadLe32(data + bytes_) : 4;
+            if (bytes_ + size > target.offset)
+            {
+                ERRORLOG("checkpoint offset {} of {} is not on a record boundary", target.offset, path_);
+                return false;
+            }
+            AddRecord(data + bytes_, size);
+        }
+    }
+    map.Close();
+    return file_->Resume(target);
+}
@@ -0,0 +1,47 @@
+#ifndef _ARCHIVE_ARCHIVE_WRITER_H_
+#define _ARCHIVE_ARCHIVE_WRITER_H_
+
+#include "archive/archive_format.h"
+#include "db/raw_block.h"
+#include "export/block_sink.h"
+#include "export/pipeline.h"
+#include <vector>
+
+// Encodes one archive record, the u32 body size followed by the body
+bool EncodeArchiveRecord(const RawBlock &block, std::string &record);
+int EncodeArchiveBlock(RocksDBReadOnly &db, uint64_t height, std::string &record);
+PipelineStages ArchivePipelineStages();
+
+// Writes records for consecutive heights and appends the chunk table, index and footer on Close
+class ArchiveSink : public BlockSink
+{
+public:
+    // append keeps the existing content, for resuming
+    ArchiveSink(const std::string &path, uint32_t chunk_blocks, bool append = false, const WriterOptions &options = WriterOptions());
+    bool IsOpen() const;
+    bool Write(uint64_t height, const std::string &record) override;
+    bool Close() override;
+    bool Checkpoint(SinkPosition &position) override;
+    // Rebuilds the index and chunk checksums from the records before the position
+    bool Resume(const SinkPosition &position) override;
+
+private:
+    bool WriteFileHeader(uint64_t start_height);
+    void AddRecord(const char *data, size_t size);
+    void FinishChunk();
+
+    std::string path_;
+    uint32_t chunk_blocks_;
+    std::unique_ptr<FileSink> file_;
+    bool started_;
+    bool closed_;
+    uint64_t start_height_;
+    uint64_t bytes_;
+    std::vector<uint64_t> offsets_;
+    std::string chunk_table_;
+    uint64_t chunk_offset_;
+    uint32_t chunk_crc_;
+    uint32_t chunk_records_;
+};
+
+#endif
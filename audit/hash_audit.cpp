@@ -0,0 +1,168 @@
+#include "hash_audit.h"
+#include "db/columns.h"
+#include "db/raw_block.h"
+#include "log/logging.h"
+#include "molecule/block_molecule.h"
+#include "utils/crypto_utils.h"
+#include "utils/parallel_for.hpp"
+#include <iostream>
+#include <mutex>
+
+static const uint64_t AUDIT_BATCH = 256;
+
+static std::mutex report_mutex;
+
+static void ReportMismatch(uint64_t height, const std::string &what, std::string_view stored, std::string_view computed)
+{
+    std::lock_guard<std::mutex> lock(report_mutex);
+    std::cout << height << " " << what << " stored:" << Bytes2Hex(std::string(stored))
+              << " computed:" << Bytes2Hex(std::string(computed)) << std::endl;
+}
+
+static void ReportMissing(uint64_t height, const std::string &what)
+{
+    std::lock_guard<std::mutex> lock(report_mutex);
+    std::cout << height << " " << what << " missing" << std::endl;
+}
+
+static void CheckHash(uint64_t height, const std::string &what, std::string_view data, std::string_view stored, HashAuditStats &stats)
+{
+    uint8_t hash[CKB_HASH_SIZE];
+    Blake2b256(data.data(), data.size(), hash);
+    std::string_view computed((char *)hash, sizeof(hash));
+    if (stored != computed)
+    {
+        ++stats.mismatches;
+        ReportMismatch(height, what, stored, computed);
+    }
+}
+
+static int AuditBlock(RocksDBReadOnly &db, const RawBlock &block, HashAuditStats &stats)
+{
+    std::string_view hash;
+    std::string_view header;
+    if (!SplitHeaderView(block.header, hash, header))
+    {
+        return -3;
+    }
+    CheckHash(block.number, "header", header, hash, stats);
+    if (hash != block.hash)
+    {
+        ++stats.mismatches;
+        ReportMismatch(block.number, "index", block.hash, hash);
+    }
+    ++stats.headers;
+
+    std::string_view uncle_hashes;
+    std::string_view uncles;
+    std::vector<std::string_view> hashes;
+    std::vector<std::string_view> headers;
+    if (!SplitUncleBlockVecView(block.uncles, uncle_hashes, uncles) || !GetByte32VecItems(uncle_hashes, hashes) ||
+        !GetUncleHeaders(uncles, headers) || hashes.size() != headers.size())
+    {
+        return -3;
+    }
+    for (size_t i = 0; i < headers.size(); ++i)
+    {
+        CheckHash(block.number, "uncle " + std::to_string(i), headers[i], hashes[i], stats);
+        ++stats.headers;
+    }
+
+    rocksdb::Status status;
+    std::string value;
+    std::string_view tx_hash;
+    std::string_view witness_hash;
+    std::string_view transaction;
+    std::string_view raw;
+    std::string_view witnesses;
+    std::string_view data;
+    std::string_view data_hash;
+    for (size_t i = 0; i < block.transactions.size(); ++i)
+    {
+        if (!SplitTransactionView(block.transactions[i], tx_hash, witness_hash, transaction) || !SplitTransaction(transaction, raw, witnesses))
+        {
+            return -3;
+        }
+        CheckHash(block.number, "tx " + std::to_string(i), raw, tx_hash, stats);
+        CheckHash(block.number, "witness " + std::to_string(i), transaction, witness_hash, stats);
+        ++stats.transactions;
+
+        uint32_t outputs = 0;
+        if (!GetOutputCount(raw, outputs))
+        {
+            return -3;
+        }
+        for (uint32_t index = 0; index < outputs; ++index)
+        {
+            std::string key = CellKey(tx_hash, index);
+            if (!db.ReadData(COLUMN_CELL_DATA, key, value, status))
+            {
+                if (!status.IsNotFound())
+                {
+                    return -2;
+                }
+                // Spent cells leave both column families, a live cell always has a data entry
+                if (!db.ReadData(COLUMN_CELL, key, value, status))
+                {
+                    if (!status.IsNotFound())
+                    {
+                        return -2;
+                    }
+                    ++stats.spent;
+                    continue;
+                }
+                ++stats.missing;
+                ReportMissing(block.number, "cell data " + std::to_string(i) + ":" + std::to_string(index));
+                continue;
+            }
+            if (value.empty())
+            {
+                continue;
+            }
+            if (!SplitCellDataEntry(value, data, data_hash))
+            {
+                return -3;
+            }
+            CheckHash(block.number, "cell " + std::to_string(i) + ":" + std::to_string(index), data, data_hash, stats);
+            ++stats.cells;
+        }
+    }
+    ++stats.blocks;
+    return 0;
+}
+
+int AuditHashes(RocksDBReadOnly &db, uint64_t start, uint64_t end, uint32_t threads, HashAuditStats &stats)
+{
+    std::atomic<int> ret(0);
+    ParallelFor(start, end, AUDIT_BATCH, threads,
+                [&](uint64_t begin, uint64_t finish, uint32_t)
+                {
+                    rocksdb::Status status;
+                    RawBlock block;
+                    for (uint64_t height = begin; height < finish; ++height)
+                    {
+                        if (!ReadRawBlock(db, height, block, status))
+                        {
+                            ERRORLOG("read block {} failed", height);
+                            ret = -2;
+                            return false;
+                        }
+                        int code = AuditBlock(db, block, stats);
+                        if (0 != code)
+                        {
+                            ERRORLOG("audit block {} failed", height);
+                            ret = code;
+                            return false;
+                        }
+                    }
+                    return true;
+                });
+    std::cout << "blocks:" << stats.blocks << " headers:" << stats.headers << " transactions:" << stats.transactions
+              << " cells:" << stats.cells << " spent:" << stats.spent << " missing:" << stats.missing << " mismatches:" << stats.mismatches
+              << std::endl;
+    if (0 != ret)
+    {
+        return ret;
+    }
+    return 0 == stats.mismatches && 0 == stats.missing ? 0 : -5;
+}
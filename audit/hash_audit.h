@@ -0,0 +1,22 @@
+#ifndef _AUDIT_HASH_AUDIT_H_
+#define _AUDIT_HASH_AUDIT_H_
+
+#include "db/rocksdb_read_only.h"
+#include <atomic>
+
+struct HashAuditStats
+{
+    std::atomic<uint64_t> blocks{0};
+    std::atomic<uint64_t> headers{0};
+    std::atomic<uint64_t> transactions{0};
+    std::atomic<uint64_t> cells{0};
+    std::atomic<uint64_t> spent{0};   // outputs no longer in COLUMN_CELL
+    std::atomic<uint64_t> missing{0}; // live cells without a COLUMN_CELL_DATA entry
+    std::atomic<uint64_t> mismatches{0};
+};
+
+// Recomputes the header, uncle, transaction, witness and live cell data hashes of blocks [start, end)
+// and compares them with the stored ones, mismatches and live cells missing their data are printed to stdout
+int AuditHashes(RocksDBReadOnly &db, uint64_t start, uint64_t end, uint32_t threads, HashAuditStats &stats);
+
+#endif
@@ -0,0 +1,100 @@
+#include "root_audit.h"
+#include "db/raw_block.h"
+#include "log/logging.h"
+#include "molecule/block_molecule.h"
+#include "utils/cbmt.h"
+#include "utils/crypto_utils.h"
+#include "utils/parallel_for.hpp"
+#include <iostream>
+#include <mutex>
+
+static const uint64_t AUDIT_BATCH = 256;
+
+// Per worker buffers, kept across blocks so the steady state allocates nothing
+struct RootAuditContext
+{
+    RawBlock block;
+    std::vector<uint8_t> tx_hashes;
+    std::vector<uint8_t> witness_hashes;
+    std::vector<uint8_t> scratch;
+};
+
+static int AuditBlockRoot(RootAuditContext &context, RootAuditStats &stats)
+{
+    const RawBlock &block = context.block;
+    std::string_view hash;
+    std::string_view header;
+    std::string_view expected;
+    if (!SplitHeaderView(block.header, hash, header) || !GetTransactionsRoot(header, expected))
+    {
+        return -3;
+    }
+
+    size_t count = block.transactions.size();
+    context.tx_hashes.resize(count * CKB_HASH_SIZE);
+    context.witness_hashes.resize(count * CKB_HASH_SIZE);
+    std::string_view tx_hash;
+    std::string_view witness_hash;
+    std::string_view transaction;
+    std::string_view raw;
+    std::string_view witnesses;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!SplitTransactionView(block.transactions[i], tx_hash, witness_hash, transaction) || !SplitTransaction(transaction, raw, witnesses))
+        {
+            return -3;
+        }
+        Blake2b256(raw.data(), raw.size(), context.tx_hashes.data() + i * CKB_HASH_SIZE);
+        Blake2b256(transaction.data(), transaction.size(), context.witness_hashes.data() + i * CKB_HASH_SIZE);
+    }
+
+    uint8_t root[CKB_HASH_SIZE];
+    CalcTransactionsRoot(context.tx_hashes.data(), context.witness_hashes.data(), count, root, context.scratch);
+    std::string_view computed((char *)root, sizeof(root));
+    if (computed != expected)
+    {
+        static std::mutex mutex;
+        std::lock_guard<std::mutex> lock(mutex);
+        ++stats.mismatches;
+        std::cout << block.number << " transactions_root stored:" << Bytes2Hex(std::string(expected))
+                  << " computed:" << Bytes2Hex(std::string(computed)) << std::endl;
+    }
+    stats.transactions += count;
+    ++stats.blocks;
+    return 0;
+}
+
+int AuditTransactionsRoot(RocksDBReadOnly &db, uint64_t start, uint64_t end, uint32_t threads, RootAuditStats &stats)
+{
+    std::vector<RootAuditContext> contexts(std::max<uint32_t>(threads, 1));
+    std::atomic<int> ret(0);
+    ParallelFor(start, end, AUDIT_BATCH, contexts.size(),
+                [&](uint64_t begin, uint64_t finish, uint32_t worker)
+                {
+                    RootAuditContext &context = contexts[worker];
+                    rocksdb::Status status;
+                    for (uint64_t height = begin; height < finish; ++height)
+                    {
+                        if (!ReadRawBlock(db, height, context.block, status))
+                        {
+                            ERRORLOG("read block {} failed", height);
+                            ret = -2;
+                            return false;
+                        }
+                        int code = AuditBlockRoot(context, stats);
+                        if (0 != code)
+                        {
+                            ERRORLOG("audit block {} failed", height);
+                            ret = code;
+                            return false;
+                        }
+                    }
+                    return true;
+                });
+    std::cout << "blocks:" << stats.blocks << " transactions:" << stats.transactions << " mismatches:" << stats.mismatches << std::endl;
+    if (0 != ret)
+    {
+        return ret;
+    }
+    return 0 == stats.mismatches ? 0 : -5;
+}
@@ -0,0 +1,18 @@
+#ifndef _AUDIT_ROOT_AUDIT_H_
+#define _AUDIT_ROOT_AUDIT_H_
+
+#include "db/rocksdb_read_only.h"
+#include <atomic>
+
+struct RootAuditStats
+{
+    std::atomic<uint64_t> blocks{0};
+    std::atomic<uint64_t> transactions{0};
+    std::atomic<uint64_t> mismatches{0};
+};
+
+// Recomputes transactions_root of blocks [start, end) from the transaction bodies and
+// compares it with the header, mismatches are printed to stdout
+int AuditTransactionsRoot(RocksDBReadOnly &db, uint64_t start, uint64_t end, uint32_t threads, RootAuditStats &stats);
+
+#endif
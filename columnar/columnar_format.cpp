@@ -0,0 +1,109 @@
+#include "columnar_format.h"
+#include "utils/varint.h"
+
+static void PutBytes(std::string &out, std::string_view bytes)
+{
+    PutVarint64(out, bytes.size());
+    out.append(bytes.data(), bytes.size());
+}
+
+static bool GetBytes(const char *&p, const char *end, std::string &bytes)
+{
+    uint64_t size = 0;
+    if (!GetVarint64(p, end, size) || size > (uint64_t)(end - p))
+    {
+        return false;
+    }
+    bytes.assign(p, size);
+    p += size;
+    return true;
+}
+
+void EncodeColumnarMeta(const ColumnarFileMeta &meta, std::string &out)
+{
+    out.clear();
+    PutBytes(out, meta.table);
+    PutVarint64(out, meta.rows);
+    PutVarint64(out, meta.columns.size());
+    for (auto &column : meta.columns)
+    {
+        PutBytes(out, column.name);
+        out.push_back((char)column.type);
+    }
+    PutVarint64(out, meta.row_groups.size());
+    for (auto &group : meta.row_groups)
+    {
+        PutVarint64(out, group.rows);
+        for (size_t i = 0; i < meta.columns.size(); ++i)
+        {
+            const ColumnChunkMeta &chunk = group.columns[i];
+            PutVarint64(out, chunk.offset);
+            PutVarint64(out, chunk.size);
+            out.push_back((char)chunk.encoding);
+            if (COLUMNAR_UINT64 == meta.columns[i].type)
+            {
+                PutVarint64(out, chunk.min_value);
+                PutVarint64(out, chunk.max_value);
+            }
+            else
+            {
+                PutBytes(out, chunk.min_bytes);
+                PutBytes(out, chunk.max_bytes);
+            }
+        }
+    }
+}
+
+bool DecodeColumnarMeta(std::string_view data, ColumnarFileMeta &meta)
+{
+    const char *p = data.data();
+    const char *end = p + data.size();
+    uint64_t count = 0;
+    if (!GetBytes(p, end, meta.table) || !GetVarint64(p, end, meta.rows) || !GetVarint64(p, end, count) || count > data.size())
+    {
+        return false;
+    }
+    meta.columns.resize(count);
+    for (auto &column : meta.columns)
+    {
+        if (!GetBytes(p, end, column.name) || p >= end)
+        {
+            return false;
+        }
+        column.type = (ColumnarType)*p++;
+        if (COLUMNAR_UINT64 != column.type && COLUMNAR_BYTES != column.type)
+        {
+            return false;
+        }
+    }
+    if (!GetVarint64(p, end, count) || count > data.size())
+    {
+        return false;
+    }
+    meta.row_groups.resize(count);
+    for (auto &group : meta.row_groups)
+    {
+        if (!GetVarint64(p, end, group.rows))
+        {
+            return false;
+        }
+        group.columns.resize(meta.columns.size());
+        for (size_t i = 0; i < meta.columns.size(); ++i)
+        {
+            ColumnChunkMeta &chunk = group.columns[i];
+            if (!GetVarint64(p, end, chunk.offset) || !GetVarint64(p, end, chunk.size) || p >= end)
+            {
+                return false;
+            }
+            chunk.encoding = *p++;
+            bool ok = COLUMNAR_UINT64 == meta.columns[i].type
+                          ? GetVarint64(p, end, chunk.min_value) && GetVarint64(p, end, chunk.max_value)
+                          : GetBytes(p, end, chunk.min_bytes) && GetBytes(p, end, chunk.max_bytes);
+            if (!ok)
+            {
+                return false;
+            }
+        }
+    }
+    return p == end;
+}
@@ -0,0 +1,71 @@
+#ifndef _COLUMNAR_COLUMNAR_FORMAT_H_
+#define _COLUMNAR_COLUMNAR_FORMAT_H_
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// .ckbc columnar file
+//
+//   magic "CKBCOL1\0"
+//   column chunks   row group by row group, column by column
+//   metadata        table, schema, and per row group and column: offset, size, encoding, zone map
+//   u32 metadata size, magic "CKBCOL1\0"
+//
+// uint64 columns are delta encoded: zigzag varints of the difference to the previous row.
+// bytes columns use a per chunk dictionary (varint count, varint length + bytes per entry,
+// varint index per row) unless most values are distinct, then plain varint length + bytes.
+
+const char COLUMNAR_MAGIC[8] = {'C', 'K', 'B', 'C', 'O', 'L', '1', '\0'};
+const uint64_t COLUMNAR_DEFAULT_ROW_GROUP_ROWS = 65536;
+
+enum ColumnarType : uint8_t
+{
+    COLUMNAR_UINT64 = 1,
+    COLUMNAR_BYTES = 2,
+};
+
+enum ColumnarEncoding : uint8_t
+{
+    ENCODING_DELTA = 1,
+    ENCODING_PLAIN = 2,
+    ENCODING_DICTIONARY = 3,
+};
+
+struct ColumnSpec
+{
+    std::string name;
+    ColumnarType type;
+};
+
+struct ColumnChunkMeta
+{
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    uint8_t encoding = 0;
+    // Zone map, the uint64 bounds for uint64 columns and the bytes bounds for bytes columns
+    uint64_t min_value = 0;
+    uint64_t max_value = 0;
+    std::string min_bytes;
+    std::string max_bytes;
+};
+
+struct RowGroupMeta
+{
+    uint64_t rows = 0;
+    std::vector<ColumnChunkMeta> columns;
+};
+
+struct ColumnarFileMeta
+{
+    std::string table;
+    std::vector<ColumnSpec> columns;
+    std::vector<RowGroupMeta> row_groups;
+    uint64_t rows = 0;
+};
+
+void EncodeColumnarMeta(const ColumnarFileMeta &meta, std::string &out);
+bool DecodeColumnarMeta(std::string_view data, ColumnarFileMeta &meta);
+
+#endif
@@ -0,0 +1,317 @@
+#include "columnar_reader.h"
+#include "log/logging.h"
+#include "utils/varint.h"
+#include <algorithm>
+#include <endian.h>
+#include <filesystem>
+#include <string.h>
+
+namespace fs = std::filesystem;
+
+bool ColumnarReader::Open(const std::string &path)
+{
+    path_ = path;
+    if (!file_.Open(path))
+    {
+        return false;
+    }
+    const char *data = file_.Data();
+    size_t size = file_.Size();
+    size_t tail = sizeof(uint32_t) + sizeof(COLUMNAR_MAGIC);
+    if (size < sizeof(COLUMNAR_MAGIC) + tail || 0 != memcmp(data, COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC)) ||
+        0 != memcmp(data + size - sizeof(COLUMNAR_MAGIC), COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC)))
+    {
+        ERRORLOG("{} is not a columnar file", path);
+        return false;
+    }
+    uint32_t meta_size;
+    memcpy(&meta_size, data + size - tail, sizeof(meta_size));
+    meta_size = le32toh(meta_size);
+    if (meta_size > size - tail - sizeof(COLUMNAR_MAGIC) ||
+        !DecodeColumnarMeta(std::string_view(data + size - tail - meta_size, meta_size), meta_))
+    {
+        ERRORLOG("{} has broken metadata", path);
+        return false;
+    }
+    uint64_t data_end = size - tail - meta_size;
+    for (auto &group : meta_.row_groups)
+    {
+        for (auto &chunk : group.columns)
+        {
+            if (chunk.offset < sizeof(COLUMNAR_MAGIC) || chunk.offset + chunk.size > data_end)
+            {
+                ERRORLOG("{} has a column chunk out of range", path);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int ColumnarReader::ColumnIndex(const std::string &name) const
+{
+    for (size_t i = 0; i < meta_.columns.size(); ++i)
+    {
+        if (meta_.columns[i].name == name)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool ColumnarReader::DecodeColumn(const ColumnChunkMeta &chunk, ColumnarType type, uint64_t rows, ColumnData &data) const
+{
+    const char *p = file_.Data() + chunk.offset;
+    const char *end = p + chunk.size;
+    data.type = type;
+    data.uints.clear();
+    data.bytes.clear();
+    uint64_t value = 0;
+    if (COLUMNAR_UINT64 == type)
+    {
+        data.uints.resize(rows);
+        uint64_t previous = 0;
+        for (uint64_t i = 0; i < rows; ++i)
+        {
+            if (!GetVarint64(p, end, value))
+            {
+                return false;
+            }
+            previous += (uint64_t)ZigZagDecode(value);
+            data.uints[i] = previous;
+        }
+        return true;
+    }
+
+    data.bytes.resize(rows);
+    if (ENCODING_PLAIN == chunk.encoding)
+    {
+        for (uint64_t i = 0; i < rows; ++i)
+        {
+            if (!GetVarint64(p, end, value) || value > (uint64_t)(end - p))
+            {
+                return false;
+            }
+            data.bytes[i] = std::string_view(p, value);
+            p += value;
+        }
+        return true;
+    }
+    thread_local std::vector<std::string_view> entries;
+    uint64_t count = 0;
+    if (ENCODING_DICTIONARY != chunk.encoding || !GetVarint64(p, end, count) || count > chunk.size)
+    {
+        return false;
+    }
+    entries.resize(count);
+    for (auto &entry : entries)
+    {
+        if (!GetVarint64(p, end, value) || value > (uint64_t)(end - p))
+        {
+            return false;
+        }
+        entry = std::string_view(p, value);
+        p += value;
+    }
+    for (uint64_t i = 0; i < rows; ++i)
+    {
+        if (!GetVarint64(p, end, value) || value >= count)
+        {
+            return false;
+        }
+        data.bytes[i] = entries[value];
+    }
+    return true;
+}
+
+// Whether the dictionary of a chunk holds the value, reading only the dictionary
+static bool DictionaryContains(const char *p, const char *end, const std::string &target)
+{
+    uint64_t count = 0;
+    uint64_t size = 0;
+    if (!GetVarint64(p, end, count))
+    {
+        return true;
+    }
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        if (!GetVarint64(p, end, size) || size > (uint64_t)(end - p))
+        {
+            return true;
+        }
+        if (size == target.size() && 0 == memcmp(p, target.data(), size))
+        {
+            return true;
+        }
+        p += size;
+    }
+    return false;
+}
+
+bool ColumnarReader::Scan(const std::vector<std::string> &projection, const std::vector<ColumnPredicate> &predicates,
+                          const ColumnarScanFunc &func, ColumnarScanStats &stats) const
+{
+    std::vector<int> projected;
+    for (auto &name : projection)
+    {
+        projected.push_back(ColumnIndex(name));
+        if (projected.back() < 0)
+        {
+            ERRORLOG("{} has no column {}", path_, name);
+            return false;
+        }
+    }
+    std::vector<int> filtered;
+    for (auto &predicate : predicates)
+    {
+        filtered.push_back(ColumnIndex(predicate.column));
+        if (filtered.back() < 0 || (predicate.has_value != (COLUMNAR_BYTES == meta_.columns[filtered.back()].type)))
+        {
+            ERRORLOG("{} can not filter column {}", path_, predicate.column);
+            return false;
+        }
+    }
+
+    std::vector<ColumnData> decoded(meta_.columns.size());
+    std::vector<bool> is_decoded(meta_.columns.size());
+    std::vector<const ColumnData *> columns(projected.size());
+    std::vector<uint32_t> rows;
+    for (auto &group : meta_.row_groups)
+    {
+        ++stats.row_groups;
+        bool skip = false;
+        for (size_t i = 0; i < predicates.size() && !skip; ++i)
+        {
+            const ColumnPredicate &predicate = predicates[i];
+            const ColumnChunkMeta &chunk = group.columns[filtered[i]];
+            if (!predicate.has_value)
+            {
+                skip = chunk.max_value < predicate.min || chunk.min_value > predicate.max;
+            }
+            else
+            {
+                skip = predicate.value < chunk.min_bytes || predicate.value > chunk.max_bytes;
+                if (!skip && ENCODING_DICTIONARY == chunk.encoding)
+                {
+                    const char *p = file_.Data() + chunk.offset;
+                    skip = !DictionaryContains(p, p + chunk.size, predicate.value);
+                }
+            }
+        }
+        if (skip)
+        {
+            ++stats.row_groups_skipped;
+            continue;
+        }
+
+        std::fill(is_decoded.begin(), is_decoded.end(), false);
+        auto decode = [&](int index) -> bool
+        {
+            if (is_decoded[index])
+            {
+                return true;
+            }
+            is_decoded[index] = true;
+            stats.bytes_decoded += group.columns[index].size;
+            return DecodeColumn(group.columns[index], meta_.columns[index].type, group.rows, decoded[index]);
+        };
+
+        rows.resize(group.rows);
+        for (uint32_t i = 0; i < group.rows; ++i)
+        {
+            rows[i] = i;
+        }
+        for (size_t i = 0; i < predicates.size() && !rows.empty(); ++i)
+        {
+            if (!decode(filtered[i]))
+            {
+                ERRORLOG("{} column {} is corrupted", path_, predicates[i].column);
+                return false;
+            }
+            const ColumnData &data = decoded[filtered[i]];
+            const ColumnPredicate &predicate = predicates[i];
+            auto last = std::remove_if(rows.begin(), rows.end(), [&](uint32_t row)
+                                       { return predicate.has_value ? data.bytes[row] != predicate.value
+                                                                    : data.uints[row] < predicate.min || data.uints[row] > predicate.max; });
+            rows.erase(last, rows.end());
+        }
+        if (rows.empty())
+        {
+            continue;
+        }
+        for (size_t i = 0; i < projected.size(); ++i)
+        {
+            if (!decode(projected[i]))
+            {
+                ERRORLOG("{} column {} is corrupted", path_, projection[i]);
+                return false;
+            }
+            columns[i] = &decoded[projected[i]];
+        }
+        stats.rows_matched += rows.size();
+        if (!func(columns, rows))
+        {
+            stats.stopped = true;
+            return true;
+        }
+    }
+    return true;
+}
+
+std::string ColumnarPartitionDir(const std::string &dir, const std::string &table, uint64_t epoch)
+{
+    return dir + "/" + table + "/epoch=" + std::to_string(epoch);
+}
+
+bool ScanColumnarDataset(const std::string &dir, const std::string &table, uint64_t min_epoch, uint64_t max_epoch,
+                         const std::vector<std::string> &projection, const std::vector<ColumnPredicate> &predicates,
+                         const ColumnarScanFunc &func, ColumnarScanStats &stats)
+{
+    std::error_code ec;
+    std::vector<std::pair<uint64_t, std::string>> partitions;
+    for (auto &entry : fs::directory_iterator(dir + "/" + table, ec))
+    {
+        std::string name = entry.path().filename().string();
+        if (0 != name.compare(0, 6, "epoch="))
+        {
+            continue;
+        }
+        uint64_t epoch = strtoull(name.c_str() + 6, nullptr, 10);
+        if (epoch >= min_epoch && epoch <= max_epoch)
+        {
+            partitions.emplace_back(epoch, entry.path().string());
+        }
+    }
+    if (ec)
+    {
+        ERRORLOG("list {}/{} failed:{}", dir, table, ec.message());
+        return false;
+    }
+    std::sort(partitions.begin(), partitions.end());
+    for (auto &partition : partitions)
+    {
+        std::vector<std::string> files;
+        for (auto &entry : fs::directory_iterator(partition.second, ec))
+        {
+            if (".ckbc" == entry.path().extension().string())
+            {
+                files.push_back(entry.path().string());
+            }
+        }
+        std::sort(files.begin(), files.end());
+        for (auto &file : files)
+        {
+            ColumnarReader reader;
+            if (!reader.Open(file) || !reader.Scan(projection, predicates, func, stats))
+            {
+                return false;
+            }
+            if (stats.stopped)
+            {
+                return true;
+            }
+        }
+    }
+    return true;
+}
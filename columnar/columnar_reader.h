@@ -0,0 +1,64 @@
+#ifndef _COLUMNAR_COLUMNAR_READER_H_
+#define _COLUMNAR_COLUMNAR_READER_H_
+
+#include "columnar/columnar_format.h"
+#include "utils/mmap_file.h"
+#include <functional>
+
+// A uint64 range [min, max] or, when has_value is set, equality on a bytes column
+struct ColumnPredicate
+{
+    std::string column;
+    uint64_t min = 0;
+    uint64_t max = UINT64_MAX;
+    bool has_value = false;
+    std::string value;
+};
+
+// One decoded column chunk, bytes point into the mapping
+struct ColumnData
+{
+    ColumnarType type = COLUMNAR_UINT64;
+    std::vector<uint64_t> uints;
+    std::vector<std::string_view> bytes;
+};
+
+struct ColumnarScanStats
+{
+    uint64_t row_groups = 0;
+    uint64_t row_groups_skipped = 0;
+    uint64_t rows_matched = 0;
+    uint64_t bytes_decoded = 0;
+    bool stopped = false; // the callback asked to stop
+};
+
+// columns follow the projection order, rows lists the matching row numbers of the group.
+// Returning false stops the scan.
+typedef std::function<bool(const std::vector<const ColumnData *> &columns, const std::vector<uint32_t> &rows)> ColumnarScanFunc;
+
+class ColumnarReader
+{
+public:
+    bool Open(const std::string &path);
+    const ColumnarFileMeta &Meta() const { return meta_; }
+    int ColumnIndex(const std::string &name) const;
+    // Row groups whose zone maps or dictionaries rule out a predicate are skipped without
+    // decoding, and only the projected and predicate columns are ever touched
+    bool Scan(const std::vector<std::string> &projection, const std::vector<ColumnPredicate> &predicates,
+              const ColumnarScanFunc &func, ColumnarScanStats &stats) const;
+
+private:
+    bool DecodeColumn(const ColumnChunkMeta &chunk, ColumnarType type, uint64_t rows, ColumnData &data) const;
+    std::string path_;
+    MmapFile file_;
+    ColumnarFileMeta meta_;
+};
+
+// Hive style layout "<dir>/<table>/epoch=<n>/part-<first height>.ckbc"
+std::string ColumnarPartitionDir(const std::string &dir, const std::string &table, uint64_t epoch);
+// Scans the partitions of epochs in [min_epoch, max_epoch], the others are never opened
+bool ScanColumnarDataset(const std::string &dir, const std::string &table, uint64_t min_epoch, uint64_t max_epoch,
+                         const std::vector<std::string> &projection, const std::vector<ColumnPredicate> &predicates,
+                         const ColumnarScanFunc &func, ColumnarScanStats &stats);
+
+#endif
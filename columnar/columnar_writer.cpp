@@ -0,0 +1,157 @@
+#include "columnar_writer.h"
+#include "log/logging.h"
+#include "utils/varint.h"
+#include <algorithm>
+#include <endian.h>
+#include <unordered_map>
+
+ColumnarWriter::ColumnarWriter(const std::string &path, const std::string &table, const std::vector<ColumnSpec> &columns,
+                               uint64_t row_group_rows)
+    : path_(path), file_(path), row_group_rows_(std::max<uint64_t>(row_group_rows, 1)), uints_(columns.size()),
+      bytes_(columns.size()), buffered_rows_(0), offset_(0), closed_(false)
+{
+    meta_.table = table;
+    meta_.columns = columns;
+    if (file_.IsOpen() && file_.Write(0, std::string(COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC))))
+    {
+        offset_ = sizeof(COLUMNAR_MAGIC);
+    }
+}
+
+bool ColumnarWriter::IsOpen() const
+{
+    return file_.IsOpen() && offset_ > 0;
+}
+
+bool ColumnarWriter::EndRow()
+{
+    if (++buffered_rows_ >= row_group_rows_)
+    {
+        return FlushRowGroup();
+    }
+    return true;
+}
+
+void ColumnarWriter::EncodeUint64Column(const std::vector<uint64_t> &values, std::string &out, ColumnChunkMeta &chunk)
+{
+    chunk.encoding = ENCODING_DELTA;
+    chunk.min_value = UINT64_MAX;
+    chunk.max_value = 0;
+    uint64_t previous = 0;
+    for (uint64_t value : values)
+    {
+        PutVarint64(out, ZigZagEncode((int64_t)(value - previous)));
+        previous = value;
+        chunk.min_value = std::min(chunk.min_value, value);
+        chunk.max_value = std::max(chunk.max_value, value);
+    }
+}
+
+void ColumnarWriter::EncodeBytesColumn(const std::vector<std::string> &values, std::string &out, ColumnChunkMeta &chunk)
+{
+    auto bounds = std::minmax_element(values.begin(), values.end());
+    chunk.min_bytes = *bounds.first;
+    chunk.max_bytes = *bounds.second;
+
+    std::unordered_map<std::string_view, uint32_t> dictionary;
+    std::vector<std::string_view> entries;
+    for (auto &value : values)
+    {
+        if (dictionary.emplace(value, entries.size()).second)
+        {
+            entries.push_back(value);
+            // Mostly distinct values, e.g. transaction hashes, are cheaper without a dictionary
+            if (entries.size() > values.size() / 2 + 1)
+            {
+                break;
+            }
+        }
+    }
+    if (entries.size() > values.size() / 2 + 1)
+    {
+        chunk.encoding = ENCODING_PLAIN;
+        for (auto &value : values)
+        {
+            PutVarint64(out, value.size());
+            out.append(value);
+        }
+        return;
+    }
+    chunk.encoding = ENCODING_DICTIONARY;
+    PutVarint64(out, entries.size());
+    for (auto &entry : entries)
+    {
+        PutVarint64(out, entry.size());
+        out.append(entry.data(), entry.size());
+    }
+    for (auto &value : values)
+    {
+        PutVarint64(out, dictionary[value]);
+    }
+}
+
+bool ColumnarWriter::FlushRowGroup()
+{
+    if (0 == buffered_rows_)
+    {
+        return true;
+    }
+    RowGroupMeta group;
+    group.rows = buffered_rows_;
+    group.columns.resize(meta_.columns.size());
+    for (size_t i = 0; i < meta_.columns.size(); ++i)
+    {
+        bool is_uint = COLUMNAR_UINT64 == meta_.columns[i].type;
+        if ((is_uint ? uints_[i].size() : bytes_[i].size()) != buffered_rows_)
+        {
+            ERRORLOG("{} column {} has a missing value", path_, meta_.columns[i].name);
+            return false;
+        }
+        chunk_.clear();
+        if (is_uint)
+        {
+            EncodeUint64Column(uints_[i], chunk_, group.columns[i]);
+            uints_[i].clear();
+        }
+        else
+        {
+            EncodeBytesColumn(bytes_[i], chunk_, group.columns[i]);
+            bytes_[i].clear();
+        }
+        group.columns[i].offset = offset_;
+        group.columns[i].size = chunk_.size();
+        if (!file_.Write(meta_.rows, chunk_))
+        {
+            return false;
+        }
+        offset_ += chunk_.size();
+    }
+    meta_.rows += buffered_rows_;
+    meta_.row_groups.push_back(std::move(group));
+    buffered_rows_ = 0;
+    return true;
+}
+
+bool ColumnarWriter::Close()
+{
+    if (closed_)
+    {
+        return true;
+    }
+    closed_ = true;
+    if (!IsOpen() || !FlushRowGroup())
+    {
+        return false;
+    }
+    std::string tail;
+    EncodeColumnarMeta(meta_, tail);
+    uint32_t size = htole32(tail.size());
+    tail.append((char *)&size, sizeof(size));
+    tail.append(COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC));
+    if (!file_.Write(meta_.rows, tail) || !file_.Close())
+    {
+        ERRORLOG("finish {} failed", path_);
+        return false;
+    }
+    return true;
+}
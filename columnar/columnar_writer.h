@@ -0,0 +1,38 @@
+#ifndef _COLUMNAR_COLUMNAR_WRITER_H_
+#define _COLUMNAR_COLUMNAR_WRITER_H_
+
+#include "columnar/columnar_format.h"
+#include "export/block_sink.h"
+
+// Buffers rows column by column and writes a row group every row_group_rows rows
+class ColumnarWriter
+{
+public:
+    ColumnarWriter(const std::string &path, const std::string &table, const std::vector<ColumnSpec> &columns,
+                   uint64_t row_group_rows = COLUMNAR_DEFAULT_ROW_GROUP_ROWS);
+    bool IsOpen() const;
+    // Every column of a row is set exactly once before EndRow
+    void SetUint64(size_t column, uint64_t value) { uints_[column].push_back(value); }
+    void SetBytes(size_t column, std::string_view value) { bytes_[column].emplace_back(value); }
+    bool EndRow();
+    bool Close();
+    uint64_t Rows() const { return meta_.rows + buffered_rows_; }
+
+private:
+    bool FlushRowGroup();
+    void EncodeUint64Column(const std::vector<uint64_t> &values, std::string &out, ColumnChunkMeta &chunk);
+    void EncodeBytesColumn(const std::vector<std::string> &values, std::string &out, ColumnChunkMeta &chunk);
+
+    std::string path_;
+    FileSink file_;
+    uint64_t row_group_rows_;
+    ColumnarFileMeta meta_;
+    std::vector<std::vector<uint64_t>> uints_;
+    std::vector<std::vector<std::string>> bytes_;
+    uint64_t buffered_rows_;
+    uint64_t offset_;
+    std::string chunk_;
+    bool closed_;
+};
+
+#endif
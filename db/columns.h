@@ -0,0 +1,23 @@
+#ifndef _DB_COLUMNS_H_
+#define _DB_COLUMNS_H_
+
+#include <string>
+
+const std::string COLUMN_INDEX = "0";               // 链索引
+const std::string COLUMN_BLOCK_HEADER = "1";        // 块头
+const std::string COLUMN_BLOCK_BODY = "2";          // 交易体
+const std::string COLUMN_BLOCK_UNCLE = "3";         // store block's uncle and uncles’ proposal zones
+const std::string COLUMN_META = "4";                // store meta data
+const std::string COLUMN_TRANSACTION_INFO = "5";    // 交易扩展信息
+const std::string COLUMN_BLOCK_EXT = "6";           // 区块扩展信息
+const std::string COLUMN_BLOCK_PROPOSAL_IDS = "7";  // store block's proposal ids
+const std::string COLUMN_BLOCK_EPOCH = "8";         // store indicates track block epoch
+const std::string COLUMN_EPOCH = "9";               // store indicates track block epoch
+const std::string COLUMN_CELL = "10";               // store cell
+const std::string COLUMN_UNCLES = "11";             // store main chain consensus include uncles
+const std::string COLUMN_CELL_DATA = "12";          // store cell data
+const std::string COLUMN_NUMBER_HASH = "13";        // store block number-hash pair
+const std::string COLUMN_CELL_DATA_HASH = "14";     // store cell data hash
+const std::string COLUMN_BLOCK_EXTENSION = "15";    // 区块扩展数据
+
+#endif
@@ -0,0 +1,157 @@
+#include "raw_block.h"
+#include "db/columns.h"
+#include "log/logging.h"
+#include <endian.h>
+#include <string.h>
+
+// TransactionInfo: struct { block_number, block_epoch, key: TransactionKey { block_hash, index: BeUint32 } },
+// the key is the COLUMN_BLOCK_BODY key of the transaction
+static const size_t TRANSACTION_INFO_SIZE = 52;
+static const size_t TRANSACTION_KEY_OFFSET = 16;
+static const size_t TRANSACTION_KEY_SIZE = 36;
+
+void RawBlock::Clear()
+{
+    number = 0;
+    hash.clear();
+    header.clear();
+    uncles.clear();
+    transactions.clear();
+    proposals.clear();
+    extension.clear();
+    has_extension = false;
+    transaction_indexes.clear();
+}
+
+size_t RawBlock::ByteSize() const
+{
+    size_t size = hash.size() + header.size() + uncles.size() + proposals.size() + extension.size();
+    for (auto &transaction : transactions)
+    {
+        size += transaction.size();
+    }
+    return size;
+}
+
+std::string NumberKey(uint64_t number)
+{
+    return std::string((char *)&number, sizeof(number));
+}
+
+std::string CellKey(std::string_view tx_hash, uint32_t index)
+{
+    index = htobe32(index);
+    return std::string(tx_hash) + std::string((char *)&index, sizeof(index));
+}
+
+void CellKeyToOutPoint(const char *key, char *out_point)
+{
+    uint32_t index;
+    memcpy(out_point, key, 32);
+    memcpy(&index, key + 32, sizeof(index));
+    index = htole32(be32toh(index));
+    memcpy(out_point + 32, &index, sizeof(index));
+}
+
+bool ReadBlockHash(RocksDBReadOnly &db, uint64_t number, std::string &hash, rocksdb::Status &status)
+{
+    return db.ReadData(COLUMN_INDEX, NumberKey(number), hash, status);
+}
+
+bool ReadTransactionCount(RocksDBReadOnly &db, uint64_t number, const std::string &hash, uint32_t &count, rocksdb::Status &status)
+{
+    std::string value;
+    if (!db.ReadData(COLUMN_NUMBER_HASH, NumberKey(number) + hash, value, status))
+    {
+        return false;
+    }
+    if (value.size() != sizeof(count))
+    {
+        ERRORLOG("number hash value size error:{}", value.size());
+        return false;
+    }
+    memcpy(&count, value.data(), sizeof(count));
+    return true;
+}
+
+bool ReadTipHeader(RocksDBReadOnly &db, std::string &hash, uint64_t &number, rocksdb::Status &status)
+{
+    if (!db.ReadData(COLUMN_META, "TIP_HEADER", hash, status))
+    {
+        return false;
+    }
+    std::string header;
+    if (!db.ReadData(COLUMN_BLOCK_HEADER, hash, header, status))
+    {
+        return false;
+    }
+    // HeaderView is the 32 byte hash followed by the packed Header, number at offset 16
+    if (header.size() < 32 + 16 + sizeof(number))
+    {
+        ERRORLOG("tip header size error:{}", header.size());
+        return false;
+    }
+    memcpy(&number, header.data() + 32 + 16, sizeof(number));
+    number = le64toh(number);
+    return true;
+}
+
+bool ReadRawBlock(RocksDBReadOnly &db, uint64_t number, RawBlock &block, rocksdb::Status &status)
+{
+    block.Clear();
+    block.number = number;
+    if (!ReadBlockHash(db, number, block.hash, status))
+    {
+        return false;
+    }
+    if (!db.ReadData(COLUMN_BLOCK_HEADER, block.hash, block.header, status))
+    {
+        return false;
+    }
+    if (!db.ReadData(COLUMN_BLOCK_UNCLE, block.hash, block.uncles, status))
+    {
+        return false;
+    }
+    uint32_t txs_len = 0;
+    if (!ReadTransactionCount(db, number, block.hash, txs_len, status))
+    {
+        return false;
+    }
+    block.transactions.resize(txs_len);
+    for (uint32_t i = 0; i < txs_len; ++i)
+    {
+        uint32_t index = htobe32(i);
+        if (!db.ReadData(COLUMN_BLOCK_BODY, block.hash + std::string((char *)&index, sizeof(index)), block.transactions[i], status))
+        {
+            return false;
+        }
+    }
+    if (!db.ReadData(COLUMN_BLOCK_PROPOSAL_IDS, block.hash, block.proposals, status))
+    {
+        return false;
+    }
+    // older databases have no extension column family, treat it as not found
+    status = rocksdb::Status::NotFound();
+    block.has_extension = db.ReadData(COLUMN_BLOCK_EXTENSION, block.hash, block.extension, status);
+    if (!block.has_extension && !status.IsNotFound())
+    {
+        return false;
+    }
+    status = rocksdb::Status::OK();
+    return true;
+}
+
+bool ReadTransactionView(RocksDBReadOnly &db, std::string_view tx_hash, std::string &view, rocksdb::Status &status)
+{
+    std::string info;
+    if (!db.ReadData(COLUMN_TRANSACTION_INFO, std::string(tx_hash), info, status))
+    {
+        return false;
+    }
+    if (TRANSACTION_INFO_SIZE != info.size())
+    {
+        ERRORLOG("transaction info size error:{}", info.size());
+        return false;
+    }
+    return db.ReadData(COLUMN_BLOCK_BODY, info.substr(TRANSACTION_KEY_OFFSET, TRANSACTION_KEY_SIZE), view, status);
+}
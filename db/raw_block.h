@@ -0,0 +1,41 @@
+#ifndef _DB_RAW_BLOCK_H_
+#define _DB_RAW_BLOCK_H_
+
+#include "db/rocksdb_read_only.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Undecoded column family values of one main chain block
+struct RawBlock
+{
+    uint64_t number = 0;
+    std::string hash;                      // COLUMN_INDEX value
+    std::string header;                    // COLUMN_BLOCK_HEADER value (HeaderView)
+    std::string uncles;                    // COLUMN_BLOCK_UNCLE value (UncleBlockVecView)
+    std::vector<std::string> transactions; // COLUMN_BLOCK_BODY values (TransactionView)
+    std::string proposals;                 // COLUMN_BLOCK_PROPOSAL_IDS value
+    std::string extension;                 // COLUMN_BLOCK_EXTENSION value
+    bool has_extension = false;
+    std::vector<uint32_t> transaction_indexes; // positions in the block when transactions were filtered out
+
+    void Clear();
+    size_t ByteSize() const;
+    uint32_t TransactionIndex(size_t i) const { return transaction_indexes.empty() ? i : transaction_indexes[i]; }
+};
+
+std::string NumberKey(uint64_t number);
+// COLUMN_CELL and COLUMN_CELL_DATA key of an output, tx_hash followed by the big endian u32 index.
+// A molecule OutPoint ends in a little endian index instead.
+std::string CellKey(std::string_view tx_hash, uint32_t index);
+// The 36 byte molecule OutPoint of a cell key
+void CellKeyToOutPoint(const char *key, char *out_point);
+bool ReadBlockHash(RocksDBReadOnly &db, uint64_t number, std::string &hash, rocksdb::Status &status);
+bool ReadTransactionCount(RocksDBReadOnly &db, uint64_t number, const std::string &hash, uint32_t &count, rocksdb::Status &status);
+// Hash and number of the main chain tip recorded under TIP_HEADER in COLUMN_META
+bool ReadTipHeader(RocksDBReadOnly &db, std::string &hash, uint64_t &number, rocksdb::Status &status);
+bool ReadRawBlock(RocksDBReadOnly &db, uint64_t number, RawBlock &block, rocksdb::Status &status);
+// TransactionView of a main chain transaction, found through its COLUMN_TRANSACTION_INFO key
+bool ReadTransactionView(RocksDBReadOnly &db, std::string_view tx_hash, std::string &view, rocksdb::Status &status);
+
+#endif
@@ -1,5 +1,6 @@
 #include "rocksdb_read_only.h"
 #include "log/logging.h"
+#include <memory>
 
 RocksDBReadOnly::RocksDBReadOnly(const std::string &db_path, rocksdb::Status &status)
 {
@@ -140,3 +141,42 @@ bool RocksDBReadOnly::ReadData(const std::string &column_family_name, const std:
     }
     return false;
 }
+
+bool RocksDBReadOnly::ScanRange(const std::string &column_family_name, const std::string &begin, const std::string &end,
+                                const std::function<bool(const rocksdb::Slice &key, const rocksdb::Slice &value)> &func,
+                                rocksdb::Status &status)
+{
+    if (!init_success_)
+    {
+        ERRORLOG("Rocksdb Uninitialized");
+        return false;
+    }
+    auto handle = column_family_handles_.find(column_family_name);
+    if (column_family_handles_.end() == handle)
+    {
+        ERRORLOG("column family not found");
+        return false;
+    }
+    rocksdb::ReadOptions options = read_options_;
+    options.fill_cache = false;
+    rocksdb::Slice upper_bound(end);
+    if (!end.empty())
+    {
+        options.iterate_upper_bound = &upper_bound;
+    }
+    std::unique_ptr<rocksdb::Iterator> it(db_->NewIterator(options, handle->second));
+    for (it->Seek(begin); it->Valid(); it->Next())
+    {
+        if (!func(it->key(), it->value()))
+        {
+            break;
+        }
+    }
+    status = it->status();
+    if (!status.ok())
+    {
+        ERRORLOG("scan {} failed:{}", column_family_name, status.ToString());
+        return false;
+    }
+    return true;
+}
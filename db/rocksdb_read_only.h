@@ -1,6 +1,7 @@
 #ifndef _DB_ROCKSDB_READ_ONLY_H_
 #define _DB_ROCKSDB_READ_ONLY_H_
 
+#include <functional>
 #include <mutex>
 #include <rocksdb/db.h>
 #include <rocksdb/options.h>
@@ -18,6 +19,11 @@ public:
     bool MultiReadData(const std::vector<rocksdb::Slice> &keys, std::vector<std::string> &values, std::vector<rocksdb::Status> &status);
     bool ReadData(const std::string &column_family_name, const std::string &key,
                   std::string &value, rocksdb::Status &status);
+    // Visits the keys in [begin, end) in order, an empty end runs to the last key. func returns
+    // false to stop early. Blocks read by the scan do not displace the block cache.
+    bool ScanRange(const std::string &column_family_name, const std::string &begin, const std::string &end,
+                   const std::function<bool(const rocksdb::Slice &key, const rocksdb::Slice &value)> &func,
+                   rocksdb::Status &status);
 
 private:
     RocksDBReadOnly(RocksDBReadOnly &&) = delete;
@@ -0,0 +1,217 @@
+#include "block_json.h"
+#include "db/columns.h"
+#include "log/logging.h"
+#include "molecule/block_molecule.h"
+#include "molecule/blockchain.h"
+#include "utils/crypto_utils.h"
+
+void JsonBlockSource::Clear()
+{
+    block.Clear();
+    infos.clear();
+    cells.clear();
+    cell_datas.clear();
+    block_ext.clear();
+}
+
+size_t JsonBlockSource::ByteSize() const
+{
+    size_t size = block.ByteSize() + block_ext.size();
+    for (size_t i = 0; i < infos.size(); ++i)
+    {
+        size += infos[i].size() + cells[i].size() + cell_datas[i].size();
+    }
+    return size;
+}
+
+static bool ReadOptional(RocksDBReadOnly &db, const std::string &column_family_name, const std::string &key, std::string &value)
+{
+    rocksdb::Status status;
+    if (!db.ReadData(column_family_name, key, value, status))
+    {
+        value.clear();
+        return status.IsNotFound();
+    }
+    return true;
+}
+
+bool ReadJsonBlockDetails(RocksDBReadOnly &db, JsonBlockSource &source)
+{
+    source.infos.clear();
+    source.cells.clear();
+    source.cell_datas.clear();
+    source.block_ext.clear();
+    size_t count = source.block.transactions.size();
+    source.infos.resize(count);
+    source.cells.resize(count);
+    source.cell_datas.resize(count);
+    std::string_view tx_hash;
+    std::string_view witness_hash;
+    std::string_view transaction;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!SplitTransactionView(source.block.transactions[i], tx_hash, witness_hash, transaction))
+        {
+            return false;
+        }
+        std::string key(tx_hash);
+        int tx_index = source.block.TransactionIndex(i);
+        std::string cell_key = key + std::string((char *)&tx_index, sizeof(tx_index));
+        if (!ReadOptional(db, COLUMN_TRANSACTION_INFO, key, source.infos[i]) ||
+            !ReadOptional(db, COLUMN_CELL, cell_key, source.cells[i]) ||
+            !ReadOptional(db, COLUMN_CELL_DATA, cell_key, source.cell_datas[i]))
+        {
+            return false;
+        }
+    }
+    return ReadOptional(db, COLUMN_BLOCK_EXT, source.block.hash, source.block_ext);
+}
+
+bool ReadJsonBlockSource(RocksDBReadOnly &db, uint64_t height, JsonBlockSource &source, rocksdb::Status &status)
+{
+    source.Clear();
+    return ReadRawBlock(db, height, source.block, status) && ReadJsonBlockDetails(db, source);
+}
+
+static bool DeduplicateOutputsData(std::string_view view, nlohmann::json &outputs_data, CellDataStore &store)
+{
+    std::string_view hash, witness_hash, transaction, raw, witnesses;
+    RawTransactionFields fields;
+    thread_local std::vector<std::string_view> items;
+    if (!SplitTransactionView(view, hash, witness_hash, transaction) || !SplitTransaction(transaction, raw, witnesses) ||
+        !DecodeRawTransaction(raw, fields) || !GetDynVecItems(fields.outputs_data, items) || items.size() != outputs_data.size())
+    {
+        return false;
+    }
+    std::string data_hash;
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        std::string_view data;
+        if (!GetBytesData(items[i], data))
+        {
+            return false;
+        }
+        if (!store.Deduplicates(data.size()))
+        {
+            continue;
+        }
+        if (!store.Put(data, data_hash))
+        {
+            return false;
+        }
+        outputs_data[i] = {{"blob", Bytes2Hex(data_hash)}, {"size", data.size()}};
+    }
+    return true;
+}
+
+int DecodeBlockJson(const JsonBlockSource &source, nlohmann::json &json, CellDataStore *store)
+{
+    json.clear();
+    nlohmann::json block;
+    const RawBlock &raw = source.block;
+
+    Header header;
+    if (!header.ParseFromByteWithHash(raw.header.data(), raw.header.size()))
+    {
+        return -4;
+    }
+    block["header"] = header.json;
+
+    UncleBlockVec uncles;
+    if (!uncles.ParseFromByte(raw.uncles.data(), raw.uncles.size()))
+    {
+        return -6;
+    }
+    block["uncles"] = uncles.json;
+
+    Transaction transaction;
+    for (auto &value : raw.transactions)
+    {
+        transaction.Clear();
+        if (!transaction.ParseFromByte(value.data(), value.size()))
+        {
+            return -9;
+        }
+        if (nullptr != store && !DeduplicateOutputsData(value, transaction.json["raw"]["outputs_data"], *store))
+        {
+            return -16;
+        }
+        block["transactions"].push_back(transaction.json);
+    }
+
+    ProposalShortIdVec proposals;
+    if (!proposals.ParseFromByte(raw.proposals.data(), raw.proposals.size()))
+    {
+        return -10;
+    }
+    block["proposals"] = proposals.json;
+
+    if (raw.has_extension)
+    {
+        block["extension"] = Bytes2Hex(raw.extension);
+    }
+    json["block"] = block;
+
+    for (size_t i = 0; i < source.infos.size(); ++i)
+    {
+        TransactionInfo info;
+        if (!source.infos[i].empty() && info.ParseFromByte(source.infos[i].data(), source.infos[i].size()))
+        {
+            json["info"].push_back(info.json);
+        }
+        CellEntry entry;
+        if (!source.cells[i].empty() && entry.ParseFromByte(source.cells[i].data(), source.cells[i].size()))
+        {
+            json["entry"].push_back(entry.json);
+        }
+        CellDataEntry data_entry;
+        if (!source.cell_datas[i].empty() && data_entry.ParseFromByte(source.cell_datas[i].data(), source.cell_datas[i].size()))
+        {
+            json["data_entry"].push_back(data_entry.json);
+        }
+    }
+
+    BlockExt block_ext;
+    if (!source.block_ext.empty() && block_ext.ParseFromByte(source.block_ext.data(), source.block_ext.size()))
+    {
+        json["block_ext"] = block_ext.json;
+    }
+    return 0;
+}
+
+int BuildBlockJson(RocksDBReadOnly &db, uint64_t height, nlohmann::json &json, CellDataStore *store)
+{
+    thread_local JsonBlockSource source;
+    rocksdb::Status status;
+    if (!ReadJsonBlockSource(db, height, source, status))
+    {
+        ERRORLOG("read block {} failed", height);
+        return -2;
+    }
+    return DecodeBlockJson(source, json, store);
+}
+
+int EncodeBlockJson(RocksDBReadOnly &db, uint64_t height, std::string &record, CellDataStore *store)
+{
+    nlohmann::json json;
+    int ret = BuildBlockJson(db, height, json, store);
+    if (0 != ret)
+    {
+        return ret;
+    }
+    record = json.dump(4);
+    return 0;
+}
+
+int EncodeBlockNdjson(RocksDBReadOnly &db, uint64_t height, std::string &record, CellDataStore *store)
+{
+    nlohmann::json json;
+    int ret = BuildBlockJson(db, height, json, store);
+    if (0 != ret)
+    {
+        return ret;
+    }
+    record = json.dump();
+    record.push_back('\n');
+    return 0;
+}
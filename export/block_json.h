@@ -0,0 +1,34 @@
+#ifndef _EXPORT_BLOCK_JSON_H_
+#define _EXPORT_BLOCK_JSON_H_
+
+#include "db/raw_block.h"
+#include "export/cell_data_store.h"
+#include <nlohmann/json.hpp>
+
+// Every column family value the json export of one block reads, an empty string means not found
+struct JsonBlockSource
+{
+    RawBlock block;
+    std::vector<std::string> infos;      // COLUMN_TRANSACTION_INFO per transaction
+    std::vector<std::string> cells;      // COLUMN_CELL per transaction
+    std::vector<std::string> cell_datas; // COLUMN_CELL_DATA per transaction
+    std::string block_ext;               // COLUMN_BLOCK_EXT
+
+    void Clear();
+    size_t ByteSize() const;
+};
+
+// Reads everything but source.block, which is read (and possibly filtered) already
+bool ReadJsonBlockDetails(RocksDBReadOnly &db, JsonBlockSource &source);
+bool ReadJsonBlockSource(RocksDBReadOnly &db, uint64_t height, JsonBlockSource &source, rocksdb::Status &status);
+// With a store, outputs_data items it deduplicates become {"blob": hash, "size": n}
+int DecodeBlockJson(const JsonBlockSource &source, nlohmann::json &json, CellDataStore *store = nullptr);
+
+// Read and decode in one go, returns 0 or a negative error code
+int BuildBlockJson(RocksDBReadOnly &db, uint64_t height, nlohmann::json &json, CellDataStore *store = nullptr);
+// The pretty printed json written to "<height>.txt"
+int EncodeBlockJson(RocksDBReadOnly &db, uint64_t height, std::string &record, CellDataStore *store = nullptr);
+// One compact json line
+int EncodeBlockNdjson(RocksDBReadOnly &db, uint64_t height, std::string &record, CellDataStore *store = nullptr);
+
+#endif
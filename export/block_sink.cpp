@@ -0,0 +1,75 @@
+#include "block_sink.h"
+#include "log/logging.h"
+#include "utils/file_utils.h"
+#include <unistd.h>
+
+PerBlockFileSink::PerBlockFileSink(const std::string &dir, const std::string &suffix)
+    : dir_(dir), suffix_(suffix)
+{
+    if (!dir_.empty() && '/' != dir_.back())
+    {
+        dir_.push_back('/');
+    }
+}
+
+bool PerBlockFileSink::Write(uint64_t height, const std::string &record)
+{
+    return WriteFile(dir_ + std::to_string(height) + suffix_, record);
+}
+
+FileSink::FileSink(const std::string &path, bool append, const WriterOptions &options)
+    : path_(path), writer_(options)
+{
+    writer_.Open(path_, append);
+}
+
+bool FileSink::IsOpen() const
+{
+    return writer_.IsOpen();
+}
+
+bool FileSink::Write(uint64_t height, const std::string &record)
+{
+    if (!writer_.Append(record.data(), record.size()))
+    {
+        ERRORLOG("write {} failed at block {}", path_, height);
+        return false;
+    }
+    return true;
+}
+
+bool FileSink::Close()
+{
+    return writer_.Close();
+}
+
+bool FileSink::Checkpoint(SinkPosition &position)
+{
+    // The checkpoint must not point past what a crash would leave on disk, so this syncs
+    // whatever the fsync policy
+    if (!writer_.Flush(true))
+    {
+        ERRORLOG("flush {} failed", path_);
+        return false;
+    }
+    position.file = path_;
+    position.offset = writer_.Size();
+    return true;
+}
+
+bool FileSink::Resume(const SinkPosition &position)
+{
+    if (position.file != path_ || position.offset > writer_.Size())
+    {
+        ERRORLOG("{} is shorter than the checkpoint offset {}", path_, position.offset);
+        return false;
+    }
+    writer_.Close();
+    // Cut the records written after the checkpoint, including a partial last one
+    if (0 != truncate(path_.c_str(), position.offset))
+    {
+        ERRORLOG("truncate {} to {} failed", path_, position.offset);
+        return false;
+    }
+    return writer_.Open(path_, true);
+}
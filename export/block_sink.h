@@ -0,0 +1,62 @@
+#ifndef _EXPORT_BLOCK_SINK_H_
+#define _EXPORT_BLOCK_SINK_H_
+
+#include "utils/vectored_writer.h"
+#include <memory>
+#include <string>
+
+// Where the output stands after the last committed record
+struct SinkPosition
+{
+    std::string file;
+    uint64_t offset = 0;
+    uint64_t end_height = 0; // every block below it is in the output
+};
+
+// Receives encoded blocks in height order
+class BlockSink
+{
+public:
+    virtual ~BlockSink() = default;
+    virtual bool Write(uint64_t height, const std::string &record) = 0;
+    // A record holding the blocks [start, end), e.g. one compressed frame
+    virtual bool WriteRange(uint64_t start, uint64_t end, const std::string &record) { return Write(start, record); }
+    virtual bool Close() { return true; }
+    // Flushes everything written so far and reports the output position, for checkpoints
+    virtual bool Checkpoint(SinkPosition &position) { return false; }
+    // Drops whatever was written after the position and continues from there
+    virtual bool Resume(const SinkPosition &position) { return false; }
+};
+
+// One "<dir>/<height><suffix>" file per block, the historic json layout
+class PerBlockFileSink : public BlockSink
+{
+public:
+    PerBlockFileSink(const std::string &dir, const std::string &suffix);
+    bool Write(uint64_t height, const std::string &record) override;
+    bool Checkpoint(SinkPosition &position) override { return true; }
+    bool Resume(const SinkPosition &position) override { return true; }
+
+private:
+    std::string dir_;
+    std::string suffix_;
+};
+
+// Every record appended to a single file through a VectoredWriter
+class FileSink : public BlockSink
+{
+public:
+    // append keeps the existing content, for resuming
+    explicit FileSink(const std::string &path, bool append = false, const WriterOptions &options = WriterOptions());
+    bool IsOpen() const;
+    bool Write(uint64_t height, const std::string &record) override;
+    bool Close() override;
+    bool Checkpoint(SinkPosition &position) override;
+    bool Resume(const SinkPosition &position) override;
+
+private:
+    std::string path_;
+    VectoredWriter writer_;
+};
+
+#endif
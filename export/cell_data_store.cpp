@@ -0,0 +1,89 @@
+#include "cell_data_store.h"
+#include "log/logging.h"
+#include "utils/crypto_utils.h"
+#include "utils/file_utils.h"
+#include <filesystem>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+CellDataStore::CellDataStore(const std::string &dir, size_t seen_entries, size_t min_bytes)
+    : dir_(dir), min_bytes_(std::max<size_t>(min_bytes, 1)), open_(true), seen_size_(std::max<size_t>(seen_entries, 1)),
+      seen_(new std::atomic<uint64_t>[seen_size_]), blobs_(0), bytes_(0), duplicates_(0), bytes_saved_(0)
+{
+    for (size_t i = 0; i < seen_size_; ++i)
+    {
+        seen_[i].store(0, std::memory_order_relaxed);
+    }
+    if (!dir_.empty() && '/' != dir_.back())
+    {
+        dir_.push_back('/');
+    }
+    std::error_code error;
+    for (int i = 0; i < 256 && open_; ++i)
+    {
+        char name[3];
+        snprintf(name, sizeof(name), "%02x", i);
+        std::filesystem::create_directories(dir_ + name, error);
+        if (error)
+        {
+            ERRORLOG("create {}{} failed:{}", dir_, name, error.message());
+            open_ = false;
+        }
+    }
+}
+
+std::string CellDataStore::BlobPath(const std::string &hex) const
+{
+    return dir_ + hex.substr(0, 2) + "/" + hex;
+}
+
+bool CellDataStore::Put(std::string_view data, std::string &hash)
+{
+    hash.resize(CKB_HASH_SIZE);
+    Blake2b256(data.data(), data.size(), (uint8_t *)&hash[0]);
+    // The hash is uniformly distributed, its first 8 bytes are fingerprint and slot at once.
+    // 0 marks an empty slot.
+    uint64_t fingerprint;
+    memcpy(&fingerprint, hash.data(), sizeof(fingerprint));
+    fingerprint |= 1;
+    std::atomic<uint64_t> &slot = seen_[fingerprint % seen_size_];
+    if (slot.load(std::memory_order_relaxed) == fingerprint)
+    {
+        ++duplicates_;
+        bytes_saved_ += data.size();
+        return true;
+    }
+
+    std::string path = BlobPath(Bytes2Hex(hash));
+    if (FileExists(path))
+    {
+        ++duplicates_;
+        bytes_saved_ += data.size();
+    }
+    else
+    {
+        // Two threads may store the same blob at once, each renames its own complete copy. The
+        // copy is synced first, an existing blob is trusted without reading it back.
+        std::string suffix = ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        if (!WriteFileAtomic(path, std::string(data), suffix))
+        {
+            ERRORLOG("store cell data {} failed", path);
+            return false;
+        }
+        ++blobs_;
+        bytes_ += data.size();
+    }
+    slot.store(fingerprint, std::memory_order_relaxed);
+    return true;
+}
+
+CellDataStoreStats CellDataStore::Stats() const
+{
+    CellDataStoreStats stats;
+    stats.blobs = blobs_;
+    stats.bytes = bytes_;
+    stats.duplicates = duplicates_;
+    stats.bytes_saved = bytes_saved_;
+    return stats;
+}
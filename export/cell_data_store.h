@@ -0,0 +1,47 @@
+#ifndef _EXPORT_CELL_DATA_STORE_H_
+#define _EXPORT_CELL_DATA_STORE_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+
+struct CellDataStoreStats
+{
+    uint64_t blobs = 0;      // distinct data written
+    uint64_t bytes = 0;
+    uint64_t duplicates = 0; // data that was stored already
+    uint64_t bytes_saved = 0;
+};
+
+// Content addressed store, every distinct cell data is written once to "<dir>/<xx>/<hash>" where the
+// hash is the ckb hash of the data (output_data_hash) and xx its first byte. Block records keep
+// only the hash. A fixed size table of hash fingerprints remembers what was written recently, a
+// miss falls back to checking the file, so memory stays bounded however many blobs there are.
+// Safe to use from several encoder threads.
+class CellDataStore
+{
+public:
+    CellDataStore(const std::string &dir, size_t seen_entries, size_t min_bytes);
+    bool IsOpen() const { return open_; }
+    // Smaller data stays inline, a hash would not be shorter
+    bool Deduplicates(size_t size) const { return size >= min_bytes_; }
+    // Stores data unless it is known already and returns its 32 byte hash
+    bool Put(std::string_view data, std::string &hash);
+    CellDataStoreStats Stats() const;
+
+private:
+    std::string BlobPath(const std::string &hex) const;
+
+    std::string dir_;
+    size_t min_bytes_;
+    bool open_;
+    size_t seen_size_;
+    std::unique_ptr<std::atomic<uint64_t>[]> seen_;
+    std::atomic<uint64_t> blobs_;
+    std::atomic<uint64_t> bytes_;
+    std::atomic<uint64_t> duplicates_;
+    std::atomic<uint64_t> bytes_saved_;
+};
+
+#endif
@@ -0,0 +1,164 @@
+#include "checkpoint.h"
+#include "db/raw_block.h"
+#include "log/logging.h"
+#include "utils/crypto_utils.h"
+#include "utils/file_utils.h"
+#include <csignal>
+#include <nlohmann/json.hpp>
+
+static volatile std::sig_atomic_t g_stop_requested = 0;
+
+static void OnStopSignal(int)
+{
+    g_stop_requested = 1;
+}
+
+void InstallStopHandler()
+{
+    struct sigaction action = {};
+    action.sa_handler = OnStopSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+}
+
+bool StopRequested()
+{
+    return 0 != g_stop_requested;
+}
+
+bool SaveCheckpoint(const std::string &path, const ExportCheckpoint &checkpoint)
+{
+    nlohmann::json json;
+    json["format"] = checkpoint.format;
+    json["output"] = checkpoint.output;
+    json["start"] = checkpoint.start;
+    json["end"] = checkpoint.end;
+    json["next_height"] = checkpoint.next_height;
+    json["boundary_hash"] = checkpoint.boundary_hash;
+    json["file"] = checkpoint.position.file;
+    json["offset"] = checkpoint.position.offset;
+    json["complete"] = checkpoint.complete;
+    return WriteFileAtomic(path, json.dump(4));
+}
+
+bool LoadCheckpoint(const std::string &path, ExportCheckpoint &checkpoint)
+{
+    std::string content;
+    if (!ReadFile(path, content))
+    {
+        ERRORLOG("read {} failed", path);
+        return false;
+    }
+    nlohmann::json json = nlohmann::json::parse(content, nullptr, false);
+    if (json.is_discarded() || !json.is_object())
+    {
+        ERRORLOG("parse {} failed", path);
+        return false;
+    }
+    try
+    {
+        checkpoint.format = json.at("format").get<std::string>();
+        checkpoint.output = json.at("output").get<std::string>();
+        checkpoint.start = json.at("start").get<uint64_t>();
+        checkpoint.end = json.at("end").get<uint64_t>();
+        checkpoint.next_height = json.at("next_height").get<uint64_t>();
+        checkpoint.boundary_hash = json.at("boundary_hash").get<std::string>();
+        checkpoint.position.file = json.at("file").get<std::string>();
+        checkpoint.position.offset = json.at("offset").get<uint64_t>();
+        checkpoint.position.end_height = checkpoint.next_height;
+        checkpoint.complete = json.at("complete").get<bool>();
+    }
+    catch (const nlohmann::json::exception &e)
+    {
+        ERRORLOG("{} is not a checkpoint: {}", path, e.what());
+        return false;
+    }
+    return true;
+}
+
+bool VerifyCheckpointBoundary(RocksDBReadOnly &db, const ExportCheckpoint &checkpoint)
+{
+    if (checkpoint.next_height <= checkpoint.start)
+    {
+        return true;
+    }
+    std::string hash;
+    rocksdb::Status status;
+    if (!ReadBlockHash(db, checkpoint.next_height - 1, hash, status))
+    {
+        ERRORLOG("read block {} hash failed:{}", checkpoint.next_height - 1, status.ToString());
+        return false;
+    }
+    if (Bytes2Hex(hash) != checkpoint.boundary_hash)
+    {
+        ERRORLOG("block {} is {} but the checkpoint recorded {}", checkpoint.next_height - 1, Bytes2Hex(hash), checkpoint.boundary_hash);
+        return false;
+    }
+    return true;
+}
+
+CheckpointSink::CheckpointSink(RocksDBReadOnly &db, std::unique_ptr<BlockSink> downstream, const std::string &path,
+                               const ExportCheckpoint &checkpoint, uint64_t interval_seconds)
+    : db_(db), downstream_(std::move(downstream)), path_(path), checkpoint_(checkpoint),
+      interval_(std::chrono::seconds(interval_seconds)), last_save_(std::chrono::steady_clock::now()),
+      interrupted_(false)
+{
+}
+
+bool CheckpointSink::Save()
+{
+    last_save_ = std::chrono::steady_clock::now();
+    if (!downstream_->Checkpoint(checkpoint_.position))
+    {
+        ERRORLOG("checkpoint output at block {} failed", checkpoint_.next_height);
+        return false;
+    }
+    checkpoint_.position.end_height = checkpoint_.next_height;
+    checkpoint_.boundary_hash.clear();
+    if (checkpoint_.next_height > checkpoint_.start)
+    {
+        std::string hash;
+        rocksdb::Status status;
+        if (!ReadBlockHash(db_, checkpoint_.next_height - 1, hash, status))
+        {
+            ERRORLOG("read block {} hash failed:{}", checkpoint_.next_height - 1, status.ToString());
+            return false;
+        }
+        checkpoint_.boundary_hash = Bytes2Hex(hash);
+    }
+    return SaveCheckpoint(path_, checkpoint_);
+}
+
+bool CheckpointSink::Write(uint64_t height, const std::string &record)
+{
+    if (!downstream_->Write(height, record))
+    {
+        return false;
+    }
+    checkpoint_.next_height = height + 1;
+    if (StopRequested())
+    {
+        interrupted_ = true;
+        Save();
+        return false;
+    }
+    if (std::chrono::steady_clock::now() - last_save_ >= interval_)
+    {
+        return Save();
+    }
+    return true;
+}
+
+bool CheckpointSink::Close()
+{
+    if (!downstream_->Close())
+    {
+        return false;
+    }
+    checkpoint_.next_height = checkpoint_.end;
+    checkpoint_.position = SinkPosition();
+    checkpoint_.boundary_hash.clear();
+    checkpoint_.complete = true;
+    return SaveCheckpoint(path_, checkpoint_);
+}
@@ -0,0 +1,53 @@
+#ifndef _EXPORT_CHECKPOINT_H_
+#define _EXPORT_CHECKPOINT_H_
+
+#include "db/rocksdb_read_only.h"
+#include "export/block_sink.h"
+#include <chrono>
+
+struct ExportCheckpoint
+{
+    std::string format;
+    std::string output;
+    uint64_t start = 0;
+    uint64_t end = 0;
+    uint64_t next_height = 0;  // every block below it is committed
+    std::string boundary_hash; // hex hash of block next_height - 1
+    SinkPosition position;
+    bool complete = false;
+};
+
+bool SaveCheckpoint(const std::string &path, const ExportCheckpoint &checkpoint);
+bool LoadCheckpoint(const std::string &path, ExportCheckpoint &checkpoint);
+// Checks that block next_height - 1 still has the recorded hash
+bool VerifyCheckpointBoundary(RocksDBReadOnly &db, const ExportCheckpoint &checkpoint);
+
+// SIGINT/SIGTERM only raise a flag, the export stops at the next committed block
+void InstallStopHandler();
+bool StopRequested();
+
+// Persists a checkpoint every interval and when a stop is requested. A stop makes Write fail
+// right after the checkpoint, which ends the export with everything up to it on disk.
+class CheckpointSink : public BlockSink
+{
+public:
+    CheckpointSink(RocksDBReadOnly &db, std::unique_ptr<BlockSink> downstream, const std::string &path,
+                   const ExportCheckpoint &checkpoint, uint64_t interval_seconds);
+    bool Write(uint64_t height, const std::string &record) override;
+    bool Close() override;
+    bool Interrupted() const { return interrupted_; }
+    uint64_t NextHeight() const { return checkpoint_.next_height; }
+
+private:
+    bool Save();
+
+    RocksDBReadOnly &db_;
+    std::unique_ptr<BlockSink> downstream_;
+    std::string path_;
+    ExportCheckpoint checkpoint_;
+    std::chrono::steady_clock::duration interval_;
+    std::chrono::steady_clock::time_point last_save_;
+    bool interrupted_;
+};
+
+#endif
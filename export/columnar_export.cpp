@@ -0,0 +1,293 @@
+#include "columnar_export.h"
+#include "archive/archive_format.h"
+#include "columnar/columnar_reader.h"
+#include "log/logging.h"
+#include "molecule/block_molecule.h"
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+
+static const char *TABLE_NAMES[COLUMNAR_TABLE_COUNT] = {"headers", "transactions", "outputs"};
+
+const char *ColumnarTableName(int table)
+{
+    return TABLE_NAMES[table];
+}
+
+const std::vector<ColumnSpec> &ColumnarTableSchema(int table)
+{
+    static const std::vector<ColumnSpec> schemas[COLUMNAR_TABLE_COUNT] = {
+        {{"height", COLUMNAR_UINT64}, {"hash", COLUMNAR_BYTES}, {"timestamp", COLUMNAR_UINT64}, {"epoch", COLUMNAR_UINT64},
+         {"compact_target", COLUMNAR_UINT64}, {"parent_hash", COLUMNAR_BYTES}, {"transaction_count", COLUMNAR_UINT64},
+         {"uncle_count", COLUMNAR_UINT64}, {"dao", COLUMNAR_BYTES}, {"dao_c", COLUMNAR_UINT64}, {"dao_ar", COLUMNAR_UINT64},
+         {"dao_s", COLUMNAR_UINT64}, {"dao_u", COLUMNAR_UINT64}},
+        {{"height", COLUMNAR_UINT64}, {"tx_index", COLUMNAR_UINT64}, {"hash", COLUMNAR_BYTES}, {"cell_dep_count", COLUMNAR_UINT64},
+         {"header_dep_count", COLUMNAR_UINT64}, {"input_count", COLUMNAR_UINT64}, {"output_count", COLUMNAR_UINT64},
+         {"witness_count", COLUMNAR_UINT64}, {"size", COLUMNAR_UINT64}},
+        {{"height", COLUMNAR_UINT64}, {"tx_index", COLUMNAR_UINT64}, {"output_index", COLUMNAR_UINT64}, {"capacity", COLUMNAR_UINT64},
+         {"lock_code_hash", COLUMNAR_BYTES}, {"lock_hash_type", COLUMNAR_UINT64}, {"lock_args", COLUMNAR_BYTES},
+         {"type_code_hash", COLUMNAR_BYTES}, {"type_hash_type", COLUMNAR_UINT64}, {"type_args", COLUMNAR_BYTES},
+         {"data_size", COLUMNAR_UINT64}}};
+    return schemas[table];
+}
+
+uint64_t EpochNumber(uint64_t epoch)
+{
+    return epoch & 0xffffff;
+}
+
+// Rows of one table, appended value by value in schema order
+struct RowBuffer
+{
+    std::string data;
+    uint32_t rows = 0;
+
+    RowBuffer &Uint(uint64_t value)
+    {
+        char buffer[8];
+        StoreLe64(buffer, value);
+        data.append(buffer, sizeof(buffer));
+        return *this;
+    }
+    RowBuffer &Bytes(std::string_view value)
+    {
+        char buffer[4];
+        StoreLe32(buffer, value.size());
+        data.append(buffer, sizeof(buffer));
+        data.append(value.data(), value.size());
+        return *this;
+    }
+    void End()
+    {
+        ++rows;
+    }
+};
+
+static bool EncodeTransactionRows(uint64_t height, uint64_t tx_index, std::string_view view, RowBuffer *tables)
+{
+    std::string_view hash, witness_hash, transaction, raw, witnesses;
+    if (!SplitTransactionView(view, hash, witness_hash, transaction) || !SplitTransaction(transaction, raw, witnesses))
+    {
+        return false;
+    }
+    RawTransactionFields fields;
+    thread_local std::vector<std::string_view> cell_deps, header_deps, inputs, outputs, outputs_data, witness_items;
+    if (!DecodeRawTransaction(raw, fields) ||
+        !GetFixVecItems(fields.cell_deps, CELL_DEP_SIZE, cell_deps) ||
+        !GetFixVecItems(fields.header_deps, 32, header_deps) ||
+        !GetFixVecItems(fields.inputs, CELL_INPUT_SIZE, inputs) ||
+        !GetDynVecItems(fields.outputs, outputs) ||
+        !GetDynVecItems(fields.outputs_data, outputs_data) ||
+        !GetDynVecItems(witnesses, witness_items) ||
+        outputs.size() != outputs_data.size())
+    {
+        return false;
+    }
+    tables[COLUMNAR_TRANSACTIONS].Uint(height).Uint(tx_index).Bytes(hash).Uint(cell_deps.size()).Uint(header_deps.size())
+        .Uint(inputs.size()).Uint(outputs.size()).Uint(witness_items.size()).Uint(transaction.size()).End();
+
+    for (size_t i = 0; i < outputs.size(); ++i)
+    {
+        CellOutputFields output;
+        std::string_view data;
+        if (!DecodeCellOutput(outputs[i], output) || !GetBytesData(outputs_data[i], data))
+        {
+            return false;
+        }
+        tables[COLUMNAR_OUTPUTS].Uint(height).Uint(tx_index).Uint(i).Uint(output.capacity).Bytes(output.lock.code_hash)
+            .Uint(output.lock.hash_type).Bytes(output.lock.args).Bytes(output.type.code_hash).Uint(output.type.hash_type)
+            .Bytes(output.type.args).Uint(data.size()).End();
+    }
+    return true;
+}
+
+bool EncodeColumnarRows(const RawBlock &block, std::string &record)
+{
+    thread_local RowBuffer tables[COLUMNAR_TABLE_COUNT];
+    for (auto &table : tables)
+    {
+        table.data.clear();
+        table.rows = 0;
+    }
+    std::string_view hash, header, uncle_hashes, uncles;
+    if (!SplitHeaderView(block.header, hash, header) || !SplitUncleBlockVecView(block.uncles, uncle_hashes, uncles) ||
+        uncle_hashes.size() < 4)
+    {
+        ERRORLOG("block {} format error", block.number);
+        return false;
+    }
+    const char *p = header.data();
+    uint64_t epoch = LoadLe64(p + HEADER_EPOCH);
+    tables[COLUMNAR_HEADERS].Uint(block.number).Bytes(hash).Uint(LoadLe64(p + HEADER_TIMESTAMP)).Uint(epoch)
+        .Uint(LoadLe32(p + HEADER_COMPACT_TARGET)).Bytes(header.substr(HEADER_PARENT_HASH, 32))
+        .Uint(block.transactions.size()).Uint(LoadLe32(uncle_hashes.data())).Bytes(header.substr(HEADER_DAO, 32))
+        .Uint(LoadLe64(p + HEADER_DAO_C)).Uint(LoadLe64(p + HEADER_DAO_AR)).Uint(LoadLe64(p + HEADER_DAO_S))
+        .Uint(LoadLe64(p + HEADER_DAO_U)).End();
+    for (size_t i = 0; i < block.transactions.size(); ++i)
+    {
+        if (!EncodeTransactionRows(block.number, block.TransactionIndex(i), block.transactions[i], tables))
+        {
+            ERRORLOG("block {} transaction {} format error", block.number, i);
+            return false;
+        }
+    }
+
+    char buffer[8];
+    record.clear();
+    StoreLe64(buffer, EpochNumber(epoch));
+    record.append(buffer, 8);
+    for (auto &table : tables)
+    {
+        StoreLe32(buffer, table.rows);
+        StoreLe32(buffer + 4, table.data.size());
+        record.append(buffer, 8);
+        record.append(table.data);
+    }
+    return true;
+}
+
+int EncodeColumnarBlock(RocksDBReadOnly &db, uint64_t height, std::string &record)
+{
+    thread_local RawBlock block;
+    rocksdb::Status status;
+    if (!ReadRawBlock(db, height, block, status))
+    {
+        ERRORLOG("read block {} failed", height);
+        return -2;
+    }
+    return EncodeColumnarRows(block, record) ? 0 : -3;
+}
+
+PipelineStages ColumnarPipelineStages()
+{
+    PipelineStages stages;
+    stages.fetch = [](RocksDBReadOnly &db, PipelineItem &item)
+    {
+        rocksdb::Status status;
+        return ReadRawBlock(db, item.height, item.source.block, status) ? 0 : -2;
+    };
+    stages.decode = [](PipelineItem &item)
+    {
+        return EncodeColumnarRows(item.source.block, item.record) ? 0 : -3;
+    };
+    stages.serialize = [](PipelineItem &item)
+    {
+        return 0;
+    };
+    return stages;
+}
+
+ColumnarSink::ColumnarSink(const std::string &dir, uint64_t row_group_rows)
+    : dir_(dir.empty() ? "." : dir), row_group_rows_(row_group_rows), epoch_(UINT64_MAX)
+{
+}
+
+ColumnarSink::~ColumnarSink()
+{
+    ClosePartition();
+}
+
+bool ColumnarSink::OpenPartition(uint64_t epoch, uint64_t height)
+{
+    for (int i = 0; i < COLUMNAR_TABLE_COUNT; ++i)
+    {
+        std::string dir = ColumnarPartitionDir(dir_, TABLE_NAMES[i], epoch);
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        std::ostringstream path;
+        path << dir << "/part-" << std::setw(10) << std::setfill('0') << height << ".ckbc";
+        writers_[i].reset(new ColumnarWriter(path.str(), TABLE_NAMES[i], ColumnarTableSchema(i), row_group_rows_));
+        if (!writers_[i]->IsOpen())
+        {
+            ERRORLOG("open {} failed", path.str());
+            return false;
+        }
+    }
+    epoch_ = epoch;
+    return true;
+}
+
+bool ColumnarSink::ClosePartition()
+{
+    bool success = true;
+    for (auto &writer : writers_)
+    {
+        if (nullptr != writer && !writer->Close())
+        {
+            success = false;
+        }
+        writer.reset();
+    }
+    epoch_ = UINT64_MAX;
+    return success;
+}
+
+bool ColumnarSink::Write(uint64_t height, const std::string &record)
+{
+    if (record.size() < 8)
+    {
+        return false;
+    }
+    const char *p = record.data();
+    const char *end = p + record.size();
+    uint64_t epoch = LoadLe64(p);
+    p += 8;
+    if (epoch != epoch_ && (!ClosePartition() || !OpenPartition(epoch, height)))
+    {
+        return false;
+    }
+    for (int i = 0; i < COLUMNAR_TABLE_COUNT; ++i)
+    {
+        if (end - p < 8)
+        {
+            return false;
+        }
+        uint32_t rows = LoadLe32(p);
+        const char *table_end = p + 8 + LoadLe32(p + 4);
+        p += 8;
+        if (table_end > end)
+        {
+            return false;
+        }
+        const std::vector<ColumnSpec> &schema = ColumnarTableSchema(i);
+        ColumnarWriter &writer = *writers_[i];
+        for (uint32_t row = 0; row < rows; ++row)
+        {
+            for (size_t column = 0; column < schema.size(); ++column)
+            {
+                if (COLUMNAR_UINT64 == schema[column].type)
+                {
+                    if (table_end - p < 8)
+                    {
+                        return false;
+                    }
+                    writer.SetUint64(column, LoadLe64(p));
+                    p += 8;
+                    continue;
+                }
+                if (table_end - p < 4 || (uint64_t)(table_end - p - 4) < LoadLe32(p))
+                {
+                    return false;
+                }
+                uint32_t size = LoadLe32(p);
+                writer.SetBytes(column, std::string_view(p + 4, size));
+                p += 4 + size;
+            }
+            if (!writer.EndRow())
+            {
+                return false;
+            }
+        }
+        if (p != table_end)
+        {
+            ERRORLOG("columnar record of block {} is malformed", height);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ColumnarSink::Close()
+{
+    return ClosePartition();
+}
@@ -0,0 +1,47 @@
+#ifndef _EXPORT_COLUMNAR_EXPORT_H_
+#define _EXPORT_COLUMNAR_EXPORT_H_
+
+#include "columnar/columnar_writer.h"
+#include "db/raw_block.h"
+#include "export/pipeline.h"
+
+enum ColumnarTable
+{
+    COLUMNAR_HEADERS = 0,
+    COLUMNAR_TRANSACTIONS,
+    COLUMNAR_OUTPUTS,
+    COLUMNAR_TABLE_COUNT,
+};
+
+const char *ColumnarTableName(int table);
+const std::vector<ColumnSpec> &ColumnarTableSchema(int table);
+// The epoch number of the packed epoch field, the low 24 bits
+uint64_t EpochNumber(uint64_t epoch);
+
+// The rows of one block: u64 epoch number, then per table u32 row count, u32 size and the rows,
+// with uint64 values as 8 bytes and bytes values as u32 length + data
+bool EncodeColumnarRows(const RawBlock &block, std::string &record);
+int EncodeColumnarBlock(RocksDBReadOnly &db, uint64_t height, std::string &record);
+PipelineStages ColumnarPipelineStages();
+
+// Writes "<dir>/<table>/epoch=<n>/part-<first height>.ckbc", a new part per table whenever
+// the epoch changes
+class ColumnarSink : public BlockSink
+{
+public:
+    ColumnarSink(const std::string &dir, uint64_t row_group_rows);
+    ~ColumnarSink();
+    bool Write(uint64_t height, const std::string &record) override;
+    bool Close() override;
+
+private:
+    bool OpenPartition(uint64_t epoch, uint64_t height);
+    bool ClosePartition();
+
+    std::string dir_;
+    uint64_t row_group_rows_;
+    uint64_t epoch_;
+    std::unique_ptr<ColumnarWriter> writers_[COLUMNAR_TABLE_COUNT];
+};
+
+#endif
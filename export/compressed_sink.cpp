@@ -0,0 +1,105 @@
+#include "compressed_sink.h"
+#include "log/logging.h"
+
+CompressedSink::CompressedSink(std::unique_ptr<BlockSink> downstream, const CompressOptions &options)
+    : downstream_(std::move(downstream)), options_(options), pool_(options.threads),
+      start_height_(0), end_height_(0), failed_(false)
+{
+}
+
+CompressedSink::~CompressedSink()
+{
+    for (auto &frame : frames_)
+    {
+        frame.done.wait();
+    }
+}
+
+bool CompressedSink::SubmitFrame()
+{
+    if (buffer_.empty())
+    {
+        return true;
+    }
+    auto input = std::make_shared<std::string>(std::move(buffer_));
+    buffer_.clear();
+
+    Frame frame;
+    frame.start = start_height_;
+    frame.end = end_height_;
+    frame.data = std::make_shared<std::string>();
+    CompressType type = options_.type;
+    int level = options_.level;
+    std::shared_ptr<std::string> output = frame.data;
+    frame.done = pool_.Submit([type, level, input, output]()
+                              { return CompressFrame(type, level, *input, *output); });
+    frames_.push_back(std::move(frame));
+
+    // Two frames per worker keep the pool busy while bounding the memory held by pending frames
+    return WriteFrames(pool_.Size() * 2);
+}
+
+bool CompressedSink::WriteFrames(size_t keep)
+{
+    while (frames_.size() > keep)
+    {
+        Frame &frame = frames_.front();
+        if (!frame.done.get())
+        {
+            ERRORLOG("compress blocks [{}, {}) failed", frame.start, frame.end);
+            failed_ = true;
+            frames_.pop_front();
+            return false;
+        }
+        bool success = downstream_->WriteRange(frame.start, frame.end, *frame.data);
+        frames_.pop_front();
+        if (!success)
+        {
+            failed_ = true;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CompressedSink::Write(uint64_t height, const std::string &record)
+{
+    if (failed_)
+    {
+        return false;
+    }
+    if (buffer_.empty())
+    {
+        start_height_ = height;
+    }
+    buffer_.append(record);
+    end_height_ = height + 1;
+    if (buffer_.size() >= options_.frame_bytes)
+    {
+        return SubmitFrame();
+    }
+    return true;
+}
+
+bool CompressedSink::Close()
+{
+    if (failed_ || !SubmitFrame() || !WriteFrames(0))
+    {
+        return false;
+    }
+    return downstream_->Close();
+}
+
+bool CompressedSink::Checkpoint(SinkPosition &position)
+{
+    if (failed_ || !SubmitFrame() || !WriteFrames(0))
+    {
+        return false;
+    }
+    return downstream_->Checkpoint(position);
+}
+
+bool CompressedSink::Resume(const SinkPosition &position)
+{
+    return downstream_->Resume(position);
+}
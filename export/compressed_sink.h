@@ -0,0 +1,54 @@
+#ifndef _EXPORT_COMPRESSED_SINK_H_
+#define _EXPORT_COMPRESSED_SINK_H_
+
+#include "export/block_sink.h"
+#include "utils/compress_utils.h"
+#include "utils/thread_pool.hpp"
+#include <deque>
+
+struct CompressOptions
+{
+    CompressType type = COMPRESS_GZIP;
+    int level = 6;
+    uint32_t threads = 4;
+    uint64_t frame_bytes = 4 * 1024 * 1024; // 0 compresses every record on its own
+};
+
+// Groups records into frames of about frame_bytes, compresses the frames on a worker pool and
+// hands them to the downstream sink in height order. Every frame is an independent gzip member
+// or zstd frame, so the output still decompresses as one stream and can be split at frame
+// boundaries.
+class CompressedSink : public BlockSink
+{
+public:
+    CompressedSink(std::unique_ptr<BlockSink> downstream, const CompressOptions &options);
+    ~CompressedSink();
+    bool Write(uint64_t height, const std::string &record) override;
+    bool Close() override;
+    // Ends the current frame early so the checkpoint falls on a frame boundary
+    bool Checkpoint(SinkPosition &position) override;
+    bool Resume(const SinkPosition &position) override;
+
+private:
+    struct Frame
+    {
+        uint64_t start;
+        uint64_t end;
+        std::shared_ptr<std::string> data;
+        std::future<bool> done;
+    };
+
+    bool SubmitFrame();
+    bool WriteFrames(size_t keep);
+
+    std::unique_ptr<BlockSink> downstream_;
+    CompressOptions options_;
+    ThreadPool pool_;
+    std::string buffer_;
+    uint64_t start_height_;
+    uint64_t end_height_;
+    std::deque<Frame> frames_;
+    bool failed_;
+};
+
+#endif
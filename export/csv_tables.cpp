@@ -0,0 +1,364 @@
+#include "csv_tables.h"
+#include "archive/archive_format.h"
+#include "log/logging.h"
+#include "molecule/block_molecule.h"
+#include <inttypes.h>
+#include <stdio.h>
+
+static const char *TABLE_NAMES[CSV_TABLE_COUNT] = {
+    "blocks", "uncles", "transactions", "inputs", "outputs", "cell_deps", "header_deps", "proposals"};
+
+static const char *TABLE_COLUMNS[CSV_TABLE_COUNT] = {
+    "height,hash,version,compact_target,timestamp,epoch,parent_hash,transactions_root,proposals_hash,extra_hash,dao,dao_c,dao_ar,dao_s,dao_u,nonce,"
+    "transaction_count,uncle_count,proposal_count,extension\n",
+    "height,uncle_index,hash,number,version,compact_target,timestamp,epoch,parent_hash,nonce,proposal_count\n",
+    "height,tx_index,hash,witness_hash,version,cell_dep_count,header_dep_count,input_count,output_count,witness_count,size\n",
+    "height,tx_index,input_index,previous_tx_hash,previous_index,since\n",
+    "height,tx_index,output_index,capacity,lock_code_hash,lock_hash_type,lock_args,type_code_hash,type_hash_type,type_args,"
+    "data_size,data\n",
+    "height,tx_index,dep_index,tx_hash,index,dep_type\n",
+    "height,tx_index,dep_index,hash\n",
+    "height,proposal_index,short_id\n"};
+
+const char *CsvTableName(int table)
+{
+    return TABLE_NAMES[table];
+}
+
+const char *CsvTableColumns(int table)
+{
+    return TABLE_COLUMNS[table];
+}
+
+// Every value is a number or lowercase hex, so nothing needs quoting
+static void AppendHex(std::string &out, std::string_view bytes)
+{
+    static const char digits[] = "0123456789abcdef";
+    size_t pos = out.size();
+    out.resize(pos + bytes.size() * 2);
+    for (unsigned char c : bytes)
+    {
+        out[pos++] = digits[c >> 4];
+        out[pos++] = digits[c & 0x0f];
+    }
+}
+
+static void AppendNumber(std::string &out, uint64_t value)
+{
+    char buffer[24];
+    int len = snprintf(buffer, sizeof(buffer), "%" PRIu64, value);
+    out.append(buffer, len);
+}
+
+struct CsvRow
+{
+    std::string &out;
+    bool first = true;
+
+    explicit CsvRow(std::string &out) : out(out) {}
+    void Separate()
+    {
+        if (!first)
+        {
+            out.push_back(',');
+        }
+        first = false;
+    }
+    CsvRow &Number(uint64_t value)
+    {
+        Separate();
+        AppendNumber(out, value);
+        return *this;
+    }
+    CsvRow &Hex(std::string_view bytes)
+    {
+        Separate();
+        AppendHex(out, bytes);
+        return *this;
+    }
+    CsvRow &Empty()
+    {
+        Separate();
+        return *this;
+    }
+    void End()
+    {
+        out.push_back('\n');
+    }
+};
+
+static void AppendHeaderColumns(CsvRow &row, std::string_view header)
+{
+    const char *p = header.data();
+    row.Number(LoadLe32(p + HEADER_VERSION))
+        .Number(LoadLe32(p + HEADER_COMPACT_TARGET))
+        .Number(LoadLe64(p + HEADER_TIMESTAMP))
+        .Number(LoadLe64(p + HEADER_EPOCH))
+        .Hex(header.substr(HEADER_PARENT_HASH, 32));
+}
+
+static bool EncodeTransactionRows(uint64_t height, uint64_t tx_index, std::string_view view, std::string *tables)
+{
+    std::string_view hash, witness_hash, transaction, raw, witnesses;
+    if (!SplitTransactionView(view, hash, witness_hash, transaction) || !SplitTransaction(transaction, raw, witnesses))
+    {
+        return false;
+    }
+    RawTransactionFields fields;
+    thread_local std::vector<std::string_view> cell_deps, header_deps, inputs, outputs, outputs_data, witness_items;
+    if (!DecodeRawTransaction(raw, fields) ||
+        !GetFixVecItems(fields.cell_deps, CELL_DEP_SIZE, cell_deps) ||
+        !GetFixVecItems(fields.header_deps, 32, header_deps) ||
+        !GetFixVecItems(fields.inputs, CELL_INPUT_SIZE, inputs) ||
+        !GetDynVecItems(fields.outputs, outputs) ||
+        !GetDynVecItems(fields.outputs_data, outputs_data) ||
+        !GetDynVecItems(witnesses, witness_items) || outputs_data.size() != outputs.size())
+    {
+        return false;
+    }
+
+    CsvRow(tables[CSV_TRANSACTIONS]).Number(height).Number(tx_index).Hex(hash).Hex(witness_hash).Number(fields.version)
+        .Number(cell_deps.size()).Number(header_deps.size()).Number(inputs.size()).Number(outputs.size())
+        .Number(witness_items.size()).Number(transaction.size()).End();
+
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        const char *p = inputs[i].data();
+        CsvRow(tables[CSV_INPUTS]).Number(height).Number(tx_index).Number(i).Hex(inputs[i].substr(8, 32))
+            .Number(LoadLe32(p + 40)).Number(LoadLe64(p)).End();
+    }
+    for (size_t i = 0; i < outputs.size(); ++i)
+    {
+        CellOutputFields output;
+        std::string_view data;
+        if (!DecodeCellOutput(outputs[i], output) || !GetBytesData(outputs_data[i], data))
+        {
+            return false;
+        }
+        CsvRow row(tables[CSV_OUTPUTS]);
+        row.Number(height).Number(tx_index).Number(i).Number(output.capacity)
+            .Hex(output.lock.code_hash).Number(output.lock.hash_type).Hex(output.lock.args);
+        if (output.has_type)
+        {
+            row.Hex(output.type.code_hash).Number(output.type.hash_type).Hex(output.type.args);
+        }
+        else
+        {
+            row.Empty().Empty().Empty();
+        }
+        row.Number(data.size()).Hex(data).End();
+    }
+    for (size_t i = 0; i < cell_deps.size(); ++i)
+    {
+        const char *p = cell_deps[i].data();
+        CsvRow(tables[CSV_CELL_DEPS]).Number(height).Number(tx_index).Number(i).Hex(cell_deps[i].substr(0, 32))
+            .Number(LoadLe32(p + 32)).Number((uint8_t)p[36]).End();
+    }
+    for (size_t i = 0; i < header_deps.size(); ++i)
+    {
+        CsvRow(tables[CSV_HEADER_DEPS]).Number(height).Number(tx_index).Number(i).Hex(header_deps[i]).End();
+    }
+    return true;
+}
+
+bool EncodeCsvRows(const RawBlock &block, std::string &record)
+{
+    thread_local std::string tables[CSV_TABLE_COUNT];
+    for (auto &table : tables)
+    {
+        table.clear();
+    }
+
+    std::string_view hash, header, uncle_hashes, uncle_vec;
+    thread_local std::vector<std::string_view> hashes, uncles, proposals;
+    if (!SplitHeaderView(block.header, hash, header) || !SplitUncleBlockVecView(block.uncles, uncle_hashes, uncle_vec) ||
+        !GetByte32VecItems(uncle_hashes, hashes) || !GetUncleBlocks(uncle_vec, uncles) || hashes.size() != uncles.size() ||
+        !GetFixVecItems(block.proposals, ARCHIVE_PROPOSAL_SIZE, proposals))
+    {
+        ERRORLOG("block {} format error", block.number);
+        return false;
+    }
+
+    CsvRow row(tables[CSV_BLOCKS]);
+    row.Number(block.number).Hex(hash);
+    AppendHeaderColumns(row, header);
+    const char *p = header.data();
+    row.Hex(header.substr(HEADER_TRANSACTIONS_ROOT, 32)).Hex(header.substr(HEADER_PROPOSALS_HASH, 32))
+        .Hex(header.substr(HEADER_EXTRA_HASH, 32)).Hex(header.substr(HEADER_DAO, 32)).Number(LoadLe64(p + HEADER_DAO_C))
+        .Number(LoadLe64(p + HEADER_DAO_AR)).Number(LoadLe64(p + HEADER_DAO_S)).Number(LoadLe64(p + HEADER_DAO_U))
+        .Hex(header.substr(HEADER_NONCE, 16))
+        .Number(block.transactions.size()).Number(uncles.size()).Number(proposals.size());
+    if (block.has_extension)
+    {
+        std::string_view extension;
+        if (!GetBytesData(block.extension, extension))
+        {
+            ERRORLOG("block {} extension format error", block.number);
+            return false;
+        }
+        row.Hex(extension);
+    }
+    else
+    {
+        row.Empty();
+    }
+    row.End();
+
+    for (size_t i = 0; i < uncles.size(); ++i)
+    {
+        std::vector<std::string_view> uncle_fields;
+        if (!GetDynVecItems(uncles[i], uncle_fields) || uncle_fields.size() < 2 || uncle_fields[0].size() != 208 ||
+            uncle_fields[1].size() < 4)
+        {
+            ERRORLOG("block {} uncle {} format error", block.number, i);
+            return false;
+        }
+        std::string_view uncle_header = uncle_fields[0];
+        CsvRow uncle(tables[CSV_UNCLES]);
+        uncle.Number(block.number).Number(i).Hex(hashes[i]).Number(LoadLe64(uncle_header.data() + HEADER_NUMBER));
+        AppendHeaderColumns(uncle, uncle_header);
+        uncle.Hex(uncle_header.substr(HEADER_NONCE, 16)).Number(LoadLe32(uncle_fields[1].data())).End();
+    }
+
+    for (size_t i = 0; i < block.transactions.size(); ++i)
+    {
+        if (!EncodeTransactionRows(block.number, block.TransactionIndex(i), block.transactions[i], tables))
+        {
+            ERRORLOG("block {} transaction {} format error", block.number, i);
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < proposals.size(); ++i)
+    {
+        CsvRow(tables[CSV_PROPOSALS]).Number(block.number).Number(i).Hex(proposals[i]).End();
+    }
+
+    size_t size = 0;
+    for (auto &table : tables)
+    {
+        size += 4 + table.size();
+    }
+    record.clear();
+    record.reserve(size);
+    char len[4];
+    for (auto &table : tables)
+    {
+        StoreLe32(len, table.size());
+        record.append(len, sizeof(len));
+        record.append(table);
+    }
+    return true;
+}
+
+int EncodeCsvBlock(RocksDBReadOnly &db, uint64_t height, std::string &record)
+{
+    thread_local RawBlock block;
+    rocksdb::Status status;
+    if (!ReadRawBlock(db, height, block, status))
+    {
+        ERRORLOG("read block {} failed", height);
+        return -2;
+    }
+    return EncodeCsvRows(block, record) ? 0 : -3;
+}
+
+PipelineStages CsvPipelineStages()
+{
+    PipelineStages stages;
+    stages.fetch = [](RocksDBReadOnly &db, PipelineItem &item)
+    {
+        rocksdb::Status status;
+        return ReadRawBlock(db, item.height, item.source.block, status) ? 0 : -2;
+    };
+    stages.decode = [](PipelineItem &item)
+    {
+        return EncodeCsvRows(item.source.block, item.record) ? 0 : -3;
+    };
+    stages.serialize = [](PipelineItem &item)
+    {
+        return 0;
+    };
+    return stages;
+}
+
+CsvTableSink::CsvTableSink(const std::string &dir, const CompressOptions &compress, const std::set<std::string> &compressed,
+                           const WriterOptions &writer)
+    : open_(true)
+{
+    std::string prefix = dir;
+    if (!prefix.empty() && '/' != prefix.back())
+    {
+        prefix.push_back('/');
+    }
+    for (int i = 0; i < CSV_TABLE_COUNT; ++i)
+    {
+        bool compress_table = COMPRESS_NONE != compress.type && (compressed.empty() || compressed.count(TABLE_NAMES[i]));
+        std::string path = prefix + TABLE_NAMES[i] + ".csv" + (compress_table ? CompressSuffix(compress.type) : "");
+        auto file = new FileSink(path, false, writer);
+        tables_[i].reset(file);
+        if (!file->IsOpen())
+        {
+            open_ = false;
+            continue;
+        }
+        if (compress_table)
+        {
+            std::string columns;
+            open_ = open_ && CompressFrame(compress.type, compress.level, TABLE_COLUMNS[i], columns) && file->Write(0, columns);
+            tables_[i].reset(new CompressedSink(std::move(tables_[i]), compress));
+        }
+        else
+        {
+            open_ = open_ && file->Write(0, TABLE_COLUMNS[i]);
+        }
+    }
+}
+
+bool CsvTableSink::IsOpen() const
+{
+    return open_;
+}
+
+bool CsvTableSink::Write(uint64_t height, const std::string &record)
+{
+    size_t pos = 0;
+    for (int i = 0; i < CSV_TABLE_COUNT; ++i)
+    {
+        if (pos + 4 > record.size())
+        {
+            ERRORLOG("csv record of block {} is truncated", height);
+            return false;
+        }
+        size_t size = LoadLe32(record.data() + pos);
+        pos += 4;
+        if (pos + size > record.size())
+        {
+            ERRORLOG("csv record of block {} is truncated", height);
+            return false;
+        }
+        if (size > 0)
+        {
+            section_.assign(record, pos, size);
+            if (!tables_[i]->Write(height, section_))
+            {
+                return false;
+            }
+        }
+        pos += size;
+    }
+    return true;
+}
+
+bool CsvTableSink::Close()
+{
+    bool success = true;
+    for (auto &table : tables_)
+    {
+        if (nullptr != table && !table->Close())
+        {
+            success = false;
+        }
+    }
+    return success;
+}
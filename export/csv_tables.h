@@ -0,0 +1,49 @@
+#ifndef _EXPORT_CSV_TABLES_H_
+#define _EXPORT_CSV_TABLES_H_
+
+#include "db/raw_block.h"
+#include "export/block_sink.h"
+#include "export/compressed_sink.h"
+#include "export/pipeline.h"
+#include <set>
+
+enum CsvTable
+{
+    CSV_BLOCKS = 0,
+    CSV_UNCLES,
+    CSV_TRANSACTIONS,
+    CSV_INPUTS,
+    CSV_OUTPUTS,
+    CSV_CELL_DEPS,
+    CSV_HEADER_DEPS,
+    CSV_PROPOSALS,
+    CSV_TABLE_COUNT,
+};
+
+const char *CsvTableName(int table);
+const char *CsvTableColumns(int table);
+
+// The rows one block adds to every table, CSV_TABLE_COUNT sections of a u32 size followed by
+// the rows. Rows are keyed by height, tx_index and the index inside the transaction.
+bool EncodeCsvRows(const RawBlock &block, std::string &record);
+int EncodeCsvBlock(RocksDBReadOnly &db, uint64_t height, std::string &record);
+PipelineStages CsvPipelineStages();
+
+// "<dir>/<table>.csv" per table, each behind its own buffered writer and optionally compressed
+class CsvTableSink : public BlockSink
+{
+public:
+    // compressed lists the tables to compress, empty means all of them
+    CsvTableSink(const std::string &dir, const CompressOptions &compress, const std::set<std::string> &compressed,
+                 const WriterOptions &writer = WriterOptions());
+    bool IsOpen() const;
+    bool Write(uint64_t height, const std::string &record) override;
+    bool Close() override;
+
+private:
+    std::unique_ptr<BlockSink> tables_[CSV_TABLE_COUNT];
+    std::string section_;
+    bool open_;
+};
+
+#endif
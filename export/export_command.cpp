@@ -0,0 +1,420 @@
+#include "export_command.h"
+#include "archive/archive_writer.h"
+#include "db/columns.h"
+#include "db/raw_block.h"
+#include "export/block_json.h"
+#include "export/block_sink.h"
+#include "export/checkpoint.h"
+#include "export/columnar_export.h"
+#include "export/compressed_sink.h"
+#include "export/csv_tables.h"
+#include "export/molecule_export.h"
+#include "export/parallel_exporter.h"
+#include "export/pipeline.h"
+#include "export/protobuf_export.h"
+#include "export/script_filter.h"
+#include "export/shard_sink.h"
+#include "export/sync_state.h"
+#include "utils/arg_utils.h"
+#include "utils/file_utils.h"
+#include "utils/parallel_for.hpp"
+#include <iostream>
+#include <sstream>
+
+void PrintExportUsage()
+{
+    printf("export options:\n"
+           "    --format=json|molecule|protobuf --output=path\n"
+           "    --format=protobuf --records=cells|epochs --output=path   live cells or epochs of the tip, start and end are ignored\n"
+           "    --format=ndjson --output=prefix|- [--shard-bytes=n] [--shard-blocks=n]\n"
+           "    --format=archive --output=path [--archive-chunk-blocks=n]\n"
+           "    --format=csv --output=dir [--compress-tables=outputs,inputs,...]\n"
+           "    --format=columnar --output=dir [--row-group-rows=n]\n"
+           "    --engine=chunks [--chunk-bytes=n] [--max-inflight=bytes] [--max-rate=blocks]\n"
+           "    --engine=pipeline [--fetch-threads=n] [--decode-threads=n] [--serialize-threads=n]\n"
+           "                      [--queue-capacity=n] [--stats-interval=seconds]\n"
+           "    --write-buffer=bytes [--preallocate=bytes] [--direct-io] [--fsync=none|close|bytes]\n"
+           "    --filter=rules [--filter-inputs]   all formats but archive and molecule\n"
+           "    --dedup-data=dir [--dedup-seen=entries] [--dedup-min-bytes=n]   json, ndjson and protobuf only\n"
+           "    --compress=gzip|zstd [--compress-level=n] [--compress-threads=n] [--frame-bytes=n]\n"
+           "    --checkpoint=path [--checkpoint-interval=seconds] [--resume]\n"
+           "    --incremental=state [--reorg-depth=n]   ndjson only, end is capped at the tip\n");
+}
+
+int RunExport(RocksDBReadOnly &db, uint64_t start, uint64_t end, const std::map<std::string, std::string> &options)
+{
+    std::string format = GetOption(options, "format", "json");
+    CompressOptions compress_options;
+    if (!ParseCompressType(GetOption(options, "compress", "none"), compress_options.type))
+    {
+        printf("unsupported compression %s\n", GetOption(options, "compress", "").c_str());
+        return EXPORT_INVALID_OPTIONS;
+    }
+    compress_options.level = GetOptionNumber(options, "compress-level", DefaultCompressLevel(compress_options.type));
+    compress_options.threads = GetOptionNumber(options, "compress-threads", compress_options.threads);
+    compress_options.frame_bytes = GetOptionNumber(options, "frame-bytes", compress_options.frame_bytes);
+    std::string compress_suffix = CompressSuffix(compress_options.type);
+
+    std::string checkpoint_path = GetOption(options, "checkpoint", "");
+    std::string state_path = GetOption(options, "incremental", "");
+    SyncState sync_state;
+    std::vector<OrphanedBlock> orphaned;
+    if (!state_path.empty())
+    {
+        if ("ndjson" != format || !checkpoint_path.empty())
+        {
+            printf("incremental exports need --format=ndjson and can not be checkpointed\n");
+            return EXPORT_INVALID_OPTIONS;
+        }
+        sync_state.format = format + compress_suffix;
+        sync_state.output = GetOption(options, "output", "blocks");
+        sync_state.next_height = start;
+        if (FileExists(state_path))
+        {
+            SyncState saved;
+            if (!LoadSyncState(state_path, saved))
+            {
+                return -15;
+            }
+            if (saved.format != sync_state.format || saved.output != sync_state.output)
+            {
+                printf("sync state %s belongs to another export: %s %s\n", state_path.c_str(), saved.format.c_str(), saved.output.c_str());
+                return -15;
+            }
+            sync_state = saved;
+        }
+        std::string tip_hash;
+        uint64_t tip = 0;
+        rocksdb::Status status;
+        if (!ReadTipHeader(db, tip_hash, tip, status))
+        {
+            printf("read tip header failed:%s\n", status.ToString().c_str());
+            return -15;
+        }
+        if (!DetectReorg(db, sync_state, orphaned))
+        {
+            return -15;
+        }
+        start = sync_state.next_height;
+        end = std::min(end, tip + 1);
+        if (start >= end && orphaned.empty())
+        {
+            printf("up to date at block %lu, tip %lu\n", start, tip);
+            return 0;
+        }
+        end = std::max(start, end);
+    }
+
+    bool resume = HasOption(options, "resume");
+    ExportCheckpoint checkpoint;
+    checkpoint.format = format + compress_suffix;
+    checkpoint.output = GetOption(options, "output", "");
+    checkpoint.start = start;
+    checkpoint.end = end;
+    checkpoint.next_height = start;
+    if (resume)
+    {
+        ExportCheckpoint saved;
+        if (checkpoint_path.empty() || !LoadCheckpoint(checkpoint_path, saved))
+        {
+            printf("--resume needs a readable --checkpoint\n");
+            return -13;
+        }
+        if (saved.format != checkpoint.format || saved.output != checkpoint.output || saved.start != start || saved.end != end)
+        {
+            printf("checkpoint %s belongs to another export: %s %s [%lu, %lu)\n", checkpoint_path.c_str(),
+                   saved.format.c_str(), saved.output.c_str(), saved.start, saved.end);
+            return -13;
+        }
+        if (saved.complete)
+        {
+            printf("export [%lu, %lu) is already complete\n", start, end);
+            return 0;
+        }
+        if (!VerifyCheckpointBoundary(db, saved))
+        {
+            printf("block %lu changed since the checkpoint\n", saved.next_height - 1);
+            return -13;
+        }
+        checkpoint = saved;
+    }
+
+    WriterOptions writer_options;
+    writer_options.buffer_bytes = GetOptionNumber(options, "write-buffer", writer_options.buffer_bytes);
+    writer_options.preallocate_bytes = GetOptionNumber(options, "preallocate", writer_options.preallocate_bytes);
+    writer_options.direct = HasOption(options, "direct-io");
+    if (!ParseFsyncPolicy(GetOption(options, "fsync", "none"), writer_options))
+    {
+        printf("--fsync expects none, close or a byte interval\n");
+        return EXPORT_INVALID_OPTIONS;
+    }
+
+    // Declared before the sink, the encoders use it until the sink is gone
+    std::unique_ptr<CellDataStore> data_store;
+    std::string dedup_dir = GetOption(options, "dedup-data", "");
+    if (!dedup_dir.empty())
+    {
+        if ("json" != format && "ndjson" != format && "protobuf" != format)
+        {
+            printf("--dedup-data works with the json, ndjson and protobuf formats\n");
+            return EXPORT_INVALID_OPTIONS;
+        }
+        data_store.reset(new CellDataStore(dedup_dir, GetOptionNumber(options, "dedup-seen", 1 << 22),
+                                           GetOptionNumber(options, "dedup-min-bytes", 64)));
+        if (!data_store->IsOpen())
+        {
+            return -1;
+        }
+    }
+    CellDataStore *store = data_store.get();
+
+    ScriptFilter filter;
+    std::string filter_path = GetOption(options, "filter", "");
+    if (!filter_path.empty())
+    {
+        if ("archive" == format || "molecule" == format)
+        {
+            printf("archive and molecule exports keep whole blocks and can not be filtered\n");
+            return EXPORT_INVALID_OPTIONS;
+        }
+        if (!filter.Load(filter_path))
+        {
+            return -1;
+        }
+    }
+
+    std::string records = GetOption(options, "records", "blocks");
+    std::unique_ptr<BlockSink> sink;
+    BlockEncoder encoder;
+    PipelineStages stages;
+    if ("molecule" == format)
+    {
+        auto file = new FileSink(GetOption(options, "output", std::to_string(start) + "_" + std::to_string(end) + ".mol" + compress_suffix), resume, writer_options);
+        sink.reset(file);
+        if (!file->IsOpen())
+        {
+            return -1;
+        }
+        encoder = EncodeMoleculeBlock;
+        stages = MoleculePipelineStages();
+    }
+    else if ("protobuf" == format)
+    {
+        if ("blocks" != records && "cells" != records && "epochs" != records)
+        {
+            printf("--records expects blocks, cells or epochs\n");
+            return EXPORT_INVALID_OPTIONS;
+        }
+        if ("blocks" != records && (!checkpoint_path.empty() || !state_path.empty() || !filter_path.empty()))
+        {
+            printf("cells and epochs exports can not be filtered, checkpointed or run incrementally\n");
+            return EXPORT_INVALID_OPTIONS;
+        }
+        std::string name = "blocks" == records ? std::to_string(start) + "_" + std::to_string(end) : records;
+        auto file = new FileSink(GetOption(options, "output", name + ".pb" + compress_suffix), resume, writer_options);
+        sink.reset(file);
+        if (!file->IsOpen())
+        {
+            return -1;
+        }
+        encoder = [store](RocksDBReadOnly &db, uint64_t height, std::string &record)
+        {
+            return EncodeProtobufBlock(db, height, record, store);
+        };
+        stages = ProtobufPipelineStages(store);
+    }
+    else if ("json" == format)
+    {
+        sink.reset(new PerBlockFileSink(GetOption(options, "output", ""), ".txt" + compress_suffix));
+        // Every block file is a complete stream of its own
+        compress_options.frame_bytes = 0;
+        encoder = [store](RocksDBReadOnly &db, uint64_t height, std::string &record)
+        {
+            return EncodeBlockJson(db, height, record, store);
+        };
+        stages = JsonPipelineStages(false, store);
+    }
+    else if ("archive" == format)
+    {
+        if (COMPRESS_NONE != compress_options.type)
+        {
+            printf("archives are read through mmap and can not be compressed\n");
+            return EXPORT_INVALID_OPTIONS;
+        }
+        auto archive = new ArchiveSink(GetOption(options, "output", std::to_string(start) + "_" + std::to_string(end) + ".ckba"),
+                                       GetOptionNumber(options, "archive-chunk-blocks", ARCHIVE_DEFAULT_CHUNK_BLOCKS), resume, writer_options);
+        sink.reset(archive);
+        if (!archive->IsOpen())
+        {
+            return -1;
+        }
+        encoder = EncodeArchiveBlock;
+        stages = ArchivePipelineStages();
+    }
+    else if ("csv" == format)
+    {
+        if (!checkpoint_path.empty())
+        {
+            printf("csv exports write several tables and can not be checkpointed\n");
+            return EXPORT_INVALID_OPTIONS;
+        }
+        std::set<std::string> compressed;
+        std::stringstream tables(GetOption(options, "compress-tables", ""));
+        for (std::string table; std::getline(tables, table, ',');)
+        {
+            compressed.insert(table);
+        }
+        auto csv = new CsvTableSink(GetOption(options, "output", ""), compress_options, compressed, writer_options);
+        sink.reset(csv);
+        if (!csv->IsOpen())
+        {
+            return -1;
+        }
+        // Compression is applied per table by the sink itself
+        compress_options.type = COMPRESS_NONE;
+        encoder = EncodeCsvBlock;
+        stages = CsvPipelineStages();
+    }
+    else if ("columnar" == format)
+    {
+        if (COMPRESS_NONE != compress_options.type || !checkpoint_path.empty())
+        {
+            printf("columnar exports can not be compressed or checkpointed\n");
+            return EXPORT_INVALID_OPTIONS;
+        }
+        sink.reset(new ColumnarSink(GetOption(options, "output", "."), GetOptionNumber(options, "row-group-rows", COLUMNAR_DEFAULT_ROW_GROUP_ROWS)));
+        encoder = EncodeColumnarBlock;
+        stages = ColumnarPipelineStages();
+    }
+    else if ("ndjson" == format)
+    {
+        std::string output = GetOption(options, "output", "blocks");
+        if ("-" == output)
+        {
+            sink.reset(new StdoutSink());
+        }
+        else
+        {
+            ShardOptions shard_options;
+            shard_options.prefix = output;
+            shard_options.suffix += compress_suffix;
+            shard_options.max_bytes = GetOptionNumber(options, "shard-bytes", shard_options.max_bytes);
+            shard_options.max_blocks = GetOptionNumber(options, "shard-blocks", shard_options.max_blocks);
+            shard_options.writer = writer_options;
+            if (!state_path.empty())
+            {
+                shard_options.run = sync_state.runs + 1;
+            }
+            sink.reset(new ShardedFileSink(shard_options));
+        }
+        encoder = [store](RocksDBReadOnly &db, uint64_t height, std::string &record)
+        {
+            return EncodeBlockNdjson(db, height, record, store);
+        };
+        stages = JsonPipelineStages(true, store);
+    }
+    else
+    {
+        printf("unknown format %s\n", format.c_str());
+        return EXPORT_INVALID_OPTIONS;
+    }
+
+    if (!filter_path.empty())
+    {
+        stages = FilterPipelineStages(stages, filter, HasOption(options, "filter-inputs"), "json" == format || "ndjson" == format);
+        encoder = StagesEncoder(stages);
+    }
+
+    if (COMPRESS_NONE != compress_options.type)
+    {
+        sink.reset(new CompressedSink(std::move(sink), compress_options));
+    }
+
+    // Whole column families, the height range and the engine do not apply
+    if ("protobuf" == format && "blocks" != records)
+    {
+        return ExportProtobufColumn(db, "cells" == records ? COLUMN_CELL : COLUMN_EPOCH, *sink) ? 0 : -11;
+    }
+
+    // Consumers drop the orphaned blocks before the replacements arrive
+    for (auto &block : orphaned)
+    {
+        if (!sink->Write(start, EncodeRollbackMarker(block)))
+        {
+            return -11;
+        }
+    }
+
+    CheckpointSink *checkpoint_sink = nullptr;
+    if (!checkpoint_path.empty())
+    {
+        if (resume && !sink->Resume(checkpoint.position))
+        {
+            printf("resume output at block %lu failed\n", checkpoint.next_height);
+            return -13;
+        }
+        checkpoint_sink = new CheckpointSink(db, std::move(sink), checkpoint_path, checkpoint,
+                                             GetOptionNumber(options, "checkpoint-interval", 30));
+        sink.reset(checkpoint_sink);
+        InstallStopHandler();
+    }
+    start = checkpoint.next_height;
+
+    std::string engine = GetOption(options, "engine", "chunks");
+    int ret = 0;
+    if (start >= end)
+    {
+        // Only rollbacks, the chain got shorter
+        ret = sink->Close() ? 0 : -11;
+    }
+    else if ("pipeline" == engine)
+    {
+        PipelineOptions pipeline_options;
+        pipeline_options.fetch_threads = GetOptionNumber(options, "fetch-threads", pipeline_options.fetch_threads);
+        pipeline_options.decode_threads = GetOptionNumber(options, "decode-threads", pipeline_options.decode_threads);
+        pipeline_options.serialize_threads = GetOptionNumber(options, "serialize-threads", pipeline_options.serialize_threads);
+        pipeline_options.queue_capacity = GetOptionNumber(options, "queue-capacity", pipeline_options.queue_capacity);
+        pipeline_options.stats_interval = GetOptionNumber(options, "stats-interval", pipeline_options.stats_interval);
+        std::vector<StageMetrics> metrics;
+        ret = RunPipeline(db, start, end, pipeline_options, stages, *sink, metrics);
+        std::cerr << FormatStageMetrics(metrics);
+    }
+    else if ("chunks" == engine)
+    {
+        ExportOptions export_options;
+        export_options.threads = GetOptionNumber(options, "threads", DefaultThreadCount());
+        export_options.chunk_bytes = GetOptionNumber(options, "chunk-bytes", export_options.chunk_bytes);
+        export_options.max_inflight_bytes = GetOptionNumber(options, "max-inflight", export_options.max_inflight_bytes);
+        export_options.max_blocks_per_second = GetOptionNumber(options, "max-rate", export_options.max_blocks_per_second);
+        ret = ExportRange(db, start, end, export_options, encoder, *sink);
+    }
+    else
+    {
+        printf("unknown engine %s\n", engine.c_str());
+        return EXPORT_INVALID_OPTIONS;
+    }
+
+    if (nullptr != checkpoint_sink && checkpoint_sink->Interrupted())
+    {
+        printf("export stopped at block %lu, continue with --resume\n", checkpoint_sink->NextHeight());
+        return -14;
+    }
+    if (nullptr != store)
+    {
+        CellDataStoreStats stats = store->Stats();
+        fprintf(stderr, "cell data: %lu blobs written (%lu bytes), %lu duplicates (%lu bytes saved)\n", stats.blobs, stats.bytes,
+                stats.duplicates, stats.bytes_saved);
+    }
+    if (0 == ret && !state_path.empty())
+    {
+        sync_state.next_height = end;
+        ++sync_state.runs;
+        if (!RecordRecentHashes(db, sync_state, start, GetOptionNumber(options, "reorg-depth", 256)) ||
+            !SaveSyncState(state_path, sync_state))
+        {
+            return -15;
+        }
+        printf("exported [%lu, %lu), rolled back %zu blocks\n", start, end, orphaned.size());
+    }
+    return ret;
+}
@@ -0,0 +1,15 @@
+#ifndef _EXPORT_EXPORT_COMMAND_H_
+#define _EXPORT_EXPORT_COMMAND_H_
+
+#include "db/rocksdb_read_only.h"
+#include <map>
+#include <string>
+
+// Returned by RunExport when the options do not make a valid export
+const int EXPORT_INVALID_OPTIONS = -20;
+
+// --mode=export: picks the format, sink and engine from the command line options
+int RunExport(RocksDBReadOnly &db, uint64_t start, uint64_t end, const std::map<std::string, std::string> &options);
+void PrintExportUsage();
+
+#endif
@@ -0,0 +1,26 @@
+#include "molecule_export.h"
+#include "db/raw_block.h"
+#include "log/logging.h"
+#include "molecule/block_molecule.h"
+#include <endian.h>
+
+int EncodeMoleculeBlock(RocksDBReadOnly &db, uint64_t height, std::string &record)
+{
+    thread_local RawBlock block;
+    thread_local std::string molecule;
+    rocksdb::Status status;
+    if (!ReadRawBlock(db, height, block, status))
+    {
+        ERRORLOG("read block {} failed", height);
+        return -2;
+    }
+    if (!BuildBlockMolecule(block, molecule))
+    {
+        ERRORLOG("build block {} failed", height);
+        return -3;
+    }
+    uint32_t len = htole32(molecule.size());
+    record.assign((char *)&len, sizeof(len));
+    record.append(molecule);
+    return 0;
+}
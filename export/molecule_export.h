@@ -0,0 +1,10 @@
+#ifndef _EXPORT_MOLECULE_EXPORT_H_
+#define _EXPORT_MOLECULE_EXPORT_H_
+
+#include "db/rocksdb_read_only.h"
+#include <string>
+
+// A little endian uint32 length followed by the packed Block/BlockV1
+int EncodeMoleculeBlock(RocksDBReadOnly &db, uint64_t height, std::string &record);
+
+#endif
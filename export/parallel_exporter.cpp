@@ -0,0 +1,222 @@
+#include "parallel_exporter.h"
+#include "log/logging.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static const uint64_t INITIAL_CHUNK_BLOCKS = 16;
+static const uint64_t MAX_CHUNK_BLOCKS = 65536;
+
+struct ExportChunk
+{
+    uint64_t begin = 0;
+    uint64_t end = 0;
+    uint64_t reserved = 0; // in-flight bytes accounted when the chunk was planned
+    uint64_t bytes = 0;
+    std::vector<std::string> records;
+};
+
+class ParallelExporter
+{
+public:
+    ParallelExporter(RocksDBReadOnly &db, uint64_t start, uint64_t end, const ExportOptions &options,
+                     const BlockEncoder &encoder, BlockSink &sink);
+    int Run();
+
+private:
+    bool NextChunk(ExportChunk &chunk);
+    void FinishChunk(ExportChunk &chunk);
+    void Work();
+    int Commit();
+    void Fail(int code);
+
+    RocksDBReadOnly &db_;
+    uint64_t end_;
+    const ExportOptions &options_;
+    const BlockEncoder &encoder_;
+    BlockSink &sink_;
+
+    std::mutex mutex_;
+    std::condition_variable plan_cv_;
+    std::condition_variable commit_cv_;
+    uint64_t next_height_;
+    uint64_t commit_height_;
+    double bytes_per_block_;
+    uint64_t inflight_bytes_;
+    uint32_t running_workers_;
+    std::map<uint64_t, ExportChunk> finished_; // reorder buffer keyed by the first height of a chunk
+    int error_;
+};
+
+ParallelExporter::ParallelExporter(RocksDBReadOnly &db, uint64_t start, uint64_t end, const ExportOptions &options,
+                                   const BlockEncoder &encoder, BlockSink &sink)
+    : db_(db), end_(end), options_(options), encoder_(encoder), sink_(sink),
+      next_height_(start), commit_height_(start), bytes_per_block_(0), inflight_bytes_(0),
+      running_workers_(0), error_(0)
+{
+}
+
+bool ParallelExporter::NextChunk(ExportChunk &chunk)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    plan_cv_.wait(lock, [this]()
+                  { return 0 != error_ || next_height_ >= end_ || 0 == inflight_bytes_ ||
+                           inflight_bytes_ < options_.max_inflight_bytes; });
+    if (0 != error_ || next_height_ >= end_)
+    {
+        return false;
+    }
+    // chunks are sized from the encoded bytes per block seen so far, so that dense
+    // recent blocks get short chunks and the sparse early chain long ones
+    uint64_t blocks = INITIAL_CHUNK_BLOCKS;
+    if (bytes_per_block_ > 0)
+    {
+        blocks = std::clamp<uint64_t>(options_.chunk_bytes / bytes_per_block_, 1, MAX_CHUNK_BLOCKS);
+    }
+    chunk.begin = next_height_;
+    chunk.end = std::min(end_, next_height_ + blocks);
+    chunk.reserved = (chunk.end - chunk.begin) * bytes_per_block_;
+    chunk.bytes = 0;
+    chunk.records.clear();
+    next_height_ = chunk.end;
+    inflight_bytes_ += chunk.reserved;
+    return true;
+}
+
+void ParallelExporter::FinishChunk(ExportChunk &chunk)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    double average = (double)chunk.bytes / (chunk.end - chunk.begin);
+    bytes_per_block_ = bytes_per_block_ > 0 ? bytes_per_block_ * 0.75 + average * 0.25 : average;
+    inflight_bytes_ = inflight_bytes_ - chunk.reserved + chunk.bytes;
+    uint64_t begin = chunk.begin;
+    finished_.emplace(begin, std::move(chunk));
+    commit_cv_.notify_one();
+}
+
+void ParallelExporter::Work()
+{
+    ExportChunk chunk;
+    std::string record;
+    while (NextChunk(chunk))
+    {
+        int code = 0;
+        for (uint64_t height = chunk.begin; height < chunk.end; ++height)
+        {
+            code = encoder_(db_, height, record);
+            if (0 != code)
+            {
+                ERRORLOG("encode block {} failed:{}", height, code);
+                break;
+            }
+            chunk.bytes += record.size();
+            chunk.records.push_back(std::move(record));
+        }
+        if (0 != code)
+        {
+            Fail(code);
+            break;
+        }
+        FinishChunk(chunk);
+        chunk = ExportChunk();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    --running_workers_;
+    commit_cv_.notify_one();
+}
+
+int ParallelExporter::Commit()
+{
+    auto started = std::chrono::steady_clock::now();
+    uint64_t committed = 0;
+    while (true)
+    {
+        ExportChunk chunk;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (commit_height_ >= end_)
+            {
+                return 0;
+            }
+            commit_cv_.wait(lock, [this]()
+                            { return 0 != error_ || 0 == running_workers_ || finished_.count(commit_height_) > 0; });
+            if (0 != error_)
+            {
+                return error_;
+            }
+            auto it = finished_.find(commit_height_);
+            if (finished_.end() == it)
+            {
+                ERRORLOG("workers stopped before block {}", commit_height_);
+                return -12;
+            }
+            chunk = std::move(it->second);
+            finished_.erase(it);
+        }
+        for (size_t i = 0; i < chunk.records.size(); ++i)
+        {
+            if (!sink_.Write(chunk.begin + i, chunk.records[i]))
+            {
+                return -11;
+            }
+            ++committed;
+            if (options_.max_blocks_per_second > 0)
+            {
+                std::this_thread::sleep_until(started + std::chrono::microseconds(committed * 1000000 / options_.max_blocks_per_second));
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            inflight_bytes_ -= chunk.bytes;
+            commit_height_ = chunk.end;
+        }
+        plan_cv_.notify_all();
+    }
+}
+
+void ParallelExporter::Fail(int code)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (0 == error_)
+    {
+        error_ = code;
+    }
+    plan_cv_.notify_all();
+    commit_cv_.notify_all();
+}
+
+int ParallelExporter::Run()
+{
+    uint32_t threads = std::max<uint32_t>(options_.threads, 1);
+    running_workers_ = threads;
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < threads; ++i)
+    {
+        workers.emplace_back(&ParallelExporter::Work, this);
+    }
+    int ret = Commit();
+    if (0 != ret)
+    {
+        Fail(ret);
+    }
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    if (0 == ret && !sink_.Close())
+    {
+        ret = -11;
+    }
+    return ret;
+}
+
+int ExportRange(RocksDBReadOnly &db, uint64_t start, uint64_t end, const ExportOptions &options,
+                const BlockEncoder &encoder, BlockSink &sink)
+{
+    ParallelExporter exporter(db, start, end, options, encoder, sink);
+    return exporter.Run();
+}
@@ -0,0 +1,23 @@
+#ifndef _EXPORT_PARALLEL_EXPORTER_H_
+#define _EXPORT_PARALLEL_EXPORTER_H_
+
+#include "db/rocksdb_read_only.h"
+#include "export/block_sink.h"
+#include <functional>
+
+struct ExportOptions
+{
+    uint32_t threads = 1;
+    uint64_t chunk_bytes = 8 * 1024 * 1024;        // target encoded size of one chunk of heights
+    uint64_t max_inflight_bytes = 1024 * 1024 * 1024; // encoded records waiting for the sink
+    uint64_t max_blocks_per_second = 0;            // 0 means unlimited
+};
+
+// Encodes one block into the record handed to the sink, returns 0 or a negative error code
+typedef std::function<int(RocksDBReadOnly &db, uint64_t height, std::string &record)> BlockEncoder;
+
+// Encodes [start, end) on a worker pool and writes the records to sink in height order
+int ExportRange(RocksDBReadOnly &db, uint64_t start, uint64_t end, const ExportOptions &options,
+                const BlockEncoder &encoder, BlockSink &sink);
+
+#endif
@@ -0,0 +1,399 @@
+#include "pipeline.h"
+#include "log/logging.h"
+#include "molecule/block_molecule.h"
+#include "utils/bounded_queue.hpp"
+#include <algorithm>
+#include <chrono>
+#include <endian.h>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+enum
+{
+    STAGE_FETCH = 0,
+    STAGE_DECODE,
+    STAGE_SERIALIZE,
+    STAGE_WRITE,
+    STAGE_COUNT
+};
+static const char *STAGE_NAMES[STAGE_COUNT] = {"fetch", "decode", "serialize", "write"};
+static const uint32_t MONITOR_SAMPLE_MS = 10;
+
+typedef BoundedQueue<PipelineItem *> ItemQueue;
+
+static uint64_t NowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double StageMetrics::Utilization() const
+{
+    if (0 == wall_ns || 0 == threads)
+    {
+        return 0;
+    }
+    return (double)busy_ns / ((double)wall_ns * threads);
+}
+
+struct StageCounter
+{
+    uint32_t threads = 0;
+    std::atomic<uint32_t> running{0};
+    std::atomic<uint64_t> items{0};
+    std::atomic<uint64_t> busy_ns{0};
+    uint64_t depth_sum = 0;
+    uint64_t depth_samples = 0;
+    size_t depth_max = 0;
+};
+
+class Pipeline
+{
+public:
+    Pipeline(RocksDBReadOnly &db, uint64_t start, uint64_t end, const PipelineOptions &options,
+             const PipelineStages &stages, BlockSink &sink);
+    int Run(std::vector<StageMetrics> &metrics);
+
+private:
+    void Fetch();
+    void Transform(int stage);
+    int Write();
+    void Monitor();
+    void Fail(int code);
+    void CloseAll();
+    void Collect(std::vector<StageMetrics> &metrics, uint64_t wall_ns);
+
+    RocksDBReadOnly &db_;
+    uint64_t start_;
+    uint64_t end_;
+    const PipelineOptions &options_;
+    const PipelineStages &stages_;
+    BlockSink &sink_;
+
+    std::vector<std::unique_ptr<PipelineItem>> items_;
+    // queues_[stage] is the input of stage, the fetch input holds the free items
+    std::unique_ptr<ItemQueue> queues_[STAGE_COUNT];
+    StageCounter counters_[STAGE_COUNT];
+    std::atomic<uint64_t> cursor_;
+    std::atomic<int> error_;
+    std::atomic<bool> stop_monitor_;
+    uint64_t started_ns_;
+};
+
+Pipeline::Pipeline(RocksDBReadOnly &db, uint64_t start, uint64_t end, const PipelineOptions &options,
+                   const PipelineStages &stages, BlockSink &sink)
+    : db_(db), start_(start), end_(end), options_(options), stages_(stages), sink_(sink),
+      cursor_(start), error_(0), stop_monitor_(false), started_ns_(0)
+{
+    size_t capacity = std::max<size_t>(options_.queue_capacity, 2);
+    for (int i = 0; i < STAGE_COUNT; ++i)
+    {
+        queues_[i].reset(new ItemQueue(capacity));
+    }
+    // every queue can hold all items, so a push only waits for a consumer and never deadlocks
+    items_.resize(capacity);
+    for (auto &item : items_)
+    {
+        item.reset(new PipelineItem());
+        PipelineItem *ptr = item.get();
+        queues_[STAGE_FETCH]->Push(ptr);
+    }
+    counters_[STAGE_FETCH].threads = std::max<uint32_t>(options_.fetch_threads, 1);
+    counters_[STAGE_DECODE].threads = std::max<uint32_t>(options_.decode_threads, 1);
+    counters_[STAGE_SERIALIZE].threads = std::max<uint32_t>(options_.serialize_threads, 1);
+    counters_[STAGE_WRITE].threads = 1;
+}
+
+void Pipeline::Fail(int code)
+{
+    int expected = 0;
+    error_.compare_exchange_strong(expected, code);
+    CloseAll();
+}
+
+void Pipeline::CloseAll()
+{
+    for (auto &queue : queues_)
+    {
+        queue->Close();
+    }
+}
+
+void Pipeline::Fetch()
+{
+    StageCounter &counter = counters_[STAGE_FETCH];
+    PipelineItem *item = nullptr;
+    while (0 == error_ && queues_[STAGE_FETCH]->Pop(item))
+    {
+        uint64_t height = cursor_.fetch_add(1);
+        if (height >= end_)
+        {
+            // wakes the other fetchers waiting for a free item
+            queues_[STAGE_FETCH]->Close();
+            break;
+        }
+        item->height = height;
+        uint64_t begin = NowNs();
+        int code = stages_.fetch(db_, *item);
+        counter.busy_ns += NowNs() - begin;
+        ++counter.items;
+        if (0 != code)
+        {
+            ERRORLOG("fetch block {} failed:{}", height, code);
+            Fail(code);
+            break;
+        }
+        if (!queues_[STAGE_DECODE]->Push(item))
+        {
+            break;
+        }
+    }
+    if (1 == counter.running.fetch_sub(1))
+    {
+        queues_[STAGE_DECODE]->Close();
+    }
+}
+
+void Pipeline::Transform(int stage)
+{
+    StageCounter &counter = counters_[stage];
+    PipelineItem *item = nullptr;
+    while (0 == error_ && queues_[stage]->Pop(item))
+    {
+        uint64_t begin = NowNs();
+        int code = STAGE_DECODE == stage ? stages_.decode(*item) : stages_.serialize(*item);
+        counter.busy_ns += NowNs() - begin;
+        ++counter.items;
+        if (0 != code)
+        {
+            ERRORLOG("{} block {} failed:{}", STAGE_NAMES[stage], item->height, code);
+            Fail(code);
+            break;
+        }
+        if (!queues_[stage + 1]->Push(item))
+        {
+            break;
+        }
+    }
+    if (1 == counter.running.fetch_sub(1))
+    {
+        queues_[stage + 1]->Close();
+    }
+}
+
+int Pipeline::Write()
+{
+    StageCounter &counter = counters_[STAGE_WRITE];
+    // decode and serialize run on several threads, so items arrive out of order
+    std::map<uint64_t, PipelineItem *> pending;
+    uint64_t next = start_;
+    PipelineItem *item = nullptr;
+    while (next < end_)
+    {
+        auto it = pending.find(next);
+        if (pending.end() == it)
+        {
+            if (!queues_[STAGE_WRITE]->Pop(item))
+            {
+                return 0 != error_ ? error_.load() : -12;
+            }
+            pending.emplace(item->height, item);
+            continue;
+        }
+        item = it->second;
+        pending.erase(it);
+        uint64_t begin = NowNs();
+        bool success = sink_.Write(item->height, item->record);
+        counter.busy_ns += NowNs() - begin;
+        ++counter.items;
+        if (!success)
+        {
+            return -11;
+        }
+        ++next;
+        queues_[STAGE_FETCH]->Push(item);
+    }
+    return 0;
+}
+
+void Pipeline::Monitor()
+{
+    uint64_t last_report = NowNs();
+    while (!stop_monitor_)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(MONITOR_SAMPLE_MS));
+        for (int i = 0; i < STAGE_COUNT; ++i)
+        {
+            size_t depth = queues_[i]->Size();
+            counters_[i].depth_sum += depth;
+            ++counters_[i].depth_samples;
+            counters_[i].depth_max = std::max(counters_[i].depth_max, depth);
+        }
+        uint64_t now = NowNs();
+        if (options_.stats_interval > 0 && now - last_report >= options_.stats_interval * 1000000000ULL)
+        {
+            last_report = now;
+            std::vector<StageMetrics> metrics;
+            Collect(metrics, now - started_ns_);
+            std::cerr << FormatStageMetrics(metrics);
+        }
+    }
+}
+
+void Pipeline::Collect(std::vector<StageMetrics> &metrics, uint64_t wall_ns)
+{
+    metrics.clear();
+    for (int i = 0; i < STAGE_COUNT; ++i)
+    {
+        StageMetrics stage;
+        stage.name = STAGE_NAMES[i];
+        stage.threads = counters_[i].threads;
+        stage.items = counters_[i].items;
+        stage.busy_ns = counters_[i].busy_ns;
+        stage.wall_ns = wall_ns;
+        stage.queue_capacity = queues_[i]->Capacity();
+        stage.queue_depth = queues_[i]->Size();
+        stage.queue_depth_max = counters_[i].depth_max;
+        if (counters_[i].depth_samples > 0)
+        {
+            stage.queue_depth_avg = (double)counters_[i].depth_sum / counters_[i].depth_samples;
+        }
+        metrics.push_back(stage);
+    }
+}
+
+int Pipeline::Run(std::vector<StageMetrics> &metrics)
+{
+    started_ns_ = NowNs();
+    std::vector<std::thread> threads;
+    counters_[STAGE_FETCH].running = counters_[STAGE_FETCH].threads;
+    counters_[STAGE_DECODE].running = counters_[STAGE_DECODE].threads;
+    counters_[STAGE_SERIALIZE].running = counters_[STAGE_SERIALIZE].threads;
+    for (uint32_t i = 0; i < counters_[STAGE_FETCH].threads; ++i)
+    {
+        threads.emplace_back(&Pipeline::Fetch, this);
+    }
+    for (int stage : {STAGE_DECODE, STAGE_SERIALIZE})
+    {
+        for (uint32_t i = 0; i < counters_[stage].threads; ++i)
+        {
+            threads.emplace_back(&Pipeline::Transform, this, stage);
+        }
+    }
+    std::thread monitor(&Pipeline::Monitor, this);
+
+    int ret = Write();
+    if (0 != ret)
+    {
+        Fail(ret);
+    }
+    CloseAll();
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    stop_monitor_ = true;
+    monitor.join();
+    if (0 == ret && !sink_.Close())
+    {
+        ret = -11;
+    }
+    Collect(metrics, NowNs() - started_ns_);
+    return ret;
+}
+
+int RunPipeline(RocksDBReadOnly &db, uint64_t start, uint64_t end, const PipelineOptions &options,
+                const PipelineStages &stages, BlockSink &sink, std::vector<StageMetrics> &metrics)
+{
+    Pipeline pipeline(db, start, end, options, stages, sink);
+    return pipeline.Run(metrics);
+}
+
+BlockEncoder StagesEncoder(const PipelineStages &stages)
+{
+    return [stages](RocksDBReadOnly &db, uint64_t height, std::string &record)
+    {
+        thread_local PipelineItem item;
+        item.height = height;
+        int ret = stages.fetch(db, item);
+        if (0 == ret)
+        {
+            ret = stages.decode(item);
+        }
+        if (0 == ret)
+        {
+            ret = stages.serialize(item);
+        }
+        if (0 != ret)
+        {
+            ERRORLOG("encode block {} failed:{}", height, ret);
+            return ret;
+        }
+        record = std::move(item.record);
+        return 0;
+    };
+}
+
+PipelineStages JsonPipelineStages(bool compact, CellDataStore *store)
+{
+    PipelineStages stages;
+    stages.fetch = [](RocksDBReadOnly &db, PipelineItem &item)
+    {
+        rocksdb::Status status;
+        return ReadJsonBlockSource(db, item.height, item.source, status) ? 0 : -2;
+    };
+    stages.decode = [store](PipelineItem &item)
+    {
+        return DecodeBlockJson(item.source, item.json, store);
+    };
+    stages.serialize = [compact](PipelineItem &item)
+    {
+        if (compact)
+        {
+            item.record = item.json.dump();
+            item.record.push_back('\n');
+        }
+        else
+        {
+            item.record = item.json.dump(4);
+        }
+        return 0;
+    };
+    return stages;
+}
+
+PipelineStages MoleculePipelineStages()
+{
+    PipelineStages stages;
+    stages.fetch = [](RocksDBReadOnly &db, PipelineItem &item)
+    {
+        rocksdb::Status status;
+        return ReadRawBlock(db, item.height, item.source.block, status) ? 0 : -2;
+    };
+    stages.decode = [](PipelineItem &item)
+    {
+        return BuildBlockMolecule(item.source.block, item.record) ? 0 : -3;
+    };
+    stages.serialize = [](PipelineItem &item)
+    {
+        uint32_t len = htole32(item.record.size());
+        item.record.insert(0, (char *)&len, sizeof(len));
+        return 0;
+    };
+    return stages;
+}
+
+std::string FormatStageMetrics(const std::vector<StageMetrics> &metrics)
+{
+    std::ostringstream out;
+    for (auto &stage : metrics)
+    {
+        out << stage.name << " threads:" << stage.threads << " items:" << stage.items
+            << " utilization:" << (int)(stage.Utilization() * 100) << "%"
+            << " queue:" << stage.queue_depth << "/" << stage.queue_capacity
+            << " avg:" << stage.queue_depth_avg << " max:" << stage.queue_depth_max << std::endl;
+    }
+    return out.str();
+}
@@ -0,0 +1,63 @@
+#ifndef _EXPORT_PIPELINE_H_
+#define _EXPORT_PIPELINE_H_
+
+#include "db/rocksdb_read_only.h"
+#include "export/block_json.h"
+#include "export/block_sink.h"
+#include "export/parallel_exporter.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+// Travels through fetch -> decode -> serialize -> write, every stage fills its own part
+struct PipelineItem
+{
+    uint64_t height = 0;
+    JsonBlockSource source; // fetch
+    nlohmann::json json;    // decode
+    std::string record;     // serialize
+};
+
+struct PipelineStages
+{
+    std::function<int(RocksDBReadOnly &db, PipelineItem &item)> fetch;
+    std::function<int(PipelineItem &item)> decode;
+    std::function<int(PipelineItem &item)> serialize;
+};
+
+struct PipelineOptions
+{
+    uint32_t fetch_threads = 2;
+    uint32_t decode_threads = 2;
+    uint32_t serialize_threads = 4;
+    size_t queue_capacity = 256;  // items between two stages, also the number of items in flight
+    uint32_t stats_interval = 0;  // seconds between metric reports on stderr, 0 only reports at the end
+};
+
+struct StageMetrics
+{
+    std::string name;
+    uint32_t threads = 0;
+    uint64_t items = 0;
+    uint64_t busy_ns = 0;
+    uint64_t wall_ns = 0;
+    size_t queue_capacity = 0;    // input queue of the stage
+    size_t queue_depth = 0;       // last sample
+    size_t queue_depth_max = 0;
+    double queue_depth_avg = 0;
+
+    double Utilization() const;
+};
+
+// Returns the metrics of the fetch, decode, serialize and write stages in metrics
+int RunPipeline(RocksDBReadOnly &db, uint64_t start, uint64_t end, const PipelineOptions &options,
+                const PipelineStages &stages, BlockSink &sink, std::vector<StageMetrics> &metrics);
+
+// Runs the stages back to back on the calling thread, so the chunk engine can share them
+BlockEncoder StagesEncoder(const PipelineStages &stages);
+
+PipelineStages JsonPipelineStages(bool compact = false, CellDataStore *store = nullptr);
+PipelineStages MoleculePipelineStages();
+std::string FormatStageMetrics(const std::vector<StageMetrics> &metrics);
+
+#endif
@@ -0,0 +1,364 @@
+#include "protobuf_export.h"
+#include "archive/archive_format.h"
+#include "db/columns.h"
+#include "log/logging.h"
+#include "molecule/block_molecule.h"
+#include "utils/crypto_utils.h"
+#include <google/protobuf/io/coded_stream.h>
+
+static const size_t EPOCH_EXT_SIZE = 108;
+// Most blocks fit, so building a message does not touch the heap
+static const size_t ARENA_INITIAL_BLOCK_SIZE = 256 * 1024;
+// Column exports hand the sink this much at a time
+static const size_t COLUMN_RECORD_BYTES = 1 << 20;
+
+static void FillHeader(std::string_view hash, std::string_view header, ckb::Header *message)
+{
+    const char *p = header.data();
+    message->set_hash(hash.data(), hash.size());
+    message->set_version(LoadLe32(p + HEADER_VERSION));
+    message->set_compact_target(LoadLe32(p + HEADER_COMPACT_TARGET));
+    message->set_timestamp(LoadLe64(p + HEADER_TIMESTAMP));
+    message->set_number(LoadLe64(p + HEADER_NUMBER));
+    message->set_epoch(LoadLe64(p + HEADER_EPOCH));
+    message->set_parent_hash(p + HEADER_PARENT_HASH, 32);
+    message->set_transactions_root(p + HEADER_TRANSACTIONS_ROOT, 32);
+    message->set_proposals_hash(p + HEADER_PROPOSALS_HASH, 32);
+    message->set_extra_hash(p + HEADER_EXTRA_HASH, 32);
+    message->set_dao(p + HEADER_DAO, 32);
+    message->set_nonce(p + HEADER_NONCE, 16);
+    message->set_dao_c(LoadLe64(p + HEADER_DAO_C));
+    message->set_dao_ar(LoadLe64(p + HEADER_DAO_AR));
+    message->set_dao_s(LoadLe64(p + HEADER_DAO_S));
+    message->set_dao_u(LoadLe64(p + HEADER_DAO_U));
+}
+
+static void FillScript(const ScriptFields &fields, ckb::Script *message)
+{
+    message->set_code_hash(fields.code_hash.data(), fields.code_hash.size());
+    message->set_hash_type(fields.hash_type);
+    message->set_args(fields.args.data(), fields.args.size());
+}
+
+static bool FillCellOutput(std::string_view output, ckb::CellOutput *message)
+{
+    CellOutputFields fields;
+    if (!DecodeCellOutput(output, fields))
+    {
+        return false;
+    }
+    message->set_capacity(fields.capacity);
+    FillScript(fields.lock, message->mutable_lock());
+    if (fields.has_type)
+    {
+        FillScript(fields.type, message->mutable_type());
+    }
+    return true;
+}
+
+static void FillOutPoint(const char *p, ckb::OutPoint *message)
+{
+    message->set_tx_hash(p, 32);
+    message->set_index(LoadLe32(p + 32));
+}
+
+static bool FillTransaction(std::string_view view, ckb::Transaction *message, CellDataStore *store)
+{
+    std::string_view hash, witness_hash, transaction, raw, witnesses;
+    if (!SplitTransactionView(view, hash, witness_hash, transaction) || !SplitTransaction(transaction, raw, witnesses))
+    {
+        return false;
+    }
+    RawTransactionFields fields;
+    thread_local std::vector<std::string_view> cell_deps, header_deps, inputs, outputs, outputs_data, witness_items;
+    if (!DecodeRawTransaction(raw, fields) ||
+        !GetFixVecItems(fields.cell_deps, CELL_DEP_SIZE, cell_deps) ||
+        !GetFixVecItems(fields.header_deps, 32, header_deps) ||
+        !GetFixVecItems(fields.inputs, CELL_INPUT_SIZE, inputs) ||
+        !GetDynVecItems(fields.outputs, outputs) ||
+        !GetDynVecItems(fields.outputs_data, outputs_data) ||
+        !GetDynVecItems(witnesses, witness_items))
+    {
+        return false;
+    }
+
+    message->set_hash(hash.data(), hash.size());
+    message->set_witness_hash(witness_hash.data(), witness_hash.size());
+    message->set_version(fields.version);
+    for (auto &item : cell_deps)
+    {
+        ckb::CellDep *dep = message->add_cell_deps();
+        FillOutPoint(item.data(), dep->mutable_out_point());
+        dep->set_dep_type((uint8_t)item[36]);
+    }
+    for (auto &item : header_deps)
+    {
+        message->add_header_deps(item.data(), item.size());
+    }
+    for (auto &item : inputs)
+    {
+        ckb::CellInput *input = message->add_inputs();
+        input->set_since(LoadLe64(item.data()));
+        FillOutPoint(item.data() + 8, input->mutable_previous_output());
+    }
+    for (auto &item : outputs)
+    {
+        if (!FillCellOutput(item, message->add_outputs()))
+        {
+            return false;
+        }
+    }
+    std::string data_hash;
+    for (auto &item : outputs_data)
+    {
+        std::string_view data;
+        if (!GetBytesData(item, data))
+        {
+            return false;
+        }
+        if (nullptr == store || !store->Deduplicates(data.size()))
+        {
+            message->add_outputs_data(data.data(), data.size());
+            if (nullptr != store)
+            {
+                message->add_outputs_data_hash();
+            }
+            continue;
+        }
+        if (!store->Put(data, data_hash))
+        {
+            return false;
+        }
+        message->add_outputs_data();
+        message->add_outputs_data_hash(data_hash);
+    }
+    for (auto &item : witness_items)
+    {
+        std::string_view data;
+        if (!GetBytesData(item, data))
+        {
+            return false;
+        }
+        message->add_witnesses(data.data(), data.size());
+    }
+    return true;
+}
+
+bool FillBlockMessage(const RawBlock &block, ckb::Block *message, CellDataStore *store)
+{
+    std::string_view hash, header, uncle_hashes, uncle_vec;
+    thread_local std::vector<std::string_view> hashes, uncles, proposals, uncle_fields, uncle_proposals;
+    if (!SplitHeaderView(block.header, hash, header) || !SplitUncleBlockVecView(block.uncles, uncle_hashes, uncle_vec) ||
+        !GetByte32VecItems(uncle_hashes, hashes) || !GetUncleBlocks(uncle_vec, uncles) || hashes.size() != uncles.size() ||
+        !GetFixVecItems(block.proposals, ARCHIVE_PROPOSAL_SIZE, proposals))
+    {
+        ERRORLOG("block {} format error", block.number);
+        return false;
+    }
+    FillHeader(hash, header, message->mutable_header());
+
+    for (size_t i = 0; i < uncles.size(); ++i)
+    {
+        if (!GetDynVecItems(uncles[i], uncle_fields) || uncle_fields.size() < 2 || uncle_fields[0].size() != 208 ||
+            !GetFixVecItems(uncle_fields[1], ARCHIVE_PROPOSAL_SIZE, uncle_proposals))
+        {
+            ERRORLOG("block {} uncle {} format error", block.number, i);
+            return false;
+        }
+        ckb::UncleBlock *uncle = message->add_uncles();
+        FillHeader(hashes[i], uncle_fields[0], uncle->mutable_header());
+        for (auto &proposal : uncle_proposals)
+        {
+            uncle->add_proposals(proposal.data(), proposal.size());
+        }
+    }
+
+    for (size_t i = 0; i < block.transactions.size(); ++i)
+    {
+        if (!FillTransaction(block.transactions[i], message->add_transactions(), store))
+        {
+            ERRORLOG("block {} transaction {} format error", block.number, i);
+            return false;
+        }
+    }
+
+    for (auto &proposal : proposals)
+    {
+        message->add_proposals(proposal.data(), proposal.size());
+    }
+    if (block.has_extension)
+    {
+        std::string_view extension;
+        if (!GetBytesData(block.extension, extension))
+        {
+            ERRORLOG("block {} extension format error", block.number);
+            return false;
+        }
+        message->set_extension(extension.data(), extension.size());
+    }
+    return true;
+}
+
+bool FillCellEntryMessage(std::string_view entry, ckb::CellEntry *message)
+{
+    CellEntryFields fields;
+    if (!DecodeCellEntry(entry, fields) || !FillCellOutput(fields.output, message->mutable_output()))
+    {
+        return false;
+    }
+    message->set_block_hash(fields.block_hash.data(), fields.block_hash.size());
+    message->set_block_number(fields.block_number);
+    message->set_block_epoch(fields.block_epoch);
+    message->set_index(fields.index);
+    message->set_data_size(fields.data_size);
+    return true;
+}
+
+bool FillEpochExtMessage(std::string_view ext, ckb::EpochExt *message)
+{
+    if (ext.size() != EPOCH_EXT_SIZE)
+    {
+        ERRORLOG("epoch ext size error:{}", ext.size());
+        return false;
+    }
+    const char *p = ext.data();
+    message->set_previous_epoch_hash_rate(p, 32);
+    message->set_last_block_hash_in_previous_epoch(p + 32, 32);
+    message->set_compact_target(LoadLe32(p + 64));
+    message->set_number(LoadLe64(p + 68));
+    message->set_base_block_reward(LoadLe64(p + 76));
+    message->set_remainder_reward(LoadLe64(p + 84));
+    message->set_start_number(LoadLe64(p + 92));
+    message->set_length(LoadLe64(p + 100));
+    return true;
+}
+
+void AppendDelimited(const google::protobuf::MessageLite &message, std::string &out)
+{
+    size_t size = message.ByteSizeLong();
+    size_t header = google::protobuf::io::CodedOutputStream::VarintSize32(size);
+    size_t pos = out.size();
+    out.resize(pos + header + size);
+    uint8_t *target = (uint8_t *)&out[pos];
+    target = google::protobuf::io::CodedOutputStream::WriteVarint32ToArray(size, target);
+    message.SerializeWithCachedSizesToArray(target);
+}
+
+bool EncodeProtobufRecord(const RawBlock &block, std::string &record, CellDataStore *store)
+{
+    thread_local std::unique_ptr<char[]> initial_block(new char[ARENA_INITIAL_BLOCK_SIZE]);
+    google::protobuf::ArenaOptions options;
+    options.initial_block = initial_block.get();
+    options.initial_block_size = ARENA_INITIAL_BLOCK_SIZE;
+    google::protobuf::Arena arena(options);
+    ckb::Block *message = google::protobuf::Arena::CreateMessage<ckb::Block>(&arena);
+    if (!FillBlockMessage(block, message, store))
+    {
+        return false;
+    }
+    record.clear();
+    AppendDelimited(*message, record);
+    return true;
+}
+
+int EncodeProtobufBlock(RocksDBReadOnly &db, uint64_t height, std::string &record, CellDataStore *store)
+{
+    thread_local RawBlock block;
+    rocksdb::Status status;
+    if (!ReadRawBlock(db, height, block, status))
+    {
+        ERRORLOG("read block {} failed", height);
+        return -2;
+    }
+    return EncodeProtobufRecord(block, record, store) ? 0 : -3;
+}
+
+PipelineStages ProtobufPipelineStages(CellDataStore *store)
+{
+    PipelineStages stages;
+    stages.fetch = [](RocksDBReadOnly &db, PipelineItem &item)
+    {
+        rocksdb::Status status;
+        return ReadRawBlock(db, item.height, item.source.block, status) ? 0 : -2;
+    };
+    stages.decode = [store](PipelineItem &item)
+    {
+        return EncodeProtobufRecord(item.source.block, item.record, store) ? 0 : -3;
+    };
+    stages.serialize = [](PipelineItem &item)
+    {
+        return 0;
+    };
+    return stages;
+}
+
+bool ExportProtobufColumn(RocksDBReadOnly &db, const std::string &column, BlockSink &sink)
+{
+    bool cells = COLUMN_CELL == column;
+    if (!cells && COLUMN_EPOCH != column)
+    {
+        ERRORLOG("column {} has no protobuf message", column);
+        return false;
+    }
+    uint64_t count = 0;
+    std::string record;
+    bool valid = true;
+    rocksdb::Status status;
+    bool scanned = db.ScanRange(column, "", "", [&](const rocksdb::Slice &key, const rocksdb::Slice &value)
+    {
+        // Freed as soon as the message is serialized
+        google::protobuf::Arena arena;
+        std::string_view data(value.data(), value.size());
+        if (cells)
+        {
+            ckb::CellEntry *message = google::protobuf::Arena::CreateMessage<ckb::CellEntry>(&arena);
+            if (CKB_HASH_SIZE + sizeof(uint32_t) != key.size() || !FillCellEntryMessage(data, message))
+            {
+                ERRORLOG("cell {} format error", Bytes2Hex(key.ToString()));
+                valid = false;
+                return false;
+            }
+            char out_point[CKB_HASH_SIZE + sizeof(uint32_t)];
+            CellKeyToOutPoint(key.data(), out_point);
+            FillOutPoint(out_point, message->mutable_out_point());
+            AppendDelimited(*message, record);
+        }
+        else
+        {
+            // COLUMN_EPOCH also maps 8 byte epoch numbers to epoch hashes, only hash keys hold an EpochExt
+            if (CKB_HASH_SIZE != key.size())
+            {
+                return true;
+            }
+            ckb::EpochExt *message = google::protobuf::Arena::CreateMessage<ckb::EpochExt>(&arena);
+            if (!FillEpochExtMessage(data, message))
+            {
+                valid = false;
+                return false;
+            }
+            AppendDelimited(*message, record);
+        }
+        if (record.size() >= COLUMN_RECORD_BYTES)
+        {
+            if (!sink.Write(count, record))
+            {
+                valid = false;
+                return false;
+            }
+            record.clear();
+        }
+        ++count;
+        return true;
+    }, status);
+    if (!scanned || !valid)
+    {
+        ERRORLOG("export column {} failed:{}", column, status.ToString());
+        return false;
+    }
+    if (!record.empty() && !sink.Write(count, record))
+    {
+        return false;
+    }
+    fprintf(stderr, "exported %lu values of column %s\n", count, column.c_str());
+    return sink.Close();
+}
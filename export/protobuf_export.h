@@ -0,0 +1,31 @@
+#ifndef _EXPORT_PROTOBUF_EXPORT_H_
+#define _EXPORT_PROTOBUF_EXPORT_H_
+
+#include "db/raw_block.h"
+#include "export/block_sink.h"
+#include "export/cell_data_store.h"
+#include "export/pipeline.h"
+#include "proto/ckb.pb.h"
+#include <string_view>
+
+// Fill messages straight from the molecule values, no json tree in between. With a store,
+// deduplicated data is replaced by its hash in outputs_data_hash.
+bool FillBlockMessage(const RawBlock &block, ckb::Block *message, CellDataStore *store = nullptr);
+bool FillCellEntryMessage(std::string_view entry, ckb::CellEntry *message);
+bool FillEpochExtMessage(std::string_view ext, ckb::EpochExt *message);
+
+// Appends the varint size followed by the message, the stream layout of
+// google::protobuf::util::ParseDelimitedFromZeroCopyStream
+void AppendDelimited(const google::protobuf::MessageLite &message, std::string &out);
+
+// One length delimited ckb.Block per record, built on a per thread arena
+bool EncodeProtobufRecord(const RawBlock &block, std::string &record, CellDataStore *store = nullptr);
+int EncodeProtobufBlock(RocksDBReadOnly &db, uint64_t height, std::string &record, CellDataStore *store = nullptr);
+PipelineStages ProtobufPipelineStages(CellDataStore *store = nullptr);
+
+// Writes the live cells of COLUMN_CELL as ckb.CellEntry, or the epochs of COLUMN_EPOCH as
+// ckb.EpochExt, one length delimited message per value. The epoch number to epoch hash entries of
+// COLUMN_EPOCH are left out.
+bool ExportProtobufColumn(RocksDBReadOnly &db, const std::string &column, BlockSink &sink);
+
+#endif
@@ -0,0 +1,242 @@
+#include "script_filter.h"
+#include "log/logging.h"
+#include "utils/crypto_utils.h"
+#include "utils/file_utils.h"
+#include <algorithm>
+#include <map>
+#include <sstream>
+
+static bool ParseHex(std::string text, std::string &bytes)
+{
+    if (0 == text.compare(0, 2, "0x"))
+    {
+        text = text.substr(2);
+    }
+    if (0 != text.size() % 2 || std::string::npos != text.find_first_not_of("0123456789abcdefABCDEF"))
+    {
+        return false;
+    }
+    bytes = Hex2Bytes(text);
+    return true;
+}
+
+static bool ParseHashType(const std::string &text, uint8_t &hash_type)
+{
+    static const std::map<std::string, uint8_t> names = {{"data", 0}, {"type", 1}, {"data1", 2}, {"data2", 4}};
+    auto it = names.find(text);
+    if (names.end() != it)
+    {
+        hash_type = it->second;
+        return true;
+    }
+    char *end = nullptr;
+    unsigned long value = strtoul(text.c_str(), &end, 10);
+    if (text.empty() || '\0' != *end || value > 255)
+    {
+        return false;
+    }
+    hash_type = value;
+    return true;
+}
+
+static void RuleKey(std::string_view code_hash, uint8_t hash_type, std::string_view args_prefix, std::string &key)
+{
+    key.assign(code_hash.data(), code_hash.size());
+    key.push_back((char)hash_type);
+    key.append(args_prefix.data(), args_prefix.size());
+}
+
+bool ScriptFilter::Load(const std::string &path)
+{
+    std::string content;
+    if (!ReadFile(path, content))
+    {
+        ERRORLOG("read {} failed", path);
+        return false;
+    }
+    std::stringstream lines(content);
+    size_t line_number = 0;
+    for (std::string line; std::getline(lines, line);)
+    {
+        ++line_number;
+        std::stringstream fields(line.substr(0, line.find('#')));
+        std::string role, code_hash_hex, hash_type_text, args_hex, extra;
+        if (!(fields >> role))
+        {
+            continue;
+        }
+        fields >> code_hash_hex >> hash_type_text >> args_hex;
+        std::string code_hash, args_prefix;
+        uint8_t hash_type = 0;
+        if (("lock" != role && "type" != role) || !ParseHex(code_hash_hex, code_hash) || CKB_HASH_SIZE != code_hash.size() ||
+            !ParseHashType(hash_type_text, hash_type) || !ParseHex(args_hex, args_prefix) || (fields >> extra))
+        {
+            ERRORLOG("{}:{} is not a script rule", path, line_number);
+            return false;
+        }
+        Add("lock" == role ? SCRIPT_LOCK : SCRIPT_TYPE, code_hash, hash_type, args_prefix);
+    }
+    if (0 == Size())
+    {
+        ERRORLOG("{} has no script rules", path);
+        return false;
+    }
+    return true;
+}
+
+bool ScriptFilter::Add(ScriptRole role, const std::string &code_hash, uint8_t hash_type, const std::string &args_prefix)
+{
+    RoleRules &rules = roles_[role];
+    std::string key;
+    RuleKey(code_hash, hash_type, args_prefix, key);
+    if (!rules.keys.insert(key).second)
+    {
+        return false;
+    }
+    auto it = std::lower_bound(rules.prefix_lengths.begin(), rules.prefix_lengths.end(), args_prefix.size());
+    if (rules.prefix_lengths.end() == it || *it != args_prefix.size())
+    {
+        rules.prefix_lengths.insert(it, args_prefix.size());
+    }
+    return true;
+}
+
+bool ScriptFilter::Match(ScriptRole role, const ScriptFields &script) const
+{
+    const RoleRules &rules = roles_[role];
+    thread_local std::string key;
+    for (size_t length : rules.prefix_lengths)
+    {
+        if (length > script.args.size())
+        {
+            break;
+        }
+        RuleKey(script.code_hash, script.hash_type, script.args.substr(0, length), key);
+        if (rules.keys.count(key))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ScriptFilter::MatchOutput(const CellOutputFields &output) const
+{
+    return Match(SCRIPT_LOCK, output.lock) || (output.has_type && Match(SCRIPT_TYPE, output.type));
+}
+
+static bool DecodeTransactionView(std::string_view view, RawTransactionFields &fields)
+{
+    std::string_view hash, witness_hash, transaction, raw, witnesses;
+    return SplitTransactionView(view, hash, witness_hash, transaction) && SplitTransaction(transaction, raw, witnesses) &&
+           DecodeRawTransaction(raw, fields);
+}
+
+static bool MatchTransaction(const ScriptFilter &filter, RocksDBReadOnly *db, std::string_view view, bool cellbase, bool &matched)
+{
+    matched = false;
+    RawTransactionFields fields;
+    thread_local std::vector<std::string_view> outputs, inputs;
+    if (!DecodeTransactionView(view, fields) || !GetDynVecItems(fields.outputs, outputs))
+    {
+        return false;
+    }
+    CellOutputFields output;
+    for (auto &item : outputs)
+    {
+        if (!DecodeCellOutput(item, output))
+        {
+            return false;
+        }
+        if (filter.MatchOutput(output))
+        {
+            matched = true;
+            return true;
+        }
+    }
+    // The cellbase input spends nothing
+    if (nullptr == db || cellbase)
+    {
+        return true;
+    }
+    if (!GetFixVecItems(fields.inputs, CELL_INPUT_SIZE, inputs))
+    {
+        return false;
+    }
+    for (auto &item : inputs)
+    {
+        // As does the null out point of the genesis dep group input
+        if (IsNullOutPoint(item.substr(8)))
+        {
+            continue;
+        }
+        std::string_view previous;
+        if (!ReadPreviousOutput(*db, item.substr(8), previous) || !DecodeCellOutput(previous, output))
+        {
+            return false;
+        }
+        if (filter.MatchOutput(output))
+        {
+            matched = true;
+            return true;
+        }
+    }
+    return true;
+}
+
+bool FilterTransactions(const ScriptFilter &filter, RocksDBReadOnly *db, RawBlock &block)
+{
+    std::vector<uint32_t> indexes;
+    size_t kept = 0;
+    for (size_t i = 0; i < block.transactions.size(); ++i)
+    {
+        uint32_t index = block.TransactionIndex(i);
+        bool matched = false;
+        if (!MatchTransaction(filter, db, block.transactions[i], 0 == index, matched))
+        {
+            ERRORLOG("block {} transaction {} format error", block.number, index);
+            return false;
+        }
+        if (!matched)
+        {
+            continue;
+        }
+        if (kept != i)
+        {
+            block.transactions[kept] = std::move(block.transactions[i]);
+        }
+        indexes.push_back(index);
+        ++kept;
+    }
+    if (kept != block.transactions.size())
+    {
+        block.transactions.resize(kept);
+        block.transaction_indexes = std::move(indexes);
+    }
+    return true;
+}
+
+PipelineStages FilterPipelineStages(const PipelineStages &stages, const ScriptFilter &filter, bool match_inputs,
+                                    bool json_source)
+{
+    PipelineStages filtered = stages;
+    filtered.fetch = [&filter, match_inputs, json_source](RocksDBReadOnly &db, PipelineItem &item)
+    {
+        rocksdb::Status status;
+        item.source.Clear();
+        if (!ReadRawBlock(db, item.height, item.source.block, status))
+        {
+            return -2;
+        }
+        if (!FilterTransactions(filter, match_inputs ? &db : nullptr, item.source.block))
+        {
+            return -3;
+        }
+        if (json_source && !ReadJsonBlockDetails(db, item.source))
+        {
+            return -2;
+        }
+        return 0;
+    };
+    return filtered;
+}
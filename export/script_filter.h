@@ -0,0 +1,50 @@
+#ifndef _EXPORT_SCRIPT_FILTER_H_
+#define _EXPORT_SCRIPT_FILTER_H_
+
+#include "db/rocksdb_read_only.h"
+#include "export/pipeline.h"
+#include "molecule/block_molecule.h"
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+enum ScriptRole
+{
+    SCRIPT_LOCK = 0,
+    SCRIPT_TYPE = 1,
+};
+
+// Lock and type scripts a transaction has to touch to be exported. One rule per line:
+//     lock|type <code_hash> <hash_type> [args_prefix]
+// hash_type is data, type, data1, data2 or its number, hex may start with 0x, # starts a comment.
+// Rules are kept as code_hash + hash_type + args_prefix keys in a hash set, a script matches when
+// one of its args prefixes of a rule length is in the set, so the cost does not grow with the rules.
+class ScriptFilter
+{
+public:
+    bool Load(const std::string &path);
+    bool Add(ScriptRole role, const std::string &code_hash, uint8_t hash_type, const std::string &args_prefix);
+    size_t Size() const { return roles_[SCRIPT_LOCK].keys.size() + roles_[SCRIPT_TYPE].keys.size(); }
+    bool Match(ScriptRole role, const ScriptFields &script) const;
+    bool MatchOutput(const CellOutputFields &output) const;
+
+private:
+    struct RoleRules
+    {
+        std::unordered_set<std::string> keys;
+        std::vector<size_t> prefix_lengths; // distinct, ascending
+    };
+    RoleRules roles_[2];
+};
+
+// Drops the transactions of block none of whose outputs match, with db also checking the outputs
+// their inputs spend. Only the molecule values are looked at. The kept transactions remember their
+// position in transaction_indexes. Returns false on a malformed value.
+bool FilterTransactions(const ScriptFilter &filter, RocksDBReadOnly *db, RawBlock &block);
+
+// Filters right after fetch, so later stages never see the skipped transactions. The json
+// formats read their per transaction values only for the kept ones.
+PipelineStages FilterPipelineStages(const PipelineStages &stages, const ScriptFilter &filter, bool match_inputs,
+                                    bool json_source);
+
+#endif
@@ -0,0 +1,220 @@
+#include "shard_sink.h"
+#include "log/logging.h"
+#include "utils/file_utils.h"
+#include <filesystem>
+#include <iomanip>
+#include <nlohmann/json.hpp>
+#include <sstream>
+#include <stdio.h>
+
+std::string ShardPath(const ShardOptions &options, uint64_t start_height)
+{
+    std::ostringstream path;
+    path << options.prefix << "-";
+    if (options.run > 0)
+    {
+        path << std::setw(6) << std::setfill('0') << options.run << "-";
+    }
+    path << std::setw(10) << std::setfill('0') << start_height << options.suffix;
+    return path.str();
+}
+
+// Removes the shards starting at or after height and their manifests, except keep
+static void RemoveShardsFrom(const ShardOptions &options, uint64_t height, const std::string &keep)
+{
+    std::filesystem::path prefix(options.prefix);
+    std::filesystem::path dir = prefix.has_parent_path() ? prefix.parent_path() : std::filesystem::path(".");
+    std::string base = prefix.filename().string() + "-";
+    std::string manifest_suffix = options.suffix + ".manifest.json";
+    std::error_code error;
+    for (auto &entry : std::filesystem::directory_iterator(dir, error))
+    {
+        std::string name = entry.path().filename().string();
+        size_t digits = name.find_first_not_of("0123456789", base.size());
+        if (0 != name.compare(0, base.size(), base) || std::string::npos == digits || base.size() == digits ||
+            (name.substr(digits) != options.suffix && name.substr(digits) != manifest_suffix))
+        {
+            continue;
+        }
+        uint64_t start = strtoull(name.c_str() + base.size(), nullptr, 10);
+        std::string shard = ShardPath(options, start);
+        if (start >= height && shard != keep)
+        {
+            WARNLOG("remove {}, it was written after the checkpoint", entry.path().string());
+            std::filesystem::remove(entry.path(), error);
+        }
+    }
+}
+
+ShardedFileSink::ShardedFileSink(const ShardOptions &options)
+    : options_(options), start_height_(0), end_height_(0), bytes_(0)
+{
+}
+
+ShardedFileSink::~ShardedFileSink()
+{
+    Close();
+}
+
+bool ShardedFileSink::OpenShard(uint64_t height)
+{
+    path_ = ShardPath(options_, height);
+    file_.reset(new FileSink(path_, false, options_.writer));
+    if (!file_->IsOpen())
+    {
+        file_.reset();
+        return false;
+    }
+    start_height_ = height;
+    end_height_ = height;
+    bytes_ = 0;
+    offsets_.clear();
+    heights_.clear();
+    return true;
+}
+
+bool ShardedFileSink::CloseShard()
+{
+    if (nullptr == file_)
+    {
+        return true;
+    }
+    bool success = file_->Close();
+    file_.reset();
+    if (!success)
+    {
+        ERRORLOG("close {} failed", path_);
+        return false;
+    }
+    return WriteManifest();
+}
+
+bool ShardedFileSink::WriteManifest()
+{
+    nlohmann::json manifest;
+    manifest["file"] = path_.substr(path_.find_last_of('/') + 1);
+    manifest["start_height"] = start_height_;
+    manifest["end_height"] = end_height_;
+    manifest["blocks"] = end_height_ - start_height_;
+    manifest["bytes"] = bytes_;
+    manifest["offsets"] = offsets_;
+    if (offsets_.size() != end_height_ - start_height_)
+    {
+        manifest["heights"] = heights_;
+    }
+    return WriteFileAtomic(path_ + ".manifest.json", manifest.dump());
+}
+
+bool ShardedFileSink::Write(uint64_t height, const std::string &record)
+{
+    return WriteRange(height, height + 1, record);
+}
+
+bool ShardedFileSink::WriteRange(uint64_t start, uint64_t end, const std::string &record)
+{
+    bool full = (options_.max_bytes > 0 && bytes_ >= options_.max_bytes) ||
+                (options_.max_blocks > 0 && end_height_ - start_height_ >= options_.max_blocks);
+    if (nullptr != file_ && full && !CloseShard())
+    {
+        return false;
+    }
+    if (nullptr == file_ && !OpenShard(start))
+    {
+        return false;
+    }
+    if (!file_->Write(start, record))
+    {
+        return false;
+    }
+    offsets_.push_back(bytes_);
+    heights_.push_back(start);
+    bytes_ += record.size();
+    end_height_ = end;
+    return true;
+}
+
+bool ShardedFileSink::Close()
+{
+    return CloseShard();
+}
+
+bool ShardedFileSink::Checkpoint(SinkPosition &position)
+{
+    if (nullptr == file_)
+    {
+        position.file.clear();
+        position.offset = 0;
+        return true;
+    }
+    if (!file_->Checkpoint(position) || !WriteManifest())
+    {
+        return false;
+    }
+    return true;
+}
+
+bool ShardedFileSink::Resume(const SinkPosition &position)
+{
+    // Shards opened after the checkpoint hold blocks that are written again
+    RemoveShardsFrom(options_, position.end_height, position.file);
+    if (position.file.empty())
+    {
+        return true;
+    }
+    std::string content;
+    nlohmann::json manifest;
+    if (ReadFile(position.file + ".manifest.json", content))
+    {
+        manifest = nlohmann::json::parse(content, nullptr, false);
+    }
+    if (manifest.is_discarded() || !manifest.contains("offsets"))
+    {
+        ERRORLOG("read {}.manifest.json failed", position.file);
+        return false;
+    }
+    path_ = position.file;
+    start_height_ = manifest.value("start_height", uint64_t(0));
+    end_height_ = position.end_height;
+    bytes_ = position.offset;
+    offsets_ = manifest["offsets"].get<std::vector<uint64_t>>();
+    if (manifest.contains("heights"))
+    {
+        heights_ = manifest["heights"].get<std::vector<uint64_t>>();
+    }
+    else
+    {
+        heights_.clear();
+        for (uint64_t i = 0; i < offsets_.size(); ++i)
+        {
+            heights_.push_back(start_height_ + i);
+        }
+    }
+    // Forget the records written after the checkpoint
+    while (!offsets_.empty() && offsets_.back() >= position.offset)
+    {
+        offsets_.pop_back();
+        heights_.pop_back();
+    }
+    file_.reset(new FileSink(path_, true, options_.writer));
+    if (!file_->IsOpen() || !file_->Resume(position))
+    {
+        file_.reset();
+        return false;
+    }
+    return WriteManifest();
+}
+
+bool StdoutSink::Write(uint64_t height, const std::string &record)
+{
+    if (record.size() != fwrite(record.data(), 1, record.size(), stdout))
+    {
+        ERRORLOG("write stdout failed at block {}", height);
+        return false;
+    }
+    return true;
+}
+
+bool StdoutSink::Close()
+{
+    return 0 == fflush(stdout);
+}
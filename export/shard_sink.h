@@ -0,0 +1,59 @@
+#ifndef _EXPORT_SHARD_SINK_H_
+#define _EXPORT_SHARD_SINK_H_
+
+#include "export/block_sink.h"
+#include "utils/vectored_writer.h"
+#include <vector>
+
+struct ShardOptions
+{
+    std::string prefix = "blocks";
+    std::string suffix = ".ndjson";
+    uint64_t max_bytes = 1024 * 1024 * 1024; // 0 means no size limit
+    uint64_t max_blocks = 0;                 // 0 means no block count limit
+    uint64_t run = 0;                        // non-zero adds the run to the names, see ShardPath
+    WriterOptions writer;
+};
+
+// Rolls "<prefix>-<first height>.ndjson" shards by size or block count. Every shard gets a
+// "<shard>.manifest.json" with its height range and the byte offset of each record. When a
+// record holds several blocks the manifest also lists the first height of every record.
+class ShardedFileSink : public BlockSink
+{
+public:
+    explicit ShardedFileSink(const ShardOptions &options);
+    ~ShardedFileSink();
+    bool Write(uint64_t height, const std::string &record) override;
+    bool WriteRange(uint64_t start, uint64_t end, const std::string &record) override;
+    bool Close() override;
+    // The open shard's manifest is rewritten on every checkpoint so a resume can reload it
+    bool Checkpoint(SinkPosition &position) override;
+    bool Resume(const SinkPosition &position) override;
+
+private:
+    bool OpenShard(uint64_t height);
+    bool CloseShard();
+    bool WriteManifest();
+
+    ShardOptions options_;
+    std::unique_ptr<FileSink> file_;
+    std::string path_;
+    uint64_t start_height_;
+    uint64_t end_height_;
+    uint64_t bytes_;
+    std::vector<uint64_t> offsets_;
+    std::vector<uint64_t> heights_;
+};
+
+class StdoutSink : public BlockSink
+{
+public:
+    bool Write(uint64_t height, const std::string &record) override;
+    bool Close() override;
+};
+
+// "<prefix>-<run>-<first height><suffix>" when run is set, so a run that starts again below the
+// last exported height after a reorg never reopens a shard of an earlier run
+std::string ShardPath(const ShardOptions &options, uint64_t start_height);
+
+#endif
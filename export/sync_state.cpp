@@ -0,0 +1,116 @@
+#include "sync_state.h"
+#include "db/raw_block.h"
+#include "log/logging.h"
+#include "utils/crypto_utils.h"
+#include "utils/file_utils.h"
+#include <nlohmann/json.hpp>
+
+bool SaveSyncState(const std::string &path, const SyncState &state)
+{
+    nlohmann::json json;
+    json["format"] = state.format;
+    json["output"] = state.output;
+    json["next_height"] = state.next_height;
+    json["runs"] = state.runs;
+    json["recent"] = nlohmann::json::array();
+    for (auto &item : state.recent)
+    {
+        json["recent"].push_back({{"number", item.first}, {"hash", item.second}});
+    }
+    return WriteFileAtomic(path, json.dump(4));
+}
+
+bool LoadSyncState(const std::string &path, SyncState &state)
+{
+    std::string content;
+    if (!ReadFile(path, content))
+    {
+        ERRORLOG("read {} failed", path);
+        return false;
+    }
+    nlohmann::json json = nlohmann::json::parse(content, nullptr, false);
+    if (json.is_discarded() || !json.is_object())
+    {
+        ERRORLOG("parse {} failed", path);
+        return false;
+    }
+    try
+    {
+        state.format = json.at("format").get<std::string>();
+        state.output = json.at("output").get<std::string>();
+        state.next_height = json.at("next_height").get<uint64_t>();
+        state.runs = json.value("runs", uint64_t(0));
+        state.recent.clear();
+        for (auto &item : json.at("recent"))
+        {
+            state.recent[item.at("number").get<uint64_t>()] = item.at("hash").get<std::string>();
+        }
+    }
+    catch (const nlohmann::json::exception &e)
+    {
+        ERRORLOG("{} is not a sync state: {}", path, e.what());
+        return false;
+    }
+    return true;
+}
+
+bool DetectReorg(RocksDBReadOnly &db, SyncState &state, std::vector<OrphanedBlock> &orphaned)
+{
+    orphaned.clear();
+    for (auto it = state.recent.rbegin(); it != state.recent.rend(); ++it)
+    {
+        std::string hash;
+        rocksdb::Status status;
+        if (ReadBlockHash(db, it->first, hash, status))
+        {
+            if (Bytes2Hex(hash) == it->second)
+            {
+                break;
+            }
+        }
+        else if (!status.IsNotFound())
+        {
+            ERRORLOG("read block {} hash failed:{}", it->first, status.ToString());
+            return false;
+        }
+        orphaned.push_back({it->first, it->second});
+    }
+    if (orphaned.empty())
+    {
+        return true;
+    }
+    if (orphaned.size() == state.recent.size())
+    {
+        ERRORLOG("all {} recorded blocks were orphaned, the reorg is deeper than the recorded window", orphaned.size());
+        return false;
+    }
+    state.next_height = orphaned.back().number;
+    state.recent.erase(state.recent.find(state.next_height), state.recent.end());
+    return true;
+}
+
+bool RecordRecentHashes(RocksDBReadOnly &db, SyncState &state, uint64_t first_height, uint64_t depth)
+{
+    uint64_t from = state.next_height > depth ? state.next_height - depth : 0;
+    // Blocks already recorded keep their hashes, only the new ones are read
+    for (uint64_t height = std::max(from, first_height); height < state.next_height; ++height)
+    {
+        std::string hash;
+        rocksdb::Status status;
+        if (!ReadBlockHash(db, height, hash, status))
+        {
+            ERRORLOG("read block {} hash failed:{}", height, status.ToString());
+            return false;
+        }
+        state.recent[height] = Bytes2Hex(hash);
+    }
+    state.recent.erase(state.recent.begin(), state.recent.lower_bound(from));
+    return true;
+}
+
+std::string EncodeRollbackMarker(const OrphanedBlock &block)
+{
+    nlohmann::json json;
+    json["rollback"] = {{"number", block.number}, {"hash", block.hash}};
+    return json.dump() + "\n";
+}
@@ -0,0 +1,37 @@
+#ifndef _EXPORT_SYNC_STATE_H_
+#define _EXPORT_SYNC_STATE_H_
+
+#include "db/rocksdb_read_only.h"
+#include <map>
+#include <vector>
+
+// What an incremental export has emitted so far
+struct SyncState
+{
+    std::string format;
+    std::string output;
+    uint64_t next_height = 0;                // every block below it was exported
+    uint64_t runs = 0;                       // runs that wrote output, numbers the shards
+    std::map<uint64_t, std::string> recent; // hex hashes of the last exported blocks
+};
+
+struct OrphanedBlock
+{
+    uint64_t number;
+    std::string hash; // hex
+};
+
+bool SaveSyncState(const std::string &path, const SyncState &state);
+bool LoadSyncState(const std::string &path, SyncState &state);
+
+// Compares the recorded hashes with COLUMN_INDEX from the top down. Blocks no longer on the main
+// chain go to orphaned (highest first) and next_height moves back to the first of them. Fails
+// when none of the recorded blocks survived, the reorg is deeper than the recorded window.
+bool DetectReorg(RocksDBReadOnly &db, SyncState &state, std::vector<OrphanedBlock> &orphaned);
+// Records the hashes of the last depth blocks below next_height
+bool RecordRecentHashes(RocksDBReadOnly &db, SyncState &state, uint64_t first_height, uint64_t depth);
+
+// {"rollback":{"number":n,"hash":"..."}} line telling consumers to drop an exported block
+std::string EncodeRollbackMarker(const OrphanedBlock &block);
+
+#endif
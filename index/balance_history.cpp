@@ -0,0 +1,537 @@
+#include "balance_history.h"
+#include "archive/archive_format.h"
+#include "db/raw_block.h"
+#include "index/cell_table.h"
+#include "index/live_cell_index.h"
+#include "log/logging.h"
+#include "utils/crypto_utils.h"
+#include "utils/file_utils.h"
+#include "utils/parallel_for.hpp"
+#include "utils/varint.h"
+#include "utils/vectored_writer.h"
+#include <algorithm>
+#include <queue>
+#include <stdio.h>
+#include <unordered_map>
+
+static const char BALANCE_HISTORY_MAGIC[8] = {'C', 'K', 'B', 'B', 'H', 'I', 'S', '1'};
+static const uint64_t BALANCE_HISTORY_WINDOW_BLOCKS = 100000;
+static const uint64_t BALANCE_HISTORY_READ_BATCH = 16;
+static const size_t BALANCE_HISTORY_WRITE_BYTES = 1024 * 1024;
+
+bool BalanceHistory::Open(const std::string &path)
+{
+    Close();
+    if (!file_.Open(path))
+    {
+        return false;
+    }
+    const char *p = file_.Data();
+    if (file_.Size() < BALANCE_HISTORY_HEADER_SIZE || 0 != memcmp(p, BALANCE_HISTORY_MAGIC, sizeof(BALANCE_HISTORY_MAGIC)))
+    {
+        ERRORLOG("{} is not a balance history", path);
+        file_.Close();
+        return false;
+    }
+    uint64_t count = LoadLe64(p + 8);
+    if (count > (file_.Size() - BALANCE_HISTORY_HEADER_SIZE) / BALANCE_HISTORY_ENTRY_SIZE)
+    {
+        ERRORLOG("balance history {} size error:{}", path, file_.Size());
+        file_.Close();
+        return false;
+    }
+    lock_count_ = count;
+    next_height_ = LoadLe64(p + 16);
+    directory_ = p + file_.Size() - count * BALANCE_HISTORY_ENTRY_SIZE;
+    return true;
+}
+
+void BalanceHistory::Close()
+{
+    file_.Close();
+    lock_count_ = 0;
+    next_height_ = 0;
+    directory_ = nullptr;
+}
+
+const char *BalanceHistory::Entry(std::string_view lock_hash) const
+{
+    if (CKB_HASH_SIZE != lock_hash.size())
+    {
+        return nullptr;
+    }
+    uint64_t low = 0, high = lock_count_;
+    while (low < high)
+    {
+        uint64_t mid = low + (high - low) / 2;
+        const char *entry = directory_ + mid * BALANCE_HISTORY_ENTRY_SIZE;
+        int cmp = memcmp(entry, lock_hash.data(), CKB_HASH_SIZE);
+        if (0 == cmp)
+        {
+            return entry;
+        }
+        if (cmp < 0)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return nullptr;
+}
+
+// Groups of an entry's points
+static uint64_t GroupCount(const char *entry)
+{
+    uint64_t count = LoadLe64(entry + CKB_HASH_SIZE + 8);
+    return count / BALANCE_HISTORY_GROUP_POINTS + (0 != count % BALANCE_HISTORY_GROUP_POINTS);
+}
+
+const char *BalanceHistory::GroupStart(const char *entry, uint64_t group) const
+{
+    uint64_t offset = LoadLe64(entry + CKB_HASH_SIZE);
+    uint64_t groups = GroupCount(entry);
+    uint64_t limit = directory_ - file_.Data();
+    if (group >= groups || offset < BALANCE_HISTORY_HEADER_SIZE || offset > limit || groups > (limit - offset) / 4 ||
+        LoadLe32(file_.Data() + offset + group * 4) >= limit - offset)
+    {
+        ERRORLOG("balance history entry {} out of range", Bytes2Hex(std::string(entry, CKB_HASH_SIZE)));
+        return nullptr;
+    }
+    return file_.Data() + offset + LoadLe32(file_.Data() + offset + group * 4);
+}
+
+bool BalanceHistory::DecodeGroup(const char *entry, uint64_t group, std::vector<BalancePoint> &points) const
+{
+    const char *p = GroupStart(entry, group);
+    if (nullptr == p)
+    {
+        return false;
+    }
+    uint64_t count = LoadLe64(entry + CKB_HASH_SIZE + 8);
+    const char *end = directory_;
+    uint64_t size = std::min<uint64_t>(BALANCE_HISTORY_GROUP_POINTS, count - group * BALANCE_HISTORY_GROUP_POINTS);
+    uint64_t height = 0, balance = 0, value = 0;
+    for (uint64_t i = 0; i < size; ++i)
+    {
+        if (p >= end || !GetVarint64(p, end, value))
+        {
+            return false;
+        }
+        height = 0 == i ? value : height + value;
+        if (!GetVarint64(p, end, value))
+        {
+            return false;
+        }
+        balance = 0 == i ? value : balance + ZigZagDecode(value);
+        points.emplace_back(height, balance);
+    }
+    return true;
+}
+
+bool BalanceHistory::BalanceAt(std::string_view lock_hash, uint64_t height, uint64_t &balance) const
+{
+    balance = 0;
+    if (height >= next_height_)
+    {
+        return false;
+    }
+    const char *entry = Entry(lock_hash);
+    if (nullptr == entry)
+    {
+        return true;
+    }
+    // The last group starting at or before height
+    uint64_t low = 0, high = GroupCount(entry);
+    while (low < high)
+    {
+        uint64_t mid = low + (high - low) / 2;
+        const char *p = GroupStart(entry, mid);
+        uint64_t first = 0;
+        if (nullptr == p || !GetVarint64(p, directory_, first))
+        {
+            return false;
+        }
+        if (first <= height)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    if (0 == low)
+    {
+        return true;
+    }
+    std::vector<BalancePoint> points;
+    if (!DecodeGroup(entry, low - 1, points))
+    {
+        return false;
+    }
+    for (auto &point : points)
+    {
+        if (point.first > height)
+        {
+            break;
+        }
+        balance = point.second;
+    }
+    return true;
+}
+
+bool BalanceHistory::Changes(std::string_view lock_hash, std::vector<BalancePoint> &points) const
+{
+    points.clear();
+    const char *entry = Entry(lock_hash);
+    if (nullptr == entry)
+    {
+        return true;
+    }
+    uint64_t groups = GroupCount(entry);
+    for (uint64_t group = 0; group < groups; ++group)
+    {
+        if (!DecodeGroup(entry, group, points))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Last change point of a lock while building, the next one is encoded against it
+struct LockState
+{
+    std::string lock_hash;
+    uint64_t height = 0;
+    uint64_t balance = 0;
+    bool changed = false;
+};
+
+class HistoryBuilder
+{
+public:
+    HistoryBuilder(RocksDBReadOnly &db, const std::string &path, uint32_t threads) : db_(db), path_(path), threads_(threads) {}
+    ~HistoryBuilder()
+    {
+        for (auto &run : runs_)
+        {
+            remove(run.c_str());
+        }
+    }
+
+    // Applies the blocks [start, end) and spills their change points to a run
+    bool ApplyWindow(uint64_t start, uint64_t end);
+    // Merges the runs into the index
+    bool Write(uint64_t next_height, const std::string &block_hash);
+
+private:
+    uint32_t LockId(const char *lock_hash);
+    bool ApplyBlock(uint64_t height, const std::vector<LiveCellRecord> &created, const std::vector<CellOutPoint> &spent);
+
+    RocksDBReadOnly &db_;
+    std::string path_;
+    uint32_t threads_;
+    CellTable cells_{0};
+    std::unordered_map<std::string, uint32_t> lock_ids_;
+    std::vector<LockState> locks_;
+    // Change points of the current window per lock id, deltas from the lock's previous point
+    std::unordered_map<uint32_t, std::string> chunks_;
+    std::vector<std::pair<uint32_t, int64_t>> deltas_;
+    std::vector<std::string> runs_;
+};
+
+uint32_t HistoryBuilder::LockId(const char *lock_hash)
+{
+    auto result = lock_ids_.emplace(std::string(lock_hash, CKB_HASH_SIZE), (uint32_t)locks_.size());
+    if (result.second)
+    {
+        locks_.emplace_back();
+        locks_.back().lock_hash = result.first->first;
+    }
+    return result.first->second;
+}
+
+bool HistoryBuilder::ApplyBlock(uint64_t height, const std::vector<LiveCellRecord> &created, const std::vector<CellOutPoint> &spent)
+{
+    deltas_.clear();
+    // Cells are created before the inputs are applied, a transaction may spend one of the same block
+    for (auto &record : created)
+    {
+        if (!cells_.Insert(record))
+        {
+            ERRORLOG("block {} creates the live cell {} again", height, Bytes2Hex(std::string(record.data() + CKB_HASH_SIZE, OUT_POINT_SIZE)));
+            return false;
+        }
+        deltas_.emplace_back(LockId(record.data()), (int64_t)LoadLe64(record.data() + LIVE_CELL_KEY_SIZE));
+    }
+    LiveCellRecord record;
+    for (auto &out_point : spent)
+    {
+        if (!cells_.Erase(out_point.data(), record))
+        {
+            ERRORLOG("block {} spends the unknown cell {}", height, Bytes2Hex(std::string(out_point.data(), out_point.size())));
+            return false;
+        }
+        deltas_.emplace_back(LockId(record.data()), -(int64_t)LoadLe64(record.data() + LIVE_CELL_KEY_SIZE));
+    }
+    std::sort(deltas_.begin(), deltas_.end());
+    for (size_t i = 0; i < deltas_.size();)
+    {
+        uint32_t id = deltas_[i].first;
+        int64_t delta = 0;
+        for (; i < deltas_.size() && deltas_[i].first == id; ++i)
+        {
+            delta += deltas_[i].second;
+        }
+        LockState &lock = locks_[id];
+        if (0 == delta)
+        {
+            continue;
+        }
+        if (delta < 0 && lock.balance < (uint64_t)-delta)
+        {
+            ERRORLOG("block {} takes lock {} below zero", height, Bytes2Hex(lock.lock_hash));
+            return false;
+        }
+        std::string &chunk = chunks_[id];
+        PutVarint64(chunk, height - lock.height);
+        PutVarint64(chunk, ZigZagEncode(delta));
+        lock.height = height;
+        lock.balance += delta;
+        lock.changed = true;
+    }
+    return true;
+}
+
+bool HistoryBuilder::ApplyWindow(uint64_t start, uint64_t end)
+{
+    std::vector<std::vector<LiveCellRecord>> created(end - start);
+    std::vector<std::vector<CellOutPoint>> spent(end - start);
+    bool success = ParallelFor(start, end, BALANCE_HISTORY_READ_BATCH, threads_, [&](uint64_t begin, uint64_t stop, uint32_t)
+    {
+        for (uint64_t height = begin; height < stop; ++height)
+        {
+            if (!ReadBlockCellChanges(db_, height, created[height - start], spent[height - start]))
+            {
+                return false;
+            }
+        }
+        return true;
+    });
+    if (!success)
+    {
+        return false;
+    }
+    for (uint64_t height = start; height < end; ++height)
+    {
+        if (!ApplyBlock(height, created[height - start], spent[height - start]))
+        {
+            return false;
+        }
+        std::vector<LiveCellRecord>().swap(created[height - start]);
+        std::vector<CellOutPoint>().swap(spent[height - start]);
+    }
+
+    // Run: (lock_hash[32], varint size, points) sorted by lock_hash
+    std::vector<uint32_t> ids;
+    for (auto &chunk : chunks_)
+    {
+        ids.push_back(chunk.first);
+    }
+    std::sort(ids.begin(), ids.end(), [&](uint32_t a, uint32_t b) { return locks_[a].lock_hash < locks_[b].lock_hash; });
+    std::string content;
+    for (uint32_t id : ids)
+    {
+        std::string &chunk = chunks_[id];
+        content += locks_[id].lock_hash;
+        PutVarint64(content, chunk.size());
+        content += chunk;
+    }
+    chunks_.clear();
+    std::string run = path_ + ".run" + std::to_string(runs_.size());
+    runs_.push_back(run);
+    return WriteFile(run, content);
+}
+
+struct RunCursor
+{
+    const char *p = nullptr;
+    const char *end = nullptr;
+    std::string_view chunk;
+    size_t run = 0;
+
+    // Steps to the next lock of the run, false at its end
+    bool Next()
+    {
+        uint64_t size = 0;
+        if (end - p < (ptrdiff_t)CKB_HASH_SIZE)
+        {
+            return false;
+        }
+        const char *q = p + CKB_HASH_SIZE;
+        if (!GetVarint64(q, end, size) || size > (uint64_t)(end - q))
+        {
+            return false;
+        }
+        chunk = std::string_view(q, size);
+        return true;
+    }
+    void Advance() { p = chunk.data() + chunk.size(); }
+};
+
+bool HistoryBuilder::Write(uint64_t next_height, const std::string &block_hash)
+{
+    std::vector<MmapFile> files(runs_.size());
+    std::vector<RunCursor> cursors(runs_.size());
+    // Ordered so the queue yields the smallest lock hash first, earlier runs first among equals
+    auto greater = [&](size_t a, size_t b)
+    {
+        int cmp = memcmp(cursors[a].p, cursors[b].p, CKB_HASH_SIZE);
+        return 0 != cmp ? cmp > 0 : a > b;
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> queue(greater);
+    for (size_t i = 0; i < runs_.size(); ++i)
+    {
+        if (!files[i].Open(runs_[i]))
+        {
+            return false;
+        }
+        cursors[i].p = files[i].Data();
+        cursors[i].end = files[i].Data() + files[i].Size();
+        cursors[i].run = i;
+        if (cursors[i].Next())
+        {
+            queue.push(i);
+        }
+        else if (cursors[i].p != cursors[i].end)
+        {
+            ERRORLOG("run {} format error", runs_[i]);
+            return false;
+        }
+    }
+    uint64_t lock_count = 0;
+    for (auto &lock : locks_)
+    {
+        lock_count += lock.changed ? 1 : 0;
+    }
+
+    std::string tmp_path = path_ + ".tmp";
+    WriterOptions options;
+    options.fsync = FSYNC_CLOSE;
+    VectoredWriter writer(options);
+    if (!writer.Open(tmp_path, false))
+    {
+        return false;
+    }
+    std::string buffer(BALANCE_HISTORY_HEADER_SIZE, '\0');
+    memcpy(&buffer[0], BALANCE_HISTORY_MAGIC, sizeof(BALANCE_HISTORY_MAGIC));
+    StoreLe64(&buffer[8], lock_count);
+    StoreLe64(&buffer[16], next_height);
+    memcpy(&buffer[24], block_hash.data(), std::min(block_hash.size(), CKB_HASH_SIZE));
+    uint64_t offset = 0;
+    std::string directory, data, entry(BALANCE_HISTORY_ENTRY_SIZE, '\0');
+    std::vector<BalancePoint> points;
+    while (!queue.empty())
+    {
+        size_t first = queue.top();
+        std::string lock_hash(cursors[first].p, CKB_HASH_SIZE);
+        points.clear();
+        uint64_t height = 0, balance = 0;
+        while (!queue.empty() && 0 == memcmp(cursors[queue.top()].p, lock_hash.data(), CKB_HASH_SIZE))
+        {
+            RunCursor &cursor = cursors[queue.top()];
+            queue.pop();
+            const char *p = cursor.chunk.data(), *end = p + cursor.chunk.size();
+            uint64_t height_delta = 0, balance_delta = 0;
+            while (p < end)
+            {
+                if (!GetVarint64(p, end, height_delta) || !GetVarint64(p, end, balance_delta))
+                {
+                    ERRORLOG("run {} chunk format error", runs_[cursor.run]);
+                    return false;
+                }
+                height += height_delta;
+                balance += ZigZagDecode(balance_delta);
+                points.emplace_back(height, balance);
+            }
+            cursor.Advance();
+            if (cursor.Next())
+            {
+                queue.push(cursor.run);
+            }
+        }
+
+        uint64_t groups = (points.size() + BALANCE_HISTORY_GROUP_POINTS - 1) / BALANCE_HISTORY_GROUP_POINTS;
+        data.assign(groups * 4, '\0');
+        for (size_t i = 0; i < points.size(); ++i)
+        {
+            if (0 == i % BALANCE_HISTORY_GROUP_POINTS)
+            {
+                StoreLe32(&data[i / BALANCE_HISTORY_GROUP_POINTS * 4], data.size());
+                PutVarint64(data, points[i].first);
+                PutVarint64(data, points[i].second);
+            }
+            else
+            {
+                PutVarint64(data, points[i].first - points[i - 1].first);
+                PutVarint64(data, ZigZagEncode((int64_t)(points[i].second - points[i - 1].second)));
+            }
+        }
+        memcpy(&entry[0], lock_hash.data(), CKB_HASH_SIZE);
+        StoreLe64(&entry[CKB_HASH_SIZE], BALANCE_HISTORY_HEADER_SIZE + offset);
+        StoreLe64(&entry[CKB_HASH_SIZE + 8], points.size());
+        directory += entry;
+        offset += data.size();
+        buffer += data;
+        if (buffer.size() >= BALANCE_HISTORY_WRITE_BYTES)
+        {
+            if (!writer.Append(buffer.data(), buffer.size()))
+            {
+                return false;
+            }
+            buffer.clear();
+        }
+    }
+    if (directory.size() != lock_count * BALANCE_HISTORY_ENTRY_SIZE)
+    {
+        ERRORLOG("balance history expected {} locks, got {}", lock_count, directory.size() / BALANCE_HISTORY_ENTRY_SIZE);
+        return false;
+    }
+    buffer += directory;
+    if (!writer.Append(buffer.data(), buffer.size()) || !writer.Close())
+    {
+        return false;
+    }
+    if (0 != rename(tmp_path.c_str(), path_.c_str()))
+    {
+        ERRORLOG("rename {} to {} failed", tmp_path, path_);
+        return false;
+    }
+    return true;
+}
+
+bool BuildBalanceHistory(RocksDBReadOnly &db, uint64_t height, const std::string &path, uint32_t threads)
+{
+    std::string hash;
+    rocksdb::Status status;
+    if (!ReadBlockHash(db, height, hash, status))
+    {
+        ERRORLOG("read block hash {} failed:{}", height, status.ToString());
+        return false;
+    }
+    HistoryBuilder builder(db, path, threads);
+    for (uint64_t begin = 0; begin <= height; begin += BALANCE_HISTORY_WINDOW_BLOCKS)
+    {
+        uint64_t end = std::min(height + 1, begin + BALANCE_HISTORY_WINDOW_BLOCKS);
+        if (!builder.ApplyWindow(begin, end))
+        {
+            return false;
+        }
+        fprintf(stderr, "replayed blocks [%lu, %lu)\n", begin, end);
+    }
+    return builder.Write(height + 1, hash);
+}
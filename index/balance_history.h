@@ -0,0 +1,64 @@
+#ifndef _INDEX_BALANCE_HISTORY_H_
+#define _INDEX_BALANCE_HISTORY_H_
+
+#include "db/rocksdb_read_only.h"
+#include "utils/mmap_file.h"
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Capacity of every lock hash through time, as the (height, balance after the block) points
+// where it changed. Built in one pass over the blocks, replaying the live cells in memory so that
+// inputs resolve without lookups, and read through mmap.
+//
+// File layout, integers little endian, varints as in utils/varint.h
+//   header     magic "CKBBHIS1", u64 lock_count, u64 next_height, hash[32] of block next_height - 1
+//   data       per lock: u32 group_offsets[ceil(points / 64)] from the start of its data, then the
+//              groups of 64 points. A group's first point is varint height, varint balance, the
+//              others varint height delta, zigzag varint balance delta from the previous point.
+//   directory  lock_count * (lock_hash[32], u64 data offset, u64 points), sorted by lock_hash, at
+//              the end of the file
+//
+// A lookup binary searches the directory, then the groups by their first height, and decodes at
+// most one group.
+const size_t BALANCE_HISTORY_HEADER_SIZE = 56;
+const size_t BALANCE_HISTORY_ENTRY_SIZE = 48;
+const size_t BALANCE_HISTORY_GROUP_POINTS = 64;
+
+typedef std::pair<uint64_t, uint64_t> BalancePoint; // height, balance
+
+class BalanceHistory
+{
+public:
+    bool Open(const std::string &path);
+    void Close();
+
+    uint64_t LockCount() const { return lock_count_; }
+    // The blocks below next height are reflected
+    uint64_t NextHeight() const { return next_height_; }
+    // Balance of lock_hash after block height, false when the height is past the index
+    bool BalanceAt(std::string_view lock_hash, uint64_t height, uint64_t &balance) const;
+    // Every change point of lock_hash, oldest first
+    bool Changes(std::string_view lock_hash, std::vector<BalancePoint> &points) const;
+
+private:
+    // Directory entry of lock_hash, nullptr when it never held cells
+    const char *Entry(std::string_view lock_hash) const;
+    // Start of a group of the entry's points, nullptr when the entry's offsets or the group's lie
+    // outside the data
+    const char *GroupStart(const char *entry, uint64_t group) const;
+    bool DecodeGroup(const char *entry, uint64_t group, std::vector<BalancePoint> &points) const;
+
+    MmapFile file_;
+    uint64_t lock_count_ = 0;
+    uint64_t next_height_ = 0;
+    const char *directory_ = nullptr;
+};
+
+// Replays the blocks up to height into the history at path. Every window of blocks is read in
+// parallel, then applied in order, its change points spilled to a run file that is merged into
+// the index at the end.
+bool BuildBalanceHistory(RocksDBReadOnly &db, uint64_t height, const std::string &path, uint32_t threads);
+
+#endif
@@ -0,0 +1,432 @@
+#include "balance_index.h"
+#include "archive/archive_format.h"
+#include "db/columns.h"
+#include "db/raw_block.h"
+#include "index/live_cell_index.h"
+#include "log/logging.h"
+#include "molecule/block_molecule.h"
+#include "utils/crypto_utils.h"
+#include "utils/file_utils.h"
+#include "utils/parallel_for.hpp"
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <stdio.h>
+#include <unordered_map>
+#include <vector>
+
+static const char BALANCE_MAGIC[8] = {'C', 'K', 'B', 'B', 'A', 'L', 'C', '2'};
+static const uint64_t BALANCE_CHECKPOINT_BLOCKS = 100000;
+static const uint64_t BALANCE_RESOLVE_BATCH = 256;
+static const uint64_t BALANCE_TABLE_MIN_SLOTS = 1 << 10;
+
+bool BalanceIndex::Open(const std::string &path)
+{
+    Close();
+    if (!file_.Open(path))
+    {
+        return false;
+    }
+    const char *p = file_.Data();
+    if (file_.Size() < BALANCE_HEADER_SIZE || 0 != memcmp(p, BALANCE_MAGIC, sizeof(BALANCE_MAGIC)))
+    {
+        ERRORLOG("{} is not a balance index", path);
+        file_.Close();
+        return false;
+    }
+    uint64_t count = LoadLe64(p + 8);
+    const size_t entry_size = BALANCE_RECORD_SIZE + BALANCE_POSITION_SIZE;
+    if (count > file_.Size() / entry_size || file_.Size() != BALANCE_HEADER_SIZE + count * entry_size)
+    {
+        ERRORLOG("balance index {} size error:{}", path, file_.Size());
+        file_.Close();
+        return false;
+    }
+    const char *positions = p + BALANCE_HEADER_SIZE + count * BALANCE_RECORD_SIZE;
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        if (LoadLe64(positions + i * BALANCE_POSITION_SIZE) >= count)
+        {
+            ERRORLOG("balance index {} position {} out of range", path, i);
+            file_.Close();
+            return false;
+        }
+    }
+    count_ = count;
+    next_height_ = LoadLe64(p + 16);
+    return true;
+}
+
+void BalanceIndex::Close()
+{
+    file_.Close();
+    count_ = 0;
+    next_height_ = 0;
+}
+
+std::string_view BalanceIndex::BlockHash() const
+{
+    return std::string_view(file_.Data() + 24, CKB_HASH_SIZE);
+}
+
+Balance BalanceIndex::At(uint64_t i) const
+{
+    const char *p = Record(i);
+    Balance balance;
+    balance.lock_hash = std::string_view(p, CKB_HASH_SIZE);
+    balance.capacity = LoadLe64(p + CKB_HASH_SIZE);
+    balance.cells = LoadLe64(p + CKB_HASH_SIZE + 8);
+    return balance;
+}
+
+bool BalanceIndex::Find(std::string_view lock_hash, Balance &balance) const
+{
+    if (CKB_HASH_SIZE != lock_hash.size())
+    {
+        return false;
+    }
+    const char *positions = file_.Data() + BALANCE_HEADER_SIZE + count_ * BALANCE_RECORD_SIZE;
+    uint64_t low = 0, high = count_;
+    while (low < high)
+    {
+        uint64_t mid = low + (high - low) / 2;
+        uint64_t position = LoadLe64(positions + mid * BALANCE_POSITION_SIZE);
+        int order = memcmp(Record(position), lock_hash.data(), CKB_HASH_SIZE);
+        if (0 == order)
+        {
+            balance = At(position);
+            return true;
+        }
+        if (order < 0)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return false;
+}
+
+struct BalanceSlot
+{
+    std::array<char, CKB_HASH_SIZE> lock_hash;
+    uint64_t capacity;
+    uint64_t cells;
+};
+
+// Open addressing map from lock hash to balance, slots sit inline so a probe reads one cache
+// line. Locks are never removed, an emptied one just keeps zero cells.
+class BalanceTable
+{
+public:
+    explicit BalanceTable(uint64_t count)
+    {
+        uint64_t slots = BALANCE_TABLE_MIN_SLOTS;
+        while (slots < count * 2)
+        {
+            slots *= 2;
+        }
+        Reset(slots);
+    }
+
+    BalanceSlot &Get(const char *lock_hash)
+    {
+        if ((size_ + 1) * 10 > slots_.size() * 7)
+        {
+            Grow();
+        }
+        // Lock hashes are uniform
+        for (uint64_t i = LoadLe64(lock_hash) & mask_;; i = (i + 1) & mask_)
+        {
+            if (!used_[i])
+            {
+                memcpy(slots_[i].lock_hash.data(), lock_hash, CKB_HASH_SIZE);
+                slots_[i].capacity = 0;
+                slots_[i].cells = 0;
+                used_[i] = 1;
+                ++size_;
+                return slots_[i];
+            }
+            if (0 == memcmp(slots_[i].lock_hash.data(), lock_hash, CKB_HASH_SIZE))
+            {
+                return slots_[i];
+            }
+        }
+    }
+
+    void Add(const char *lock_hash, uint64_t capacity, uint64_t cells)
+    {
+        BalanceSlot &slot = Get(lock_hash);
+        slot.capacity += capacity;
+        slot.cells += cells;
+    }
+
+    // False when the lock does not hold the cell
+    bool Remove(const char *lock_hash, uint64_t capacity)
+    {
+        BalanceSlot &slot = Get(lock_hash);
+        if (0 == slot.cells || slot.capacity < capacity)
+        {
+            return false;
+        }
+        slot.capacity -= capacity;
+        --slot.cells;
+        return true;
+    }
+
+    // The locks that hold cells
+    void Balances(std::vector<BalanceSlot> &balances) const
+    {
+        for (uint64_t i = 0; i < slots_.size(); ++i)
+        {
+            if (used_[i] && slots_[i].cells > 0)
+            {
+                balances.push_back(slots_[i]);
+            }
+        }
+    }
+
+private:
+    void Reset(uint64_t slots)
+    {
+        std::vector<BalanceSlot>(slots).swap(slots_);
+        std::vector<uint8_t>(slots, 0).swap(used_);
+        mask_ = slots - 1;
+        size_ = 0;
+    }
+
+    void Grow()
+    {
+        std::vector<BalanceSlot> slots;
+        std::vector<uint8_t> used;
+        slots.swap(slots_);
+        used.swap(used_);
+        Reset(slots.size() * 2);
+        for (uint64_t i = 0; i < slots.size(); ++i)
+        {
+            if (used[i])
+            {
+                Get(slots[i].lock_hash.data()) = slots[i];
+            }
+        }
+    }
+
+    std::vector<BalanceSlot> slots_;
+    std::vector<uint8_t> used_;
+    uint64_t mask_ = 0;
+    uint64_t size_ = 0;
+};
+
+static bool WriteBalanceIndex(const std::string &path, const BalanceTable &table, uint64_t next_height, const std::string &block_hash)
+{
+    std::vector<BalanceSlot> balances;
+    table.Balances(balances);
+    std::sort(balances.begin(), balances.end(), [](const BalanceSlot &a, const BalanceSlot &b)
+    {
+        return a.capacity != b.capacity ? a.capacity > b.capacity : a.lock_hash < b.lock_hash;
+    });
+    std::string content(BALANCE_HEADER_SIZE + balances.size() * (BALANCE_RECORD_SIZE + BALANCE_POSITION_SIZE), '\0');
+    char *p = &content[0];
+    memcpy(p, BALANCE_MAGIC, sizeof(BALANCE_MAGIC));
+    StoreLe64(p + 8, balances.size());
+    StoreLe64(p + 16, next_height);
+    memcpy(p + 24, block_hash.data(), std::min(block_hash.size(), CKB_HASH_SIZE));
+    p += BALANCE_HEADER_SIZE;
+    for (auto &balance : balances)
+    {
+        memcpy(p, balance.lock_hash.data(), CKB_HASH_SIZE);
+        StoreLe64(p + CKB_HASH_SIZE, balance.capacity);
+        StoreLe64(p + CKB_HASH_SIZE + 8, balance.cells);
+        p += BALANCE_RECORD_SIZE;
+    }
+    std::vector<uint64_t> by_lock(balances.size());
+    std::iota(by_lock.begin(), by_lock.end(), 0);
+    // memcmp order, as Find compares, std::array<char> compares signed chars
+    std::sort(by_lock.begin(), by_lock.end(), [&](uint64_t a, uint64_t b)
+    {
+        return memcmp(balances[a].lock_hash.data(), balances[b].lock_hash.data(), CKB_HASH_SIZE) < 0;
+    });
+    for (auto position : by_lock)
+    {
+        StoreLe64(p, position);
+        p += BALANCE_POSITION_SIZE;
+    }
+    return WriteFileAtomic(path, content);
+}
+
+static bool BuildBalanceIndex(RocksDBReadOnly &db, const std::string &path, uint32_t threads)
+{
+    std::string tip_hash;
+    uint64_t tip = 0;
+    rocksdb::Status status;
+    if (!ReadTipHeader(db, tip_hash, tip, status))
+    {
+        ERRORLOG("read tip header failed:{}", status.ToString());
+        return false;
+    }
+    // Tx hashes are uniform, their first byte splits the column family evenly
+    std::vector<BalanceTable> parts(256, BalanceTable(0));
+    bool success = ParallelFor(0, parts.size(), 1, threads, [&](uint64_t part, uint64_t, uint32_t)
+    {
+        std::string begin(1, (char)part);
+        std::string end = part + 1 < parts.size() ? std::string(1, (char)(part + 1)) : "";
+        CellEntryFields entry;
+        CellOutputFields output;
+        char lock_hash[CKB_HASH_SIZE];
+        bool valid = true;
+        rocksdb::Status status;
+        bool scanned = db.ScanRange(COLUMN_CELL, begin, end, [&](const rocksdb::Slice &key, const rocksdb::Slice &value)
+        {
+            if (!DecodeCellEntry(std::string_view(value.data(), value.size()), entry) || !DecodeCellOutput(entry.output, output))
+            {
+                ERRORLOG("cell {} format error", Bytes2Hex(key.ToString()));
+                valid = false;
+                return false;
+            }
+            Blake2b256(output.lock_script.data(), output.lock_script.size(), (uint8_t *)lock_hash);
+            parts[part].Add(lock_hash, output.capacity, 1);
+            return true;
+        }, status);
+        return scanned && valid;
+    });
+    if (!success)
+    {
+        return false;
+    }
+    BalanceTable table(0);
+    std::vector<BalanceSlot> balances;
+    for (auto &part : parts)
+    {
+        balances.clear();
+        part.Balances(balances);
+        for (auto &balance : balances)
+        {
+            table.Add(balance.lock_hash.data(), balance.capacity, balance.cells);
+        }
+        part = BalanceTable(0);
+    }
+    return WriteBalanceIndex(path, table, tip + 1, tip_hash);
+}
+
+// Applies the blocks [start, end) to table
+static bool ApplyBlocks(RocksDBReadOnly &db, uint64_t start, uint64_t end, uint32_t threads, BalanceTable &table)
+{
+    std::vector<LiveCellRecord> created;
+    std::vector<CellOutPoint> spent;
+    if (!ReadCellChanges(db, start, end, threads, created, spent))
+    {
+        return false;
+    }
+    // A cell created and spent inside the range changes no balance and needs no lookup
+    std::unordered_map<std::string, size_t> positions;
+    positions.reserve(created.size());
+    for (size_t i = 0; i < created.size(); ++i)
+    {
+        positions.emplace(std::string(created[i].data() + CKB_HASH_SIZE, OUT_POINT_SIZE), i);
+    }
+    std::vector<uint8_t> consumed(created.size(), 0);
+    std::vector<CellOutPoint> older;
+    for (auto &item : spent)
+    {
+        auto it = positions.find(std::string(item.data(), item.size()));
+        if (positions.end() == it)
+        {
+            older.push_back(item);
+        }
+        else
+        {
+            consumed[it->second] = 1;
+        }
+    }
+    positions.clear();
+    // Sorted, the outputs of one transaction are resolved together
+    std::sort(older.begin(), older.end());
+    std::vector<LiveCellRecord> resolved(older.size());
+    bool success = ParallelFor(0, older.size(), BALANCE_RESOLVE_BATCH, threads, [&](uint64_t begin, uint64_t stop, uint32_t)
+    {
+        CellOutputFields output;
+        for (uint64_t i = begin; i < stop; ++i)
+        {
+            std::string_view previous;
+            if (!ReadPreviousOutput(db, std::string_view(older[i].data(), older[i].size()), previous) ||
+                !DecodeCellOutput(previous, output))
+            {
+                ERRORLOG("resolve input {} failed", Bytes2Hex(std::string(older[i].data(), older[i].size())));
+                return false;
+            }
+            Blake2b256(output.lock_script.data(), output.lock_script.size(), (uint8_t *)resolved[i].data());
+            StoreLe64(resolved[i].data() + LIVE_CELL_KEY_SIZE, output.capacity);
+        }
+        return true;
+    });
+    if (!success)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < created.size(); ++i)
+    {
+        if (!consumed[i])
+        {
+            table.Add(created[i].data(), LoadLe64(created[i].data() + LIVE_CELL_KEY_SIZE), 1);
+        }
+    }
+    for (size_t i = 0; i < resolved.size(); ++i)
+    {
+        if (!table.Remove(resolved[i].data(), LoadLe64(resolved[i].data() + LIVE_CELL_KEY_SIZE)))
+        {
+            ERRORLOG("blocks [{}, {}) spend {}, its lock holds less", start, end,
+                     Bytes2Hex(std::string(older[i].data(), older[i].size())));
+            return false;
+        }
+    }
+    return true;
+}
+
+bool UpdateBalanceIndex(RocksDBReadOnly &db, const std::string &path, uint32_t threads)
+{
+    BalanceIndex index;
+    if (!FileExists(path) || !index.Open(path))
+    {
+        return BuildBalanceIndex(db, path, threads);
+    }
+    std::string tip_hash, hash;
+    uint64_t tip = 0;
+    rocksdb::Status status;
+    if (!ReadTipHeader(db, tip_hash, tip, status))
+    {
+        ERRORLOG("read tip header failed:{}", status.ToString());
+        return false;
+    }
+    uint64_t start = index.NextHeight();
+    if (0 == start || !ReadBlockHash(db, start - 1, hash, status) || hash != index.BlockHash())
+    {
+        fprintf(stderr, "block %lu of the balance index left the main chain, rebuilding\n", start - 1);
+        index.Close();
+        return BuildBalanceIndex(db, path, threads);
+    }
+    if (start > tip)
+    {
+        return true;
+    }
+
+    BalanceTable table(index.Count());
+    for (uint64_t i = 0; i < index.Count(); ++i)
+    {
+        Balance balance = index.At(i);
+        table.Add(balance.lock_hash.data(), balance.capacity, balance.cells);
+    }
+    index.Close();
+    for (uint64_t begin = start; begin <= tip; begin += BALANCE_CHECKPOINT_BLOCKS)
+    {
+        uint64_t end = std::min(tip + 1, begin + BALANCE_CHECKPOINT_BLOCKS);
+        if (!ApplyBlocks(db, begin, end, threads, table) || !ReadBlockHash(db, end - 1, hash, status) ||
+            !WriteBalanceIndex(path, table, end, hash))
+        {
+            return false;
+        }
+        fprintf(stderr, "balances updated to block %lu\n", end - 1);
+    }
+    return true;
+}
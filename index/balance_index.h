@@ -0,0 +1,58 @@
+#ifndef _INDEX_BALANCE_INDEX_H_
+#define _INDEX_BALANCE_INDEX_H_
+
+#include "db/rocksdb_read_only.h"
+#include "utils/mmap_file.h"
+#include <string>
+#include <string_view>
+
+// Capacity and cell count of every lock hash, materialized so reports read balances instead of
+// summing cells. Built by scanning COLUMN_CELL, then kept current by applying the capacity deltas
+// of the blocks after it, spent inputs resolved to the outputs they consume.
+//
+// The checkpoint file is sorted by capacity, so the rich list is its first records, and lookups
+// by lock hash binary search the positions that follow them.
+// File layout, integers little endian
+//   header   magic "CKBBALC2", u64 count, u64 next_height, hash[32] of block next_height - 1
+//   records  count * (lock_hash[32], u64 capacity, u64 cells), by capacity descending then lock_hash
+//   by_lock  count * u64 record position, by the lock_hash of the record
+const size_t BALANCE_HEADER_SIZE = 56;
+const size_t BALANCE_RECORD_SIZE = 48;
+const size_t BALANCE_POSITION_SIZE = 8;
+
+struct Balance
+{
+    std::string_view lock_hash;
+    uint64_t capacity = 0;
+    uint64_t cells = 0;
+};
+
+class BalanceIndex
+{
+public:
+    bool Open(const std::string &path);
+    void Close();
+
+    uint64_t Count() const { return count_; }
+    // The blocks below next height are reflected
+    uint64_t NextHeight() const { return next_height_; }
+    std::string_view BlockHash() const;
+    // The i-th largest balance
+    Balance At(uint64_t i) const;
+    // Binary searches by_lock, false when the lock hash holds no cells
+    bool Find(std::string_view lock_hash, Balance &balance) const;
+
+private:
+    const char *Record(uint64_t i) const { return file_.Data() + BALANCE_HEADER_SIZE + i * BALANCE_RECORD_SIZE; }
+
+    MmapFile file_;
+    uint64_t count_ = 0;
+    uint64_t next_height_ = 0;
+};
+
+// Brings the checkpoint at path to the tip, writing it again every 100k blocks so that an
+// interrupted update resumes from there. Rebuilds from COLUMN_CELL when the file is missing or
+// a reorg replaced its last block.
+bool UpdateBalanceIndex(RocksDBReadOnly &db, const std::string &path, uint32_t threads);
+
+#endif
@@ -0,0 +1,129 @@
+#include "cell_snapshot.h"
+#include "archive/archive_format.h"
+#include "db/raw_block.h"
+#include "index/cell_table.h"
+#include "index/live_cell_index.h"
+#include "log/logging.h"
+#include "utils/crypto_utils.h"
+#include "utils/file_utils.h"
+#include <algorithm>
+#include <stdio.h>
+#include <vector>
+
+// Blocks read per window, bounds the created and spent cells held before they are applied
+static const uint64_t SNAPSHOT_WINDOW_BLOCKS = 100000;
+
+// One line per lock hash of the sorted records: lock_hash,cells,capacity
+static bool WriteLockTotals(const std::string &path, const std::vector<LiveCellRecord> &records)
+{
+    std::string content = "lock_hash,cells,capacity\n";
+    char line[128];
+    for (size_t i = 0; i < records.size();)
+    {
+        size_t j = i;
+        uint64_t capacity = 0;
+        for (; j < records.size() && 0 == memcmp(records[i].data(), records[j].data(), CKB_HASH_SIZE); ++j)
+        {
+            capacity += LoadLe64(records[j].data() + LIVE_CELL_KEY_SIZE);
+        }
+        content += Bytes2Hex(std::string(records[i].data(), CKB_HASH_SIZE));
+        snprintf(line, sizeof(line), ",%zu,%lu\n", j - i, capacity);
+        content += line;
+        i = j;
+    }
+    return WriteFileAtomic(path, content);
+}
+
+bool BuildCellSnapshot(RocksDBReadOnly &db, uint64_t height, const std::string &base, const std::string &path, uint32_t threads)
+{
+    std::string hash;
+    rocksdb::Status status;
+    if (!ReadBlockHash(db, height, hash, status))
+    {
+        ERRORLOG("read block hash {} failed:{}", height, status.ToString());
+        return false;
+    }
+
+    uint64_t start = 0;
+    LiveCellIndex index;
+    if (!base.empty())
+    {
+        std::string base_hash;
+        if (!index.Open(base))
+        {
+            return false;
+        }
+        start = index.NextHeight();
+        if (0 == start || start > height + 1)
+        {
+            ERRORLOG("snapshot {} next height {} is not in [1, {}]", base, start, height + 1);
+            return false;
+        }
+        if (!ReadBlockHash(db, start - 1, base_hash, status) || base_hash != index.BlockHash())
+        {
+            ERRORLOG("block {} of snapshot {} is not on the main chain", start - 1, base);
+            return false;
+        }
+    }
+    CellTable table(index.Count());
+    LiveCellRecord record;
+    for (uint64_t i = 0; i < index.Count(); ++i)
+    {
+        memcpy(record.data(), index.At(i).lock_hash.data(), LIVE_CELL_RECORD_SIZE);
+        table.Insert(record);
+    }
+    index.Close();
+
+    std::vector<LiveCellRecord> created;
+    std::vector<CellOutPoint> spent;
+    for (uint64_t begin = start; begin <= height; begin += SNAPSHOT_WINDOW_BLOCKS)
+    {
+        uint64_t end = std::min(height + 1, begin + SNAPSHOT_WINDOW_BLOCKS);
+        created.clear();
+        spent.clear();
+        if (!ReadCellChanges(db, begin, end, threads, created, spent))
+        {
+            return false;
+        }
+        // Each cell is created once and spent at most once, so inside a window the order of
+        // the blocks does not matter as long as creations go first
+        for (auto &item : created)
+        {
+            if (!table.Insert(item))
+            {
+                ERRORLOG("blocks [{}, {}) create the live cell {} again", begin, end,
+                         Bytes2Hex(std::string(item.data() + CKB_HASH_SIZE, OUT_POINT_SIZE)));
+                return false;
+            }
+        }
+        for (auto &item : spent)
+        {
+            if (!table.Erase(item.data(), record))
+            {
+                ERRORLOG("blocks [{}, {}) spend the unknown cell {}", begin, end, Bytes2Hex(std::string(item.data(), item.size())));
+                return false;
+            }
+        }
+        fprintf(stderr, "replayed blocks [%lu, %lu), %lu live cells\n", begin, end, table.Size());
+    }
+    std::vector<LiveCellRecord>().swap(created);
+    std::vector<CellOutPoint>().swap(spent);
+
+    std::vector<LiveCellRecord> records;
+    table.Extract(records);
+    std::sort(records.begin(), records.end(), LiveCellRecordLess);
+    size_t position = 0;
+    if (!WriteLiveCellIndex(path, records.size(), height + 1, hash, [&](LiveCellRecord &record)
+    {
+        if (position == records.size())
+        {
+            return false;
+        }
+        record = records[position++];
+        return true;
+    }))
+    {
+        return false;
+    }
+    return WriteLockTotals(path + ".locks.csv", records);
+}
@@ -0,0 +1,16 @@
+#ifndef _INDEX_CELL_SNAPSHOT_H_
+#define _INDEX_CELL_SNAPSHOT_H_
+
+#include "db/rocksdb_read_only.h"
+#include <string>
+
+// Live cell set as of a past height. COLUMN_CELL only holds the tip's, so the blocks are replayed
+// from genesis, or from an earlier snapshot when base is set, into an in-memory cell table. Every
+// window of blocks is read in parallel and its created and spent cells applied in one go.
+//
+// The snapshot uses the live cell index layout with next_height = height + 1, so LiveCellIndex
+// reads it and it can be the base of a later one, as can a live cell index built from COLUMN_CELL. "<path>.locks.csv" gets the cell count and
+// capacity total of every lock hash.
+bool BuildCellSnapshot(RocksDBReadOnly &db, uint64_t height, const std::string &base, const std::string &path, uint32_t threads);
+
+#endif
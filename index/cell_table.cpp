@@ -0,0 +1,112 @@
+#include "cell_table.h"
+#include "archive/archive_format.h"
+#include "utils/crypto_utils.h"
+#include <string.h>
+
+static const uint64_t CELL_TABLE_MIN_SLOTS = 1 << 16;
+
+CellTable::CellTable(uint64_t count)
+{
+    uint64_t slots = CELL_TABLE_MIN_SLOTS;
+    while (slots < count * 2)
+    {
+        slots *= 2;
+    }
+    Reset(slots);
+}
+
+bool CellTable::Insert(const LiveCellRecord &record)
+{
+    if ((size_ + 1) * 10 > slots_.size() * 7)
+    {
+        Grow();
+    }
+    const char *out_point = record.data() + CKB_HASH_SIZE;
+    for (uint64_t i = Home(out_point);; i = (i + 1) & mask_)
+    {
+        if (!used_[i])
+        {
+            slots_[i] = record;
+            used_[i] = 1;
+            ++size_;
+            return true;
+        }
+        if (0 == memcmp(slots_[i].data() + CKB_HASH_SIZE, out_point, OUT_POINT_SIZE))
+        {
+            return false;
+        }
+    }
+}
+
+bool CellTable::Erase(const char *out_point, LiveCellRecord &record)
+{
+    uint64_t i = Home(out_point);
+    for (;; i = (i + 1) & mask_)
+    {
+        if (!used_[i])
+        {
+            return false;
+        }
+        if (0 == memcmp(slots_[i].data() + CKB_HASH_SIZE, out_point, OUT_POINT_SIZE))
+        {
+            break;
+        }
+    }
+    record = slots_[i];
+    // Pulls back every following cell whose home is not between the hole and itself
+    for (uint64_t j = (i + 1) & mask_; used_[j]; j = (j + 1) & mask_)
+    {
+        uint64_t home = Home(slots_[j].data() + CKB_HASH_SIZE);
+        if (((j - home) & mask_) >= ((j - i) & mask_))
+        {
+            slots_[i] = slots_[j];
+            i = j;
+        }
+    }
+    used_[i] = 0;
+    --size_;
+    return true;
+}
+
+void CellTable::Extract(std::vector<LiveCellRecord> &records)
+{
+    records.reserve(records.size() + size_);
+    for (uint64_t i = 0; i < slots_.size(); ++i)
+    {
+        if (used_[i])
+        {
+            records.push_back(slots_[i]);
+        }
+    }
+    Reset(CELL_TABLE_MIN_SLOTS);
+}
+
+// Tx hashes are uniform, the output index is mixed in for the cells of one transaction
+uint64_t CellTable::Home(const char *out_point) const
+{
+    return (LoadLe64(out_point) ^ LoadLe32(out_point + CKB_HASH_SIZE) * 0x9e3779b97f4a7c15ULL) & mask_;
+}
+
+void CellTable::Reset(uint64_t slots)
+{
+    std::vector<LiveCellRecord>(slots).swap(slots_);
+    std::vector<uint8_t>(slots, 0).swap(used_);
+    mask_ = slots - 1;
+    size_ = 0;
+}
+
+void CellTable::Grow()
+{
+    std::vector<LiveCellRecord> slots;
+    std::vector<uint8_t> used;
+    slots.swap(slots_);
+    used.swap(used_);
+    Reset(slots.size() * 2);
+    for (uint64_t i = 0; i < slots.size(); ++i)
+    {
+        if (used[i])
+        {
+            Insert(slots[i]);
+        }
+    }
+}
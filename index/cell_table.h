@@ -0,0 +1,34 @@
+#ifndef _INDEX_CELL_TABLE_H_
+#define _INDEX_CELL_TABLE_H_
+
+#include "index/live_cell_index.h"
+#include <vector>
+
+// Open addressing set of live cells keyed by out_point, used to replay blocks in memory. Linear
+// probing with backward shift deletion, so erasing a spent cell leaves no tombstone behind.
+class CellTable
+{
+public:
+    // Sized for count cells without growing
+    explicit CellTable(uint64_t count);
+
+    uint64_t Size() const { return size_; }
+    // False when the out_point is already live
+    bool Insert(const LiveCellRecord &record);
+    // Removes the cell of out_point into record, false when it is not live
+    bool Erase(const char *out_point, LiveCellRecord &record);
+    // Moves the cells out, leaving the table empty
+    void Extract(std::vector<LiveCellRecord> &records);
+
+private:
+    uint64_t Home(const char *out_point) const;
+    void Reset(uint64_t slots);
+    void Grow();
+
+    std::vector<LiveCellRecord> slots_;
+    std::vector<uint8_t> used_;
+    uint64_t mask_ = 0;
+    uint64_t size_ = 0;
+};
+
+#endif
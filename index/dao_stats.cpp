@@ -0,0 +1,305 @@
+#include "dao_stats.h"
+#include "archive/archive_format.h"
+#include "db/columns.h"
+#include "db/raw_block.h"
+#include "log/logging.h"
+#include "molecule/block_molecule.h"
+#include "utils/crypto_utils.h"
+#include "utils/file_utils.h"
+#include "utils/parallel_for.hpp"
+#include <algorithm>
+#include <stdio.h>
+
+static const uint64_t DAO_WINDOW_BLOCKS = 100000;
+static const uint64_t DAO_READ_BATCH = 64;
+static const size_t DAO_DATA_SIZE = 8;
+static const uint8_t DAO_HASH_TYPE = 1;
+static const uint64_t SHANNONS_PER_BYTE = 100000000;
+static const uint64_t EPOCH_NUMBER_MASK = 0xffffff;
+
+// Mainnet NervosDAO type script code hash
+static const std::string &DaoCodeHash()
+{
+    static const std::string code_hash = Hex2Bytes("82d76d1b75fe2fd9a27dfbaa65a039221a380d76c926f378d3f81cf3e7e13f2e");
+    return code_hash;
+}
+
+struct DaoBlock
+{
+    uint64_t epoch = 0;
+    uint64_t c = 0;
+    uint64_t ar = 0;
+    uint64_t s = 0;
+    uint64_t u = 0;
+    uint64_t deposits = 0;
+    uint64_t deposit_capacity = 0;
+    uint64_t requests = 0;
+    uint64_t request_capacity = 0;
+    uint64_t request_compensation = 0;
+};
+
+// An input of a transaction with header deps, the DAO script needs them to withdraw
+struct DaoSpend
+{
+    std::array<char, 36> out_point;
+    uint64_t height = 0;
+};
+
+static bool ReadAccumulateRate(RocksDBReadOnly &db, uint64_t height, uint64_t &ar)
+{
+    std::string hash, view;
+    std::string_view header_hash, header;
+    rocksdb::Status status;
+    if (!ReadBlockHash(db, height, hash, status) || !db.ReadData(COLUMN_BLOCK_HEADER, hash, view, status))
+    {
+        ERRORLOG("read header {} failed:{}", height, status.ToString());
+        return false;
+    }
+    if (!SplitHeaderView(view, header_hash, header))
+    {
+        ERRORLOG("header {} format error", height);
+        return false;
+    }
+    ar = LoadLe64(header.data() + HEADER_DAO_AR);
+    return true;
+}
+
+// Bytes of the capacity field, the scripts and the data, in shannons
+static uint64_t OccupiedCapacity(const CellOutputFields &output, size_t data_size)
+{
+    uint64_t bytes = 8 + data_size + 32 + 1 + output.lock.args.size();
+    if (output.has_type)
+    {
+        bytes += 32 + 1 + output.type.args.size();
+    }
+    return bytes * SHANNONS_PER_BYTE;
+}
+
+static bool ReadDaoBlock(RocksDBReadOnly &db, uint64_t height, DaoBlock &stats, std::vector<DaoWithdrawal> &requests,
+                         std::vector<DaoSpend> &spends)
+{
+    thread_local RawBlock block;
+    thread_local std::vector<std::string_view> header_deps, inputs, outputs, outputs_data;
+    rocksdb::Status status;
+    std::string_view block_hash, header;
+    if (!ReadRawBlock(db, height, block, status))
+    {
+        ERRORLOG("read block {} failed:{}", height, status.ToString());
+        return false;
+    }
+    if (!SplitHeaderView(block.header, block_hash, header))
+    {
+        ERRORLOG("block {} format error", height);
+        return false;
+    }
+    const char *p = header.data();
+    stats.epoch = LoadLe64(p + HEADER_EPOCH) & EPOCH_NUMBER_MASK;
+    stats.c = LoadLe64(p + HEADER_DAO_C);
+    stats.ar = LoadLe64(p + HEADER_DAO_AR);
+    stats.s = LoadLe64(p + HEADER_DAO_S);
+    stats.u = LoadLe64(p + HEADER_DAO_U);
+    for (size_t i = 0; i < block.transactions.size(); ++i)
+    {
+        std::string_view hash, witness_hash, transaction, raw, witnesses;
+        RawTransactionFields fields;
+        if (!SplitTransactionView(block.transactions[i], hash, witness_hash, transaction) ||
+            !SplitTransaction(transaction, raw, witnesses) || !DecodeRawTransaction(raw, fields) ||
+            !GetFixVecItems(fields.header_deps, 32, header_deps) || !GetFixVecItems(fields.inputs, CELL_INPUT_SIZE, inputs) ||
+            !GetDynVecItems(fields.outputs, outputs) || !GetDynVecItems(fields.outputs_data, outputs_data) ||
+            outputs.size() != outputs_data.size())
+        {
+            ERRORLOG("block {} transaction {} format error", height, i);
+            return false;
+        }
+        // The cellbase input spends nothing
+        for (size_t j = 0; i > 0 && !header_deps.empty() && j < inputs.size(); ++j)
+        {
+            spends.emplace_back();
+            memcpy(spends.back().out_point.data(), inputs[j].data() + 8, spends.back().out_point.size());
+            spends.back().height = height;
+        }
+        CellOutputFields output;
+        std::string_view data;
+        for (uint32_t j = 0; j < outputs.size(); ++j)
+        {
+            if (!DecodeCellOutput(outputs[j], output) || !GetBytesData(outputs_data[j], data))
+            {
+                ERRORLOG("block {} transaction {} output {} format error", height, i, j);
+                return false;
+            }
+            if (!output.has_type || DAO_HASH_TYPE != output.type.hash_type || output.type.code_hash != DaoCodeHash() ||
+                DAO_DATA_SIZE != data.size())
+            {
+                continue;
+            }
+            uint64_t deposit_height = LoadLe64(data.data());
+            if (0 == deposit_height)
+            {
+                ++stats.deposits;
+                stats.deposit_capacity += output.capacity;
+                continue;
+            }
+            uint64_t deposit_ar = 0;
+            if (deposit_height >= height || !ReadAccumulateRate(db, deposit_height, deposit_ar) || 0 == deposit_ar)
+            {
+                ERRORLOG("block {} transaction {} output {} deposit block {} error", height, i, j, deposit_height);
+                return false;
+            }
+            requests.emplace_back();
+            DaoWithdrawal &request = requests.back();
+            uint32_t index = htole32(j);
+            memcpy(request.out_point.data(), hash.data(), CKB_HASH_SIZE);
+            memcpy(request.out_point.data() + CKB_HASH_SIZE, &index, sizeof(index));
+            request.deposit_height = deposit_height;
+            request.request_height = height;
+            request.capacity = output.capacity;
+            request.occupied = OccupiedCapacity(output, data.size());
+            uint64_t counted = output.capacity > request.occupied ? output.capacity - request.occupied : 0;
+            request.compensation = (uint64_t)((unsigned __int128)counted * stats.ar / deposit_ar) - counted;
+            ++stats.requests;
+            stats.request_capacity += output.capacity;
+            stats.request_compensation += request.compensation;
+        }
+    }
+    return true;
+}
+
+static bool OutPointLess(const std::array<char, 36> &a, const std::array<char, 36> &b)
+{
+    return memcmp(a.data(), b.data(), a.size()) < 0;
+}
+
+// Adds the blocks [start, end) to the epochs
+static bool CollectWindow(RocksDBReadOnly &db, uint64_t start, uint64_t end, uint32_t threads, std::vector<DaoEpochStats> &epochs,
+                          std::vector<DaoWithdrawal> &requests, std::vector<DaoSpend> &spends)
+{
+    threads = std::max<uint32_t>(threads, 1);
+    std::vector<DaoBlock> blocks(end - start);
+    std::vector<std::vector<DaoWithdrawal>> worker_requests(threads);
+    std::vector<std::vector<DaoSpend>> worker_spends(threads);
+    bool success = ParallelFor(start, end, DAO_READ_BATCH, threads, [&](uint64_t begin, uint64_t stop, uint32_t worker)
+    {
+        for (uint64_t height = begin; height < stop; ++height)
+        {
+            if (!ReadDaoBlock(db, height, blocks[height - start], worker_requests[worker], worker_spends[worker]))
+            {
+                return false;
+            }
+        }
+        return true;
+    });
+    if (!success)
+    {
+        return false;
+    }
+    for (uint64_t height = start; height < end; ++height)
+    {
+        const DaoBlock &block = blocks[height - start];
+        if (epochs.empty() || epochs.back().epoch != block.epoch)
+        {
+            epochs.emplace_back();
+            epochs.back().epoch = block.epoch;
+            epochs.back().start_height = height;
+        }
+        DaoEpochStats &epoch = epochs.back();
+        ++epoch.blocks;
+        epoch.c = block.c;
+        epoch.ar = block.ar;
+        epoch.s = block.s;
+        epoch.u = block.u;
+        epoch.deposits += block.deposits;
+        epoch.deposit_capacity += block.deposit_capacity;
+        epoch.requests += block.requests;
+        epoch.request_capacity += block.request_capacity;
+        epoch.request_compensation += block.request_compensation;
+    }
+    for (auto &items : worker_requests)
+    {
+        requests.insert(requests.end(), items.begin(), items.end());
+    }
+    for (auto &items : worker_spends)
+    {
+        spends.insert(spends.end(), items.begin(), items.end());
+    }
+    return true;
+}
+
+bool CollectDaoStats(RocksDBReadOnly &db, uint64_t start, uint64_t end, uint32_t threads, std::vector<DaoEpochStats> &epochs,
+                     std::vector<DaoWithdrawal> &withdrawals)
+{
+    epochs.clear();
+    withdrawals.clear();
+    std::vector<DaoSpend> spends;
+    for (uint64_t begin = start; begin < end; begin += DAO_WINDOW_BLOCKS)
+    {
+        uint64_t stop = std::min(end, begin + DAO_WINDOW_BLOCKS);
+        if (!CollectWindow(db, begin, stop, threads, epochs, withdrawals, spends))
+        {
+            return false;
+        }
+        fprintf(stderr, "read the DAO cells of blocks [%lu, %lu)\n", begin, stop);
+    }
+
+    std::sort(withdrawals.begin(), withdrawals.end(), [](const DaoWithdrawal &a, const DaoWithdrawal &b)
+    {
+        return OutPointLess(a.out_point, b.out_point);
+    });
+    for (auto &spend : spends)
+    {
+        auto it = std::lower_bound(withdrawals.begin(), withdrawals.end(), spend.out_point,
+                                   [](const DaoWithdrawal &a, const std::array<char, 36> &b) { return OutPointLess(a.out_point, b); });
+        if (it == withdrawals.end() || it->out_point != spend.out_point)
+        {
+            continue;
+        }
+        it->withdraw_height = spend.height;
+        // The epoch holding the height, the last one starting at or before it
+        auto epoch = std::upper_bound(epochs.begin(), epochs.end(), spend.height,
+                                      [](uint64_t height, const DaoEpochStats &stats) { return height < stats.start_height; });
+        --epoch;
+        ++epoch->withdrawals;
+        epoch->withdrawal_capacity += it->capacity;
+        epoch->withdrawal_compensation += it->compensation;
+    }
+    int64_t net_capacity = 0;
+    for (auto &epoch : epochs)
+    {
+        net_capacity += (int64_t)epoch.deposit_capacity - (int64_t)epoch.withdrawal_capacity;
+        epoch.net_capacity = net_capacity;
+    }
+    return true;
+}
+
+bool WriteDaoReports(const std::string &dir, const std::vector<DaoEpochStats> &epochs, const std::vector<DaoWithdrawal> &withdrawals)
+{
+    char line[512];
+    std::string content = "epoch,start_height,blocks,c,ar,s,u,deposits,deposit_capacity,requests,request_capacity,request_compensation,"
+                          "withdrawals,withdrawal_capacity,withdrawal_compensation,net_capacity\n";
+    for (auto &epoch : epochs)
+    {
+        snprintf(line, sizeof(line), "%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%ld\n", epoch.epoch, epoch.start_height,
+                 epoch.blocks, epoch.c, epoch.ar, epoch.s, epoch.u, epoch.deposits, epoch.deposit_capacity, epoch.requests,
+                 epoch.request_capacity, epoch.request_compensation, epoch.withdrawals, epoch.withdrawal_capacity,
+                 epoch.withdrawal_compensation, epoch.net_capacity);
+        content += line;
+    }
+    if (!WriteFileAtomic(dir + "/dao_epochs.csv", content))
+    {
+        return false;
+    }
+    content = "tx_hash,index,deposit_height,request_height,withdraw_height,capacity,occupied,compensation\n";
+    for (auto &withdrawal : withdrawals)
+    {
+        content += Bytes2Hex(std::string(withdrawal.out_point.data(), CKB_HASH_SIZE));
+        snprintf(line, sizeof(line), ",%u,%lu,%lu,", LoadLe32(withdrawal.out_point.data() + CKB_HASH_SIZE), withdrawal.deposit_height,
+                 withdrawal.request_height);
+        content += line;
+        if (UINT64_MAX != withdrawal.withdraw_height)
+        {
+            content += std::to_string(withdrawal.withdraw_height);
+        }
+        snprintf(line, sizeof(line), ",%lu,%lu,%lu\n", withdrawal.capacity, withdrawal.occupied, withdrawal.compensation);
+        content += line;
+    }
+    return WriteFileAtomic(dir + "/dao_withdrawals.csv", content);
+}
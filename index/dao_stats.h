@@ -0,0 +1,56 @@
+#ifndef _INDEX_DAO_STATS_H_
+#define _INDEX_DAO_STATS_H_
+
+#include "db/rocksdb_read_only.h"
+#include <array>
+#include <string>
+#include <vector>
+
+// NervosDAO activity per epoch, RFC 0023. A DAO cell is a cell whose type script is the DAO script.
+// Its data is 8 zero bytes while deposited, the withdraw request (phase 1) turns it into a cell whose
+// data is the deposit block number, and the withdrawal (phase 2) spends that cell. The amount a
+// request can withdraw is fixed by the accumulate rates (AR) of the two blocks:
+//   counted = capacity - occupied capacity
+//   compensation = counted * AR(request block) / AR(deposit block) - counted
+struct DaoEpochStats
+{
+    uint64_t epoch = 0;
+    uint64_t start_height = 0;
+    uint64_t blocks = 0;
+    // dao field of the last block of the epoch
+    uint64_t c = 0;
+    uint64_t ar = 0;
+    uint64_t s = 0;
+    uint64_t u = 0;
+    uint64_t deposits = 0;
+    uint64_t deposit_capacity = 0;
+    uint64_t requests = 0;
+    uint64_t request_capacity = 0;
+    uint64_t request_compensation = 0;
+    uint64_t withdrawals = 0;
+    uint64_t withdrawal_capacity = 0;
+    uint64_t withdrawal_compensation = 0;
+    // Deposits less withdrawals since the first block, the capacity in the DAO when it is genesis
+    int64_t net_capacity = 0;
+};
+
+struct DaoWithdrawal
+{
+    std::array<char, 36> out_point; // the withdrawing cell
+    uint64_t deposit_height = 0;
+    uint64_t request_height = 0;
+    uint64_t withdraw_height = UINT64_MAX; // UINT64_MAX while unspent
+    uint64_t capacity = 0;
+    uint64_t occupied = 0;
+    uint64_t compensation = 0;
+};
+
+// Reads the blocks [start, end) on threads. Withdrawals are matched to requests of the same range,
+// so withdrawals of requests made before start are not counted. Withdrawals come out sorted by
+// out_point.
+bool CollectDaoStats(RocksDBReadOnly &db, uint64_t start, uint64_t end, uint32_t threads, std::vector<DaoEpochStats> &epochs,
+                     std::vector<DaoWithdrawal> &withdrawals);
+// Writes dao_epochs.csv and dao_withdrawals.csv into dir
+bool WriteDaoReports(const std::string &dir, const std::vector<DaoEpochStats> &epochs, const std::vector<DaoWithdrawal> &withdrawals);
+
+#endif
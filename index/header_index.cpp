@@ -0,0 +1,293 @@
+#include "header_index.h"
+#include "archive/archive_format.h"
+#include "db/columns.h"
+#include "db/raw_block.h"
+#include "log/logging.h"
+#include "utils/arg_utils.h"
+#include "utils/file_utils.h"
+#include "utils/mmap_file.h"
+#include "utils/parallel_for.hpp"
+#include <algorithm>
+#include <time.h>
+
+static const char HEADER_INDEX_MAGIC[8] = {'C', 'K', 'B', 'H', 'I', 'D', 'X', '1'};
+static const size_t HEADER_INDEX_FILE_HEADER_SIZE = 32;
+static const size_t HEADER_INDEX_HASH_SIZE = 32;
+static const size_t HEADER_INDEX_TAIL_BLOCKS = 256;
+static const size_t HEADER_VIEW_SIZE = 32 + 208;
+static const uint64_t HEADER_INDEX_BATCH = 1024;
+
+bool HeaderIndex::Load(const std::string &path)
+{
+    MmapFile file;
+    if (!file.Open(path))
+    {
+        return false;
+    }
+    const char *p = file.Data();
+    size_t size = file.Size();
+    if (size < HEADER_INDEX_FILE_HEADER_SIZE || 0 != memcmp(p, HEADER_INDEX_MAGIC, sizeof(HEADER_INDEX_MAGIC)))
+    {
+        ERRORLOG("{} is not a header index", path);
+        return false;
+    }
+    uint64_t count = LoadLe64(p + 8);
+    uint64_t epoch_count = LoadLe64(p + 16);
+    uint64_t tail_count = LoadLe64(p + 24);
+    if (count > size / 8 || epoch_count > size / 8 || tail_count > size / HEADER_INDEX_HASH_SIZE ||
+        size != HEADER_INDEX_FILE_HEADER_SIZE + 8 * (count + epoch_count) + HEADER_INDEX_HASH_SIZE * tail_count ||
+        tail_count > count)
+    {
+        ERRORLOG("header index {} size error:{}", path, size);
+        return false;
+    }
+    p += HEADER_INDEX_FILE_HEADER_SIZE;
+    timestamps_.resize(count);
+    for (uint64_t i = 0; i < count; ++i, p += 8)
+    {
+        timestamps_[i] = LoadLe64(p);
+    }
+    epoch_starts_.resize(epoch_count);
+    for (uint64_t i = 0; i < epoch_count; ++i, p += 8)
+    {
+        epoch_starts_[i] = LoadLe64(p);
+    }
+    tail_.clear();
+    for (uint64_t i = 0; i < tail_count; ++i, p += HEADER_INDEX_HASH_SIZE)
+    {
+        tail_.emplace_back(p, HEADER_INDEX_HASH_SIZE);
+    }
+    return true;
+}
+
+bool HeaderIndex::Save(const std::string &path) const
+{
+    std::string content(HEADER_INDEX_FILE_HEADER_SIZE + 8 * (timestamps_.size() + epoch_starts_.size()), '\0');
+    char *p = &content[0];
+    memcpy(p, HEADER_INDEX_MAGIC, sizeof(HEADER_INDEX_MAGIC));
+    StoreLe64(p + 8, timestamps_.size());
+    StoreLe64(p + 16, epoch_starts_.size());
+    StoreLe64(p + 24, tail_.size());
+    p += HEADER_INDEX_FILE_HEADER_SIZE;
+    for (uint64_t timestamp : timestamps_)
+    {
+        StoreLe64(p, timestamp);
+        p += 8;
+    }
+    for (uint64_t start : epoch_starts_)
+    {
+        StoreLe64(p, start);
+        p += 8;
+    }
+    for (auto &hash : tail_)
+    {
+        content += hash;
+    }
+    return WriteFileAtomic(path, content);
+}
+
+void HeaderIndex::Truncate(uint64_t count)
+{
+    while (Count() > count)
+    {
+        timestamps_.pop_back();
+        if (!tail_.empty())
+        {
+            tail_.pop_back();
+        }
+    }
+    while (!epoch_starts_.empty() && epoch_starts_.back() >= count)
+    {
+        epoch_starts_.pop_back();
+    }
+}
+
+bool HeaderIndex::Update(RocksDBReadOnly &db, uint32_t threads, bool &changed)
+{
+    changed = false;
+    std::string tip_hash;
+    uint64_t tip = 0;
+    rocksdb::Status status;
+    if (!ReadTipHeader(db, tip_hash, tip, status))
+    {
+        ERRORLOG("read tip header failed:{}", status.ToString());
+        return false;
+    }
+    while (!tail_.empty())
+    {
+        std::string hash;
+        if (ReadBlockHash(db, Count() - 1, hash, status) && hash == tail_.back())
+        {
+            break;
+        }
+        if (!status.ok() && !status.IsNotFound())
+        {
+            ERRORLOG("read block {} hash failed:{}", Count() - 1, status.ToString());
+            return false;
+        }
+        Truncate(Count() - 1);
+        changed = true;
+    }
+    if (tail_.empty() && Count() > 0)
+    {
+        // The reorg went deeper than the tail, nothing left can be trusted
+        Truncate(0);
+    }
+
+    uint64_t start = Count();
+    uint64_t end = tip + 1;
+    if (start >= end)
+    {
+        return true;
+    }
+    uint64_t tail_start = std::max(start, end - std::min<uint64_t>(end, HEADER_INDEX_TAIL_BLOCKS));
+    std::vector<uint64_t> timestamps(end - start);
+    std::vector<uint64_t> epochs(end - start);
+    std::vector<std::string> tail(end - tail_start);
+    bool success = ParallelFor(start, end, HEADER_INDEX_BATCH, threads, [&](uint64_t begin, uint64_t stop, uint32_t)
+    {
+        std::string hash, header;
+        rocksdb::Status status;
+        for (uint64_t height = begin; height < stop; ++height)
+        {
+            if (!ReadBlockHash(db, height, hash, status) || !db.ReadData(COLUMN_BLOCK_HEADER, hash, header, status) ||
+                HEADER_VIEW_SIZE != header.size())
+            {
+                ERRORLOG("read block {} header failed:{}", height, status.ToString());
+                return false;
+            }
+            timestamps[height - start] = LoadLe64(header.data() + 32 + HEADER_TIMESTAMP);
+            epochs[height - start] = LoadLe64(header.data() + 32 + HEADER_EPOCH);
+            if (height >= tail_start)
+            {
+                tail[height - tail_start] = hash;
+            }
+        }
+        return true;
+    });
+    if (!success)
+    {
+        return false;
+    }
+    changed = true;
+
+    for (uint64_t i = 0; i < timestamps.size(); ++i)
+    {
+        uint64_t height = start + i;
+        timestamps_.push_back(timestamps_.empty() ? timestamps[i] : std::max(timestamps_.back(), timestamps[i]));
+        // EpochNumberWithFraction: number in the low 24 bits, index in the epoch the next 16
+        uint64_t number = epochs[i] & 0xffffff;
+        uint64_t index = (epochs[i] >> 24) & 0xffff;
+        while (epoch_starts_.size() <= number)
+        {
+            epoch_starts_.push_back(height - std::min(height, index));
+        }
+    }
+    tail_.insert(tail_.end(), tail.begin(), tail.end());
+    if (tail_.size() > HEADER_INDEX_TAIL_BLOCKS)
+    {
+        tail_.erase(tail_.begin(), tail_.end() - HEADER_INDEX_TAIL_BLOCKS);
+    }
+    return true;
+}
+
+uint64_t HeaderIndex::HeightAtTime(uint64_t timestamp) const
+{
+    return std::lower_bound(timestamps_.begin(), timestamps_.end(), timestamp) - timestamps_.begin();
+}
+
+bool HeaderIndex::EpochHeights(uint64_t first, uint64_t last, uint64_t &start, uint64_t &end) const
+{
+    if (first > last || first >= epoch_starts_.size())
+    {
+        return false;
+    }
+    start = epoch_starts_[first];
+    end = last + 1 < epoch_starts_.size() ? epoch_starts_[last + 1] : Count();
+    return true;
+}
+
+bool ParseTime(const std::string &text, uint64_t &timestamp)
+{
+    if (!text.empty() && std::string::npos == text.find_first_not_of("0123456789"))
+    {
+        uint64_t seconds = 0;
+        if (!ParseDecimal(text, seconds) || seconds > UINT64_MAX / 1000)
+        {
+            return false;
+        }
+        timestamp = seconds * 1000;
+        return true;
+    }
+    struct tm tm = {};
+    const char *rest = strptime(text.c_str(), "%Y-%m-%d", &tm);
+    if (nullptr != rest && ('T' == *rest || ' ' == *rest))
+    {
+        rest = strptime(rest + 1, "%H:%M:%S", &tm);
+    }
+    if (nullptr == rest || '\0' != *rest)
+    {
+        return false;
+    }
+    time_t time = timegm(&tm);
+    if (time < 0)
+    {
+        return false;
+    }
+    timestamp = (uint64_t)time * 1000;
+    return true;
+}
+
+bool HasHeightSelection(const std::map<std::string, std::string> &options)
+{
+    return HasOption(options, "from-time") || HasOption(options, "to-time") || HasOption(options, "epochs");
+}
+
+bool SelectHeights(RocksDBReadOnly &db, const std::map<std::string, std::string> &options, uint32_t threads,
+                   uint64_t &start, uint64_t &end)
+{
+    std::string path = GetOption(options, "header-index", "headers.idx");
+    HeaderIndex index;
+    if (FileExists(path) && !index.Load(path))
+    {
+        return false;
+    }
+    bool changed = false;
+    if (!index.Update(db, threads, changed) || (changed && !index.Save(path)))
+    {
+        return false;
+    }
+
+    uint64_t first = 0, last = index.Count();
+    std::string epochs = GetOption(options, "epochs", "");
+    if (!epochs.empty())
+    {
+        size_t colon = epochs.find(':');
+        uint64_t first_epoch = 0, last_epoch = 0;
+        if (std::string::npos == colon || !ParseDecimal(epochs.substr(0, colon), first_epoch) ||
+            !ParseDecimal(epochs.substr(colon + 1), last_epoch) || !index.EpochHeights(first_epoch, last_epoch, first, last))
+        {
+            printf("--epochs expects first:last within the %lu indexed epochs\n", index.EpochCount());
+            return false;
+        }
+    }
+    uint64_t from_time = 0, to_time = 0;
+    std::string from = GetOption(options, "from-time", ""), to = GetOption(options, "to-time", "");
+    if ((!from.empty() && !ParseTime(from, from_time)) || (!to.empty() && !ParseTime(to, to_time)))
+    {
+        printf("--from-time and --to-time expect unix seconds or YYYY-MM-DD[THH:MM:SS]\n");
+        return false;
+    }
+    if (!from.empty())
+    {
+        first = std::max(first, index.HeightAtTime(from_time));
+    }
+    if (!to.empty())
+    {
+        last = std::min(last, index.HeightAtTime(to_time));
+    }
+    start = std::max(start, first);
+    end = std::max(start, std::min(end, last));
+    fprintf(stderr, "selected heights [%lu, %lu) of %lu indexed blocks\n", start, end, index.Count());
+    return true;
+}
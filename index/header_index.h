@@ -0,0 +1,50 @@
+#ifndef _INDEX_HEADER_INDEX_H_
+#define _INDEX_HEADER_INDEX_H_
+
+#include "db/rocksdb_read_only.h"
+#include <map>
+#include <string>
+#include <vector>
+
+// Timestamp and epoch of every main chain block, so time and epoch bounds resolve to heights with
+// a binary search instead of reading headers. Header timestamps only have to beat the median of
+// the previous blocks, the index keeps their running maximum so that it is sorted.
+//
+// File layout, integers little endian
+//   magic "CKBHIDX1", u64 count, u64 epoch_count, u64 tail_count
+//   u64 timestamps[count]          running maximum, milliseconds
+//   u64 epoch_starts[epoch_count]  first height of every epoch
+//   hash[32] tail[tail_count]      hashes of the last indexed blocks, to find where a reorg started
+class HeaderIndex
+{
+public:
+    bool Load(const std::string &path);
+    bool Save(const std::string &path) const;
+    // Indexes the blocks after Count() up to the tip, first dropping the ones a reorg replaced
+    bool Update(RocksDBReadOnly &db, uint32_t threads, bool &changed);
+
+    uint64_t Count() const { return timestamps_.size(); }
+    uint64_t EpochCount() const { return epoch_starts_.size(); }
+    // First height at or after timestamp, Count() when the chain has not got there
+    uint64_t HeightAtTime(uint64_t timestamp) const;
+    // Heights [start, end) of the epochs first to last, the last indexed epoch may be partial
+    bool EpochHeights(uint64_t first, uint64_t last, uint64_t &start, uint64_t &end) const;
+
+private:
+    void Truncate(uint64_t count);
+
+    std::vector<uint64_t> timestamps_;
+    std::vector<uint64_t> epoch_starts_;
+    std::vector<std::string> tail_;
+};
+
+// Unix seconds or a UTC "YYYY-MM-DD[THH:MM:SS]" date, to milliseconds
+bool ParseTime(const std::string &text, uint64_t &timestamp);
+
+// True when one of --from-time, --to-time or --epochs=first:last selects the heights
+bool HasHeightSelection(const std::map<std::string, std::string> &options);
+// Narrows [start, end) to the selection, loading and updating the index at --header-index first
+bool SelectHeights(RocksDBReadOnly &db, const std::map<std::string, std::string> &options, uint32_t threads,
+                   uint64_t &start, uint64_t &end);
+
+#endif
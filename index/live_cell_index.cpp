@@ -0,0 +1,411 @@
+#include "live_cell_index.h"
+#include "archive/archive_format.h"
+#include "db/columns.h"
+#include "db/raw_block.h"
+#include "log/logging.h"
+#include "molecule/block_molecule.h"
+#include "utils/crypto_utils.h"
+#include "utils/file_utils.h"
+#include "utils/parallel_for.hpp"
+#include "utils/vectored_writer.h"
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <queue>
+#include <stdio.h>
+#include <unordered_set>
+
+static const char LIVE_CELL_MAGIC[8] = {'C', 'K', 'B', 'L', 'I', 'D', 'X', '2'};
+static const uint64_t LIVE_CELL_UPDATE_BATCH = 64;
+static const size_t LIVE_CELL_WRITE_BYTES = 1024 * 1024;
+
+bool LiveCellRecordLess(const LiveCellRecord &a, const LiveCellRecord &b)
+{
+    return memcmp(a.data(), b.data(), LIVE_CELL_KEY_SIZE) < 0;
+}
+
+static void MakeRecord(const CellOutputFields &output, std::string_view out_point, LiveCellRecord &record)
+{
+    Blake2b256(output.lock_script.data(), output.lock_script.size(), (uint8_t *)record.data());
+    memcpy(record.data() + CKB_HASH_SIZE, out_point.data(), OUT_POINT_SIZE);
+    StoreLe64(record.data() + LIVE_CELL_KEY_SIZE, output.capacity);
+}
+
+bool LiveCellIndex::Open(const std::string &path)
+{
+    Close();
+    if (!file_.Open(path))
+    {
+        return false;
+    }
+    const char *p = file_.Data();
+    if (file_.Size() < LIVE_CELL_HEADER_SIZE || 0 != memcmp(p, LIVE_CELL_MAGIC, sizeof(LIVE_CELL_MAGIC)))
+    {
+        ERRORLOG("{} is not a live cell index", path);
+        file_.Close();
+        return false;
+    }
+    uint64_t count = LoadLe64(p + 8);
+    if (count > file_.Size() / LIVE_CELL_RECORD_SIZE || file_.Size() != LIVE_CELL_HEADER_SIZE + count * LIVE_CELL_RECORD_SIZE)
+    {
+        ERRORLOG("live cell index {} size error:{}", path, file_.Size());
+        file_.Close();
+        return false;
+    }
+    count_ = count;
+    next_height_ = LoadLe64(p + 16);
+    return true;
+}
+
+void LiveCellIndex::Close()
+{
+    file_.Close();
+    count_ = 0;
+    next_height_ = 0;
+}
+
+std::string_view LiveCellIndex::BlockHash() const
+{
+    return std::string_view(file_.Data() + 24, CKB_HASH_SIZE);
+}
+
+LiveCell LiveCellIndex::At(uint64_t i) const
+{
+    const char *p = Record(i);
+    LiveCell cell;
+    cell.lock_hash = std::string_view(p, CKB_HASH_SIZE);
+    cell.tx_hash = std::string_view(p + CKB_HASH_SIZE, CKB_HASH_SIZE);
+    cell.index = LoadLe32(p + 2 * CKB_HASH_SIZE);
+    cell.capacity = LoadLe64(p + LIVE_CELL_KEY_SIZE);
+    return cell;
+}
+
+void LiveCellIndex::Find(std::string_view lock_hash, uint64_t &first, uint64_t &last) const
+{
+    first = last = 0;
+    if (CKB_HASH_SIZE != lock_hash.size())
+    {
+        return;
+    }
+    // upper finds the first record past lock_hash, lower the first one not before it
+    auto search = [&](bool upper)
+    {
+        uint64_t low = 0, high = count_;
+        while (low < high)
+        {
+            uint64_t mid = low + (high - low) / 2;
+            int cmp = memcmp(Record(mid), lock_hash.data(), CKB_HASH_SIZE);
+            if (cmp < 0 || (upper && 0 == cmp))
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+        return low;
+    };
+    first = search(false);
+    last = search(true);
+}
+
+bool WriteLiveCellIndex(const std::string &path, uint64_t count, uint64_t next_height, const std::string &block_hash,
+                        const std::function<bool(LiveCellRecord &record)> &next)
+{
+    std::string tmp_path = path + ".tmp";
+    WriterOptions options;
+    options.fsync = FSYNC_CLOSE;
+    VectoredWriter writer(options);
+    if (!writer.Open(tmp_path, false))
+    {
+        return false;
+    }
+    std::string buffer(LIVE_CELL_HEADER_SIZE, '\0');
+    memcpy(&buffer[0], LIVE_CELL_MAGIC, sizeof(LIVE_CELL_MAGIC));
+    StoreLe64(&buffer[8], count);
+    StoreLe64(&buffer[16], next_height);
+    memcpy(&buffer[24], block_hash.data(), std::min(block_hash.size(), CKB_HASH_SIZE));
+    uint64_t written = 0;
+    LiveCellRecord record;
+    while (next(record))
+    {
+        buffer.append(record.data(), record.size());
+        ++written;
+        if (buffer.size() >= LIVE_CELL_WRITE_BYTES)
+        {
+            if (!writer.Append(buffer.data(), buffer.size()))
+            {
+                return false;
+            }
+            buffer.clear();
+        }
+    }
+    if (!writer.Append(buffer.data(), buffer.size()) || !writer.Close())
+    {
+        return false;
+    }
+    if (written != count)
+    {
+        ERRORLOG("live cell index {} expected {} cells, got {}", path, count, written);
+        return false;
+    }
+    if (0 != rename(tmp_path.c_str(), path.c_str()))
+    {
+        ERRORLOG("rename {} to {} failed", tmp_path, path);
+        return false;
+    }
+    return true;
+}
+
+bool BuildLiveCellIndex(RocksDBReadOnly &db, const std::string &path, uint32_t threads)
+{
+    std::string tip_hash;
+    uint64_t tip = 0;
+    rocksdb::Status status;
+    if (!ReadTipHeader(db, tip_hash, tip, status))
+    {
+        ERRORLOG("read tip header failed:{}", status.ToString());
+        return false;
+    }
+    // Tx hashes are uniform, their first byte splits the column family evenly
+    std::vector<std::vector<LiveCellRecord>> parts(256);
+    bool success = ParallelFor(0, parts.size(), 1, threads, [&](uint64_t part, uint64_t, uint32_t)
+    {
+        std::string begin(1, (char)part);
+        std::string end = part + 1 < parts.size() ? std::string(1, (char)(part + 1)) : "";
+        std::vector<LiveCellRecord> &records = parts[part];
+        CellEntryFields entry;
+        CellOutputFields output;
+        bool valid = true;
+        rocksdb::Status status;
+        bool scanned = db.ScanRange(COLUMN_CELL, begin, end, [&](const rocksdb::Slice &key, const rocksdb::Slice &value)
+        {
+            if (OUT_POINT_SIZE != key.size() || !DecodeCellEntry(std::string_view(value.data(), value.size()), entry) ||
+                !DecodeCellOutput(entry.output, output))
+            {
+                ERRORLOG("cell {} format error", Bytes2Hex(key.ToString()));
+                valid = false;
+                return false;
+            }
+            char out_point[OUT_POINT_SIZE];
+            CellKeyToOutPoint(key.data(), out_point);
+            records.emplace_back();
+            MakeRecord(output, std::string_view(out_point, sizeof(out_point)), records.back());
+            return true;
+        }, status);
+        std::sort(records.begin(), records.end(), LiveCellRecordLess);
+        return scanned && valid;
+    });
+    if (!success)
+    {
+        return false;
+    }
+
+    uint64_t count = 0;
+    // (part, position), ordered so the queue yields the smallest record first
+    typedef std::pair<size_t, size_t> Cursor;
+    auto greater = [&](const Cursor &a, const Cursor &b) { return LiveCellRecordLess(parts[b.first][b.second], parts[a.first][a.second]); };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(greater)> queue(greater);
+    for (size_t i = 0; i < parts.size(); ++i)
+    {
+        count += parts[i].size();
+        if (!parts[i].empty())
+        {
+            queue.push(Cursor(i, 0));
+        }
+    }
+    return WriteLiveCellIndex(path, count, tip + 1, tip_hash, [&](LiveCellRecord &record)
+    {
+        if (queue.empty())
+        {
+            return false;
+        }
+        Cursor cursor = queue.top();
+        queue.pop();
+        record = parts[cursor.first][cursor.second];
+        if (cursor.second + 1 < parts[cursor.first].size())
+        {
+            queue.push(Cursor(cursor.first, cursor.second + 1));
+        }
+        return true;
+    });
+}
+
+bool ReadBlockCellChanges(RocksDBReadOnly &db, uint64_t height, std::vector<LiveCellRecord> &created, std::vector<CellOutPoint> &spent)
+{
+    thread_local RawBlock block;
+    thread_local std::vector<std::string_view> inputs, outputs;
+    rocksdb::Status status;
+    if (!ReadRawBlock(db, height, block, status))
+    {
+        ERRORLOG("read block {} failed:{}", height, status.ToString());
+        return false;
+    }
+    std::string out_point;
+    for (size_t i = 0; i < block.transactions.size(); ++i)
+    {
+        std::string_view hash, witness_hash, transaction, raw, witnesses;
+        RawTransactionFields fields;
+        if (!SplitTransactionView(block.transactions[i], hash, witness_hash, transaction) ||
+            !SplitTransaction(transaction, raw, witnesses) || !DecodeRawTransaction(raw, fields) ||
+            !GetFixVecItems(fields.inputs, CELL_INPUT_SIZE, inputs) || !GetDynVecItems(fields.outputs, outputs))
+        {
+            ERRORLOG("block {} transaction {} format error", height, i);
+            return false;
+        }
+        // The cellbase input and null out points spend nothing
+        for (size_t j = 0; i > 0 && j < inputs.size(); ++j)
+        {
+            if (IsNullOutPoint(inputs[j].substr(8)))
+            {
+                continue;
+            }
+            spent.emplace_back();
+            memcpy(spent.back().data(), inputs[j].data() + 8, OUT_POINT_SIZE);
+        }
+        CellOutputFields output;
+        for (uint32_t j = 0; j < outputs.size(); ++j)
+        {
+            if (!DecodeCellOutput(outputs[j], output))
+            {
+                ERRORLOG("block {} transaction {} output {} format error", height, i, j);
+                return false;
+            }
+            uint32_t index = htole32(j);
+            out_point.assign(hash.data(), hash.size());
+            out_point.append((char *)&index, sizeof(index));
+            created.emplace_back();
+            MakeRecord(output, out_point, created.back());
+        }
+    }
+    return true;
+}
+
+bool ReadCellChanges(RocksDBReadOnly &db, uint64_t start, uint64_t end, uint32_t threads, std::vector<LiveCellRecord> &created,
+                     std::vector<CellOutPoint> &spent)
+{
+    threads = std::max<uint32_t>(threads, 1);
+    std::vector<std::vector<LiveCellRecord>> worker_created(threads);
+    std::vector<std::vector<CellOutPoint>> worker_spent(threads);
+    bool success = ParallelFor(start, end, LIVE_CELL_UPDATE_BATCH, threads, [&](uint64_t begin, uint64_t stop, uint32_t worker)
+    {
+        for (uint64_t height = begin; height < stop; ++height)
+        {
+            if (!ReadBlockCellChanges(db, height, worker_created[worker], worker_spent[worker]))
+            {
+                return false;
+            }
+        }
+        return true;
+    });
+    if (!success)
+    {
+        return false;
+    }
+    for (auto &records : worker_created)
+    {
+        created.insert(created.end(), records.begin(), records.end());
+        std::vector<LiveCellRecord>().swap(records);
+    }
+    for (auto &items : worker_spent)
+    {
+        spent.insert(spent.end(), items.begin(), items.end());
+        std::vector<CellOutPoint>().swap(items);
+    }
+    return true;
+}
+
+// The cells the blocks [start, end) leave live, sorted, and the older ones they spend
+static bool CollectChanges(RocksDBReadOnly &db, uint64_t start, uint64_t end, uint32_t threads, std::vector<LiveCellRecord> &created,
+                           std::unordered_set<std::string> &spent)
+{
+    std::vector<LiveCellRecord> records;
+    std::vector<CellOutPoint> items;
+    if (!ReadCellChanges(db, start, end, threads, records, items))
+    {
+        return false;
+    }
+    for (auto &item : items)
+    {
+        spent.emplace(item.data(), item.size());
+    }
+    // A cell created and spent inside the range never reaches the index
+    for (auto &record : records)
+    {
+        if (0 == spent.erase(std::string(record.data() + CKB_HASH_SIZE, OUT_POINT_SIZE)))
+        {
+            created.push_back(record);
+        }
+    }
+    std::sort(created.begin(), created.end(), LiveCellRecordLess);
+    return true;
+}
+
+bool UpdateLiveCellIndex(RocksDBReadOnly &db, const std::string &path, uint32_t threads)
+{
+    LiveCellIndex index;
+    if (!FileExists(path) || !index.Open(path))
+    {
+        return BuildLiveCellIndex(db, path, threads);
+    }
+    std::string tip_hash, hash;
+    uint64_t tip = 0;
+    rocksdb::Status status;
+    if (!ReadTipHeader(db, tip_hash, tip, status))
+    {
+        ERRORLOG("read tip header failed:{}", status.ToString());
+        return false;
+    }
+    uint64_t start = index.NextHeight();
+    if (0 == start || !ReadBlockHash(db, start - 1, hash, status) || hash != index.BlockHash())
+    {
+        fprintf(stderr, "block %lu of the live cell index left the main chain, rebuilding\n", start - 1);
+        index.Close();
+        return BuildLiveCellIndex(db, path, threads);
+    }
+    if (start > tip)
+    {
+        return true;
+    }
+
+    std::vector<LiveCellRecord> created;
+    std::unordered_set<std::string> spent;
+    if (!CollectChanges(db, start, tip + 1, threads, created, spent))
+    {
+        return false;
+    }
+    if (spent.size() > index.Count())
+    {
+        ERRORLOG("blocks [{}, {}] spend {} cells, the index has {}", start, tip, spent.size(), index.Count());
+        return false;
+    }
+    uint64_t existing = 0;
+    size_t added = 0;
+    return WriteLiveCellIndex(path, index.Count() - spent.size() + created.size(), tip + 1, tip_hash, [&](LiveCellRecord &record)
+    {
+        while (existing < index.Count())
+        {
+            LiveCell cell = index.At(existing);
+            const char *p = cell.lock_hash.data();
+            if (spent.count(std::string(p + CKB_HASH_SIZE, OUT_POINT_SIZE)))
+            {
+                ++existing;
+                continue;
+            }
+            if (added < created.size() && memcmp(created[added].data(), p, LIVE_CELL_KEY_SIZE) < 0)
+            {
+                break;
+            }
+            memcpy(record.data(), p, LIVE_CELL_RECORD_SIZE);
+            ++existing;
+            return true;
+        }
+        if (added < created.size())
+        {
+            record = created[added++];
+            return true;
+        }
+        return false;
+    });
+}
@@ -0,0 +1,79 @@
+#ifndef _INDEX_LIVE_CELL_INDEX_H_
+#define _INDEX_LIVE_CELL_INDEX_H_
+
+#include "db/rocksdb_read_only.h"
+#include "utils/mmap_file.h"
+#include <array>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Live cells sorted by lock script hash, read through mmap so a lookup is a binary search over
+// the file. Built by scanning COLUMN_CELL, then kept current by replaying the blocks after it.
+//
+// File layout, integers little endian
+//   header   magic "CKBLIDX2", u64 count, u64 next_height, hash[32] of block next_height - 1
+//   records  count * (lock_hash[32], out_point[36], u64 capacity), sorted by lock_hash and out_point
+//
+// out_point is the molecule OutPoint, tx_hash followed by the u32 output index like every other
+// integer. COLUMN_CELL keys end in a big endian index and are converted when the index is built.
+const size_t LIVE_CELL_HEADER_SIZE = 56;
+const size_t LIVE_CELL_RECORD_SIZE = 76;
+const size_t LIVE_CELL_KEY_SIZE = 68; // lock_hash + out_point
+const size_t OUT_POINT_SIZE = 36;
+
+typedef std::array<char, LIVE_CELL_RECORD_SIZE> LiveCellRecord;
+typedef std::array<char, OUT_POINT_SIZE> CellOutPoint;
+
+bool LiveCellRecordLess(const LiveCellRecord &a, const LiveCellRecord &b);
+
+struct LiveCell
+{
+    std::string_view lock_hash;
+    std::string_view tx_hash;
+    uint32_t index = 0;
+    uint64_t capacity = 0;
+};
+
+class LiveCellIndex
+{
+public:
+    bool Open(const std::string &path);
+    void Close();
+
+    uint64_t Count() const { return count_; }
+    // The blocks below next height are reflected
+    uint64_t NextHeight() const { return next_height_; }
+    std::string_view BlockHash() const;
+    LiveCell At(uint64_t i) const;
+    // Positions [first, last) of the cells locked by lock_hash
+    void Find(std::string_view lock_hash, uint64_t &first, uint64_t &last) const;
+
+private:
+    const char *Record(uint64_t i) const { return file_.Data() + LIVE_CELL_HEADER_SIZE + i * LIVE_CELL_RECORD_SIZE; }
+
+    MmapFile file_;
+    uint64_t count_ = 0;
+    uint64_t next_height_ = 0;
+};
+
+// The cells created and spent by one block, appended in transaction order
+bool ReadBlockCellChanges(RocksDBReadOnly &db, uint64_t height, std::vector<LiveCellRecord> &created, std::vector<CellOutPoint> &spent);
+// The cells created and spent by the blocks [start, end), read on threads, in no particular order.
+// Cellbase inputs and null out points spend nothing and are left out.
+bool ReadCellChanges(RocksDBReadOnly &db, uint64_t start, uint64_t end, uint32_t threads, std::vector<LiveCellRecord> &created,
+                     std::vector<CellOutPoint> &spent);
+// Writes "<path>.tmp" and renames it over path once complete, next(record) returns false after
+// the last of the count records
+bool WriteLiveCellIndex(const std::string &path, uint64_t count, uint64_t next_height, const std::string &block_hash,
+                        const std::function<bool(LiveCellRecord &record)> &next);
+
+// Writes the index of the current live cell set, scanning COLUMN_CELL split by the first tx hash
+// byte over threads
+bool BuildLiveCellIndex(RocksDBReadOnly &db, const std::string &path, uint32_t threads);
+// Applies the blocks from the index' next height to the tip, rebuilding when a reorg replaced
+// its last block or the file is missing
+bool UpdateLiveCellIndex(RocksDBReadOnly &db, const std::string &path, uint32_t threads);
+
+#endif
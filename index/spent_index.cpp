@@ -0,0 +1,397 @@
+#include "spent_index.h"
+#include "archive/archive_format.h"
+#include "db/raw_block.h"
+#include "log/logging.h"
+#include "molecule/block_molecule.h"
+#include "utils/crypto_utils.h"
+#include "utils/file_utils.h"
+#include "utils/parallel_for.hpp"
+#include "utils/vectored_writer.h"
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <queue>
+#include <stdio.h>
+#include <unistd.h>
+
+static const char SPENT_MAGIC[SPENT_MAGIC_SIZE] = {'C', 'K', 'B', 'S', 'P', 'N', 'T', '1'};
+static const size_t SPENT_OUT_POINT_SIZE = 36;
+static const size_t SPENT_INDEX_BITS = 24;
+static const uint64_t SPENT_MAX_INDEX = (1ULL << SPENT_INDEX_BITS) - 1;
+static const uint64_t SPENT_WINDOW_BLOCKS = 100000;
+static const uint64_t SPENT_READ_BATCH = 64;
+static const size_t SPENT_MAX_RUNS = 8;
+static const size_t SPENT_WRITE_BYTES = 1024 * 1024;
+
+typedef std::array<char, SPENT_RECORD_SIZE> SpentRecord;
+
+static bool SpentRecordLess(const SpentRecord &a, const SpentRecord &b)
+{
+    return memcmp(a.data(), b.data(), SPENT_OUT_POINT_SIZE) < 0;
+}
+
+static SpentBy DecodeRecord(const char *p)
+{
+    SpentBy spent;
+    spent.tx_hash = std::string_view(p + SPENT_OUT_POINT_SIZE, CKB_HASH_SIZE);
+    uint64_t position = LoadLe64(p + SPENT_OUT_POINT_SIZE + CKB_HASH_SIZE);
+    spent.height = position >> SPENT_INDEX_BITS;
+    spent.input_index = position & SPENT_MAX_INDEX;
+    return spent;
+}
+
+// First record of run at or after position whose out_point is not below out_point
+static uint64_t LowerBound(const SpentRun &run, uint64_t position, std::string_view out_point)
+{
+    uint64_t low = position, high = run.count;
+    while (low < high)
+    {
+        uint64_t mid = low + (high - low) / 2;
+        if (memcmp(run.records + mid * SPENT_RECORD_SIZE, out_point.data(), SPENT_OUT_POINT_SIZE) < 0)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+bool SpentIndex::Open(const std::string &path)
+{
+    Close();
+    if (!file_.Open(path))
+    {
+        return false;
+    }
+    const char *p = file_.Data();
+    uint64_t size = file_.Size();
+    if (size < SPENT_MAGIC_SIZE || 0 != memcmp(p, SPENT_MAGIC, SPENT_MAGIC_SIZE))
+    {
+        ERRORLOG("{} is not a spent index", path);
+        file_.Close();
+        return false;
+    }
+    for (uint64_t offset = SPENT_MAGIC_SIZE; size - offset >= SPENT_RUN_HEADER_SIZE;)
+    {
+        SpentRun run;
+        run.offset = offset;
+        run.count = LoadLe64(p + offset);
+        run.start = LoadLe64(p + offset + 8);
+        run.end = LoadLe64(p + offset + 16);
+        run.block_hash = std::string_view(p + offset + 24, CKB_HASH_SIZE);
+        run.records = p + offset + SPENT_RUN_HEADER_SIZE;
+        if (run.count > (size - offset - SPENT_RUN_HEADER_SIZE) / SPENT_RECORD_SIZE)
+        {
+            break;
+        }
+        if (run.start >= run.end || run.start != NextHeight())
+        {
+            ERRORLOG("spent index {} run at {} covers [{}, {}) after block {}", path, offset, run.start, run.end, NextHeight());
+            Close();
+            return false;
+        }
+        runs_.push_back(run);
+        offset += SPENT_RUN_HEADER_SIZE + run.count * SPENT_RECORD_SIZE;
+    }
+    return true;
+}
+
+void SpentIndex::Close()
+{
+    file_.Close();
+    runs_.clear();
+}
+
+uint64_t SpentIndex::Count() const
+{
+    uint64_t count = 0;
+    for (auto &run : runs_)
+    {
+        count += run.count;
+    }
+    return count;
+}
+
+bool SpentIndex::Find(std::string_view out_point, SpentBy &spent) const
+{
+    if (SPENT_OUT_POINT_SIZE != out_point.size())
+    {
+        return false;
+    }
+    for (auto &run : runs_)
+    {
+        uint64_t i = LowerBound(run, 0, out_point);
+        if (i < run.count && 0 == memcmp(run.records + i * SPENT_RECORD_SIZE, out_point.data(), SPENT_OUT_POINT_SIZE))
+        {
+            spent = DecodeRecord(run.records + i * SPENT_RECORD_SIZE);
+            return true;
+        }
+    }
+    return false;
+}
+
+void SpentIndex::FindMany(const std::vector<std::string> &out_points, std::vector<SpentBy> &spent, std::vector<bool> &found) const
+{
+    spent.assign(out_points.size(), SpentBy());
+    found.assign(out_points.size(), false);
+    std::vector<size_t> order(out_points.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return out_points[a] < out_points[b]; });
+    for (auto &run : runs_)
+    {
+        // The queries are sorted, each search starts where the previous one ended
+        uint64_t position = 0;
+        for (size_t i : order)
+        {
+            if (found[i] || SPENT_OUT_POINT_SIZE != out_points[i].size())
+            {
+                continue;
+            }
+            position = LowerBound(run, position, out_points[i]);
+            if (position == run.count)
+            {
+                break;
+            }
+            const char *p = run.records + position * SPENT_RECORD_SIZE;
+            if (0 == memcmp(p, out_points[i].data(), SPENT_OUT_POINT_SIZE))
+            {
+                spent[i] = DecodeRecord(p);
+                found[i] = true;
+            }
+        }
+    }
+}
+
+// The inputs of the blocks [start, end), sorted by out_point
+static bool CollectInputs(RocksDBReadOnly &db, uint64_t start, uint64_t end, uint32_t threads, std::vector<SpentRecord> &records)
+{
+    threads = std::max<uint32_t>(threads, 1);
+    std::vector<std::vector<SpentRecord>> worker_records(threads);
+    bool success = ParallelFor(start, end, SPENT_READ_BATCH, threads, [&](uint64_t begin, uint64_t stop, uint32_t worker)
+    {
+        RawBlock block;
+        rocksdb::Status status;
+        std::vector<std::string_view> inputs;
+        for (uint64_t height = begin; height < stop; ++height)
+        {
+            if (!ReadRawBlock(db, height, block, status))
+            {
+                ERRORLOG("read block {} failed:{}", height, status.ToString());
+                return false;
+            }
+            // The cellbase input spends nothing
+            for (size_t i = 1; i < block.transactions.size(); ++i)
+            {
+                std::string_view hash, witness_hash, transaction, raw, witnesses;
+                RawTransactionFields fields;
+                if (!SplitTransactionView(block.transactions[i], hash, witness_hash, transaction) ||
+                    !SplitTransaction(transaction, raw, witnesses) || !DecodeRawTransaction(raw, fields) ||
+                    !GetFixVecItems(fields.inputs, CELL_INPUT_SIZE, inputs) || inputs.size() > SPENT_MAX_INDEX + 1)
+                {
+                    ERRORLOG("block {} transaction {} format error", height, i);
+                    return false;
+                }
+                for (size_t j = 0; j < inputs.size(); ++j)
+                {
+                    // The genesis dep group input spends the null out point, which is no cell
+                    if (IsNullOutPoint(inputs[j].substr(8)))
+                    {
+                        continue;
+                    }
+                    worker_records[worker].emplace_back();
+                    char *p = worker_records[worker].back().data();
+                    memcpy(p, inputs[j].data() + 8, SPENT_OUT_POINT_SIZE);
+                    memcpy(p + SPENT_OUT_POINT_SIZE, hash.data(), CKB_HASH_SIZE);
+                    StoreLe64(p + SPENT_OUT_POINT_SIZE + CKB_HASH_SIZE, height << SPENT_INDEX_BITS | j);
+                }
+            }
+        }
+        return true;
+    });
+    if (!success)
+    {
+        return false;
+    }
+    for (auto &items : worker_records)
+    {
+        records.insert(records.end(), items.begin(), items.end());
+        std::vector<SpentRecord>().swap(items);
+    }
+    std::sort(records.begin(), records.end(), SpentRecordLess);
+    return true;
+}
+
+static void RunHeader(uint64_t count, uint64_t start, uint64_t end, std::string_view block_hash, std::string &header)
+{
+    header.assign(SPENT_RUN_HEADER_SIZE, '\0');
+    StoreLe64(&header[0], count);
+    StoreLe64(&header[8], start);
+    StoreLe64(&header[16], end);
+    memcpy(&header[24], block_hash.data(), std::min(block_hash.size(), CKB_HASH_SIZE));
+}
+
+static bool AppendRun(const std::string &path, const std::vector<SpentRecord> &records, uint64_t start, uint64_t end,
+                      const std::string &block_hash)
+{
+    WriterOptions options;
+    options.fsync = FSYNC_CLOSE;
+    VectoredWriter writer(options);
+    std::string header;
+    RunHeader(records.size(), start, end, block_hash, header);
+    return writer.Open(path, true) && writer.Append(header.data(), header.size()) &&
+           writer.Append((const char *)records.data(), records.size() * SPENT_RECORD_SIZE) && writer.Close();
+}
+
+// Merges a tail of the runs into one. The newest run is kept apart so that a reorg of the tip
+// only reads its blocks again. Older runs join the merge from the newest back while they hold no
+// more records than the merge so far, so the runs grow geometrically towards the front and a
+// record is rewritten a logarithmic number of times. The merge and the newest run are written
+// aside first and then replace the tail of path, a crash in between leaves a shorter index whose
+// missing blocks the next update reads again.
+static bool CompactSpentIndex(const std::string &path)
+{
+    SpentIndex index;
+    if (!index.Open(path))
+    {
+        return false;
+    }
+    const std::vector<SpentRun> &runs = index.Runs();
+    if (runs.size() < 3)
+    {
+        return true;
+    }
+    size_t last = runs.size() - 1, first = last - 2;
+    uint64_t merged = runs[first].count + runs[first + 1].count;
+    while (first > 0 && runs[first - 1].count <= merged)
+    {
+        --first;
+        merged += runs[first].count;
+    }
+    std::vector<uint64_t> positions(runs.size(), 0);
+    auto record = [&](size_t run) { return runs[run].records + positions[run] * SPENT_RECORD_SIZE; };
+    auto greater = [&](size_t a, size_t b) { return memcmp(record(a), record(b), SPENT_OUT_POINT_SIZE) > 0; };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> queue(greater);
+    for (size_t i = first; i < last; ++i)
+    {
+        if (runs[i].count > 0)
+        {
+            queue.push(i);
+        }
+    }
+
+    std::string tmp_path = path + ".tmp";
+    WriterOptions options;
+    options.fsync = FSYNC_CLOSE;
+    VectoredWriter writer(options);
+    if (!writer.Open(tmp_path, false))
+    {
+        return false;
+    }
+    std::string buffer;
+    RunHeader(merged, runs[first].start, runs[last - 1].end, runs[last - 1].block_hash, buffer);
+    while (!queue.empty())
+    {
+        size_t run = queue.top();
+        queue.pop();
+        buffer.append(record(run), SPENT_RECORD_SIZE);
+        if (++positions[run] < runs[run].count)
+        {
+            queue.push(run);
+        }
+        if (buffer.size() >= SPENT_WRITE_BYTES)
+        {
+            if (!writer.Append(buffer.data(), buffer.size()))
+            {
+                return false;
+            }
+            buffer.clear();
+        }
+    }
+    const char *newest = index.Runs()[last].records - SPENT_RUN_HEADER_SIZE;
+    if (!writer.Append(buffer.data(), buffer.size()) ||
+        !writer.Append(newest, SPENT_RUN_HEADER_SIZE + runs[last].count * SPENT_RECORD_SIZE) || !writer.Close())
+    {
+        return false;
+    }
+    uint64_t offset = runs[first].offset;
+    index.Close();
+
+    MmapFile tail;
+    VectoredWriter appender(options);
+    if (!tail.Open(tmp_path) || 0 != truncate(path.c_str(), offset))
+    {
+        ERRORLOG("replace the runs of {} after {} failed", path, offset);
+        return false;
+    }
+    if (!appender.Open(path, true) || !appender.Append(tail.Data(), tail.Size()) || !appender.Close())
+    {
+        return false;
+    }
+    tail.Close();
+    unlink(tmp_path.c_str());
+    return true;
+}
+
+bool UpdateSpentIndex(RocksDBReadOnly &db, const std::string &path, uint32_t threads)
+{
+    std::string tip_hash, hash;
+    uint64_t tip = 0;
+    rocksdb::Status status;
+    if (!ReadTipHeader(db, tip_hash, tip, status))
+    {
+        ERRORLOG("read tip header failed:{}", status.ToString());
+        return false;
+    }
+    SpentIndex index;
+    if (!FileExists(path) || !index.Open(path))
+    {
+        if (!WriteFile(path, std::string(SPENT_MAGIC, SPENT_MAGIC_SIZE)) || !index.Open(path))
+        {
+            return false;
+        }
+    }
+    // Runs whose last block left the main chain are read again
+    size_t runs = index.Runs().size();
+    while (runs > 0)
+    {
+        const SpentRun &run = index.Runs()[runs - 1];
+        if (ReadBlockHash(db, run.end - 1, hash, status) && hash == run.block_hash)
+        {
+            break;
+        }
+        --runs;
+    }
+    if (runs < index.Runs().size())
+    {
+        fprintf(stderr, "spent index runs after block %lu left the main chain, reading them again\n",
+                0 == runs ? 0 : index.Runs()[runs - 1].end);
+    }
+    uint64_t start = 0 == runs ? 0 : index.Runs()[runs - 1].end;
+    uint64_t valid = 0 == runs ? SPENT_MAGIC_SIZE
+                               : index.Runs()[runs - 1].offset + SPENT_RUN_HEADER_SIZE + index.Runs()[runs - 1].count * SPENT_RECORD_SIZE;
+    index.Close();
+    // Also cuts a torn last append
+    if (0 != truncate(path.c_str(), valid))
+    {
+        ERRORLOG("truncate {} to {} failed", path, valid);
+        return false;
+    }
+
+    std::vector<SpentRecord> records;
+    for (uint64_t begin = start; begin <= tip; begin += SPENT_WINDOW_BLOCKS)
+    {
+        uint64_t end = std::min(tip + 1, begin + SPENT_WINDOW_BLOCKS);
+        records.clear();
+        if (!CollectInputs(db, begin, end, threads, records) || !ReadBlockHash(db, end - 1, hash, status) ||
+            !AppendRun(path, records, begin, end, hash))
+        {
+            return false;
+        }
+        ++runs;
+        fprintf(stderr, "indexed the inputs of blocks [%lu, %lu)\n", begin, end);
+    }
+    return runs <= SPENT_MAX_RUNS || CompactSpentIndex(path);
+}
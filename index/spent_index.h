@@ -0,0 +1,68 @@
+#ifndef _INDEX_SPENT_INDEX_H_
+#define _INDEX_SPENT_INDEX_H_
+
+#include "db/rocksdb_read_only.h"
+#include "utils/mmap_file.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Reverse of CellInput::previous_output: which transaction spent an out_point, at what height
+// and input index. The file is a sequence of sorted runs, every update appends one for the new
+// blocks, and once there are more than a few a tail of the older ones is merged, see
+// CompactSpentIndex.
+//
+// File layout, integers little endian
+//   magic "CKBSPNT1"
+//   runs  u64 count, u64 start, u64 end, hash[32] of block end - 1, then count records of
+//         (out_point[36], tx_hash[32], u64 height << 24 | input index), sorted by out_point,
+//         for the blocks [start, end)
+const size_t SPENT_MAGIC_SIZE = 8;
+const size_t SPENT_RUN_HEADER_SIZE = 56;
+const size_t SPENT_RECORD_SIZE = 76;
+
+struct SpentBy
+{
+    std::string_view tx_hash;
+    uint64_t height = 0;
+    uint32_t input_index = 0;
+};
+
+struct SpentRun
+{
+    const char *records = nullptr;
+    uint64_t count = 0;
+    uint64_t start = 0;
+    uint64_t end = 0;
+    std::string_view block_hash;
+    uint64_t offset = 0; // of the run header in the file
+};
+
+class SpentIndex
+{
+public:
+    // Complete runs only, a torn last append is left out
+    bool Open(const std::string &path);
+    void Close();
+
+    const std::vector<SpentRun> &Runs() const { return runs_; }
+    // The blocks below next height are reflected
+    uint64_t NextHeight() const { return runs_.empty() ? 0 : runs_.back().end; }
+    uint64_t Count() const;
+    // False when the out_point is live or unknown
+    bool Find(std::string_view out_point, SpentBy &spent) const;
+    // Looks up many out_points at once, walking every run once in out_point order. found[i] tells
+    // whether spent[i] is set.
+    void FindMany(const std::vector<std::string> &out_points, std::vector<SpentBy> &spent, std::vector<bool> &found) const;
+
+private:
+    MmapFile file_;
+    std::vector<SpentRun> runs_;
+};
+
+// Appends a run for the blocks from the index' next height to the tip. Runs whose last block a
+// reorg replaced are cut first. Once there are more than 8 runs, runs before the newest are merged
+// into one, the older and larger ones left alone.
+bool UpdateSpentIndex(RocksDBReadOnly &db, const std::string &path, uint32_t threads);
+
+#endif
@@ -0,0 +1,204 @@
+#include "tx_hash_index.h"
+#include "archive/archive_format.h"
+#include "db/columns.h"
+#include "db/raw_block.h"
+#include "log/logging.h"
+#include "utils/crypto_utils.h"
+#include "utils/file_utils.h"
+#include "utils/parallel_for.hpp"
+#include <endian.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <vector>
+
+static const char TX_HASH_MAGIC[8] = {'C', 'K', 'B', 'T', 'I', 'D', 'X', '1'};
+static const double TX_HASH_LOAD_FACTOR = 0.85;
+static const size_t TX_HASH_INDEX_BITS = 24;
+static const uint64_t TX_HASH_MAX_NUMBER = (1ULL << (64 - TX_HASH_INDEX_BITS)) - 1;
+static const uint64_t TX_HASH_MAX_INDEX = (1ULL << TX_HASH_INDEX_BITS) - 1;
+// TransactionInfo: struct { block_number, block_epoch, key: TransactionKey { block_hash, index: BeUint32 } }
+static const size_t TRANSACTION_INFO_SIZE = 52;
+static const size_t TRANSACTION_INFO_INDEX = 48;
+
+// Hashes are uniform, the first 8 bytes pick the bucket and the next 8 identify the slot
+static uint64_t Fingerprint(std::string_view hash)
+{
+    uint64_t fingerprint = LoadLe64(hash.data() + 8);
+    return 0 == fingerprint ? 1 : fingerprint;
+}
+
+static uint64_t BucketOf(uint64_t key, uint64_t bucket_count)
+{
+    return (uint64_t)(((unsigned __int128)key * bucket_count) >> 64);
+}
+
+bool TxHashIndex::Open(const std::string &path)
+{
+    if (!file_.Open(path))
+    {
+        return false;
+    }
+    const char *p = file_.Data();
+    if (file_.Size() < TX_HASH_HEADER_SIZE || 0 != memcmp(p, TX_HASH_MAGIC, sizeof(TX_HASH_MAGIC)))
+    {
+        ERRORLOG("{} is not a tx hash index", path);
+        file_.Close();
+        return false;
+    }
+    uint64_t bucket_count = LoadLe64(p + 16);
+    if (bucket_count > file_.Size() / TX_HASH_BUCKET_SIZE || file_.Size() != TX_HASH_HEADER_SIZE + bucket_count * TX_HASH_BUCKET_SIZE)
+    {
+        ERRORLOG("tx hash index {} size error:{}", path, file_.Size());
+        file_.Close();
+        return false;
+    }
+    count_ = LoadLe64(p + 8);
+    bucket_count_ = bucket_count;
+    tip_ = LoadLe64(p + 24);
+    file_.Advise(MADV_RANDOM);
+    return true;
+}
+
+uint64_t TxHashIndex::Bucket(std::string_view hash) const
+{
+    return BucketOf(LoadLe64(hash.data()), bucket_count_);
+}
+
+bool TxHashIndex::Find(std::string_view hash, uint64_t &number, uint32_t &index) const
+{
+    if (CKB_HASH_SIZE != hash.size() || 0 == bucket_count_)
+    {
+        return false;
+    }
+    uint64_t fingerprint = Fingerprint(hash);
+    uint64_t bucket = Bucket(hash);
+    // Slots are never freed, the first free one ends the probe
+    for (uint64_t probed = 0; probed < bucket_count_; ++probed)
+    {
+        const char *p = BucketData(bucket);
+        for (size_t i = 0; i < TX_HASH_BUCKET_SLOTS; ++i, p += TX_HASH_SLOT_SIZE)
+        {
+            uint64_t slot = LoadLe64(p);
+            if (0 == slot)
+            {
+                return false;
+            }
+            if (slot == fingerprint)
+            {
+                uint64_t value = LoadLe64(p + 8);
+                number = value >> TX_HASH_INDEX_BITS;
+                index = value & TX_HASH_MAX_INDEX;
+                return true;
+            }
+        }
+        bucket = bucket + 1 == bucket_count_ ? 0 : bucket + 1;
+    }
+    return false;
+}
+
+void TxHashIndex::Prefetch(std::string_view hash) const
+{
+    if (CKB_HASH_SIZE == hash.size() && bucket_count_ > 0)
+    {
+        __builtin_prefetch(BucketData(Bucket(hash)));
+    }
+}
+
+struct TxHashEntry
+{
+    uint64_t key;
+    uint64_t fingerprint;
+    uint64_t value;
+};
+
+bool BuildTxHashIndex(RocksDBReadOnly &db, const std::string &path, uint32_t threads)
+{
+    std::string tip_hash;
+    uint64_t tip = 0;
+    rocksdb::Status status;
+    if (!ReadTipHeader(db, tip_hash, tip, status))
+    {
+        ERRORLOG("read tip header failed:{}", status.ToString());
+        return false;
+    }
+    std::vector<std::vector<TxHashEntry>> parts(256);
+    bool success = ParallelFor(0, parts.size(), 1, threads, [&](uint64_t part, uint64_t, uint32_t)
+    {
+        std::string begin(1, (char)part);
+        std::string end = part + 1 < parts.size() ? std::string(1, (char)(part + 1)) : "";
+        bool valid = true;
+        rocksdb::Status status;
+        bool scanned = db.ScanRange(COLUMN_TRANSACTION_INFO, begin, end, [&](const rocksdb::Slice &key, const rocksdb::Slice &value)
+        {
+            if (CKB_HASH_SIZE != key.size() || TRANSACTION_INFO_SIZE != value.size())
+            {
+                ERRORLOG("transaction info {} format error", Bytes2Hex(key.ToString()));
+                valid = false;
+                return false;
+            }
+            uint64_t number = LoadLe64(value.data());
+            uint32_t index;
+            memcpy(&index, value.data() + TRANSACTION_INFO_INDEX, sizeof(index));
+            index = be32toh(index);
+            if (number > TX_HASH_MAX_NUMBER || index > TX_HASH_MAX_INDEX)
+            {
+                ERRORLOG("transaction {} position {}:{} out of range", Bytes2Hex(key.ToString()), number, index);
+                valid = false;
+                return false;
+            }
+            std::string_view hash(key.data(), key.size());
+            parts[part].push_back({LoadLe64(hash.data()), Fingerprint(hash), number << TX_HASH_INDEX_BITS | index});
+            return true;
+        }, status);
+        return scanned && valid;
+    });
+    if (!success)
+    {
+        return false;
+    }
+
+    uint64_t count = 0;
+    for (auto &entries : parts)
+    {
+        count += entries.size();
+    }
+    uint64_t bucket_count = std::max<uint64_t>(1, count / (TX_HASH_BUCKET_SLOTS * TX_HASH_LOAD_FACTOR) + 1);
+    std::string content(TX_HASH_HEADER_SIZE + bucket_count * TX_HASH_BUCKET_SIZE, '\0');
+    char *p = &content[0];
+    memcpy(p, TX_HASH_MAGIC, sizeof(TX_HASH_MAGIC));
+    StoreLe64(p + 8, count);
+    StoreLe64(p + 16, bucket_count);
+    StoreLe64(p + 24, tip);
+    memcpy(p + 32, tip_hash.data(), std::min(tip_hash.size(), CKB_HASH_SIZE));
+    char *buckets = p + TX_HASH_HEADER_SIZE;
+    for (auto &entries : parts)
+    {
+        for (auto &entry : entries)
+        {
+            uint64_t bucket = BucketOf(entry.key, bucket_count);
+            char *slot = nullptr;
+            while (nullptr == slot)
+            {
+                char *q = buckets + bucket * TX_HASH_BUCKET_SIZE;
+                for (size_t i = 0; i < TX_HASH_BUCKET_SLOTS && nullptr == slot; ++i, q += TX_HASH_SLOT_SIZE)
+                {
+                    uint64_t fingerprint = LoadLe64(q);
+                    if (fingerprint == entry.fingerprint)
+                    {
+                        ERRORLOG("two transactions share the fingerprint {:x} in bucket {}", fingerprint, bucket);
+                        return false;
+                    }
+                    if (0 == fingerprint)
+                    {
+                        slot = q;
+                    }
+                }
+                bucket = bucket + 1 == bucket_count ? 0 : bucket + 1;
+            }
+            StoreLe64(slot, entry.fingerprint);
+            StoreLe64(slot + 8, entry.value);
+        }
+        std::vector<TxHashEntry>().swap(entries);
+    }
+    return WriteFileAtomic(path, content);
+}
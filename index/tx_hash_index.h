@@ -0,0 +1,48 @@
+#ifndef _INDEX_TX_HASH_INDEX_H_
+#define _INDEX_TX_HASH_INDEX_H_
+
+#include "db/rocksdb_read_only.h"
+#include "utils/mmap_file.h"
+#include <string>
+#include <string_view>
+
+// Immutable open addressing table from tx hash to (block number, index in the block), built from
+// COLUMN_TRANSACTION_INFO and read through mmap. Buckets are one cache line of four slots, the
+// bucket comes from the first 8 hash bytes and the slot is matched by the next 8, so a lookup
+// usually costs a single cache miss. Full buckets spill into the next one.
+//
+// File layout, integers little endian
+//   header   magic "CKBTIDX1", u64 count, u64 bucket_count, u64 tip, hash[32] of the tip block
+//   buckets  bucket_count * 4 slots of (u64 fingerprint, u64 number << 24 | index), 0 marks a free slot
+//
+// Hashes that are not in the table match with a probability of about 2^-64 per probed slot.
+const size_t TX_HASH_HEADER_SIZE = 64;
+const size_t TX_HASH_SLOT_SIZE = 16;
+const size_t TX_HASH_BUCKET_SLOTS = 4;
+const size_t TX_HASH_BUCKET_SIZE = TX_HASH_SLOT_SIZE * TX_HASH_BUCKET_SLOTS;
+
+class TxHashIndex
+{
+public:
+    bool Open(const std::string &path);
+
+    uint64_t Count() const { return count_; }
+    // The index holds the transactions up to this block
+    uint64_t Tip() const { return tip_; }
+    bool Find(std::string_view hash, uint64_t &number, uint32_t &index) const;
+    // Starts loading the bucket of hash, for batches that look up many hashes in a row
+    void Prefetch(std::string_view hash) const;
+
+private:
+    uint64_t Bucket(std::string_view hash) const;
+    const char *BucketData(uint64_t bucket) const { return file_.Data() + TX_HASH_HEADER_SIZE + bucket * TX_HASH_BUCKET_SIZE; }
+
+    MmapFile file_;
+    uint64_t count_ = 0;
+    uint64_t bucket_count_ = 0;
+    uint64_t tip_ = 0;
+};
+
+bool BuildTxHashIndex(RocksDBReadOnly &db, const std::string &path, uint32_t threads);
+
+#endif
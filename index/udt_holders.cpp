@@ -0,0 +1,193 @@
+#include "udt_holders.h"
+#include "db/columns.h"
+#include "log/logging.h"
+#include "molecule/block_molecule.h"
+#include "utils/crypto_utils.h"
+#include "utils/file_utils.h"
+#include "utils/parallel_for.hpp"
+#include <algorithm>
+#include <stdio.h>
+
+static const size_t UDT_AMOUNT_SIZE = 16;
+static const unsigned __int128 UDT_AMOUNT_MAX = ~(unsigned __int128)0;
+
+void AddDefaultUdtScripts(ScriptFilter &udts)
+{
+    // sUDT, RFC 0025
+    udts.Add(SCRIPT_TYPE, Hex2Bytes("5e7a36a77e68eecc013dfa2fe6a23f3b6c344b04005808694ae6dd45eea4cfd5"), 1, "");
+    // xUDT, RFC 0052
+    udts.Add(SCRIPT_TYPE, Hex2Bytes("50bd8d6680b8b9cf98b73f3c08faf8b2a21914311954118ad6609be6e78a1b95"), 2, "");
+}
+
+static bool HoldingKeyLess(const UdtHolding &a, const UdtHolding &b)
+{
+    return a.token != b.token ? a.token < b.token : a.lock < b.lock;
+}
+
+static unsigned __int128 SaturatingAdd(unsigned __int128 a, unsigned __int128 b)
+{
+    return a > UDT_AMOUNT_MAX - b ? UDT_AMOUNT_MAX : a + b;
+}
+
+// Sorts by token and lock and sums the entries of one holder
+static void FoldHoldings(std::vector<UdtHolding> &holdings)
+{
+    std::sort(holdings.begin(), holdings.end(), HoldingKeyLess);
+    size_t kept = 0;
+    for (size_t i = 0; i < holdings.size(); ++i)
+    {
+        if (kept > 0 && holdings[kept - 1].token == holdings[i].token && holdings[kept - 1].lock == holdings[i].lock)
+        {
+            holdings[kept - 1].amount = SaturatingAdd(holdings[kept - 1].amount, holdings[i].amount);
+            holdings[kept - 1].cells += holdings[i].cells;
+        }
+        else
+        {
+            holdings[kept++] = holdings[i];
+        }
+    }
+    holdings.resize(kept);
+}
+
+bool CollectUdtHoldings(RocksDBReadOnly &db, const ScriptFilter &udts, uint32_t threads, std::vector<UdtHolding> &holdings,
+                        uint64_t &invalid)
+{
+    // Tx hashes are uniform, their first byte splits the column family evenly
+    std::vector<std::vector<UdtHolding>> parts(256);
+    std::vector<uint64_t> part_invalid(parts.size(), 0);
+    bool success = ParallelFor(0, parts.size(), 1, threads, [&](uint64_t part, uint64_t, uint32_t)
+    {
+        std::string begin(1, (char)part);
+        std::string end = part + 1 < parts.size() ? std::string(1, (char)(part + 1)) : "";
+        CellEntryFields entry;
+        CellOutputFields output;
+        std::string value;
+        bool valid = true;
+        rocksdb::Status status;
+        bool scanned = db.ScanRange(COLUMN_CELL, begin, end, [&](const rocksdb::Slice &key, const rocksdb::Slice &cell)
+        {
+            if (!DecodeCellEntry(std::string_view(cell.data(), cell.size()), entry) || !DecodeCellOutput(entry.output, output))
+            {
+                ERRORLOG("cell {} format error", Bytes2Hex(key.ToString()));
+                valid = false;
+                return false;
+            }
+            if (!output.has_type || !udts.Match(SCRIPT_TYPE, output.type))
+            {
+                return true;
+            }
+            std::string_view data, data_hash;
+            rocksdb::Status data_status;
+            if (!db.ReadData(COLUMN_CELL_DATA, key.ToString(), value, data_status))
+            {
+                if (!data_status.IsNotFound())
+                {
+                    ERRORLOG("read cell data {} failed:{}", Bytes2Hex(key.ToString()), data_status.ToString());
+                    valid = false;
+                    return false;
+                }
+                value.clear();
+            }
+            if (value.empty())
+            {
+                data = std::string_view();
+            }
+            else if (!SplitCellDataEntry(value, data, data_hash))
+            {
+                valid = false;
+                return false;
+            }
+            if (data.size() < UDT_AMOUNT_SIZE)
+            {
+                ++part_invalid[part];
+                return true;
+            }
+            parts[part].emplace_back();
+            UdtHolding &holding = parts[part].back();
+            Blake2b256(output.type_script.data(), output.type_script.size(), (uint8_t *)holding.token.data());
+            Blake2b256(output.lock_script.data(), output.lock_script.size(), (uint8_t *)holding.lock.data());
+            // u128 little endian
+            uint64_t low = 0, high = 0;
+            memcpy(&low, data.data(), sizeof(low));
+            memcpy(&high, data.data() + sizeof(low), sizeof(high));
+            holding.amount = (unsigned __int128)le64toh(high) << 64 | le64toh(low);
+            holding.cells = 1;
+            return true;
+        }, status);
+        FoldHoldings(parts[part]);
+        return scanned && valid;
+    });
+    if (!success)
+    {
+        return false;
+    }
+    holdings.clear();
+    invalid = 0;
+    for (size_t i = 0; i < parts.size(); ++i)
+    {
+        holdings.insert(holdings.end(), parts[i].begin(), parts[i].end());
+        std::vector<UdtHolding>().swap(parts[i]);
+        invalid += part_invalid[i];
+    }
+    FoldHoldings(holdings);
+    std::sort(holdings.begin(), holdings.end(), [](const UdtHolding &a, const UdtHolding &b)
+    {
+        if (a.token != b.token)
+        {
+            return a.token < b.token;
+        }
+        return a.amount != b.amount ? a.amount > b.amount : a.lock < b.lock;
+    });
+    return true;
+}
+
+void SumUdtSupply(const std::vector<UdtHolding> &holdings, std::vector<UdtSupply> &supply)
+{
+    supply.clear();
+    for (auto &holding : holdings)
+    {
+        if (supply.empty() || supply.back().token != holding.token)
+        {
+            supply.emplace_back();
+            supply.back().token = holding.token;
+        }
+        UdtSupply &total = supply.back();
+        ++total.holders;
+        total.cells += holding.cells;
+        total.amount = SaturatingAdd(total.amount, holding.amount);
+    }
+}
+
+std::string U128ToString(unsigned __int128 value)
+{
+    std::string digits;
+    do
+    {
+        digits.push_back('0' + (char)(value % 10));
+        value /= 10;
+    } while (value > 0);
+    return std::string(digits.rbegin(), digits.rend());
+}
+
+bool WriteUdtReports(const std::string &dir, const std::vector<UdtHolding> &holdings, const std::vector<UdtSupply> &supply)
+{
+    char cells[32];
+    std::string content = "type_hash,lock_hash,amount,cells\n";
+    for (auto &holding : holdings)
+    {
+        snprintf(cells, sizeof(cells), ",%lu\n", holding.cells);
+        content += Bytes2Hex(std::string(holding.token.data(), holding.token.size())) + "," +
+                   Bytes2Hex(std::string(holding.lock.data(), holding.lock.size())) + "," + U128ToString(holding.amount) + cells;
+    }
+    if (!WriteFileAtomic(dir + "/udt_holders.csv", content))
+    {
+        return false;
+    }
+    content = "type_hash,holders,cells,supply\n";
+    for (auto &total : supply)
+    {
+        snprintf(cells, sizeof(cells), ",%lu,%lu,", total.holders, total.cells);
+        content += Bytes2Hex(std::string(total.token.data(), total.token.size())) + cells + U128ToString(total.amount) + "\n";
+    }
+    return WriteFileAtomic(dir + "/udt_supply.csv", content);
+}
@@ -0,0 +1,42 @@
+#ifndef _INDEX_UDT_HOLDERS_H_
+#define _INDEX_UDT_HOLDERS_H_
+
+#include "db/rocksdb_read_only.h"
+#include "export/script_filter.h"
+#include <array>
+#include <string>
+#include <vector>
+
+// sUDT and xUDT balances of the live cells. A cell is a UDT cell when its type script matches a
+// type rule of the table, its amount is the u128 in the first 16 bytes of its data. The token is
+// the type script hash, so every issuance of a UDT script is a token of its own.
+struct UdtHolding
+{
+    std::array<char, 32> token; // type script hash
+    std::array<char, 32> lock;  // lock script hash
+    unsigned __int128 amount = 0;
+    uint64_t cells = 0;
+};
+
+struct UdtSupply
+{
+    std::array<char, 32> token;
+    uint64_t holders = 0;
+    uint64_t cells = 0;
+    unsigned __int128 amount = 0; // saturates instead of wrapping
+};
+
+// The sUDT and xUDT type scripts deployed on mainnet
+void AddDefaultUdtScripts(ScriptFilter &udts);
+// Scans COLUMN_CELL split by the first tx hash byte over threads, reading COLUMN_CELL_DATA only for
+// the UDT cells. Holdings come out per (token, lock), sorted by token then amount descending.
+// Cells whose data is shorter than 16 bytes are counted in invalid.
+bool CollectUdtHoldings(RocksDBReadOnly &db, const ScriptFilter &udts, uint32_t threads, std::vector<UdtHolding> &holdings,
+                        uint64_t &invalid);
+// One entry per token of the sorted holdings
+void SumUdtSupply(const std::vector<UdtHolding> &holdings, std::vector<UdtSupply> &supply);
+std::string U128ToString(unsigned __int128 value);
+// Writes udt_holders.csv and udt_supply.csv into dir
+bool WriteUdtReports(const std::string &dir, const std::vector<UdtHolding> &holdings, const std::vector<UdtSupply> &supply);
+
+#endif
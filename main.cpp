@@ -1,27 +1,30 @@
+#include "archive/archive_reader.h"
+#include "audit/hash_audit.h"
+#include "audit/root_audit.h"
+#include "columnar/columnar_reader.h"
+#include "db/columns.h"
+#include "db/raw_block.h"
 #include "db/rocksdb_read_only.h"
+#include "export/export_command.h"
+#include "index/balance_history.h"
+#include "index/balance_index.h"
+#include "index/cell_snapshot.h"
+#include "index/dao_stats.h"
+#include "index/header_index.h"
+#include "index/live_cell_index.h"
+#include "index/spent_index.h"
+#include "index/tx_hash_index.h"
+#include "index/udt_holders.h"
+#include "utils/arg_utils.h"
 #include "utils/crypto_utils.h"
+#include "utils/file_utils.h"
+#include "utils/parallel_for.hpp"
 #include <endian.h>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include "molecule/blockchain.h"
 
-std::string COLUMN_INDEX = "0";              // 链索引
-std::string COLUMN_BLOCK_HEADER = "1";       // 块头
-std::string COLUMN_BLOCK_BODY = "2";         // 交易体
-std::string COLUMN_BLOCK_UNCLE = "3";        // store block's uncle and uncles’ proposal zones
-std::string COLUMN_META = "4";               // store meta data
-std::string COLUMN_TRANSACTION_INFO = "5"; // 交易扩展信息
-std::string COLUMN_BLOCK_EXT = "6";        // 区块扩展信息
-std::string COLUMN_BLOCK_PROPOSAL_IDS = "7"; // store block's proposal ids
-std::string COLUMN_BLOCK_EPOCH = "8"; // store indicates track block epoch
-std::string COLUMN_EPOCH = "9";       // store indicates track block epoch
-std::string COLUMN_CELL = "10";       // store cell
-std::string COLUMN_UNCLES = "11";     // store main chain consensus include uncles
-std::string COLUMN_CELL_DATA = "12";  // store cell data
-std::string COLUMN_NUMBER_HASH = "13";       // store block number-hash pair
-std::string COLUMN_CELL_DATA_HASH = "14"; // store cell data hash
-std::string COLUMN_BLOCK_EXTENSION = "15";   // 区块扩展数据
-
 std::string db_path("/home/shaorongqiang/blockchain/ckb/target/debug/node/data/db");
 
 int main_uncles(int argc, char **argv)
@@ -137,136 +140,575 @@ int main_epoch_ext(int argc, char **argv)
 }
 
 
-int main(int argc, char **argv)
+// Verifies an archive and prints a summary of the blocks in [start, end)
+int main_archive(const std::string &path, uint64_t start, uint64_t end, uint32_t threads)
 {
-    rocksdb::Status status;
-    RocksDBReadOnly db(db_path, status);
-    if (!status.ok())
+    ArchiveReader reader;
+    if (!reader.Open(path))
     {
         return -1;
     }
-    if (argc < 3)
+    uint64_t bad_chunk = 0;
+    if (!reader.VerifyChunks(threads, bad_chunk))
     {
-        printf("usage: %s start end", argv[0]);
-        return 0;
+        printf("chunk %lu of %s is corrupted\n", bad_chunk, path.c_str());
+        return -5;
     }
-
-    nlohmann::json json;
-    nlohmann::json block;
-    std::string hash_bytes;
-    std::string value;
-    Header header;
-    UncleBlockVec uncles;
-    uint32_t txs_len = 0;
-    Transaction transaction;
-    ProposalShortIdVec proposals;
-    std::ofstream fconf;
-    for (uint64_t height = std::stoul(std::string(argv[1])); height < std::stoul(std::string(argv[2])); ++height)
-    {
-        json.clear();
-        std::vector<std::string> tx_infos;
-        if (!db.ReadData("0", std::string((char *)&height, sizeof(height)), hash_bytes, status))
+    printf("%s: blocks [%lu, %lu), %u chunks\n", path.c_str(), reader.StartHeight(), reader.EndHeight(), reader.ChunkCount());
+    reader.AdviseSequential();
+    ArchiveBlockView view;
+    for (uint64_t height = std::max(start, reader.StartHeight()); height < std::min(end, reader.EndHeight()); ++height)
+    {
+        if (!reader.Get(height, view))
         {
-            return -2;
+            printf("block %lu is corrupted\n", height);
+            return -3;
         }
+        printf("%lu %s timestamp:%lu txs:%u uncles:%u proposals:%u\n", view.Number(), Bytes2Hex(std::string(view.Hash())).c_str(),
+               view.Timestamp(), view.TransactionCount(), view.UncleCount(), view.ProposalCount());
+    }
+    return 0;
+}
 
-        if (!db.ReadData("1", hash_bytes, value, status))
+static std::vector<std::string> SplitList(const std::string &list, char separator)
+{
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    for (std::string item; std::getline(stream, item, separator);)
+    {
+        items.push_back(item);
+    }
+    return items;
+}
+
+// Prints the matching rows of a columnar dataset as csv, heights limited to [start, end)
+int main_scan(uint64_t start, uint64_t end, const std::map<std::string, std::string> &options)
+{
+    // end - 1 below would wrap an empty range into every height
+    if (start >= end)
+    {
+        return 0;
+    }
+    std::string dir = GetOption(options, "dataset", ".");
+    std::string table = GetOption(options, "table", "outputs");
+    std::vector<std::string> columns = SplitList(GetOption(options, "columns", "height"), ',');
+    std::vector<ColumnPredicate> predicates;
+    ColumnPredicate height;
+    height.column = "height";
+    height.min = start;
+    height.max = end - 1;
+    predicates.push_back(height);
+    for (auto &item : SplitList(GetOption(options, "where", ""), ','))
+    {
+        std::vector<std::string> parts = SplitList(item, ':');
+        ColumnPredicate predicate;
+        if (3 != parts.size() || !ParseDecimal(parts[1], predicate.min) || !ParseDecimal(parts[2], predicate.max))
         {
-            return -3;
+            printf("--where expects column:min:max\n");
+            return 0;
+        }
+        predicate.column = parts[0];
+        predicates.push_back(predicate);
+    }
+    for (auto &item : SplitList(GetOption(options, "match", ""), ','))
+    {
+        std::vector<std::string> parts = SplitList(item, ':');
+        if (2 != parts.size())
+        {
+            printf("--match expects column:hex\n");
+            return 0;
         }
-        header.Clear();
-        if (!header.ParseFromByteWithHash(value.data(), value.size()))
+        ColumnPredicate predicate;
+        predicate.column = parts[0];
+        predicate.has_value = true;
+        predicate.value = Hex2Bytes(parts[1]);
+        predicates.push_back(predicate);
+    }
+    std::vector<std::string> epochs = SplitList(GetOption(options, "epochs", "0:" + std::to_string(UINT64_MAX)), ':');
+    uint64_t first_epoch = 0, last_epoch = 0;
+    if (2 != epochs.size() || !ParseDecimal(epochs[0], first_epoch) || !ParseDecimal(epochs[1], last_epoch))
+    {
+        printf("--epochs expects first:last\n");
+        return 0;
+    }
+    uint64_t limit = GetOptionNumber(options, "limit", UINT64_MAX);
+    uint64_t printed = 0;
+
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+        printf("%s%s", i > 0 ? "," : "", columns[i].c_str());
+    }
+    printf("\n");
+    ColumnarScanStats stats;
+    bool success = ScanColumnarDataset(dir, table, first_epoch, last_epoch, columns, predicates,
+                                       [&](const std::vector<const ColumnData *> &data, const std::vector<uint32_t> &rows)
+                                       {
+                                           for (uint32_t row : rows)
+                                           {
+                                               if (printed++ >= limit)
+                                               {
+                                                   return false;
+                                               }
+                                               for (size_t i = 0; i < data.size(); ++i)
+                                               {
+                                                   if (COLUMNAR_UINT64 == data[i]->type)
+                                                   {
+                                                       printf("%s%lu", i > 0 ? "," : "", data[i]->uints[row]);
+                                                   }
+                                                   else
+                                                   {
+                                                       printf("%s%s", i > 0 ? "," : "", Bytes2Hex(std::string(data[i]->bytes[row])).c_str());
+                                                   }
+                                               }
+                                               printf("\n");
+                                           }
+                                           return true;
+                                       },
+                                       stats);
+    fprintf(stderr, "row groups %lu, skipped %lu, rows %lu, decoded %lu bytes\n", stats.row_groups, stats.row_groups_skipped,
+            stats.rows_matched, stats.bytes_decoded);
+    return success ? 0 : -3;
+}
+
+// Brings the live cell index up to the tip and prints the live cells of every --lock-hash,
+// --no-update reads the file as it is, a snapshot for one
+int main_cells(RocksDBReadOnly &db, uint32_t threads, const std::map<std::string, std::string> &options)
+{
+    std::string path = GetOption(options, "cell-index", "live_cells.idx");
+    LiveCellIndex index;
+    if ((!HasOption(options, "no-update") && !UpdateLiveCellIndex(db, path, threads)) || !index.Open(path))
+    {
+        return -2;
+    }
+    printf("lock_hash,tx_hash,index,capacity\n");
+    for (auto &item : SplitList(GetOption(options, "lock-hash", ""), ','))
+    {
+        std::string lock_hash = Hex2Bytes(0 == item.compare(0, 2, "0x") ? item.substr(2) : item);
+        uint64_t first = 0, last = 0, capacity = 0;
+        index.Find(lock_hash, first, last);
+        for (uint64_t i = first; i < last; ++i)
         {
-            return -4;
+            LiveCell cell = index.At(i);
+            capacity += cell.capacity;
+            printf("%s,%s,%u,%lu\n", Bytes2Hex(lock_hash).c_str(), Bytes2Hex(std::string(cell.tx_hash)).c_str(), cell.index,
+                   cell.capacity);
         }
-        block["header"] = header.json;
+        fprintf(stderr, "%s: %lu cells, %lu shannons\n", item.c_str(), last - first, capacity);
+    }
+    fprintf(stderr, "%lu live cells below block %lu\n", index.Count(), index.NextHeight());
+    return 0;
+}
 
-        if (!db.ReadData("3", hash_bytes, value, status))
+// Brings the balance index up to the tip, prints the --top richest locks and the balance of
+// every --lock-hash
+int main_balances(RocksDBReadOnly &db, uint32_t threads, const std::map<std::string, std::string> &options)
+{
+    std::string path = GetOption(options, "balance-index", "balances.idx");
+    BalanceIndex index;
+    if ((!HasOption(options, "no-update") && !UpdateBalanceIndex(db, path, threads)) || !index.Open(path))
+    {
+        return -2;
+    }
+    uint64_t top = std::min<uint64_t>(GetOptionNumber(options, "top", 100), index.Count());
+    printf("rank,lock_hash,capacity,cells\n");
+    for (uint64_t i = 0; i < top; ++i)
+    {
+        Balance balance = index.At(i);
+        printf("%lu,%s,%lu,%lu\n", i + 1, Bytes2Hex(std::string(balance.lock_hash)).c_str(), balance.capacity, balance.cells);
+    }
+    for (auto &item : SplitList(GetOption(options, "lock-hash", ""), ','))
+    {
+        Balance balance;
+        if (index.Find(Hex2Bytes(0 == item.compare(0, 2, "0x") ? item.substr(2) : item), balance))
         {
-            return -5;
+            fprintf(stderr, "%s: %lu cells, %lu shannons\n", item.c_str(), balance.cells, balance.capacity);
         }
-        uncles.Clear();
-        if (!uncles.ParseFromByte(value.data(), value.size()))
+        else
         {
-            return -6;
+            fprintf(stderr, "%s: no cells\n", item.c_str());
         }
-        block["uncles"] = uncles.json;
+    }
+    fprintf(stderr, "%lu locks hold cells below block %lu\n", index.Count(), index.NextHeight());
+    return 0;
+}
 
-        if (!db.ReadData("13", std::string((char *)&height, sizeof(height)) + hash_bytes, value, status))
+// Prints the balance of every --lock-hash after block --height, or all its change points with
+// --changes, building the balance history up to the tip when it is missing or --rebuild is given
+int main_history(RocksDBReadOnly &db, uint32_t threads, const std::map<std::string, std::string> &options)
+{
+    std::string path = GetOption(options, "history-index", "balance_history.idx");
+    if (HasOption(options, "rebuild") || !FileExists(path))
+    {
+        std::string hash;
+        uint64_t tip = 0;
+        rocksdb::Status status;
+        if (!ReadTipHeader(db, hash, tip, status))
         {
-            return -7;
+            fprintf(stderr, "read tip header failed:%s\n", status.ToString().c_str());
+            return -2;
         }
-        txs_len = 0;
-        memcpy(&txs_len, value.data(), value.size());
-        for (uint32_t i = 0; i < txs_len; ++i)
+        if (!BuildBalanceHistory(db, tip, path, threads))
         {
-            int index = htobe32(i);
-            if (!db.ReadData("2", hash_bytes + std::string((char *)&index, sizeof(index)), value, status))
+            return -2;
+        }
+    }
+    BalanceHistory history;
+    if (!history.Open(path) || 0 == history.NextHeight())
+    {
+        return -2;
+    }
+    uint64_t height = GetOptionNumber(options, "height", history.NextHeight() - 1);
+    bool changes = HasOption(options, "changes");
+    printf("lock_hash,height,balance\n");
+    for (auto &item : SplitList(GetOption(options, "lock-hash", ""), ','))
+    {
+        std::string lock_hash = Hex2Bytes(0 == item.compare(0, 2, "0x") ? item.substr(2) : item);
+        std::vector<BalancePoint> points;
+        uint64_t balance = 0;
+        if (changes && history.Changes(lock_hash, points))
+        {
+            for (auto &point : points)
             {
-                return -8;
+                printf("%s,%lu,%lu\n", Bytes2Hex(lock_hash).c_str(), point.first, point.second);
             }
-            transaction.Clear();
-            if (!transaction.ParseFromByte(value.data(), value.size()))
+        }
+        else if (!changes && history.BalanceAt(lock_hash, height, balance))
+        {
+            printf("%s,%lu,%lu\n", Bytes2Hex(lock_hash).c_str(), height, balance);
+        }
+        else
+        {
+            fprintf(stderr, "%s: no balance at block %lu\n", item.c_str(), height);
+        }
+    }
+    fprintf(stderr, "%lu locks, history below block %lu\n", history.LockCount(), history.NextHeight());
+    return 0;
+}
+
+// Prints which transaction spent every out point of --out-points, given as tx_hash:index
+int main_spent(RocksDBReadOnly &db, uint32_t threads, const std::map<std::string, std::string> &options)
+{
+    std::string path = GetOption(options, "spent-index", "spent.idx");
+    SpentIndex index;
+    if ((!HasOption(options, "no-update") && !UpdateSpentIndex(db, path, threads)) || !index.Open(path))
+    {
+        return -2;
+    }
+    std::string list = GetOption(options, "out-points", "");
+    std::vector<std::string> items;
+    std::string content;
+    if (FileExists(list) && ReadFile(list, content))
+    {
+        std::stringstream lines(content);
+        for (std::string line; std::getline(lines, line);)
+        {
+            if (!line.empty())
             {
-                return -9;
+                items.push_back(line);
             }
-            tx_infos.push_back(transaction.json.at("hash"));
-            block["transactions"].push_back(transaction.json);
         }
+    }
+    else
+    {
+        items = SplitList(list, ',');
+    }
+    std::vector<std::string> out_points;
+    for (auto &item : items)
+    {
+        size_t colon = item.find(':');
+        std::string hash = item.substr(0, colon);
+        uint64_t index_value = 0;
+        if (std::string::npos != colon && (!ParseDecimal(item.substr(colon + 1), index_value) || index_value > UINT32_MAX))
+        {
+            printf("--out-points expects tx_hash:index with a u32 index: %s\n", item.c_str());
+            return -1;
+        }
+        uint32_t output_index = htole32(index_value);
+        out_points.push_back(Hex2Bytes(0 == hash.compare(0, 2, "0x") ? hash.substr(2) : hash));
+        out_points.back().append((char *)&output_index, sizeof(output_index));
+    }
 
-        if (!db.ReadData("7", hash_bytes, value, status))
+    std::vector<SpentBy> spent;
+    std::vector<bool> found;
+    index.FindMany(out_points, spent, found);
+    printf("tx_hash,index,spent_by,height,input_index\n");
+    for (size_t i = 0; i < out_points.size(); ++i)
+    {
+        std::string hash = Bytes2Hex(out_points[i].substr(0, 32));
+        uint32_t output_index = 0;
+        memcpy(&output_index, out_points[i].data() + out_points[i].size() - sizeof(output_index), sizeof(output_index));
+        if (found[i])
         {
-            return -9;
+            printf("%s,%u,%s,%lu,%u\n", hash.c_str(), le32toh(output_index), Bytes2Hex(std::string(spent[i].tx_hash)).c_str(),
+                   spent[i].height, spent[i].input_index);
         }
-        proposals.Clear();
-        if (!proposals.ParseFromByte(value.data(), value.size()))
+        else
         {
-            return -10;
+            printf("%s,%u,,,\n", hash.c_str(), le32toh(output_index));
         }
-        block["proposals"] = proposals.json;
+    }
+    fprintf(stderr, "%lu spent out points below block %lu in %zu runs\n", index.Count(), index.NextHeight(), index.Runs().size());
+    return 0;
+}
 
-        db.ReadData("15", hash_bytes, value, status);
-        if (status.ok())
+// Writes the holders and supply of every UDT token among the live cells into --output
+int main_udt(RocksDBReadOnly &db, uint32_t threads, const std::map<std::string, std::string> &options)
+{
+    ScriptFilter udts;
+    if (HasOption(options, "udt-rules"))
+    {
+        if (!udts.Load(GetOption(options, "udt-rules", "")))
         {
-            block["extension"] = Bytes2Hex(value);
+            return -2;
         }
-        json["block"] = block;
+    }
+    else
+    {
+        AddDefaultUdtScripts(udts);
+    }
+    std::vector<UdtHolding> holdings;
+    std::vector<UdtSupply> supply;
+    uint64_t invalid = 0;
+    if (!CollectUdtHoldings(db, udts, threads, holdings, invalid))
+    {
+        return -2;
+    }
+    SumUdtSupply(holdings, supply);
+    std::string dir = GetOption(options, "output", ".");
+    if (!WriteUdtReports(dir, holdings, supply))
+    {
+        return -2;
+    }
+    fprintf(stderr, "%zu tokens, %zu holdings, %lu cells with short data, written to %s\n", supply.size(), holdings.size(), invalid,
+            dir.c_str());
+    return 0;
+}
 
-        int tx_index = 0;
-        for(auto &item : tx_infos)
+// NervosDAO deposits, withdraw requests and withdrawals per epoch of [start, end), clamped to the tip
+int main_dao(RocksDBReadOnly &db, uint64_t start, uint64_t end, uint32_t threads, const std::map<std::string, std::string> &options)
+{
+    std::string hash;
+    uint64_t tip = 0;
+    rocksdb::Status status;
+    if (!ReadTipHeader(db, hash, tip, status))
+    {
+        fprintf(stderr, "read tip header failed:%s\n", status.ToString().c_str());
+        return -2;
+    }
+    end = std::min(end, tip + 1);
+    std::vector<DaoEpochStats> epochs;
+    std::vector<DaoWithdrawal> withdrawals;
+    if (!CollectDaoStats(db, start, end, threads, epochs, withdrawals))
+    {
+        return -2;
+    }
+    std::string dir = GetOption(options, "output", ".");
+    if (!WriteDaoReports(dir, epochs, withdrawals))
+    {
+        return -2;
+    }
+    fprintf(stderr, "%zu epochs, %zu withdraw requests of blocks [%lu, %lu), written to %s\n", epochs.size(), withdrawals.size(), start,
+            end, dir.c_str());
+    return 0;
+}
+
+// Writes the live cell set as of --height, the tip by default
+int main_snapshot(RocksDBReadOnly &db, uint32_t threads, const std::map<std::string, std::string> &options)
+{
+    uint64_t height = 0;
+    if (HasOption(options, "height"))
+    {
+        if (!ParseDecimal(GetOption(options, "height", ""), height))
         {
-            TransactionInfo info;
-            db.ReadData("5", Hex2Bytes(item), value, status);
-            if (status.ok() && info.ParseFromByte(value.data(), value.size()))
-            {
-                json["info"].push_back(info.json);
-            }
+            printf("--height expects a block number\n");
+            return -1;
+        }
+    }
+    else
+    {
+        std::string hash;
+        rocksdb::Status status;
+        if (!ReadTipHeader(db, hash, height, status))
+        {
+            fprintf(stderr, "read tip header failed:%s\n", status.ToString().c_str());
+            return -2;
+        }
+    }
+    std::string path = GetOption(options, "snapshot", "cells_" + std::to_string(height) + ".idx");
+    if (!BuildCellSnapshot(db, height, GetOption(options, "base", ""), path, threads))
+    {
+        return -2;
+    }
+    fprintf(stderr, "wrote the live cells of block %lu to %s and %s.locks.csv\n", height, path.c_str(), path.c_str());
+    return 0;
+}
 
-            CellEntry entry;
-            db.ReadData("10", Hex2Bytes(item) + std::string((char *)&tx_index, sizeof(tx_index)), value, status);
-            if (status.ok() && entry.ParseFromByte(value.data(), value.size()))
-            {
-                json["entry"].push_back(entry.json);
-            }
-            CellDataEntry data_entry;
-            db.ReadData("12", Hex2Bytes(item) + std::string((char *)&tx_index, sizeof(tx_index)), value, status);
-            if (status.ok() && data_entry.ParseFromByte(value.data(), value.size()))
+// Resolves every hash of --tx-hashes to its block number and index through the tx hash index
+int main_tx(RocksDBReadOnly &db, uint32_t threads, const std::map<std::string, std::string> &options)
+{
+    std::string path = GetOption(options, "tx-index", "tx_hashes.idx");
+    if ((HasOption(options, "rebuild") || !FileExists(path)) && !BuildTxHashIndex(db, path, threads))
+    {
+        return -2;
+    }
+    TxHashIndex index;
+    if (!index.Open(path))
+    {
+        return -2;
+    }
+    std::string list = GetOption(options, "tx-hashes", "");
+    std::vector<std::string> hashes;
+    std::string content;
+    if (FileExists(list) && ReadFile(list, content))
+    {
+        std::stringstream lines(content);
+        for (std::string line; std::getline(lines, line);)
+        {
+            if (!line.empty())
             {
-                json["data_entry"].push_back(data_entry.json);
+                hashes.push_back(line);
             }
+        }
+    }
+    else
+    {
+        hashes = SplitList(list, ',');
+    }
+    for (auto &hash : hashes)
+    {
+        hash = Hex2Bytes(0 == hash.compare(0, 2, "0x") ? hash.substr(2) : hash);
+    }
 
-            ++tx_index;
+    // Keeps a few buckets in flight, the lookups then overlap their cache misses
+    const size_t prefetch_distance = 8;
+    uint64_t found = 0;
+    printf("hash,block_number,index\n");
+    for (size_t i = 0; i < hashes.size(); ++i)
+    {
+        if (i + prefetch_distance < hashes.size())
+        {
+            index.Prefetch(hashes[i + prefetch_distance]);
         }
-        db.ReadData("6", hash_bytes, value, status);
-        BlockExt block_ext;
-        if (status.ok() && block_ext.ParseFromByte(value.data(), value.size()))
+        uint64_t number = 0;
+        uint32_t tx_index = 0;
+        if (index.Find(hashes[i], number, tx_index))
         {
-            json["block_ext"] = block_ext.json;
+            ++found;
+            printf("%s,%lu,%u\n", Bytes2Hex(hashes[i]).c_str(), number, tx_index);
+        }
+        else
+        {
+            printf("%s,,\n", Bytes2Hex(hashes[i]).c_str());
         }
-
-        fconf.open(std::to_string(height) + ".txt");
-        fconf << json.dump(4);
-        fconf.close();
     }
+    fprintf(stderr, "%lu of %zu found, the index holds %lu transactions up to block %lu\n", found, hashes.size(), index.Count(),
+            index.Tip());
     return 0;
 }
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> args;
+    std::map<std::string, std::string> options;
+    ParseArgs(argc, argv, args, options);
+    std::string mode = GetOption(options, "mode", "export");
+    // Index modes work on the whole chain
+    bool whole_chain = "cells" == mode || "tx" == mode || "snapshot" == mode || "balances" == mode || "history" == mode || "spent" == mode || "udt" == mode || "dao" == mode;
+    if (args.size() < 2 && !whole_chain && !HasHeightSelection(options))
+    {
+        printf("usage: %s start end [--db=path] [--mode=export|audit|root|archive|scan|cells|tx|snapshot|balances|history|spent|udt|dao] [--threads=n] [--archive=path]\n", argv[0]);
+        printf("height selection, start and end may be left out:\n"
+               "    [--from-time=t] [--to-time=t] [--epochs=first:last] [--header-index=path]\n"
+               "    t is unix seconds or a UTC YYYY-MM-DD[THH:MM:SS], the range ends before to-time and after epoch last\n");
+        printf("scan options:\n"
+               "    --dataset=dir --table=headers|transactions|outputs --columns=a,b [--where=column:min:max,...]\n"
+               "    [--match=column:hex,...] [--epochs=first:last] [--limit=n]\n");
+        printf("cells options, start and end are left out:\n"
+               "    [--cell-index=path] [--no-update] [--lock-hash=hex,...]\n");
+        printf("snapshot options, start and end are left out:\n"
+               "    [--height=n] [--snapshot=path] [--base=snapshot]   replays from base, or genesis, up to height\n");
+        printf("balances options, start and end are left out:\n"
+               "    [--balance-index=path] [--no-update] [--top=n] [--lock-hash=hex,...]\n");
+        printf("history options, start and end are left out:\n"
+               "    [--history-index=path] [--rebuild] [--height=n | --changes] --lock-hash=hex,...\n");
+        printf("spent options, start and end are left out:\n"
+               "    [--spent-index=path] [--no-update] --out-points=file|tx_hash:index,...   a file holds one per line\n");
+        printf("udt options, start and end are left out:\n"
+               "    [--udt-rules=file] [--output=dir]   rules are \"type <code_hash> <hash_type>\" lines, mainnet sUDT and xUDT by default\n");
+        printf("dao options, start and end default to the whole chain:\n"
+               "    [--output=dir]   writes dao_epochs.csv and dao_withdrawals.csv\n");
+        printf("tx options, start and end are left out:\n"
+               "    [--tx-index=path] [--rebuild] --tx-hashes=file|hex,...   a file holds one hash per line\n");
+        PrintExportUsage();
+        return 0;
+    }
+    uint64_t start = args.size() < 2 ? 0 : std::stoul(args.at(0));
+    uint64_t end = args.size() < 2 ? UINT64_MAX : std::stoul(args.at(1));
+    uint32_t threads = GetOptionNumber(options, "threads", DefaultThreadCount());
+    if ("archive" == mode)
+    {
+        return main_archive(GetOption(options, "archive", ""), start, end, threads);
+    }
+    if ("scan" == mode)
+    {
+        return main_scan(start, end, options);
+    }
+    rocksdb::Status status;
+    RocksDBReadOnly db(GetOption(options, "db", db_path), status);
+    if (!status.ok())
+    {
+        return -1;
+    }
+    if ("cells" == mode)
+    {
+        return main_cells(db, threads, options);
+    }
+    if ("tx" == mode)
+    {
+        return main_tx(db, threads, options);
+    }
+    if ("snapshot" == mode)
+    {
+        return main_snapshot(db, threads, options);
+    }
+    if ("balances" == mode)
+    {
+        return main_balances(db, threads, options);
+    }
+    if ("history" == mode)
+    {
+        return main_history(db, threads, options);
+    }
+    if ("spent" == mode)
+    {
+        return main_spent(db, threads, options);
+    }
+    if ("udt" == mode)
+    {
+        return main_udt(db, threads, options);
+    }
+    if (HasHeightSelection(options) && !SelectHeights(db, options, threads, start, end))
+    {
+        return -1;
+    }
+    if ("audit" == mode)
+    {
+        HashAuditStats stats;
+        return AuditHashes(db, start, end, threads, stats);
+    }
+    if ("root" == mode)
+    {
+        RootAuditStats stats;
+        return AuditTransactionsRoot(db, start, end, threads, stats);
+    }
+    if ("dao" == mode)
+    {
+        return main_dao(db, start, end, threads, options);
+    }
+    if ("export" != mode)
+    {
+        printf("unknown mode %s\n", mode.c_str());
+        return 0;
+    }
+    return RunExport(db, start, end, options);
+}
@@ -0,0 +1,480 @@
+#include "block_molecule.h"
+#include "log/logging.h"
+#include "utils/crypto_utils.h"
+#include <endian.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MOLECULE_API_DECORATOR static inline
+#include "generated/extensions.h"
+
+static const size_t HASH_SIZE = 32;
+static const size_t HEADER_SIZE = 208;
+
+static bool SliceTableField(std::string_view table, uint32_t field_count, uint32_t index, std::string_view &field)
+{
+    if (table.size() < MOL_NUM_T_SIZE * (field_count + 1))
+    {
+        return false;
+    }
+    const uint8_t *ptr = (const uint8_t *)table.data();
+    mol_num_t total_size = mol_unpack_number(ptr);
+    mol_num_t header_size = mol_unpack_number(ptr + MOL_NUM_T_SIZE);
+    if (total_size != table.size() || header_size < MOL_NUM_T_SIZE * (field_count + 1) || header_size > total_size)
+    {
+        return false;
+    }
+    mol_num_t start = mol_unpack_number(ptr + MOL_NUM_T_SIZE * (index + 1));
+    mol_num_t end = total_size;
+    if (index + 1 < header_size / MOL_NUM_T_SIZE - 1)
+    {
+        end = mol_unpack_number(ptr + MOL_NUM_T_SIZE * (index + 2));
+    }
+    if (start < header_size || start > end || end > total_size)
+    {
+        return false;
+    }
+    field = table.substr(start, end - start);
+    return true;
+}
+
+bool SplitHeaderView(std::string_view view, std::string_view &hash, std::string_view &header)
+{
+    if (view.size() != HASH_SIZE + HEADER_SIZE)
+    {
+        ERRORLOG("header view size error:{}", view.size());
+        return false;
+    }
+    hash = view.substr(0, HASH_SIZE);
+    header = view.substr(HASH_SIZE);
+    return true;
+}
+
+bool SplitUncleBlockVecView(std::string_view view, std::string_view &hashes, std::string_view &uncles)
+{
+    if (!SliceTableField(view, 2, 0, hashes) || !SliceTableField(view, 2, 1, uncles))
+    {
+        ERRORLOG("uncle block vec view format error");
+        return false;
+    }
+    return true;
+}
+
+bool SplitTransactionView(std::string_view view, std::string_view &hash, std::string_view &witness_hash, std::string_view &transaction)
+{
+    if (!SliceTableField(view, 3, 0, hash) || !SliceTableField(view, 3, 1, witness_hash) || !SliceTableField(view, 3, 2, transaction))
+    {
+        ERRORLOG("transaction view format error");
+        return false;
+    }
+    if (hash.size() != HASH_SIZE || witness_hash.size() != HASH_SIZE)
+    {
+        ERRORLOG("transaction view hash size error");
+        return false;
+    }
+    return true;
+}
+
+bool SplitTransaction(std::string_view transaction, std::string_view &raw, std::string_view &witnesses)
+{
+    if (!SliceTableField(transaction, 2, 0, raw) || !SliceTableField(transaction, 2, 1, witnesses))
+    {
+        ERRORLOG("transaction format error");
+        return false;
+    }
+    return true;
+}
+
+bool SplitCellDataEntry(std::string_view entry, std::string_view &data, std::string_view &data_hash)
+{
+    std::string_view bytes;
+    if (!SliceTableField(entry, 2, 0, bytes) || !SliceTableField(entry, 2, 1, data_hash))
+    {
+        ERRORLOG("cell data entry format error");
+        return false;
+    }
+    mol_seg_t seg{(uint8_t *)bytes.data(), (mol_num_t)bytes.size()};
+    if (MOL_OK != MolReader_Bytes_verify(&seg, 1) || data_hash.size() != HASH_SIZE)
+    {
+        ERRORLOG("cell data entry format error");
+        return false;
+    }
+    data = bytes.substr(MOL_NUM_T_SIZE);
+    return true;
+}
+
+bool GetTransactionsRoot(std::string_view header, std::string_view &root)
+{
+    if (header.size() != HEADER_SIZE)
+    {
+        ERRORLOG("header size error:{}", header.size());
+        return false;
+    }
+    mol_seg_t seg{(uint8_t *)header.data(), (mol_num_t)header.size()};
+    mol_seg_t raw = MolReader_Header_get_raw(&seg);
+    mol_seg_t mol = MolReader_RawHeader_get_transactions_root(&raw);
+    root = std::string_view((char *)mol.ptr, mol.size);
+    return true;
+}
+
+bool GetOutputCount(std::string_view raw, uint32_t &count)
+{
+    std::string_view outputs;
+    if (!SliceTableField(raw, 6, 4, outputs) || outputs.size() < MOL_NUM_T_SIZE)
+    {
+        ERRORLOG("raw transaction format error");
+        return false;
+    }
+    mol_seg_t seg{(uint8_t *)outputs.data(), (mol_num_t)outputs.size()};
+    count = MolReader_CellOutputVec_length(&seg);
+    return true;
+}
+
+bool GetByte32VecItems(std::string_view vec, std::vector<std::string_view> &items)
+{
+    mol_seg_t seg{(uint8_t *)vec.data(), (mol_num_t)vec.size()};
+    if (MOL_OK != MolReader_Byte32Vec_verify(&seg, 1))
+    {
+        ERRORLOG("byte32 vec format error");
+        return false;
+    }
+    items.clear();
+    uint32_t len = MolReader_Byte32Vec_length(&seg);
+    for (uint32_t i = 0; i < len; ++i)
+    {
+        items.push_back(vec.substr(MOL_NUM_T_SIZE + HASH_SIZE * i, HASH_SIZE));
+    }
+    return true;
+}
+
+bool GetUncleHeaders(std::string_view uncles, std::vector<std::string_view> &headers)
+{
+    mol_seg_t seg{(uint8_t *)uncles.data(), (mol_num_t)uncles.size()};
+    if (MOL_OK != MolReader_UncleBlockVec_verify(&seg, 1))
+    {
+        ERRORLOG("uncle block vec format error");
+        return false;
+    }
+    headers.clear();
+    uint32_t len = MolReader_UncleBlockVec_length(&seg);
+    for (uint32_t i = 0; i < len; ++i)
+    {
+        mol_seg_res_t uncle = MolReader_UncleBlockVec_get(&seg, i);
+        if (MOL_OK != uncle.errno)
+        {
+            return false;
+        }
+        mol_seg_t header = MolReader_UncleBlock_get_header(&uncle.seg);
+        headers.push_back(std::string_view((char *)header.ptr, header.size));
+    }
+    return true;
+}
+
+bool GetUncleBlocks(std::string_view uncles, std::vector<std::string_view> &blocks)
+{
+    mol_seg_t seg{(uint8_t *)uncles.data(), (mol_num_t)uncles.size()};
+    if (MOL_OK != MolReader_UncleBlockVec_verify(&seg, 1))
+    {
+        ERRORLOG("uncle block vec format error");
+        return false;
+    }
+    blocks.clear();
+    uint32_t len = MolReader_UncleBlockVec_length(&seg);
+    for (uint32_t i = 0; i < len; ++i)
+    {
+        mol_seg_res_t uncle = MolReader_UncleBlockVec_get(&seg, i);
+        if (MOL_OK != uncle.errno)
+        {
+            return false;
+        }
+        blocks.push_back(std::string_view((char *)uncle.seg.ptr, uncle.seg.size));
+    }
+    return true;
+}
+
+bool GetFixVecItems(std::string_view vec, size_t item_size, std::vector<std::string_view> &items)
+{
+    if (vec.size() < MOL_NUM_T_SIZE)
+    {
+        return false;
+    }
+    uint64_t len = mol_unpack_number((const uint8_t *)vec.data());
+    if (vec.size() != MOL_NUM_T_SIZE + len * item_size)
+    {
+        return false;
+    }
+    items.clear();
+    for (uint64_t i = 0; i < len; ++i)
+    {
+        items.push_back(vec.substr(MOL_NUM_T_SIZE + item_size * i, item_size));
+    }
+    return true;
+}
+
+bool GetDynVecItems(std::string_view vec, std::vector<std::string_view> &items)
+{
+    items.clear();
+    if (vec.size() < MOL_NUM_T_SIZE)
+    {
+        return false;
+    }
+    const uint8_t *ptr = (const uint8_t *)vec.data();
+    mol_num_t total_size = mol_unpack_number(ptr);
+    if (total_size != vec.size())
+    {
+        return false;
+    }
+    if (MOL_NUM_T_SIZE == total_size)
+    {
+        return true;
+    }
+    if (total_size < MOL_NUM_T_SIZE * 2)
+    {
+        return false;
+    }
+    mol_num_t header_size = mol_unpack_number(ptr + MOL_NUM_T_SIZE);
+    if (0 != header_size % MOL_NUM_T_SIZE || header_size < MOL_NUM_T_SIZE * 2 || header_size > total_size)
+    {
+        return false;
+    }
+    mol_num_t count = header_size / MOL_NUM_T_SIZE - 1;
+    for (mol_num_t i = 0; i < count; ++i)
+    {
+        mol_num_t start = mol_unpack_number(ptr + MOL_NUM_T_SIZE * (i + 1));
+        mol_num_t end = i + 1 < count ? mol_unpack_number(ptr + MOL_NUM_T_SIZE * (i + 2)) : total_size;
+        if (start < header_size || start > end || end > total_size)
+        {
+            items.clear();
+            return false;
+        }
+        items.push_back(vec.substr(start, end - start));
+    }
+    return true;
+}
+
+bool GetBytesData(std::string_view bytes, std::string_view &data)
+{
+    if (bytes.size() < MOL_NUM_T_SIZE || mol_unpack_number((const uint8_t *)bytes.data()) != bytes.size() - MOL_NUM_T_SIZE)
+    {
+        return false;
+    }
+    data = bytes.substr(MOL_NUM_T_SIZE);
+    return true;
+}
+
+bool DecodeRawTransaction(std::string_view raw, RawTransactionFields &fields)
+{
+    mol_seg_t seg{(uint8_t *)raw.data(), (mol_num_t)raw.size()};
+    if (MOL_OK != MolReader_RawTransaction_verify(&seg, 1))
+    {
+        ERRORLOG("raw transaction format error");
+        return false;
+    }
+    mol_seg_t mol = MolReader_RawTransaction_get_version(&seg);
+    fields.version = mol_unpack_number(mol.ptr);
+    mol = MolReader_RawTransaction_get_cell_deps(&seg);
+    fields.cell_deps = std::string_view((char *)mol.ptr, mol.size);
+    mol = MolReader_RawTransaction_get_header_deps(&seg);
+    fields.header_deps = std::string_view((char *)mol.ptr, mol.size);
+    mol = MolReader_RawTransaction_get_inputs(&seg);
+    fields.inputs = std::string_view((char *)mol.ptr, mol.size);
+    mol = MolReader_RawTransaction_get_outputs(&seg);
+    fields.outputs = std::string_view((char *)mol.ptr, mol.size);
+    mol = MolReader_RawTransaction_get_outputs_data(&seg);
+    fields.outputs_data = std::string_view((char *)mol.ptr, mol.size);
+    return true;
+}
+
+static void ReadScript(mol_seg_t *script, ScriptFields &fields)
+{
+    mol_seg_t mol = MolReader_Script_get_code_hash(script);
+    fields.code_hash = std::string_view((char *)mol.ptr, mol.size);
+    mol = MolReader_Script_get_hash_type(script);
+    fields.hash_type = *mol.ptr;
+    mol = MolReader_Script_get_args(script);
+    mol_seg_t args = MolReader_Bytes_raw_bytes(&mol);
+    fields.args = std::string_view((char *)args.ptr, args.size);
+}
+
+bool DecodeScript(std::string_view script, ScriptFields &fields)
+{
+    mol_seg_t seg{(uint8_t *)script.data(), (mol_num_t)script.size()};
+    if (MOL_OK != MolReader_Script_verify(&seg, 1))
+    {
+        ERRORLOG("script format error");
+        return false;
+    }
+    ReadScript(&seg, fields);
+    return true;
+}
+
+bool DecodeCellOutput(std::string_view output, CellOutputFields &fields)
+{
+    mol_seg_t seg{(uint8_t *)output.data(), (mol_num_t)output.size()};
+    if (MOL_OK != MolReader_CellOutput_verify(&seg, 1))
+    {
+        ERRORLOG("cell output format error");
+        return false;
+    }
+    mol_seg_t mol = MolReader_CellOutput_get_capacity(&seg);
+    memcpy(&fields.capacity, mol.ptr, sizeof(fields.capacity));
+    fields.capacity = le64toh(fields.capacity);
+    mol = MolReader_CellOutput_get_lock(&seg);
+    fields.lock_script = std::string_view((char *)mol.ptr, mol.size);
+    ReadScript(&mol, fields.lock);
+    mol = MolReader_CellOutput_get_type_(&seg);
+    fields.has_type = !MolReader_ScriptOpt_is_none(&mol);
+    fields.type = ScriptFields();
+    fields.type_script = std::string_view();
+    if (fields.has_type)
+    {
+        fields.type_script = std::string_view((char *)mol.ptr, mol.size);
+        ReadScript(&mol, fields.type);
+    }
+    return true;
+}
+
+bool DecodeCellEntry(std::string_view entry, CellEntryFields &fields)
+{
+    mol_seg_t seg{(uint8_t *)entry.data(), (mol_num_t)entry.size()};
+    if (MOL_OK != MolReader_CellEntry_verify(&seg, 1))
+    {
+        ERRORLOG("cell entry format error");
+        return false;
+    }
+    mol_seg_t mol = MolReader_CellEntry_get_output(&seg);
+    fields.output = std::string_view((char *)mol.ptr, mol.size);
+    mol = MolReader_CellEntry_get_block_hash(&seg);
+    fields.block_hash = std::string_view((char *)mol.ptr, mol.size);
+    mol = MolReader_CellEntry_get_block_number(&seg);
+    memcpy(&fields.block_number, mol.ptr, sizeof(fields.block_number));
+    fields.block_number = le64toh(fields.block_number);
+    mol = MolReader_CellEntry_get_block_epoch(&seg);
+    memcpy(&fields.block_epoch, mol.ptr, sizeof(fields.block_epoch));
+    fields.block_epoch = le64toh(fields.block_epoch);
+    mol = MolReader_CellEntry_get_index(&seg);
+    fields.index = mol_unpack_number(mol.ptr);
+    mol = MolReader_CellEntry_get_data_size(&seg);
+    memcpy(&fields.data_size, mol.ptr, sizeof(fields.data_size));
+    fields.data_size = le64toh(fields.data_size);
+    return true;
+}
+
+bool IsNullOutPoint(std::string_view out_point)
+{
+    if (out_point.size() < HASH_SIZE + sizeof(uint32_t))
+    {
+        return false;
+    }
+    uint32_t index = 0;
+    memcpy(&index, out_point.data() + HASH_SIZE, sizeof(index));
+    return 0xffffffff == index && out_point.substr(0, HASH_SIZE).find_first_not_of('\0') == std::string_view::npos;
+}
+
+struct PreviousTransaction
+{
+    std::string hash;
+    std::string view;
+    std::vector<std::string_view> outputs;
+};
+
+bool ReadPreviousOutput(RocksDBReadOnly &db, std::string_view out_point, std::string_view &output)
+{
+    thread_local PreviousTransaction previous;
+    if (out_point.size() < HASH_SIZE + sizeof(uint32_t))
+    {
+        return false;
+    }
+    std::string_view tx_hash = out_point.substr(0, HASH_SIZE);
+    if (previous.hash != tx_hash)
+    {
+        previous.hash.clear();
+        rocksdb::Status status;
+        if (!ReadTransactionView(db, tx_hash, previous.view, status))
+        {
+            ERRORLOG("read previous transaction {} failed:{}", Bytes2Hex(std::string(tx_hash)), status.ToString());
+            return false;
+        }
+        std::string_view hash, witness_hash, transaction, raw, witnesses;
+        RawTransactionFields fields;
+        if (!SplitTransactionView(previous.view, hash, witness_hash, transaction) || !SplitTransaction(transaction, raw, witnesses) ||
+            !DecodeRawTransaction(raw, fields) || !GetDynVecItems(fields.outputs, previous.outputs))
+        {
+            return false;
+        }
+        previous.hash = tx_hash;
+    }
+    uint32_t index = 0;
+    memcpy(&index, out_point.data() + HASH_SIZE, sizeof(index));
+    index = le32toh(index);
+    if (index >= previous.outputs.size())
+    {
+        ERRORLOG("transaction {} has no output {}", Bytes2Hex(previous.hash), index);
+        return false;
+    }
+    output = previous.outputs[index];
+    return true;
+}
+
+bool BuildBlockMolecule(const RawBlock &block, std::string &out)
+{
+    std::string_view hash;
+    std::string_view header;
+    if (!SplitHeaderView(block.header, hash, header))
+    {
+        return false;
+    }
+    std::string_view uncle_hashes;
+    std::string_view uncles;
+    if (!SplitUncleBlockVecView(block.uncles, uncle_hashes, uncles))
+    {
+        return false;
+    }
+
+    mol_builder_t txs_builder;
+    MolBuilder_TransactionVec_init(&txs_builder);
+    std::string_view tx_hash;
+    std::string_view witness_hash;
+    std::string_view transaction;
+    for (auto &view : block.transactions)
+    {
+        if (!SplitTransactionView(view, tx_hash, witness_hash, transaction))
+        {
+            MolBuilder_TransactionVec_clear(txs_builder);
+            return false;
+        }
+        MolBuilder_TransactionVec_push(&txs_builder, (const uint8_t *)transaction.data(), transaction.size());
+    }
+    mol_seg_res_t txs = MolBuilder_TransactionVec_build(txs_builder);
+
+    mol_builder_t builder;
+    mol_seg_res_t res;
+    if (block.has_extension)
+    {
+        MolBuilder_BlockV1_init(&builder);
+        MolBuilder_BlockV1_set_header(&builder, (const uint8_t *)header.data(), header.size());
+        MolBuilder_BlockV1_set_uncles(&builder, (const uint8_t *)uncles.data(), uncles.size());
+        MolBuilder_BlockV1_set_transactions(&builder, txs.seg.ptr, txs.seg.size);
+        MolBuilder_BlockV1_set_proposals(&builder, (const uint8_t *)block.proposals.data(), block.proposals.size());
+        MolBuilder_BlockV1_set_extension(&builder, (const uint8_t *)block.extension.data(), block.extension.size());
+        res = MolBuilder_BlockV1_build(builder);
+    }
+    else
+    {
+        MolBuilder_Block_init(&builder);
+        MolBuilder_Block_set_header(&builder, (const uint8_t *)header.data(), header.size());
+        MolBuilder_Block_set_uncles(&builder, (const uint8_t *)uncles.data(), uncles.size());
+        MolBuilder_Block_set_transactions(&builder, txs.seg.ptr, txs.seg.size);
+        MolBuilder_Block_set_proposals(&builder, (const uint8_t *)block.proposals.data(), block.proposals.size());
+        res = MolBuilder_Block_build(builder);
+    }
+    free(txs.seg.ptr);
+    if (MOL_OK != res.errno)
+    {
+        ERRORLOG("build block error:{}", res.errno);
+        return false;
+    }
+    out.assign((char *)res.seg.ptr, res.seg.size);
+    free(res.seg.ptr);
+    return true;
+}
@@ -0,0 +1,91 @@
+#ifndef _MOLECULE_BLOCK_MOLECULE_H_
+#define _MOLECULE_BLOCK_MOLECULE_H_
+
+#include "db/raw_block.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+// HeaderView: struct { hash: Byte32, data: Header }
+bool SplitHeaderView(std::string_view view, std::string_view &hash, std::string_view &header);
+// UncleBlockVecView: table { hashes: Byte32Vec, data: UncleBlockVec }
+bool SplitUncleBlockVecView(std::string_view view, std::string_view &hashes, std::string_view &uncles);
+// TransactionView: table { hash: Byte32, witness_hash: Byte32, data: Transaction }
+bool SplitTransactionView(std::string_view view, std::string_view &hash, std::string_view &witness_hash, std::string_view &transaction);
+// Transaction: table { raw: RawTransaction, witnesses: BytesVec }
+bool SplitTransaction(std::string_view transaction, std::string_view &raw, std::string_view &witnesses);
+// CellDataEntry: table { output_data: Bytes, output_data_hash: Byte32 }, data is returned without its length header
+bool SplitCellDataEntry(std::string_view entry, std::string_view &data, std::string_view &data_hash);
+bool GetTransactionsRoot(std::string_view header, std::string_view &root);
+bool GetOutputCount(std::string_view raw, uint32_t &count);
+bool GetByte32VecItems(std::string_view vec, std::vector<std::string_view> &items);
+bool GetUncleHeaders(std::string_view uncles, std::vector<std::string_view> &headers);
+bool GetUncleBlocks(std::string_view uncles, std::vector<std::string_view> &blocks);
+
+// Items of a fixvec with item_size byte items, e.g. CellDepVec or CellInputVec
+bool GetFixVecItems(std::string_view vec, size_t item_size, std::vector<std::string_view> &items);
+// Items of a dynvec, e.g. CellOutputVec or BytesVec
+bool GetDynVecItems(std::string_view vec, std::vector<std::string_view> &items);
+// Bytes: the payload without its length header
+bool GetBytesData(std::string_view bytes, std::string_view &data);
+
+const size_t CELL_DEP_SIZE = 37;   // struct { out_point: OutPoint, dep_type: byte }
+const size_t CELL_INPUT_SIZE = 44; // struct { since: Uint64, previous_output: OutPoint }
+
+// RawTransaction: table { version, cell_deps, header_deps, inputs, outputs, outputs_data }.
+// The whole transaction is verified once, the vectors keep their molecule encoding.
+struct RawTransactionFields
+{
+    uint32_t version = 0;
+    std::string_view cell_deps;    // CellDepVec
+    std::string_view header_deps;  // Byte32Vec
+    std::string_view inputs;       // CellInputVec
+    std::string_view outputs;      // CellOutputVec
+    std::string_view outputs_data; // BytesVec
+};
+bool DecodeRawTransaction(std::string_view raw, RawTransactionFields &fields);
+
+struct ScriptFields
+{
+    std::string_view code_hash;
+    uint8_t hash_type = 0;
+    std::string_view args; // without the Bytes length header
+};
+
+struct CellOutputFields
+{
+    uint64_t capacity = 0;
+    std::string_view lock_script; // the packed Script, the lock hash is its ckb hash
+    ScriptFields lock;
+    bool has_type = false;
+    std::string_view type_script; // the packed Script when has_type
+    ScriptFields type;
+};
+bool DecodeScript(std::string_view script, ScriptFields &fields);
+bool DecodeCellOutput(std::string_view output, CellOutputFields &fields);
+
+// CellEntry: table { output, block_hash, block_number, block_epoch, index, data_size }
+struct CellEntryFields
+{
+    std::string_view output; // CellOutput
+    std::string_view block_hash;
+    uint64_t block_number = 0;
+    uint64_t block_epoch = 0;
+    uint32_t index = 0;
+    uint64_t data_size = 0;
+};
+bool DecodeCellEntry(std::string_view entry, CellEntryFields &fields);
+
+// OutPoint::null(), a zero tx_hash and index 0xffffffff. The cellbase input and the input of the
+// genesis dep group transaction name it, and spend nothing.
+bool IsNullOutPoint(std::string_view out_point);
+
+// The CellOutput an input's previous out_point names, read through COLUMN_TRANSACTION_INFO. Inputs
+// often spend several outputs of one transaction, so the last transaction read is kept per thread
+// and output stays valid until the thread's next call.
+bool ReadPreviousOutput(RocksDBReadOnly &db, std::string_view out_point, std::string_view &output);
+
+// Reassemble the canonical packed block, BlockV1 when the block carries an extension, Block otherwise
+bool BuildBlockMolecule(const RawBlock &block, std::string &out);
+
+#endif
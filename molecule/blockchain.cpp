@@ -517,6 +517,13 @@ bool RawHeader::ParseFromByte(char const *const ptr, size_t size)
 
     mol = MolReader_RawHeader_get_dao(&buf);
     json["dao"] = Bytes2Hex(std::string((char *)mol.ptr, mol.size));
+    // C total issuance, AR accumulate rate, S secondary issuance, U occupied capacity
+    uint64_t dao[4];
+    memcpy(dao, mol.ptr, sizeof(dao));
+    json["dao_c"] = dao[0];
+    json["dao_ar"] = dao[1];
+    json["dao_s"] = dao[2];
+    json["dao_u"] = dao[3];
 
     return true;
 }
@@ -0,0 +1,105 @@
+#include "archive/archive_reader.h"
+#include "archive/archive_writer.h"
+#include "test_chain.h"
+#include "utils/file_utils.h"
+#include <gtest/gtest.h>
+
+class ArchiveTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        for (uint64_t number = 0; number < 5; ++number)
+        {
+            TestTransaction tx;
+            tx.outputs = {TestOutput(100 + number, TestScript('a', "alice"))};
+            tx.outputs_data = {"data" + std::to_string(number)};
+            hashes.push_back(tx.Hash());
+            chain.AddBlock({tx}, number / 2);
+        }
+        ASSERT_TRUE(chain.Write(dir.Path("db")));
+    }
+
+    // Archives blocks [start, end) with two blocks per chunk
+    void Export(uint64_t start, uint64_t end)
+    {
+        rocksdb::Status status;
+        RocksDBReadOnly db(dir.Path("db"), status);
+        ASSERT_TRUE(status.ok());
+        ArchiveSink sink(dir.Path("blocks.ckba"), 2);
+        ASSERT_TRUE(sink.IsOpen());
+        std::string record;
+        for (uint64_t height = start; height < end; ++height)
+        {
+            ASSERT_EQ(EncodeArchiveBlock(db, height, record), 0);
+            ASSERT_TRUE(sink.Write(height, record));
+        }
+        ASSERT_TRUE(sink.Close());
+    }
+
+    TestChain chain;
+    TestDir dir;
+    std::vector<std::string> hashes;
+};
+
+TEST_F(ArchiveTest, RoundTripsEveryBlock)
+{
+    Export(1, 5);
+    ArchiveReader reader;
+    ASSERT_TRUE(reader.Open(dir.Path("blocks.ckba")));
+    EXPECT_EQ(reader.StartHeight(), 1u);
+    EXPECT_EQ(reader.EndHeight(), 5u);
+    EXPECT_EQ(reader.ChunkCount(), 2u);
+    uint64_t bad_chunk = 0;
+    EXPECT_TRUE(reader.VerifyChunks(2, bad_chunk));
+
+    ArchiveBlockView view;
+    for (uint64_t height = 1; height < 5; ++height)
+    {
+        ASSERT_TRUE(reader.Get(height, view));
+        EXPECT_EQ(view.Number(), height);
+        EXPECT_EQ(view.Hash(), chain.BlockHash(height));
+        EXPECT_EQ(view.ParentHash(), chain.BlockHash(height - 1));
+        EXPECT_EQ(view.Timestamp(), 1600000000000ULL + height * 10000);
+        EXPECT_EQ(view.Epoch(), height / 2);
+        EXPECT_EQ(view.CompactTarget(), 0x1e083126u);
+        // the cellbase and tx
+        ASSERT_EQ(view.TransactionCount(), 2u);
+        EXPECT_EQ(view.TransactionHash(1), hashes[height]);
+        EXPECT_NE(view.Transaction(1).find("data" + std::to_string(height)), std::string_view::npos);
+        EXPECT_EQ(view.UncleCount(), 0u);
+        EXPECT_EQ(view.ProposalCount(), 0u);
+        EXPECT_FALSE(view.HasExtension());
+    }
+    EXPECT_FALSE(reader.Get(0, view));
+    EXPECT_FALSE(reader.Get(5, view));
+}
+
+TEST_F(ArchiveTest, RejectsTruncatedAndCorruptFiles)
+{
+    Export(0, 5);
+    std::string content;
+    ASSERT_TRUE(ReadFile(dir.Path("blocks.ckba"), content));
+    ArchiveReader reader;
+
+    // an export that died before Close has no footer
+    ASSERT_TRUE(WriteFile(dir.Path("truncated.ckba"), content.substr(0, content.size() - 1)));
+    EXPECT_FALSE(reader.Open(dir.Path("truncated.ckba")));
+    ASSERT_TRUE(WriteFile(dir.Path("short.ckba"), content.substr(0, ARCHIVE_FILE_HEADER_SIZE + 8)));
+    EXPECT_FALSE(reader.Open(dir.Path("short.ckba")));
+
+    // a flipped byte in the third block fails the second chunk
+    ASSERT_TRUE(reader.Open(dir.Path("blocks.ckba")));
+    ArchiveBlockView view;
+    ASSERT_TRUE(reader.Get(0, view));
+    const char *file = view.Body().data() - 4 - ARCHIVE_FILE_HEADER_SIZE;
+    ASSERT_TRUE(reader.Get(2, view));
+    size_t offset = view.Hash().data() - file;
+    reader.Close();
+    content[offset] ^= 1;
+    ASSERT_TRUE(WriteFile(dir.Path("corrupt.ckba"), content));
+    ASSERT_TRUE(reader.Open(dir.Path("corrupt.ckba")));
+    uint64_t bad_chunk = 0;
+    EXPECT_FALSE(reader.VerifyChunks(2, bad_chunk));
+    EXPECT_EQ(bad_chunk, 1u);
+}
@@ -0,0 +1,90 @@
+#include "index/balance_history.h"
+#include "test_chain.h"
+#include "utils/crypto_utils.h"
+#include "utils/file_utils.h"
+#include <endian.h>
+#include <gtest/gtest.h>
+#include <string.h>
+
+TEST(BalanceHistoryTest, AnswersEveryHeightAcrossPointGroups)
+{
+    // Every block pays lock n, every even block also spends the previous payment, and the
+    // miner gains 1000 per block, so both locks have more than one group of points
+    const uint64_t blocks = 70;
+    std::string lock = TestScript('c', "carol");
+    std::string miner = TestScript('m', "miner");
+    TestChain chain;
+    // The genesis dep group transaction spends the null out point, the replay has to skip it
+    chain.AddBlock({});
+    std::vector<BalancePoint> expected;
+    std::string previous;
+    uint64_t balance = 0;
+    for (uint64_t n = 1; n <= blocks; ++n)
+    {
+        TestTransaction tx;
+        tx.outputs = {TestOutput(n, lock)};
+        tx.outputs_data = {""};
+        balance += n;
+        if (0 == n % 2)
+        {
+            tx.inputs = {TestOutPoint(previous, 0)};
+            balance -= n - 1;
+        }
+        previous = tx.Hash();
+        chain.AddBlock({tx});
+        expected.emplace_back(n, balance);
+    }
+    TestDir dir;
+    ASSERT_TRUE(chain.Write(dir.Path("db")));
+    rocksdb::Status status;
+    RocksDBReadOnly db(dir.Path("db"), status);
+    ASSERT_TRUE(status.ok());
+    ASSERT_TRUE(BuildBalanceHistory(db, blocks, dir.Path("history.idx"), 4));
+
+    BalanceHistory history;
+    ASSERT_TRUE(history.Open(dir.Path("history.idx")));
+    EXPECT_EQ(history.NextHeight(), blocks + 1);
+    EXPECT_EQ(history.LockCount(), 2u);
+    std::vector<BalancePoint> points;
+    ASSERT_TRUE(history.Changes(Blake2b256(lock), points));
+    EXPECT_EQ(points, expected);
+    for (uint64_t height = 0; height <= blocks; ++height)
+    {
+        uint64_t value = 0;
+        ASSERT_TRUE(history.BalanceAt(Blake2b256(lock), height, value));
+        EXPECT_EQ(value, 0 == height ? 0 : expected[height - 1].second);
+        ASSERT_TRUE(history.BalanceAt(Blake2b256(miner), height, value));
+        EXPECT_EQ(value, 1000 * (height + 1));
+    }
+    uint64_t value = 0;
+    EXPECT_FALSE(history.BalanceAt(Blake2b256(lock), blocks + 1, value));
+    ASSERT_TRUE(history.BalanceAt(std::string(32, 'z'), blocks, value));
+    EXPECT_EQ(value, 0u);
+    history.Close();
+
+    // offsets past the data fail the lookups instead of reading out of the file
+    std::string content;
+    ASSERT_TRUE(ReadFile(dir.Path("history.idx"), content));
+    size_t entry = content.size() - 2 * BALANCE_HISTORY_ENTRY_SIZE;
+    if (content.compare(entry, 32, Blake2b256(lock)) != 0)
+    {
+        entry += BALANCE_HISTORY_ENTRY_SIZE;
+    }
+    ASSERT_EQ(content.substr(entry, 32), Blake2b256(lock));
+    std::string data_offset = content.substr(entry + 32, 8);
+    content.replace(entry + 32, 8, Le64(UINT64_MAX - 2));
+    ASSERT_TRUE(WriteFile(dir.Path("bad_entry.idx"), content));
+    ASSERT_TRUE(history.Open(dir.Path("bad_entry.idx")));
+    EXPECT_FALSE(history.BalanceAt(Blake2b256(lock), blocks, value));
+    EXPECT_FALSE(history.Changes(Blake2b256(lock), points));
+    history.Close();
+
+    content.replace(entry + 32, 8, data_offset);
+    uint64_t offset = 0;
+    memcpy(&offset, data_offset.data(), sizeof(offset));
+    content.replace(le64toh(offset) + 4, 4, Le32(0xfffffff0));
+    ASSERT_TRUE(WriteFile(dir.Path("bad_group.idx"), content));
+    ASSERT_TRUE(history.Open(dir.Path("bad_group.idx")));
+    EXPECT_FALSE(history.BalanceAt(Blake2b256(lock), blocks, value));
+    EXPECT_FALSE(history.Changes(Blake2b256(lock), points));
+}
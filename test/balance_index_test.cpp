@@ -0,0 +1,72 @@
+#include "index/balance_index.h"
+#include "test_chain.h"
+#include "utils/crypto_utils.h"
+#include "utils/file_utils.h"
+#include <gtest/gtest.h>
+
+TEST(BalanceIndexTest, AppliedBlocksMatchAFreshBuild)
+{
+    std::string lock_a = TestScript('a', "alice");
+    std::string lock_b = TestScript('b', "bob");
+    TestChain chain;
+    TestTransaction first;
+    first.outputs = {TestOutput(100, lock_a), TestOutput(200, lock_b), TestOutput(300, lock_a)};
+    first.outputs_data = {"", "", ""};
+    chain.AddBlock({});
+    chain.AddBlock({first});
+    TestDir dir;
+    ASSERT_TRUE(chain.Write(dir.Path("db")));
+    {
+        rocksdb::Status status;
+        RocksDBReadOnly db(dir.Path("db"), status);
+        ASSERT_TRUE(status.ok());
+        ASSERT_TRUE(UpdateBalanceIndex(db, dir.Path("balances.idx"), 4));
+    }
+
+    // Spends outputs 1 and 2 of first, then moves part of the result back to lock_a
+    TestTransaction second;
+    second.inputs = {TestOutPoint(first.Hash(), 2), TestOutPoint(first.Hash(), 1)};
+    second.outputs = {TestOutput(450, lock_b), TestOutput(50, lock_a)};
+    second.outputs_data = {"", ""};
+    chain.AddBlock({second});
+    TestTransaction third;
+    third.inputs = {TestOutPoint(second.Hash(), 0)};
+    third.outputs = {TestOutput(400, lock_b), TestOutput(50, lock_a)};
+    third.outputs_data = {"", ""};
+    chain.AddBlock({third});
+    ASSERT_TRUE(chain.Write(dir.Path("db")));
+
+    rocksdb::Status status;
+    RocksDBReadOnly db(dir.Path("db"), status);
+    ASSERT_TRUE(status.ok());
+    ASSERT_TRUE(UpdateBalanceIndex(db, dir.Path("balances.idx"), 4));
+    ASSERT_TRUE(UpdateBalanceIndex(db, dir.Path("fresh.idx"), 4));
+
+    BalanceIndex index;
+    ASSERT_TRUE(index.Open(dir.Path("balances.idx")));
+    EXPECT_EQ(index.NextHeight(), 4u);
+    EXPECT_EQ(index.BlockHash(), chain.BlockHash(3));
+    ASSERT_EQ(index.Count(), 3u);
+    // The miner holds four cellbase outputs
+    EXPECT_EQ(index.At(0).lock_hash, Blake2b256(TestScript('m', "miner")));
+    EXPECT_EQ(index.At(0).capacity, 4000u);
+    Balance balance;
+    ASSERT_TRUE(index.Find(Blake2b256(lock_a), balance));
+    EXPECT_EQ(balance.capacity, 200u);
+    EXPECT_EQ(balance.cells, 3u);
+    ASSERT_TRUE(index.Find(Blake2b256(lock_b), balance));
+    EXPECT_EQ(balance.capacity, 400u);
+    EXPECT_EQ(balance.cells, 1u);
+    EXPECT_FALSE(index.Find(std::string(32, 'z'), balance));
+    for (uint64_t i = 0; i < index.Count(); ++i)
+    {
+        ASSERT_TRUE(index.Find(index.At(i).lock_hash, balance));
+        EXPECT_EQ(balance.lock_hash, index.At(i).lock_hash);
+        EXPECT_EQ(balance.capacity, index.At(i).capacity);
+    }
+
+    std::string updated, fresh;
+    ASSERT_TRUE(ReadFile(dir.Path("balances.idx"), updated));
+    ASSERT_TRUE(ReadFile(dir.Path("fresh.idx"), fresh));
+    EXPECT_EQ(updated, fresh);
+}
@@ -0,0 +1,49 @@
+#include "utils/cbmt.h"
+#include "utils/crypto_utils.h"
+#include <gtest/gtest.h>
+
+// Leaf i is 32 bytes of i + first
+static std::string Leaves(size_t count, uint8_t first)
+{
+    std::string leaves;
+    for (size_t i = 0; i < count; ++i)
+    {
+        leaves += std::string(32, (char)(first + i));
+    }
+    return leaves;
+}
+
+static std::string Root(const std::string &leaves, std::vector<uint8_t> &scratch)
+{
+    std::string root(32, '\xff');
+    CbmtRoot((const uint8_t *)leaves.data(), leaves.size() / 32, (uint8_t *)&root[0], scratch);
+    return Bytes2Hex(root);
+}
+
+// Expected values from the RFC 0006 construction over blake2b-256 personalized with "ckb-default-hash"
+TEST(CbmtTest, RootsMatchTheReferenceTree)
+{
+    std::vector<uint8_t> scratch;
+    EXPECT_EQ(Root(Leaves(0, 1), scratch), std::string(64, '0'));
+    EXPECT_EQ(Root(Leaves(1, 1), scratch), Bytes2Hex(std::string(32, '\x01')));
+    EXPECT_EQ(Root(Leaves(2, 1), scratch), "b80e4ce9cdae7411fb79c76d174712aacaca8478356a9b43fcad3521e07519d4");
+    EXPECT_EQ(Root(Leaves(3, 1), scratch), "364831c33cbdddfa319b61c17c8c822b1c4dd1e740d53bc3ee4b59a947a78982");
+    EXPECT_EQ(Root(Leaves(5, 1), scratch), "4a8d6b78475ce4e221726c2001f0b7a7bfb72b5d4453cefd1fc523d8e7402ead");
+    // A warmed up scratch gives the same roots
+    EXPECT_EQ(Root(Leaves(3, 1), scratch), "364831c33cbdddfa319b61c17c8c822b1c4dd1e740d53bc3ee4b59a947a78982");
+}
+
+TEST(CbmtTest, MergeHashesBothChildren)
+{
+    std::string left(32, '\x01'), right(32, '\x02'), out(32, '\0');
+    CbmtMerge((const uint8_t *)left.data(), (const uint8_t *)right.data(), (uint8_t *)&out[0]);
+    EXPECT_EQ(Bytes2Hex(out), "b80e4ce9cdae7411fb79c76d174712aacaca8478356a9b43fcad3521e07519d4");
+}
+
+TEST(CbmtTest, TransactionsRootMergesTxAndWitnessTrees)
+{
+    std::string tx_hashes = Leaves(3, 0x01), witness_hashes = Leaves(3, 0x11), root(32, '\0');
+    std::vector<uint8_t> scratch;
+    CalcTransactionsRoot((const uint8_t *)tx_hashes.data(), (const uint8_t *)witness_hashes.data(), 3, (uint8_t *)&root[0], scratch);
+    EXPECT_EQ(Bytes2Hex(root), "4ea53618cd7a00b9984d1921674eb03efdbfd62bf73329a680c0641b44cf03bf");
+}
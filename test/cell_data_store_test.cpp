@@ -0,0 +1,109 @@
+#include "export/block_json.h"
+#include "export/cell_data_store.h"
+#include "export/protobuf_export.h"
+#include "test_chain.h"
+#include "utils/crypto_utils.h"
+#include "utils/file_utils.h"
+#include <filesystem>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/util/delimited_message_util.h>
+#include <gtest/gtest.h>
+
+class CellDataStoreTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        // The same large data twice and data below the 16 byte minimum
+        big = std::string(64, 'd');
+        tx.outputs = {TestOutput(100, TestScript('a', "alice")), TestOutput(200, TestScript('a', "alice")),
+                      TestOutput(300, TestScript('a', "alice"))};
+        tx.outputs_data = {"short", big, big};
+        chain.AddBlock({});
+        chain.AddBlock({tx});
+        ASSERT_TRUE(chain.Write(dir.Path("db")));
+    }
+
+    std::string BlobPath() const
+    {
+        std::string hex = Bytes2Hex(Blake2b256(big));
+        return dir.Path("blobs/" + hex.substr(0, 2) + "/" + hex);
+    }
+
+    std::string big;
+    TestTransaction tx;
+    TestChain chain;
+    TestDir dir;
+};
+
+TEST_F(CellDataStoreTest, JsonRecordsReferenceOneBlob)
+{
+    rocksdb::Status status;
+    RocksDBReadOnly db(dir.Path("db"), status);
+    ASSERT_TRUE(status.ok());
+    CellDataStore store(dir.Path("blobs"), 1024, 16);
+    ASSERT_TRUE(store.IsOpen());
+
+    std::string record;
+    ASSERT_EQ(EncodeBlockNdjson(db, 1, record, &store), 0);
+    nlohmann::json outputs_data = nlohmann::json::parse(record)["block"]["transactions"][1]["raw"]["outputs_data"];
+    ASSERT_EQ(outputs_data.size(), 3u);
+    EXPECT_TRUE(outputs_data[0].is_string());
+    nlohmann::json reference = {{"blob", Bytes2Hex(Blake2b256(big))}, {"size", big.size()}};
+    EXPECT_EQ(outputs_data[1], reference);
+    EXPECT_EQ(outputs_data[2], reference);
+    CellDataStoreStats stats = store.Stats();
+    EXPECT_EQ(stats.blobs, 1u);
+    EXPECT_EQ(stats.bytes, big.size());
+    EXPECT_EQ(stats.duplicates, 1u);
+    EXPECT_EQ(stats.bytes_saved, big.size());
+
+    std::string content;
+    ASSERT_TRUE(ReadFile(BlobPath(), content));
+    EXPECT_EQ(content, big);
+    for (auto &item : std::filesystem::recursive_directory_iterator(dir.Path("blobs")))
+    {
+        EXPECT_EQ(item.path().string().find(".tmp"), std::string::npos) << item.path();
+    }
+
+    ASSERT_EQ(EncodeBlockJson(db, 1, record, &store), 0);
+    EXPECT_EQ(nlohmann::json::parse(record)["block"]["transactions"][1]["raw"]["outputs_data"][2], reference);
+    EXPECT_EQ(store.Stats().blobs, 1u);
+    EXPECT_EQ(store.Stats().duplicates, 3u);
+
+    // A new store has not seen the blob, the file tells it is there
+    CellDataStore reopened(dir.Path("blobs"), 1024, 16);
+    std::string hash;
+    ASSERT_TRUE(reopened.Put(big, hash));
+    EXPECT_EQ(hash, Blake2b256(big));
+    EXPECT_EQ(reopened.Stats().blobs, 0u);
+    EXPECT_EQ(reopened.Stats().duplicates, 1u);
+}
+
+TEST_F(CellDataStoreTest, ProtobufRecordsCarryTheHash)
+{
+    rocksdb::Status status;
+    RocksDBReadOnly db(dir.Path("db"), status);
+    ASSERT_TRUE(status.ok());
+    CellDataStore store(dir.Path("blobs"), 1024, 16);
+    std::string record;
+    ASSERT_EQ(EncodeProtobufBlock(db, 1, record, &store), 0);
+
+    ckb::Block block;
+    google::protobuf::io::ArrayInputStream stream(record.data(), record.size());
+    ASSERT_TRUE(google::protobuf::util::ParseDelimitedFromZeroCopyStream(&block, &stream, nullptr));
+    ASSERT_EQ(block.transactions_size(), 2);
+    const ckb::Transaction &transaction = block.transactions(1);
+    ASSERT_EQ(transaction.outputs_data_size(), 3);
+    ASSERT_EQ(transaction.outputs_data_hash_size(), 3);
+    EXPECT_EQ(transaction.outputs_data(0), "short");
+    EXPECT_EQ(transaction.outputs_data_hash(0), "");
+    for (int i = 1; i < 3; ++i)
+    {
+        EXPECT_EQ(transaction.outputs_data(i), "");
+        EXPECT_EQ(transaction.outputs_data_hash(i), Blake2b256(big));
+    }
+    EXPECT_EQ(store.Stats().blobs, 1u);
+    EXPECT_EQ(store.Stats().duplicates, 1u);
+    EXPECT_TRUE(FileExists(BlobPath()));
+}
@@ -0,0 +1,72 @@
+#include "index/cell_snapshot.h"
+#include "index/live_cell_index.h"
+#include "test_chain.h"
+#include "utils/crypto_utils.h"
+#include "utils/file_utils.h"
+#include <gtest/gtest.h>
+
+TEST(CellSnapshotTest, ReplaysFromAnIndexBuiltFromColumnCell)
+{
+    std::string lock_a = TestScript('a', "alice");
+    std::string lock_b = TestScript('b', "bob");
+    TestChain chain;
+    TestTransaction first;
+    // no inputs, a replay from genesis knows every spent cell
+    first.outputs = {TestOutput(100, lock_a), TestOutput(200, lock_b), TestOutput(300, lock_a)};
+    first.outputs_data = {"", "", "data"};
+    chain.AddBlock({});
+    chain.AddBlock({first});
+    TestDir dir;
+    ASSERT_TRUE(chain.Write(dir.Path("db")));
+    {
+        rocksdb::Status status;
+        RocksDBReadOnly db(dir.Path("db"), status);
+        ASSERT_TRUE(status.ok());
+        ASSERT_TRUE(BuildLiveCellIndex(db, dir.Path("base.idx"), 4));
+    }
+
+    TestTransaction second;
+    second.inputs = {TestOutPoint(first.Hash(), 2), TestOutPoint(first.Hash(), 1)};
+    second.outputs = {TestOutput(250, lock_b), TestOutput(250, lock_a)};
+    second.outputs_data = {"", ""};
+    chain.AddBlock({second});
+    TestTransaction third;
+    third.inputs = {TestOutPoint(second.Hash(), 1)};
+    third.outputs = {TestOutput(250, lock_b)};
+    third.outputs_data = {""};
+    chain.AddBlock({third});
+    ASSERT_TRUE(chain.Write(dir.Path("db")));
+
+    rocksdb::Status status;
+    RocksDBReadOnly db(dir.Path("db"), status);
+    ASSERT_TRUE(status.ok());
+    ASSERT_TRUE(BuildCellSnapshot(db, 3, dir.Path("base.idx"), dir.Path("from_base.idx"), 4));
+    ASSERT_TRUE(BuildCellSnapshot(db, 3, "", dir.Path("from_genesis.idx"), 4));
+    ASSERT_TRUE(BuildLiveCellIndex(db, dir.Path("tip.idx"), 4));
+
+    std::string from_base, from_genesis, tip;
+    ASSERT_TRUE(ReadFile(dir.Path("from_base.idx"), from_base));
+    ASSERT_TRUE(ReadFile(dir.Path("from_genesis.idx"), from_genesis));
+    ASSERT_TRUE(ReadFile(dir.Path("tip.idx"), tip));
+    EXPECT_EQ(from_base, from_genesis);
+    EXPECT_EQ(from_base, tip);
+
+    LiveCellIndex index;
+    ASSERT_TRUE(index.Open(dir.Path("from_base.idx")));
+    EXPECT_EQ(index.NextHeight(), 4u);
+    // four cellbases, first:0, second:0 and third:0
+    EXPECT_EQ(index.Count(), 7u);
+
+    // the genesis dep group transaction spends the null out point, a replay of genesis alone
+    // keeps its cellbase output
+    ASSERT_TRUE(BuildCellSnapshot(db, 0, "", dir.Path("genesis.idx"), 4));
+    LiveCellIndex genesis;
+    ASSERT_TRUE(genesis.Open(dir.Path("genesis.idx")));
+    EXPECT_EQ(genesis.NextHeight(), 1u);
+    EXPECT_EQ(genesis.Count(), 1u);
+
+    std::string totals;
+    ASSERT_TRUE(ReadFile(dir.Path("from_base.idx.locks.csv"), totals));
+    EXPECT_NE(totals.find(Bytes2Hex(Blake2b256(lock_b)) + ",2,500\n"), std::string::npos);
+    EXPECT_NE(totals.find(Bytes2Hex(Blake2b256(lock_a)) + ",1,100\n"), std::string::npos);
+}
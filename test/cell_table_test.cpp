@@ -0,0 +1,66 @@
+#include "index/cell_table.h"
+#include "test_chain.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <string.h>
+
+// Record of output index of a transaction whose hash starts with tx
+static LiveCellRecord Record(uint32_t tx, uint32_t index, uint64_t capacity)
+{
+    LiveCellRecord record{};
+    std::string fields = std::string(32, 'l') + TestOutPoint(Le32(tx) + std::string(28, 't'), index) + Le64(capacity);
+    memcpy(record.data(), fields.data(), record.size());
+    return record;
+}
+
+TEST(CellTableTest, InsertsErasesAndGrows)
+{
+    // Sized for far fewer cells than inserted, the table has to grow
+    CellTable table(4);
+    for (uint32_t tx = 0; tx < 500; ++tx)
+    {
+        for (uint32_t index = 0; index < 3; ++index)
+        {
+            ASSERT_TRUE(table.Insert(Record(tx, index, tx * 3 + index)));
+        }
+    }
+    EXPECT_EQ(table.Size(), 1500u);
+    EXPECT_FALSE(table.Insert(Record(7, 1, 0)));
+
+    // Erase every other cell, the backward shift has to keep the rest reachable
+    LiveCellRecord erased;
+    for (uint32_t tx = 0; tx < 500; tx += 2)
+    {
+        for (uint32_t index = 0; index < 3; ++index)
+        {
+            LiveCellRecord record = Record(tx, index, 0);
+            ASSERT_TRUE(table.Erase(record.data() + 32, erased));
+            EXPECT_EQ(erased, Record(tx, index, tx * 3 + index));
+        }
+    }
+    EXPECT_EQ(table.Size(), 750u);
+    LiveCellRecord missing = Record(0, 0, 0);
+    EXPECT_FALSE(table.Erase(missing.data() + 32, erased));
+    for (uint32_t tx = 1; tx < 500; tx += 2)
+    {
+        LiveCellRecord record = Record(tx, 2, 0);
+        ASSERT_TRUE(table.Erase(record.data() + 32, erased));
+        ASSERT_TRUE(table.Insert(erased));
+    }
+
+    std::vector<LiveCellRecord> records;
+    table.Extract(records);
+    EXPECT_EQ(table.Size(), 0u);
+    ASSERT_EQ(records.size(), 750u);
+    std::sort(records.begin(), records.end(), LiveCellRecordLess);
+    std::vector<LiveCellRecord> expected;
+    for (uint32_t tx = 1; tx < 500; tx += 2)
+    {
+        for (uint32_t index = 0; index < 3; ++index)
+        {
+            expected.push_back(Record(tx, index, tx * 3 + index));
+        }
+    }
+    std::sort(expected.begin(), expected.end(), LiveCellRecordLess);
+    EXPECT_EQ(records, expected);
+}
@@ -0,0 +1,126 @@
+#include "columnar/columnar_reader.h"
+#include "columnar/columnar_writer.h"
+#include "export/columnar_export.h"
+#include "test_chain.h"
+#include "utils/crypto_utils.h"
+#include <gtest/gtest.h>
+
+class ColumnarTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        // Four rows per group: numbers rise by group and fall inside one, locks repeat, data never does
+        ColumnarWriter writer(dir.Path("t.ckbc"), "outputs", {{"number", COLUMNAR_UINT64}, {"lock", COLUMNAR_BYTES}, {"data", COLUMNAR_BYTES}}, 4);
+        ASSERT_TRUE(writer.IsOpen());
+        for (uint64_t i = 0; i < 10; ++i)
+        {
+            numbers.push_back((i / 4) * 100 + 10 - i % 4);
+            locks.push_back(std::string(32, 0 == i % 3 ? 'a' : 'b'));
+            datas.push_back("data" + std::to_string(i));
+            writer.SetUint64(0, numbers.back());
+            writer.SetBytes(1, locks.back());
+            writer.SetBytes(2, datas.back());
+            ASSERT_TRUE(writer.EndRow());
+        }
+        ASSERT_TRUE(writer.Close());
+        ASSERT_TRUE(reader.Open(dir.Path("t.ckbc")));
+    }
+
+    // (number, lock, data) of the matching rows
+    std::vector<std::tuple<uint64_t, std::string, std::string>> Scan(const std::vector<ColumnPredicate> &predicates, ColumnarScanStats &stats)
+    {
+        std::vector<std::tuple<uint64_t, std::string, std::string>> rows;
+        EXPECT_TRUE(reader.Scan({"number", "lock", "data"}, predicates, [&](const std::vector<const ColumnData *> &columns, const std::vector<uint32_t> &matched)
+        {
+            for (auto row : matched)
+            {
+                rows.emplace_back(columns[0]->uints[row], std::string(columns[1]->bytes[row]), std::string(columns[2]->bytes[row]));
+            }
+            return true;
+        }, stats));
+        return rows;
+    }
+
+    std::vector<uint64_t> numbers;
+    std::vector<std::string> locks, datas;
+    TestDir dir;
+    ColumnarReader reader;
+};
+
+TEST_F(ColumnarTest, RoundTripsEveryRow)
+{
+    const ColumnarFileMeta &meta = reader.Meta();
+    EXPECT_EQ(meta.table, "outputs");
+    EXPECT_EQ(meta.rows, 10u);
+    ASSERT_EQ(meta.row_groups.size(), 3u);
+    EXPECT_EQ(meta.row_groups[2].rows, 2u);
+    EXPECT_EQ(meta.row_groups[0].columns[0].encoding, ENCODING_DELTA);
+    EXPECT_EQ(meta.row_groups[0].columns[1].encoding, ENCODING_DICTIONARY);
+    EXPECT_EQ(meta.row_groups[0].columns[2].encoding, ENCODING_PLAIN);
+    EXPECT_EQ(meta.row_groups[1].columns[0].min_value, 107u);
+    EXPECT_EQ(meta.row_groups[1].columns[0].max_value, 110u);
+    EXPECT_EQ(reader.ColumnIndex("data"), 2);
+    EXPECT_EQ(reader.ColumnIndex("missing"), -1);
+
+    ColumnarScanStats stats;
+    auto rows = Scan({}, stats);
+    ASSERT_EQ(rows.size(), 10u);
+    for (size_t i = 0; i < rows.size(); ++i)
+    {
+        EXPECT_EQ(rows[i], std::make_tuple(numbers[i], locks[i], datas[i]));
+    }
+    EXPECT_EQ(stats.row_groups_skipped, 0u);
+}
+
+TEST_F(ColumnarTest, ZoneMapsSkipRowGroups)
+{
+    ColumnPredicate range;
+    range.column = "number";
+    range.min = 108;
+    range.max = 200;
+    ColumnarScanStats stats;
+    auto rows = Scan({range}, stats);
+    ASSERT_EQ(rows.size(), 3u);
+    EXPECT_EQ(std::get<0>(rows[0]), 110u);
+    EXPECT_EQ(std::get<0>(rows[2]), 108u);
+    EXPECT_EQ(stats.row_groups_skipped, 2u);
+    EXPECT_EQ(stats.rows_matched, 3u);
+}
+
+TEST_F(ColumnarTest, BytesEqualityMatchesDictionaryValues)
+{
+    ColumnPredicate lock;
+    lock.column = "lock";
+    lock.has_value = true;
+    lock.value = std::string(32, 'a');
+    ColumnarScanStats stats;
+    auto rows = Scan({lock}, stats);
+    ASSERT_EQ(rows.size(), 4u);
+    EXPECT_EQ(std::get<2>(rows[3]), "data9");
+}
+
+TEST(ColumnarExportTest, MissingOutputsDataIsAnError)
+{
+    TestTransaction tx;
+    tx.outputs = {TestOutput(100, TestScript('a', "alice")), TestOutput(200, TestScript('b', "bob"))};
+    tx.outputs_data = {"", "data"};
+    TestChain chain;
+    chain.AddBlock({});
+    chain.AddBlock({tx});
+    TestDir dir;
+    ASSERT_TRUE(chain.Write(dir.Path("db")));
+    rocksdb::Status status;
+    RocksDBReadOnly db(dir.Path("db"), status);
+    ASSERT_TRUE(status.ok());
+    RawBlock block;
+    ASSERT_TRUE(ReadRawBlock(db, 1, block, status));
+    std::string record;
+    ASSERT_TRUE(EncodeColumnarRows(block, record));
+
+    TestTransaction broken = tx;
+    broken.outputs_data.pop_back();
+    std::string transaction = MolTable({broken.Raw(), MolDynVec({})});
+    block.transactions[1] = MolTable({broken.Hash(), Blake2b256(transaction), transaction});
+    EXPECT_FALSE(EncodeColumnarRows(block, record));
+}
@@ -0,0 +1,32 @@
+#include "utils/compress_utils.h"
+#include <gtest/gtest.h>
+
+TEST(CompressUtilsTest, GzipFramesConcatenateIntoOneStream)
+{
+    std::string first, second;
+    for (int i = 0; i < 100000; ++i)
+    {
+        first += std::to_string(i * 7919 % 100003) + ",";
+    }
+    second = "tail";
+    std::string a, b, frames, output;
+    ASSERT_TRUE(CompressFrame(COMPRESS_GZIP, 6, first, a));
+    ASSERT_TRUE(CompressFrame(COMPRESS_GZIP, 1, second, b));
+    EXPECT_LT(a.size(), first.size());
+    ASSERT_TRUE(DecompressFrames(COMPRESS_GZIP, a, output));
+    EXPECT_EQ(output, first);
+    frames = a + b;
+    ASSERT_TRUE(DecompressFrames(COMPRESS_GZIP, frames, output));
+    EXPECT_EQ(output, first + second);
+    // A cut frame is an error, not a short result
+    EXPECT_FALSE(DecompressFrames(COMPRESS_GZIP, frames.substr(0, frames.size() - 3), output));
+}
+
+TEST(CompressUtilsTest, EmptyInputIsAFrameToo)
+{
+    std::string frame, output = "x";
+    ASSERT_TRUE(CompressFrame(COMPRESS_GZIP, 6, "", frame));
+    EXPECT_FALSE(frame.empty());
+    ASSERT_TRUE(DecompressFrames(COMPRESS_GZIP, frame, output));
+    EXPECT_EQ(output, "");
+}
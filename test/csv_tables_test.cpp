@@ -0,0 +1,82 @@
+#include "export/csv_tables.h"
+#include "test_chain.h"
+#include "utils/crypto_utils.h"
+#include "utils/file_utils.h"
+#include <gtest/gtest.h>
+
+static std::string Code(char code)
+{
+    return Bytes2Hex(std::string(32, code));
+}
+
+class CsvTablesTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        tx.header_deps = {std::string(32, 'h')};
+        tx.inputs = {TestOutPoint(std::string(32, 'x'), 3)};
+        tx.since = 9;
+        tx.outputs = {TestOutput(100, TestScript('a', "alice")), TestOutput(5000000000ULL, TestScript('b', "bob"), TestScript('t', "token"))};
+        tx.outputs_data = {"", "data"};
+        chain.AddBlock({});
+        chain.AddBlock({tx}, 2);
+        ASSERT_TRUE(chain.Write(dir.Path("db")));
+    }
+
+    TestTransaction tx;
+    TestChain chain;
+    TestDir dir;
+};
+
+TEST_F(CsvTablesTest, WritesOneRowPerItem)
+{
+    {
+        rocksdb::Status status;
+        RocksDBReadOnly db(dir.Path("db"), status);
+        ASSERT_TRUE(status.ok());
+        CompressOptions compress;
+        compress.type = COMPRESS_NONE;
+        CsvTableSink sink(dir.Path(""), compress, {});
+        ASSERT_TRUE(sink.IsOpen());
+        std::string record;
+        ASSERT_EQ(EncodeCsvBlock(db, 1, record), 0);
+        ASSERT_TRUE(sink.Write(1, record));
+        ASSERT_TRUE(sink.Close());
+    }
+
+    std::string hash = Bytes2Hex(tx.Hash());
+    std::string content;
+    ASSERT_TRUE(ReadFile(dir.Path("outputs.csv"), content));
+    EXPECT_EQ(content, std::string(CsvTableColumns(CSV_OUTPUTS)) +
+                           "1,0,0,1000," + Code('m') + ",1,6d696e6572,,,,0,\n"
+                           "1,1,0,100," + Code('a') + ",1,616c696365,,,,0,\n"
+                           "1,1,1,5000000000," + Code('b') + ",1,626f62," + Code('t') + ",1,746f6b656e,4,64617461\n");
+    ASSERT_TRUE(ReadFile(dir.Path("inputs.csv"), content));
+    EXPECT_NE(content.find("\n1,1,0," + Bytes2Hex(std::string(32, 'x')) + ",3,9\n"), std::string::npos);
+    ASSERT_TRUE(ReadFile(dir.Path("header_deps.csv"), content));
+    EXPECT_EQ(content, std::string(CsvTableColumns(CSV_HEADER_DEPS)) + "1,1,0," + Bytes2Hex(std::string(32, 'h')) + "\n");
+    ASSERT_TRUE(ReadFile(dir.Path("transactions.csv"), content));
+    EXPECT_NE(content.find("\n1,1," + hash + ","), std::string::npos);
+    ASSERT_TRUE(ReadFile(dir.Path("blocks.csv"), content));
+    EXPECT_NE(content.find("\n1," + Bytes2Hex(chain.BlockHash(1)) + ",0,503853350,1600000010000,2,"), std::string::npos);
+    ASSERT_TRUE(ReadFile(dir.Path("uncles.csv"), content));
+    EXPECT_EQ(content, CsvTableColumns(CSV_UNCLES));
+}
+
+TEST_F(CsvTablesTest, MissingOutputsDataIsAnError)
+{
+    rocksdb::Status status;
+    RocksDBReadOnly db(dir.Path("db"), status);
+    ASSERT_TRUE(status.ok());
+    RawBlock block;
+    ASSERT_TRUE(ReadRawBlock(db, 1, block, status));
+    std::string record;
+    ASSERT_TRUE(EncodeCsvRows(block, record));
+
+    TestTransaction broken = tx;
+    broken.outputs_data.pop_back();
+    std::string transaction = MolTable({broken.Raw(), MolDynVec({})});
+    block.transactions[1] = MolTable({broken.Hash(), Blake2b256(transaction), transaction});
+    EXPECT_FALSE(EncodeCsvRows(block, record));
+}
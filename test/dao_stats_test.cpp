@@ -0,0 +1,131 @@
+#include "index/dao_stats.h"
+#include "test_chain.h"
+#include "utils/crypto_utils.h"
+#include "utils/file_utils.h"
+#include <gtest/gtest.h>
+
+static const uint64_t CKB = 100000000;
+static const uint64_t AR_BASE = 10000000000000000ULL;
+
+static std::string Dao(uint64_t c, uint64_t ar, uint64_t s, uint64_t u)
+{
+    return Le64(c) + Le64(ar) + Le64(s) + Le64(u);
+}
+
+// Epoch number in the low 24 bits, index and length above it
+static uint64_t Epoch(uint64_t number)
+{
+    return 1800ULL << 40 | 7ULL << 24 | number;
+}
+
+TEST(DaoStatsTest, FollowsADepositThroughItsWithdrawal)
+{
+    std::string dao = MolTable({Hex2Bytes("82d76d1b75fe2fd9a27dfbaa65a039221a380d76c926f378d3f81cf3e7e13f2e"), std::string(1, '\x01'),
+                                MolBytes("")});
+    std::string alice = TestScript('a', "alice");
+    TestTransaction deposit, request, withdraw, second_deposit;
+    deposit.outputs = {TestOutput(1000 * CKB, alice, dao), TestOutput(1000 * CKB, alice, TestScript('t', ""))};
+    deposit.outputs_data = {Le64(0), Le64(0)};
+    second_deposit.outputs = {TestOutput(500 * CKB, alice, dao)};
+    second_deposit.outputs_data = {Le64(0)};
+
+    TestChain chain;
+    chain.AddBlock({}, Epoch(0), Dao(0, AR_BASE, 0, 0));
+    std::string deposit_block = chain.AddBlock({deposit}, Epoch(0), Dao(1, AR_BASE, 2, 3));
+    // The request block has accumulated 10% over the deposit block
+    request.inputs = {TestOutPoint(deposit.Hash(), 0)};
+    request.header_deps = {deposit_block};
+    request.outputs = {TestOutput(1000 * CKB, alice, dao)};
+    request.outputs_data = {Le64(1)};
+    std::string request_block = chain.AddBlock({request}, Epoch(1), Dao(4, AR_BASE / 10 * 11, 5, 6));
+    chain.AddBlock({second_deposit}, Epoch(1), Dao(7, AR_BASE / 10 * 11, 8, 9));
+    withdraw.inputs = {TestOutPoint(request.Hash(), 0)};
+    withdraw.header_deps = {deposit_block, request_block};
+    withdraw.outputs = {TestOutput(1009 * CKB, alice)};
+    withdraw.outputs_data = {""};
+    chain.AddBlock({withdraw}, Epoch(2), Dao(10, AR_BASE / 10 * 12, 11, 12));
+    TestDir dir;
+    ASSERT_TRUE(chain.Write(dir.Path("db")));
+    rocksdb::Status status;
+    RocksDBReadOnly db(dir.Path("db"), status);
+    ASSERT_TRUE(status.ok());
+
+    std::vector<DaoEpochStats> epochs;
+    std::vector<DaoWithdrawal> withdrawals;
+    ASSERT_TRUE(CollectDaoStats(db, 0, chain.Count(), 2, epochs, withdrawals));
+
+    // 8 capacity, 8 data, alice's lock with 5 args bytes and the DAO type without args
+    const uint64_t occupied = (8 + 8 + 32 + 1 + 5 + 32 + 1) * CKB;
+    const uint64_t compensation = (1000 * CKB - occupied) / 10;
+    ASSERT_EQ(withdrawals.size(), 1u);
+    const DaoWithdrawal &withdrawal = withdrawals[0];
+    EXPECT_EQ(std::string(withdrawal.out_point.data(), 36), TestOutPoint(request.Hash(), 0));
+    EXPECT_EQ(withdrawal.deposit_height, 1u);
+    EXPECT_EQ(withdrawal.request_height, 2u);
+    EXPECT_EQ(withdrawal.withdraw_height, 4u);
+    EXPECT_EQ(withdrawal.capacity, 1000 * CKB);
+    EXPECT_EQ(withdrawal.occupied, occupied);
+    EXPECT_EQ(withdrawal.compensation, compensation);
+
+    ASSERT_EQ(epochs.size(), 3u);
+    for (uint64_t i = 0; i < epochs.size(); ++i)
+    {
+        EXPECT_EQ(epochs[i].epoch, i);
+    }
+    // The dao field of the last block of each epoch
+    EXPECT_EQ(epochs[0].start_height, 0u);
+    EXPECT_EQ(epochs[0].blocks, 2u);
+    EXPECT_EQ(epochs[0].c, 1u);
+    EXPECT_EQ(epochs[0].ar, AR_BASE);
+    EXPECT_EQ(epochs[0].s, 2u);
+    EXPECT_EQ(epochs[0].u, 3u);
+    EXPECT_EQ(epochs[1].start_height, 2u);
+    EXPECT_EQ(epochs[1].blocks, 2u);
+    EXPECT_EQ(epochs[1].c, 7u);
+    EXPECT_EQ(epochs[1].ar, AR_BASE / 10 * 11);
+    EXPECT_EQ(epochs[1].s, 8u);
+    EXPECT_EQ(epochs[1].u, 9u);
+    EXPECT_EQ(epochs[2].start_height, 4u);
+    EXPECT_EQ(epochs[2].blocks, 1u);
+
+    // The cell of another type with zero data is not a deposit
+    EXPECT_EQ(epochs[0].deposits, 1u);
+    EXPECT_EQ(epochs[0].deposit_capacity, 1000 * CKB);
+    EXPECT_EQ(epochs[0].requests, 0u);
+    EXPECT_EQ(epochs[0].withdrawals, 0u);
+    EXPECT_EQ(epochs[0].net_capacity, (int64_t)(1000 * CKB));
+
+    EXPECT_EQ(epochs[1].deposits, 1u);
+    EXPECT_EQ(epochs[1].deposit_capacity, 500 * CKB);
+    EXPECT_EQ(epochs[1].requests, 1u);
+    EXPECT_EQ(epochs[1].request_capacity, 1000 * CKB);
+    EXPECT_EQ(epochs[1].request_compensation, compensation);
+    // Spending the deposit for the request is not a withdrawal
+    EXPECT_EQ(epochs[1].withdrawals, 0u);
+    EXPECT_EQ(epochs[1].net_capacity, (int64_t)(1500 * CKB));
+
+    EXPECT_EQ(epochs[2].deposits, 0u);
+    EXPECT_EQ(epochs[2].requests, 0u);
+    EXPECT_EQ(epochs[2].withdrawals, 1u);
+    EXPECT_EQ(epochs[2].withdrawal_capacity, 1000 * CKB);
+    EXPECT_EQ(epochs[2].withdrawal_compensation, compensation);
+    EXPECT_EQ(epochs[2].net_capacity, (int64_t)(500 * CKB));
+
+    // A range starting after the request leaves the withdrawal unmatched
+    ASSERT_TRUE(CollectDaoStats(db, 3, chain.Count(), 2, epochs, withdrawals));
+    EXPECT_TRUE(withdrawals.empty());
+    ASSERT_EQ(epochs.size(), 2u);
+    EXPECT_EQ(epochs[1].withdrawals, 0u);
+    EXPECT_EQ(epochs[1].net_capacity, (int64_t)(500 * CKB));
+
+    // A request is open until its cell is spent
+    ASSERT_TRUE(CollectDaoStats(db, 0, 4, 2, epochs, withdrawals));
+    ASSERT_EQ(withdrawals.size(), 1u);
+    EXPECT_EQ(withdrawals[0].withdraw_height, UINT64_MAX);
+    ASSERT_TRUE(WriteDaoReports(dir.Path(""), epochs, withdrawals));
+    std::string content;
+    ASSERT_TRUE(ReadFile(dir.Path("dao_withdrawals.csv"), content));
+    EXPECT_EQ(content, "tx_hash,index,deposit_height,request_height,withdraw_height,capacity,occupied,compensation\n" +
+                           Bytes2Hex(request.Hash()) + ",0,1,2,," + std::to_string(1000 * CKB) + "," + std::to_string(occupied) + "," +
+                           std::to_string(compensation) + "\n");
+}
@@ -0,0 +1,71 @@
+#include "audit/hash_audit.h"
+#include "db/columns.h"
+#include "db/raw_block.h"
+#include "test_chain.h"
+#include <gtest/gtest.h>
+
+class HashAuditTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        TestTransaction first;
+        first.inputs.push_back(TestOutPoint(std::string(32, 'x'), 0));
+        first.outputs = {TestOutput(100, TestScript('a', "")), TestOutput(200, TestScript('a', "")), TestOutput(300, TestScript('b', ""))};
+        first.outputs_data = {"", "one", "two"};
+        TestTransaction second;
+        second.inputs.push_back(TestOutPoint(first.Hash(), 2));
+        second.outputs = {TestOutput(300, TestScript('c', ""))};
+        second.outputs_data = {"three"};
+        chain.AddBlock({});
+        chain.AddBlock({first});
+        chain.AddBlock({second});
+        first_hash = first.Hash();
+    }
+
+    int Audit(HashAuditStats &stats)
+    {
+        if (!chain.Write(dir.Path("db")))
+        {
+            return -1;
+        }
+        rocksdb::Status status;
+        RocksDBReadOnly db(dir.Path("db"), status);
+        return status.ok() ? AuditHashes(db, 0, chain.Count(), 2, stats) : -1;
+    }
+
+    std::string first_hash;
+    TestChain chain;
+    TestDir dir;
+};
+
+TEST_F(HashAuditTest, ChecksTheDataOfEveryLiveOutput)
+{
+    HashAuditStats stats;
+    EXPECT_EQ(Audit(stats), 0);
+    EXPECT_EQ(stats.blocks, 3u);
+    // the genesis dep group transaction, three cellbases and two transactions
+    EXPECT_EQ(stats.transactions, 6u);
+    // "one" at index 1 and "three", the cell with "two" is spent
+    EXPECT_EQ(stats.cells, 2u);
+    EXPECT_EQ(stats.spent, 1u);
+    EXPECT_EQ(stats.missing, 0u);
+    EXPECT_EQ(stats.mismatches, 0u);
+}
+
+TEST_F(HashAuditTest, ReportsWrongDataHashes)
+{
+    chain.columns[COLUMN_CELL_DATA][CellKey(first_hash, 1)] = MolTable({MolBytes("one"), std::string(32, 'z')});
+    HashAuditStats stats;
+    EXPECT_EQ(Audit(stats), -5);
+    EXPECT_EQ(stats.mismatches, 1u);
+}
+
+TEST_F(HashAuditTest, ReportsLiveCellsWithoutData)
+{
+    chain.columns[COLUMN_CELL_DATA].erase(CellKey(first_hash, 1));
+    HashAuditStats stats;
+    EXPECT_EQ(Audit(stats), -5);
+    EXPECT_EQ(stats.missing, 1u);
+    EXPECT_EQ(stats.mismatches, 0u);
+}
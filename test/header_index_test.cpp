@@ -0,0 +1,109 @@
+#include "index/header_index.h"
+#include "test_chain.h"
+#include <gtest/gtest.h>
+
+// EpochNumberWithFraction of block index of an epoch with length blocks
+static uint64_t Epoch(uint64_t number, uint64_t index, uint64_t length)
+{
+    return number | index << 24 | length << 40;
+}
+
+// Block n is 10 seconds after block n - 1, epochs start at the heights in starts
+static TestChain EpochChain(const std::vector<uint64_t> &starts, uint64_t count, uint64_t salt)
+{
+    TestChain chain;
+    for (uint64_t height = 0, epoch = 0; height < count; ++height)
+    {
+        while (epoch + 1 < starts.size() && starts[epoch + 1] <= height)
+        {
+            ++epoch;
+        }
+        uint64_t length = epoch + 1 < starts.size() ? starts[epoch + 1] - starts[epoch] : 10;
+        std::vector<TestTransaction> txs;
+        if (height >= 3)
+        {
+            // Blocks from 3 on differ between salts, like the two sides of a reorg
+            txs.resize(1);
+            txs[0].outputs = {TestOutput(salt, TestScript('s', ""))};
+            txs[0].outputs_data = {""};
+        }
+        chain.AddBlock(txs, Epoch(epoch, height - starts[epoch], length));
+    }
+    return chain;
+}
+
+TEST(HeaderIndexTest, ResolvesTimesAndEpochsThroughAReorg)
+{
+    TestDir dir;
+    TestChain chain = EpochChain({0, 3, 6}, 7, 1);
+    ASSERT_TRUE(chain.Write(dir.Path("db")));
+    HeaderIndex index;
+    {
+        rocksdb::Status status;
+        RocksDBReadOnly db(dir.Path("db"), status);
+        ASSERT_TRUE(status.ok());
+        bool changed = false;
+        ASSERT_TRUE(index.Update(db, 4, changed));
+        EXPECT_TRUE(changed);
+        ASSERT_TRUE(index.Update(db, 4, changed));
+        EXPECT_FALSE(changed);
+    }
+    EXPECT_EQ(index.Count(), 7u);
+    EXPECT_EQ(index.EpochCount(), 3u);
+    EXPECT_EQ(index.HeightAtTime(0), 0u);
+    EXPECT_EQ(index.HeightAtTime(1600000000000ULL + 15000), 2u);
+    EXPECT_EQ(index.HeightAtTime(1600000000000ULL + 60000), 6u);
+    EXPECT_EQ(index.HeightAtTime(1600000000000ULL + 60001), 7u);
+    uint64_t start = 0, end = 0;
+    ASSERT_TRUE(index.EpochHeights(0, 1, start, end));
+    EXPECT_EQ(std::make_pair(start, end), std::make_pair(uint64_t(0), uint64_t(6)));
+    ASSERT_TRUE(index.EpochHeights(2, 2, start, end));
+    EXPECT_EQ(std::make_pair(start, end), std::make_pair(uint64_t(6), uint64_t(7)));
+    EXPECT_FALSE(index.EpochHeights(3, 3, start, end));
+    EXPECT_FALSE(index.EpochHeights(2, 1, start, end));
+    ASSERT_TRUE(index.Save(dir.Path("headers.idx")));
+
+    // Blocks 3 and on are replaced, the new side starts epoch 2 earlier and is longer
+    ASSERT_TRUE(EpochChain({0, 3, 5}, 9, 2).Write(dir.Path("db")));
+    HeaderIndex loaded;
+    ASSERT_TRUE(loaded.Load(dir.Path("headers.idx")));
+    EXPECT_EQ(loaded.Count(), 7u);
+    rocksdb::Status status;
+    RocksDBReadOnly db(dir.Path("db"), status);
+    ASSERT_TRUE(status.ok());
+    bool changed = false;
+    ASSERT_TRUE(loaded.Update(db, 4, changed));
+    EXPECT_TRUE(changed);
+    EXPECT_EQ(loaded.Count(), 9u);
+    ASSERT_TRUE(loaded.EpochHeights(1, 1, start, end));
+    EXPECT_EQ(std::make_pair(start, end), std::make_pair(uint64_t(3), uint64_t(5)));
+    ASSERT_TRUE(loaded.EpochHeights(2, 2, start, end));
+    EXPECT_EQ(std::make_pair(start, end), std::make_pair(uint64_t(5), uint64_t(9)));
+
+    // malformed --epochs values are rejected instead of throwing
+    for (const char *epochs : {"a:b", ":5", "1:", "5", "1:99999999999999999999999"})
+    {
+        start = 0;
+        end = UINT64_MAX;
+        EXPECT_FALSE(SelectHeights(db, {{"header-index", dir.Path("select.idx")}, {"epochs", epochs}}, 4, start, end)) << epochs;
+    }
+    start = 0;
+    end = UINT64_MAX;
+    ASSERT_TRUE(SelectHeights(db, {{"header-index", dir.Path("select.idx")}, {"epochs", "1:1"}}, 4, start, end));
+    EXPECT_EQ(std::make_pair(start, end), std::make_pair(uint64_t(3), uint64_t(5)));
+}
+
+TEST(HeaderIndexTest, ParsesSecondsAndUtcDates)
+{
+    uint64_t timestamp = 0;
+    ASSERT_TRUE(ParseTime("1600000000", timestamp));
+    EXPECT_EQ(timestamp, 1600000000000ULL);
+    ASSERT_TRUE(ParseTime("1970-01-02", timestamp));
+    EXPECT_EQ(timestamp, 86400000u);
+    ASSERT_TRUE(ParseTime("2020-09-13T12:26:40", timestamp));
+    EXPECT_EQ(timestamp, 1600000000000ULL);
+    EXPECT_FALSE(ParseTime("2020-09-13T12", timestamp));
+    EXPECT_FALSE(ParseTime("yesterday", timestamp));
+    EXPECT_FALSE(ParseTime("99999999999999999999999", timestamp));
+    EXPECT_FALSE(ParseTime("18446744073709552", timestamp));
+}
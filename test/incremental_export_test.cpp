@@ -0,0 +1,95 @@
+#include "export/export_command.h"
+#include "export/shard_sink.h"
+#include "export/sync_state.h"
+#include "test_chain.h"
+#include "utils/crypto_utils.h"
+#include "utils/file_utils.h"
+#include <gtest/gtest.h>
+#include <sstream>
+
+// Block n pays 100 + n + fork to alice, so a fork changes every block hash from its first block on
+static void AddBlocks(TestChain &chain, uint64_t count, uint64_t fork)
+{
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        TestTransaction tx;
+        tx.outputs = {TestOutput(100 + chain.Count() + fork, TestScript('a', "alice"))};
+        tx.outputs_data = {""};
+        chain.AddBlock({tx});
+    }
+}
+
+static std::vector<std::string> Lines(const std::string &path)
+{
+    std::string content;
+    EXPECT_TRUE(ReadFile(path, content));
+    std::vector<std::string> lines;
+    std::istringstream stream(content);
+    for (std::string line; std::getline(stream, line);)
+    {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+class IncrementalExportTest : public ::testing::Test
+{
+protected:
+    int Export(const TestChain &chain)
+    {
+        EXPECT_TRUE(chain.Write(dir.Path("db")));
+        rocksdb::Status status;
+        RocksDBReadOnly db(dir.Path("db"), status);
+        EXPECT_TRUE(status.ok());
+        return RunExport(db, 0, UINT64_MAX,
+                         {{"format", "ndjson"}, {"output", dir.Path("blocks")}, {"incremental", dir.Path("state.json")}, {"threads", "2"}});
+    }
+
+    std::string Shard(uint64_t run, uint64_t start)
+    {
+        ShardOptions options;
+        options.prefix = dir.Path("blocks");
+        options.run = run;
+        return ShardPath(options, start);
+    }
+
+    TestDir dir;
+};
+
+TEST_F(IncrementalExportTest, ReorgRollsBackIntoANewShard)
+{
+    TestChain chain;
+    AddBlocks(chain, 4, 0);
+    ASSERT_EQ(Export(chain), 0);
+    auto first = Lines(Shard(1, 0));
+    ASSERT_EQ(first.size(), 4u);
+    EXPECT_NE(first[3].find(Bytes2Hex(chain.BlockHash(3))), std::string::npos);
+
+    // blocks 2 and 3 are replaced by three others
+    TestChain fork;
+    AddBlocks(fork, 2, 0);
+    AddBlocks(fork, 3, 1000);
+    ASSERT_EQ(Export(fork), 0);
+
+    EXPECT_EQ(Lines(Shard(1, 0)), first);
+    auto second = Lines(Shard(2, 2));
+    ASSERT_EQ(second.size(), 5u);
+    EXPECT_EQ(second[0] + "\n", EncodeRollbackMarker({3, Bytes2Hex(chain.BlockHash(3))}));
+    EXPECT_EQ(second[1] + "\n", EncodeRollbackMarker({2, Bytes2Hex(chain.BlockHash(2))}));
+    for (uint64_t number = 2; number < 5; ++number)
+    {
+        EXPECT_NE(second[number].find(Bytes2Hex(fork.BlockHash(number))), std::string::npos);
+    }
+
+    SyncState state;
+    ASSERT_TRUE(LoadSyncState(dir.Path("state.json"), state));
+    EXPECT_EQ(state.next_height, 5u);
+    EXPECT_EQ(state.runs, 2u);
+    EXPECT_EQ(state.recent.rbegin()->second, Bytes2Hex(fork.BlockHash(4)));
+
+    // nothing new, no third shard
+    ASSERT_EQ(Export(fork), 0);
+    ASSERT_TRUE(LoadSyncState(dir.Path("state.json"), state));
+    EXPECT_EQ(state.runs, 2u);
+    EXPECT_FALSE(FileExists(Shard(3, 5)));
+}
@@ -0,0 +1,118 @@
+#include "db/raw_block.h"
+#include "index/live_cell_index.h"
+#include "test_chain.h"
+#include "utils/crypto_utils.h"
+#include "utils/file_utils.h"
+#include <gtest/gtest.h>
+#include <map>
+
+// out_point -> (lock hash, capacity) of the live cells in COLUMN_CELL
+static std::map<std::string, std::pair<std::string, uint64_t>> ReadIndex(const LiveCellIndex &index)
+{
+    std::map<std::string, std::pair<std::string, uint64_t>> cells;
+    for (uint64_t i = 0; i < index.Count(); ++i)
+    {
+        LiveCell cell = index.At(i);
+        cells[std::string(cell.tx_hash) + Le32(cell.index)] = {std::string(cell.lock_hash), cell.capacity};
+    }
+    return cells;
+}
+
+class LiveCellIndexTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        lock_a = TestScript('a', "alice");
+        lock_b = TestScript('b', "bob");
+        TestTransaction first;
+        first.inputs.push_back(TestOutPoint(std::string(32, 'x'), 0));
+        first.outputs = {TestOutput(100, lock_a), TestOutput(200, lock_b), TestOutput(300, lock_a)};
+        first.outputs_data = {"", "", "data"};
+        chain.AddBlock({});
+        chain.AddBlock({first});
+        first_hash = first.Hash();
+    }
+
+    std::string lock_a, lock_b, first_hash;
+    TestChain chain;
+    TestDir dir;
+};
+
+TEST_F(LiveCellIndexTest, BuildStoresMoleculeOutPoints)
+{
+    ASSERT_TRUE(chain.Write(dir.Path("db")));
+    rocksdb::Status status;
+    RocksDBReadOnly db(dir.Path("db"), status);
+    ASSERT_TRUE(status.ok());
+    ASSERT_TRUE(BuildLiveCellIndex(db, dir.Path("cells.idx"), 4));
+
+    LiveCellIndex index;
+    ASSERT_TRUE(index.Open(dir.Path("cells.idx")));
+    EXPECT_EQ(index.NextHeight(), 2u);
+    EXPECT_EQ(index.BlockHash(), chain.BlockHash(1));
+    // Two cellbase outputs and three of the first transaction
+    EXPECT_EQ(index.Count(), 5u);
+    auto cells = ReadIndex(index);
+    ASSERT_EQ(cells.count(TestOutPoint(first_hash, 2)), 1u);
+    EXPECT_EQ(cells[TestOutPoint(first_hash, 2)], std::make_pair(Blake2b256(lock_a), uint64_t(300)));
+    EXPECT_EQ(cells[TestOutPoint(first_hash, 1)], std::make_pair(Blake2b256(lock_b), uint64_t(200)));
+
+    uint64_t first = 0, last = 0;
+    index.Find(Blake2b256(lock_a), first, last);
+    ASSERT_EQ(last - first, 2u);
+    EXPECT_EQ(index.At(first).index + index.At(first + 1).index, 2u);
+}
+
+TEST_F(LiveCellIndexTest, UpdateSpendsOutputsPastIndexZero)
+{
+    ASSERT_TRUE(chain.Write(dir.Path("db")));
+    {
+        rocksdb::Status status;
+        RocksDBReadOnly db(dir.Path("db"), status);
+        ASSERT_TRUE(status.ok());
+        ASSERT_TRUE(BuildLiveCellIndex(db, dir.Path("cells.idx"), 4));
+    }
+
+    TestTransaction second;
+    second.inputs = {TestOutPoint(first_hash, 1), TestOutPoint(first_hash, 2)};
+    second.outputs = {TestOutput(450, lock_b)};
+    second.outputs_data = {""};
+    chain.AddBlock({second});
+    TestTransaction third;
+    third.inputs = {TestOutPoint(second.Hash(), 0)};
+    third.outputs = {TestOutput(440, lock_a), TestOutput(10, lock_b)};
+    third.outputs_data = {"", ""};
+    chain.AddBlock({third});
+    ASSERT_TRUE(chain.Write(dir.Path("db")));
+
+    rocksdb::Status status;
+    RocksDBReadOnly db(dir.Path("db"), status);
+    ASSERT_TRUE(status.ok());
+    ASSERT_TRUE(UpdateLiveCellIndex(db, dir.Path("cells.idx"), 4));
+    ASSERT_TRUE(BuildLiveCellIndex(db, dir.Path("rebuilt.idx"), 4));
+
+    LiveCellIndex index;
+    ASSERT_TRUE(index.Open(dir.Path("cells.idx")));
+    EXPECT_EQ(index.NextHeight(), 4u);
+    auto cells = ReadIndex(index);
+    EXPECT_EQ(cells.count(TestOutPoint(first_hash, 1)), 0u);
+    EXPECT_EQ(cells.count(TestOutPoint(first_hash, 2)), 0u);
+    EXPECT_EQ(cells.count(TestOutPoint(first_hash, 0)), 1u);
+    EXPECT_EQ(cells[TestOutPoint(third.Hash(), 1)], std::make_pair(Blake2b256(lock_b), uint64_t(10)));
+
+    std::string updated, rebuilt;
+    ASSERT_TRUE(ReadFile(dir.Path("cells.idx"), updated));
+    ASSERT_TRUE(ReadFile(dir.Path("rebuilt.idx"), rebuilt));
+    EXPECT_EQ(updated, rebuilt);
+}
+
+TEST(CellKeyTest, IndexIsBigEndianInKeysAndLittleEndianInOutPoints)
+{
+    std::string hash(32, 'h');
+    std::string key = CellKey(hash, 0x01020304);
+    EXPECT_EQ(key, hash + std::string("\x01\x02\x03\x04", 4));
+    char out_point[36];
+    CellKeyToOutPoint(key.data(), out_point);
+    EXPECT_EQ(std::string(out_point, sizeof(out_point)), TestOutPoint(hash, 0x01020304));
+}
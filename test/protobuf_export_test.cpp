@@ -0,0 +1,107 @@
+#include "db/columns.h"
+#include "export/protobuf_export.h"
+#include "test_chain.h"
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/util/delimited_message_util.h>
+#include <gtest/gtest.h>
+
+class StringSink : public BlockSink
+{
+public:
+    bool Write(uint64_t height, const std::string &record) override
+    {
+        content += record;
+        return true;
+    }
+
+    std::string content;
+};
+
+template <typename Message>
+static std::vector<Message> ParseDelimited(const std::string &content)
+{
+    std::vector<Message> messages;
+    google::protobuf::io::ArrayInputStream stream(content.data(), content.size());
+    Message message;
+    bool clean_eof = false;
+    while (google::protobuf::util::ParseDelimitedFromZeroCopyStream(&message, &stream, &clean_eof))
+    {
+        messages.push_back(message);
+    }
+    EXPECT_TRUE(clean_eof);
+    return messages;
+}
+
+TEST(ProtobufExportTest, WritesLiveCellsWithTheirOutPoints)
+{
+    std::string lock = TestScript('a', "alice");
+    TestTransaction tx;
+    tx.outputs = {TestOutput(100, lock), TestOutput(200, lock, TestScript('t', "token"))};
+    tx.outputs_data = {"", "data"};
+    TestChain chain;
+    chain.AddBlock({});
+    chain.AddBlock({tx}, 7);
+    TestDir dir;
+    ASSERT_TRUE(chain.Write(dir.Path("db")));
+    rocksdb::Status status;
+    RocksDBReadOnly db(dir.Path("db"), status);
+    ASSERT_TRUE(status.ok());
+
+    StringSink sink;
+    ASSERT_TRUE(ExportProtobufColumn(db, COLUMN_CELL, sink));
+    auto cells = ParseDelimited<ckb::CellEntry>(sink.content);
+    // two cellbase outputs and the two of tx
+    ASSERT_EQ(cells.size(), 4u);
+    bool found = false;
+    for (auto &cell : cells)
+    {
+        if (cell.out_point().tx_hash() != tx.Hash() || 1 != cell.out_point().index())
+        {
+            continue;
+        }
+        found = true;
+        EXPECT_EQ(cell.output().capacity(), 200u);
+        EXPECT_EQ(cell.output().type().args(), "token");
+        EXPECT_EQ(cell.block_hash(), chain.BlockHash(1));
+        EXPECT_EQ(cell.block_number(), 1u);
+        EXPECT_EQ(cell.block_epoch(), 7u);
+        EXPECT_EQ(cell.index(), 1u);
+        EXPECT_EQ(cell.data_size(), 4u);
+    }
+    EXPECT_TRUE(found);
+}
+
+TEST(ProtobufExportTest, WritesEpochs)
+{
+    TestChain chain;
+    chain.AddBlock({});
+    std::string ext = std::string(32, 'r') + std::string(32, 'h') + Le32(0x1e083126) + Le64(3) + Le64(1000) + Le64(5) + Le64(3600) +
+                      Le64(1800);
+    chain.columns[COLUMN_EPOCH][std::string(32, 'e')] = ext;
+    // CKB also maps the epoch number to its hash in the same column
+    chain.columns[COLUMN_EPOCH][std::string("\0\0\0\0\0\0\0\3", 8)] = std::string(32, 'e');
+    TestDir dir;
+    ASSERT_TRUE(chain.Write(dir.Path("db")));
+    rocksdb::Status status;
+    RocksDBReadOnly db(dir.Path("db"), status);
+    ASSERT_TRUE(status.ok());
+
+    StringSink sink;
+    ASSERT_TRUE(ExportProtobufColumn(db, COLUMN_EPOCH, sink));
+    auto epochs = ParseDelimited<ckb::EpochExt>(sink.content);
+    ASSERT_EQ(epochs.size(), 1u);
+    EXPECT_EQ(epochs[0].previous_epoch_hash_rate(), std::string(32, 'r'));
+    EXPECT_EQ(epochs[0].last_block_hash_in_previous_epoch(), std::string(32, 'h'));
+    EXPECT_EQ(epochs[0].compact_target(), 0x1e083126u);
+    EXPECT_EQ(epochs[0].number(), 3u);
+    EXPECT_EQ(epochs[0].base_block_reward(), 1000u);
+    EXPECT_EQ(epochs[0].remainder_reward(), 5u);
+    EXPECT_EQ(epochs[0].start_number(), 3600u);
+    EXPECT_EQ(epochs[0].length(), 1800u);
+
+    chain.columns[COLUMN_EPOCH][std::string(32, 'e')] = ext.substr(1);
+    ASSERT_TRUE(chain.Write(dir.Path("db2")));
+    RocksDBReadOnly broken(dir.Path("db2"), status);
+    ASSERT_TRUE(status.ok());
+    EXPECT_FALSE(ExportProtobufColumn(broken, COLUMN_EPOCH, sink));
+}
@@ -0,0 +1,194 @@
+#include "export/script_filter.h"
+#include "test_chain.h"
+#include "utils/crypto_utils.h"
+#include "utils/file_utils.h"
+#include <gtest/gtest.h>
+
+static std::string Code(char code)
+{
+    return Bytes2Hex(std::string(32, code));
+}
+
+static ScriptFields Script(const std::string &code_hash, uint8_t hash_type, const std::string &args)
+{
+    ScriptFields script;
+    script.code_hash = code_hash;
+    script.hash_type = hash_type;
+    script.args = args;
+    return script;
+}
+
+TEST(ScriptFilterTest, LoadsRulesAndRejectsBadLines)
+{
+    TestDir dir;
+    ASSERT_TRUE(WriteFile(dir.Path("rules"), "# locks\n"
+                                             "lock 0x" + Code('a') + " type\n"
+                                             "\n"
+                                             "lock " + Code('b') + " 1 0x0102   # with an args prefix\n"
+                                             "type " + Code('t') + " data1 aabb\n"));
+    ScriptFilter filter;
+    ASSERT_TRUE(filter.Load(dir.Path("rules")));
+    EXPECT_EQ(filter.Size(), 3u);
+    std::string a(32, 'a'), b(32, 'b'), t(32, 't');
+    EXPECT_TRUE(filter.Match(SCRIPT_LOCK, Script(a, 1, "anything")));
+    EXPECT_TRUE(filter.Match(SCRIPT_LOCK, Script(b, 1, "\x01\x02\x03")));
+    EXPECT_FALSE(filter.Match(SCRIPT_TYPE, Script(b, 1, "\x01\x02\x03")));
+    EXPECT_TRUE(filter.Match(SCRIPT_TYPE, Script(t, 2, "\xaa\xbb")));
+    EXPECT_FALSE(filter.Match(SCRIPT_LOCK, Script(t, 2, "\xaa\xbb")));
+
+    const std::vector<std::string> bad = {
+        "lock " + Code('a').substr(1) + " type\n",   // odd hex
+        "lock " + Code('a').substr(2) + " type\n",   // 31 bytes
+        "lock " + std::string(64, 'z') + " type\n",  // not hex
+        "lock " + Code('a') + " type 0x0g\n",        // bad args
+        "lock " + Code('a') + " data3\n",            // unknown hash type
+        "lock " + Code('a') + " 256\n",              // hash type past a byte
+        "lock " + Code('a') + "\n",                  // no hash type
+        "data " + Code('a') + " type\n",             // unknown role
+        "lock " + Code('a') + " type 01 02\n",       // extra field
+        "# only a comment\n",                        // no rules
+    };
+    for (auto &content : bad)
+    {
+        ASSERT_TRUE(WriteFile(dir.Path("bad"), content));
+        ScriptFilter rejected;
+        EXPECT_FALSE(rejected.Load(dir.Path("bad"))) << content;
+    }
+}
+
+TEST(ScriptFilterTest, MatchesArgsPrefixesOfEveryRuleLength)
+{
+    std::string a(32, 'a'), b(32, 'b');
+    ScriptFilter filter;
+    ASSERT_TRUE(filter.Add(SCRIPT_LOCK, a, 1, ""));
+    ASSERT_TRUE(filter.Add(SCRIPT_LOCK, b, 1, "\x01\x02"));
+    ASSERT_TRUE(filter.Add(SCRIPT_LOCK, b, 1, "\x05\x06\x07\x08"));
+    EXPECT_FALSE(filter.Add(SCRIPT_LOCK, b, 1, "\x01\x02"));
+    EXPECT_EQ(filter.Size(), 3u);
+
+    EXPECT_TRUE(filter.Match(SCRIPT_LOCK, Script(a, 1, "")));
+    EXPECT_TRUE(filter.Match(SCRIPT_LOCK, Script(a, 1, "\x09\x09\x09")));
+    EXPECT_TRUE(filter.Match(SCRIPT_LOCK, Script(b, 1, "\x01\x02")));
+    EXPECT_TRUE(filter.Match(SCRIPT_LOCK, Script(b, 1, "\x01\x02\x03\x04\x05")));
+    EXPECT_TRUE(filter.Match(SCRIPT_LOCK, Script(b, 1, "\x05\x06\x07\x08\x09")));
+    // shorter than the prefix, or equal to another rule's prefix only in part
+    EXPECT_FALSE(filter.Match(SCRIPT_LOCK, Script(b, 1, "\x01")));
+    EXPECT_FALSE(filter.Match(SCRIPT_LOCK, Script(b, 1, "\x05\x06\x07")));
+    EXPECT_FALSE(filter.Match(SCRIPT_LOCK, Script(b, 1, "\x01\x03\x07\x08")));
+    EXPECT_FALSE(filter.Match(SCRIPT_LOCK, Script(b, 1, "\x05\x06\x01\x02")));
+    // the code hash and hash type are part of every rule
+    EXPECT_FALSE(filter.Match(SCRIPT_LOCK, Script(b, 0, "\x01\x02")));
+    EXPECT_FALSE(filter.Match(SCRIPT_LOCK, Script(std::string(32, 'c'), 1, "\x01\x02")));
+}
+
+TEST(ScriptFilterTest, DistinguishesHashTypes)
+{
+    TestDir dir;
+    std::string content;
+    const std::vector<std::pair<char, std::string>> rules = {{'0', "data"}, {'1', "type"}, {'2', "data1"}, {'4', "data2"}};
+    for (auto &rule : rules)
+    {
+        content += "type " + Code(rule.first) + " " + rule.second + "\n";
+    }
+    ASSERT_TRUE(WriteFile(dir.Path("rules"), content));
+    ScriptFilter filter;
+    ASSERT_TRUE(filter.Load(dir.Path("rules")));
+    const uint8_t hash_types[] = {0, 1, 2, 4};
+    for (size_t i = 0; i < rules.size(); ++i)
+    {
+        for (size_t j = 0; j < 4; ++j)
+        {
+            EXPECT_EQ(filter.Match(SCRIPT_TYPE, Script(std::string(32, rules[i].first), hash_types[j], "")), i == j)
+                << rules[i].second << " " << (int)hash_types[j];
+        }
+    }
+}
+
+class FilterTransactionsTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        // Block 1 pays bob and alice, block 2 moves bob's cell to carol and pays alice again
+        first.outputs = {TestOutput(100, TestScript('b', "bob")), TestOutput(200, TestScript('a', "alice"))};
+        first.outputs_data = {"", ""};
+        second.inputs = {TestOutPoint(first.Hash(), 0)};
+        second.outputs = {TestOutput(100, TestScript('c', "carol"))};
+        second.outputs_data = {""};
+        third.outputs = {TestOutput(50, TestScript('a', "alice"))};
+        third.outputs_data = {""};
+        chain.AddBlock({});
+        chain.AddBlock({first});
+        chain.AddBlock({second, third});
+        ASSERT_TRUE(chain.Write(dir.Path("db")));
+    }
+
+    RawBlock Read(RocksDBReadOnly &db, uint64_t height)
+    {
+        RawBlock block;
+        rocksdb::Status status;
+        EXPECT_TRUE(ReadRawBlock(db, height, block, status));
+        return block;
+    }
+
+    TestTransaction first, second, third;
+    TestChain chain;
+    TestDir dir;
+};
+
+TEST_F(FilterTransactionsTest, ResolvesInputsAndKeepsPositions)
+{
+    rocksdb::Status status;
+    RocksDBReadOnly db(dir.Path("db"), status);
+    ASSERT_TRUE(status.ok());
+    ScriptFilter bob;
+    ASSERT_TRUE(bob.Add(SCRIPT_LOCK, std::string(32, 'b'), 1, "bob"));
+
+    // outputs only, nothing in block 2 pays bob
+    RawBlock block = Read(db, 2);
+    ASSERT_TRUE(FilterTransactions(bob, nullptr, block));
+    EXPECT_TRUE(block.transactions.empty());
+
+    // second spends bob's cell
+    block = Read(db, 2);
+    ASSERT_TRUE(FilterTransactions(bob, &db, block));
+    ASSERT_EQ(block.transactions.size(), 1u);
+    EXPECT_EQ(block.TransactionIndex(0), 1u);
+    EXPECT_NE(block.transactions[0].find(second.Hash()), std::string::npos);
+
+    // the genesis cellbase and dep group inputs spend nothing and are not looked up
+    block = Read(db, 0);
+    ASSERT_TRUE(FilterTransactions(bob, &db, block));
+    EXPECT_TRUE(block.transactions.empty());
+}
+
+TEST_F(FilterTransactionsTest, KeepsTheCellbaseAtIndexZero)
+{
+    rocksdb::Status status;
+    RocksDBReadOnly db(dir.Path("db"), status);
+    ASSERT_TRUE(status.ok());
+    ScriptFilter filter;
+    ASSERT_TRUE(filter.Add(SCRIPT_LOCK, std::string(32, 'm'), 1, ""));
+    ASSERT_TRUE(filter.Add(SCRIPT_LOCK, std::string(32, 'a'), 1, "alice"));
+
+    RawBlock block = Read(db, 2);
+    ASSERT_TRUE(FilterTransactions(filter, &db, block));
+    ASSERT_EQ(block.transactions.size(), 2u);
+    EXPECT_EQ(block.TransactionIndex(0), 0u);
+    EXPECT_EQ(block.TransactionIndex(1), 2u);
+    EXPECT_NE(block.transactions[1].find(third.Hash()), std::string::npos);
+
+    // filtering again maps through the positions already kept
+    ScriptFilter alice;
+    ASSERT_TRUE(alice.Add(SCRIPT_LOCK, std::string(32, 'a'), 1, "alice"));
+    ASSERT_TRUE(FilterTransactions(alice, &db, block));
+    ASSERT_EQ(block.transactions.size(), 1u);
+    EXPECT_EQ(block.TransactionIndex(0), 2u);
+
+    // every transaction kept leaves the positions implicit
+    block = Read(db, 1);
+    ASSERT_TRUE(FilterTransactions(filter, &db, block));
+    ASSERT_EQ(block.transactions.size(), 2u);
+    EXPECT_TRUE(block.transaction_indexes.empty());
+    EXPECT_EQ(block.TransactionIndex(1), 1u);
+}
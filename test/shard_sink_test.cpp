@@ -0,0 +1,75 @@
+#include "export/shard_sink.h"
+#include "test_chain.h"
+#include "utils/file_utils.h"
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+static std::string Record(uint64_t height)
+{
+    return "{\"height\":" + std::to_string(height) + "}\n";
+}
+
+TEST(ShardSinkTest, ResumeDropsWhatWasWrittenAfterTheCheckpoint)
+{
+    TestDir dir;
+    ShardOptions options;
+    options.prefix = dir.Path("blocks");
+    options.max_blocks = 2;
+    SinkPosition position;
+    {
+        ShardedFileSink sink(options);
+        for (uint64_t height = 0; height < 3; ++height)
+        {
+            ASSERT_TRUE(sink.Write(height, Record(height)));
+        }
+        ASSERT_TRUE(sink.Checkpoint(position));
+        position.end_height = 3;
+        // written after the checkpoint, then the process dies
+        for (uint64_t height = 3; height < 6; ++height)
+        {
+            ASSERT_TRUE(sink.Write(height, Record(height)));
+        }
+    }
+    EXPECT_EQ(position.file, ShardPath(options, 2));
+    ASSERT_EQ(0, access(ShardPath(options, 4).c_str(), F_OK));
+
+    ShardedFileSink sink(options);
+    ASSERT_TRUE(sink.Resume(position));
+    EXPECT_NE(0, access(ShardPath(options, 4).c_str(), F_OK));
+    EXPECT_NE(0, access((ShardPath(options, 4) + ".manifest.json").c_str(), F_OK));
+    ASSERT_TRUE(sink.Write(3, Record(3)));
+    ASSERT_TRUE(sink.Write(4, Record(4)));
+    ASSERT_TRUE(sink.Close());
+
+    std::string content;
+    ASSERT_TRUE(ReadFile(ShardPath(options, 0), content));
+    EXPECT_EQ(content, Record(0) + Record(1));
+    ASSERT_TRUE(ReadFile(ShardPath(options, 2), content));
+    EXPECT_EQ(content, Record(2) + Record(3));
+    ASSERT_TRUE(ReadFile(ShardPath(options, 4), content));
+    EXPECT_EQ(content, Record(4));
+    ASSERT_TRUE(ReadFile(ShardPath(options, 4) + ".manifest.json", content));
+    EXPECT_NE(content.find("\"offsets\":[0]"), std::string::npos);
+}
+
+TEST(ShardSinkTest, ResumeAtAShardBoundaryDropsLaterShards)
+{
+    TestDir dir;
+    ShardOptions options;
+    options.prefix = dir.Path("blocks");
+    options.max_blocks = 2;
+    SinkPosition position;
+    position.end_height = 2;
+    {
+        ShardedFileSink sink(options);
+        for (uint64_t height = 0; height < 4; ++height)
+        {
+            ASSERT_TRUE(sink.Write(height, Record(height)));
+        }
+    }
+
+    ShardedFileSink sink(options);
+    ASSERT_TRUE(sink.Resume(position));
+    EXPECT_EQ(0, access(ShardPath(options, 0).c_str(), F_OK));
+    EXPECT_NE(0, access(ShardPath(options, 2).c_str(), F_OK));
+}
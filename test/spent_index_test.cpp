@@ -0,0 +1,136 @@
+#include "index/spent_index.h"
+#include "test_chain.h"
+#include "utils/file_utils.h"
+#include <gtest/gtest.h>
+
+TEST(SpentIndexTest, FindsTheSpenderOfEveryInput)
+{
+    std::string lock = TestScript('a', "alice");
+    TestChain chain;
+    TestTransaction first;
+    first.outputs = {TestOutput(100, lock), TestOutput(200, lock), TestOutput(300, lock)};
+    first.outputs_data = {"", "", ""};
+    TestTransaction second;
+    second.inputs = {TestOutPoint(first.Hash(), 2), TestOutPoint(first.Hash(), 1)};
+    second.outputs = {TestOutput(500, lock)};
+    second.outputs_data = {""};
+    chain.AddBlock({});
+    chain.AddBlock({first});
+    chain.AddBlock({second});
+    TestDir dir;
+    ASSERT_TRUE(chain.Write(dir.Path("db")));
+    {
+        rocksdb::Status status;
+        RocksDBReadOnly db(dir.Path("db"), status);
+        ASSERT_TRUE(status.ok());
+        ASSERT_TRUE(UpdateSpentIndex(db, dir.Path("spent.idx"), 4));
+    }
+
+    TestTransaction third;
+    third.inputs = {TestOutPoint(first.Hash(), 0), TestOutPoint(second.Hash(), 0)};
+    third.outputs = {TestOutput(600, lock)};
+    third.outputs_data = {""};
+    chain.AddBlock({third});
+    ASSERT_TRUE(chain.Write(dir.Path("db")));
+    rocksdb::Status status;
+    RocksDBReadOnly db(dir.Path("db"), status);
+    ASSERT_TRUE(status.ok());
+    ASSERT_TRUE(UpdateSpentIndex(db, dir.Path("spent.idx"), 4));
+
+    SpentIndex index;
+    ASSERT_TRUE(index.Open(dir.Path("spent.idx")));
+    EXPECT_EQ(index.Runs().size(), 2u);
+    EXPECT_EQ(index.NextHeight(), 4u);
+    // Cellbase inputs and the null out point of the genesis dep group input spend nothing
+    EXPECT_EQ(index.Count(), 4u);
+
+    SpentBy spent;
+    EXPECT_FALSE(index.Find(TestOutPoint(std::string(32, '\0'), 0xffffffff), spent));
+    ASSERT_TRUE(index.Find(TestOutPoint(first.Hash(), 1), spent));
+    EXPECT_EQ(spent.tx_hash, second.Hash());
+    EXPECT_EQ(spent.height, 2u);
+    EXPECT_EQ(spent.input_index, 1u);
+    ASSERT_TRUE(index.Find(TestOutPoint(second.Hash(), 0), spent));
+    EXPECT_EQ(spent.tx_hash, third.Hash());
+    EXPECT_EQ(spent.height, 3u);
+    EXPECT_EQ(spent.input_index, 1u);
+    EXPECT_FALSE(index.Find(TestOutPoint(third.Hash(), 0), spent));
+
+    std::vector<std::string> out_points = {TestOutPoint(third.Hash(), 0), TestOutPoint(first.Hash(), 2), TestOutPoint(first.Hash(), 0)};
+    std::vector<SpentBy> spents;
+    std::vector<bool> found;
+    index.FindMany(out_points, spents, found);
+    ASSERT_EQ(found, std::vector<bool>({false, true, true}));
+    EXPECT_EQ(spents[1].tx_hash, second.Hash());
+    EXPECT_EQ(spents[1].input_index, 0u);
+    EXPECT_EQ(spents[2].tx_hash, third.Hash());
+    EXPECT_EQ(spents[2].height, 3u);
+}
+
+// Genesis and blocks 1 to blocks, block n spends the output of block n - 1. The last block pays
+// fork more, so two forks differ in their last block only.
+static TestChain SpendChain(uint64_t blocks, uint64_t fork, std::vector<std::string> &hashes)
+{
+    TestChain chain;
+    chain.AddBlock({});
+    hashes.clear();
+    for (uint64_t n = 1; n <= blocks; ++n)
+    {
+        TestTransaction tx;
+        if (n > 1)
+        {
+            tx.inputs = {TestOutPoint(hashes.back(), 0)};
+        }
+        tx.outputs = {TestOutput(n + (n == blocks ? fork : 0), TestScript('a', "alice"))};
+        tx.outputs_data = {""};
+        hashes.push_back(tx.Hash());
+        chain.AddBlock({tx});
+    }
+    return chain;
+}
+
+TEST(SpentIndexTest, CompactionKeepsTheNewestRunForTipReorgs)
+{
+    TestDir dir;
+    std::vector<std::string> hashes;
+    for (uint64_t blocks = 1; blocks <= 10; ++blocks)
+    {
+        ASSERT_TRUE(SpendChain(blocks, 0, hashes).Write(dir.Path("db")));
+        rocksdb::Status status;
+        RocksDBReadOnly db(dir.Path("db"), status);
+        ASSERT_TRUE(status.ok());
+        ASSERT_TRUE(UpdateSpentIndex(db, dir.Path("spent.idx"), 4));
+    }
+    SpentIndex index;
+    ASSERT_TRUE(index.Open(dir.Path("spent.idx")));
+    // the ninth run merged the eight before it, the newest of them stayed apart
+    ASSERT_EQ(index.Runs().size(), 3u);
+    EXPECT_EQ(index.Runs()[0].end, 9u);
+    EXPECT_EQ(index.Runs()[1].end, 10u);
+    uint64_t kept = index.Runs()[2].offset;
+    index.Close();
+    std::string before;
+    ASSERT_TRUE(ReadFile(dir.Path("spent.idx"), before));
+
+    // the tip is replaced, only the newest run is read again
+    std::vector<std::string> fork_hashes;
+    ASSERT_TRUE(SpendChain(10, 1000, fork_hashes).Write(dir.Path("db")));
+    rocksdb::Status status;
+    RocksDBReadOnly db(dir.Path("db"), status);
+    ASSERT_TRUE(status.ok());
+    ASSERT_TRUE(UpdateSpentIndex(db, dir.Path("spent.idx"), 4));
+    std::string after;
+    ASSERT_TRUE(ReadFile(dir.Path("spent.idx"), after));
+    EXPECT_EQ(after.substr(0, kept), before.substr(0, kept));
+
+    ASSERT_TRUE(index.Open(dir.Path("spent.idx")));
+    ASSERT_EQ(index.Runs().size(), 3u);
+    EXPECT_EQ(index.NextHeight(), 11u);
+    EXPECT_EQ(index.Count(), 9u);
+    SpentBy spent;
+    ASSERT_TRUE(index.Find(TestOutPoint(fork_hashes[8], 0), spent));
+    EXPECT_EQ(spent.tx_hash, fork_hashes[9]);
+    EXPECT_EQ(spent.height, 10u);
+    ASSERT_TRUE(index.Find(TestOutPoint(fork_hashes[0], 0), spent));
+    EXPECT_EQ(spent.height, 2u);
+}
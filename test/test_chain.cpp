@@ -0,0 +1,189 @@
+#include "test_chain.h"
+#include "db/columns.h"
+#include "db/raw_block.h"
+#include "utils/cbmt.h"
+#include "utils/crypto_utils.h"
+#include <endian.h>
+#include <filesystem>
+#include <stdlib.h>
+#include <string.h>
+
+std::string Le32(uint32_t value)
+{
+    value = htole32(value);
+    return std::string((char *)&value, sizeof(value));
+}
+
+std::string Le64(uint64_t value)
+{
+    value = htole64(value);
+    return std::string((char *)&value, sizeof(value));
+}
+
+std::string MolBytes(const std::string &data)
+{
+    return Le32(data.size()) + data;
+}
+
+std::string MolFixVec(const std::vector<std::string> &items)
+{
+    std::string out = Le32(items.size());
+    for (auto &item : items)
+    {
+        out += item;
+    }
+    return out;
+}
+
+std::string MolDynVec(const std::vector<std::string> &items)
+{
+    size_t size = 4 + 4 * items.size();
+    std::string offsets;
+    std::string body;
+    for (auto &item : items)
+    {
+        offsets += Le32(size + body.size());
+        body += item;
+    }
+    return Le32(size + body.size()) + offsets + body;
+}
+
+std::string MolTable(const std::vector<std::string> &fields)
+{
+    return MolDynVec(fields);
+}
+
+std::string TestScript(char code, const std::string &args, uint8_t hash_type)
+{
+    return MolTable({std::string(32, code), std::string(1, (char)hash_type), MolBytes(args)});
+}
+
+std::string TestOutput(uint64_t capacity, const std::string &lock, const std::string &type)
+{
+    return MolTable({Le64(capacity), lock, type});
+}
+
+std::string TestOutPoint(const std::string &tx_hash, uint32_t index)
+{
+    return tx_hash + Le32(index);
+}
+
+std::string TestTransaction::Raw() const
+{
+    std::string inputs_vec = Le32(inputs.size());
+    for (auto &input : inputs)
+    {
+        inputs_vec += Le64(since) + input;
+    }
+    std::vector<std::string> datas;
+    for (auto &data : outputs_data)
+    {
+        datas.push_back(MolBytes(data));
+    }
+    return MolTable({Le32(0), MolFixVec({}), MolFixVec(header_deps), inputs_vec, MolDynVec(outputs), MolDynVec(datas)});
+}
+
+std::string TestTransaction::Hash() const
+{
+    return Blake2b256(Raw());
+}
+
+std::string TestChain::AddBlock(const std::vector<TestTransaction> &txs, uint64_t epoch, const std::string &dao)
+{
+    uint64_t number = count_;
+    TestTransaction cellbase;
+    cellbase.since = number;
+    cellbase.inputs.push_back(std::string(32, '\0') + Le32(0xffffffff));
+    cellbase.outputs.push_back(TestOutput(1000, TestScript('m', "miner")));
+    cellbase.outputs_data.push_back("");
+    std::vector<TestTransaction> all(1, cellbase);
+    if (0 == number)
+    {
+        // The genesis dep group transaction, built with CellInput::new(OutPoint::null(), 0)
+        TestTransaction dep_group;
+        dep_group.inputs.push_back(std::string(32, '\0') + Le32(0xffffffff));
+        all.push_back(dep_group);
+    }
+    all.insert(all.end(), txs.begin(), txs.end());
+
+    std::vector<std::string> views, tx_hashes, witness_hashes;
+    for (auto &tx : all)
+    {
+        std::string transaction = MolTable({tx.Raw(), MolDynVec({})});
+        tx_hashes.push_back(tx.Hash());
+        witness_hashes.push_back(Blake2b256(transaction));
+        views.push_back(MolTable({tx_hashes.back(), witness_hashes.back(), transaction}));
+    }
+    std::string hashes, witnesses, root(32, '\0');
+    for (size_t i = 0; i < all.size(); ++i)
+    {
+        hashes += tx_hashes[i];
+        witnesses += witness_hashes[i];
+    }
+    std::vector<uint8_t> scratch;
+    CalcTransactionsRoot((const uint8_t *)hashes.data(), (const uint8_t *)witnesses.data(), all.size(), (uint8_t *)&root[0],
+                         scratch);
+
+    std::string parent = 0 == number ? std::string(32, '\0') : hashes_.back();
+    std::string header = Le32(0) + Le32(0x1e083126) + Le64(1600000000000ULL + number * 10000) + Le64(number) + Le64(epoch) + parent +
+                         root + std::string(32, '\0') + std::string(32, '\0') + dao + std::string(16, '\0');
+    std::string hash = Blake2b256(header);
+    hashes_.push_back(hash);
+    ++count_;
+
+    columns[COLUMN_INDEX][NumberKey(number)] = hash;
+    columns[COLUMN_BLOCK_HEADER][hash] = hash + header;
+    columns[COLUMN_BLOCK_UNCLE][hash] = MolTable({MolFixVec({}), MolDynVec({})});
+    columns[COLUMN_BLOCK_PROPOSAL_IDS][hash] = MolFixVec({});
+    columns[COLUMN_NUMBER_HASH][NumberKey(number) + hash] = Le32(all.size());
+    columns[COLUMN_META]["TIP_HEADER"] = hash;
+    for (uint32_t i = 0; i < all.size(); ++i)
+    {
+        uint32_t be_index = htobe32(i);
+        std::string key = hash + std::string((char *)&be_index, sizeof(be_index));
+        columns[COLUMN_BLOCK_BODY][key] = views[i];
+        columns[COLUMN_TRANSACTION_INFO][tx_hashes[i]] = Le64(number) + Le64(epoch) + key;
+        for (size_t j = 0; i > 0 && j < all[i].inputs.size(); ++j)
+        {
+            const std::string &input = all[i].inputs[j];
+            uint32_t index;
+            memcpy(&index, input.data() + 32, sizeof(index));
+            std::string cell_key = CellKey(std::string_view(input).substr(0, 32), le32toh(index));
+            cells_.erase(cell_key);
+            datas_.erase(cell_key);
+        }
+        for (uint32_t j = 0; j < all[i].outputs.size(); ++j)
+        {
+            const std::string &data = all[i].outputs_data[j];
+            std::string cell_key = CellKey(tx_hashes[i], j);
+            cells_[cell_key] = MolTable({all[i].outputs[j], hash, Le64(number), Le64(epoch), Le32(i), Le64(data.size())});
+            datas_[cell_key] = data.empty() ? "" : MolTable({MolBytes(data), Blake2b256(data)});
+        }
+    }
+    columns[COLUMN_CELL] = cells_;
+    columns[COLUMN_CELL_DATA] = datas_;
+    return hash;
+}
+
+std::string TestChain::BlockHash(uint64_t number) const
+{
+    return hashes_.at(number);
+}
+
+TestDir::TestDir()
+{
+    char path[] = "/tmp/parse_ckb_db_test_XXXXXX";
+    if (nullptr != mkdtemp(path))
+    {
+        path_ = path;
+    }
+}
+
+TestDir::~TestDir()
+{
+    if (!path_.empty())
+    {
+        std::error_code error;
+        std::filesystem::remove_all(path_, error);
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef _TEST_TEST_CHAIN_H_
+#define _TEST_TEST_CHAIN_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Molecule encoders for test values
+std::string Le32(uint32_t value);
+std::string Le64(uint64_t value);
+std::string MolBytes(const std::string &data);
+std::string MolFixVec(const std::vector<std::string> &items);
+std::string MolDynVec(const std::vector<std::string> &items);
+std::string MolTable(const std::vector<std::string> &fields);
+// Script with code_hash of 32 code bytes
+std::string TestScript(char code, const std::string &args, uint8_t hash_type = 1);
+// CellOutput, type is a packed Script or empty for none
+std::string TestOutput(uint64_t capacity, const std::string &lock, const std::string &type = "");
+// 36 byte molecule OutPoint, little endian index
+std::string TestOutPoint(const std::string &tx_hash, uint32_t index);
+
+struct TestTransaction
+{
+    std::vector<std::string> inputs; // OutPoints
+    uint64_t since = 0;              // of every input
+    std::vector<std::string> header_deps;
+    std::vector<std::string> outputs;      // CellOutputs
+    std::vector<std::string> outputs_data; // one per output, without the Bytes header
+
+    std::string Raw() const;
+    std::string Hash() const;
+};
+
+// A main chain stored the way a CKB node stores it: number keys, block body keys ending in a big
+// endian index, TransactionInfo, and the live cells in COLUMN_CELL and COLUMN_CELL_DATA under cell
+// keys that end in a big endian index.
+class TestChain
+{
+public:
+    // Appends a block with a cellbase in front of txs and returns its hash. The genesis block also
+    // gets a dep group transaction without outputs whose input is the null out point, as on a CKB
+    // chain, so its txs start at index 2. Inputs must spend live cells.
+    std::string AddBlock(const std::vector<TestTransaction> &txs, uint64_t epoch = 0, const std::string &dao = std::string(32, '\0'));
+    uint64_t Count() const { return count_; }
+    std::string BlockHash(uint64_t number) const;
+    // Writes every column family to a new rocksdb database at path, replacing what is there
+    bool Write(const std::string &path) const;
+
+    std::map<std::string, std::map<std::string, std::string>> columns; // column family, key, value
+
+private:
+    std::map<std::string, std::string> cells_; // cell key, CellEntry
+    std::map<std::string, std::string> datas_; // cell key, CellDataEntry or empty
+    std::vector<std::string> hashes_;
+    uint64_t count_ = 0;
+};
+
+// Directory under /tmp removed with its contents when the object goes
+class TestDir
+{
+public:
+    TestDir();
+    ~TestDir();
+    std::string Path(const std::string &name) const { return path_ + "/" + name; }
+
+private:
+    std::string path_;
+};
+
+#endif
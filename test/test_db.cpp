@@ -0,0 +1,47 @@
+#include "test_chain.h"
+#include <filesystem>
+#include <memory>
+#include <rocksdb/db.h>
+#include <rocksdb/write_batch.h>
+
+bool TestChain::Write(const std::string &path) const
+{
+    std::error_code error;
+    std::filesystem::remove_all(path, error);
+    rocksdb::Options options;
+    options.create_if_missing = true;
+    options.create_missing_column_families = true;
+    // CKB creates every column family up front, the readers look them up by name
+    std::vector<rocksdb::ColumnFamilyDescriptor> families;
+    families.emplace_back(rocksdb::kDefaultColumnFamilyName, rocksdb::ColumnFamilyOptions());
+    for (int i = 0; i <= 15; ++i)
+    {
+        families.emplace_back(std::to_string(i), rocksdb::ColumnFamilyOptions());
+    }
+    std::vector<rocksdb::ColumnFamilyHandle *> handles;
+    rocksdb::DB *db = nullptr;
+    if (!rocksdb::DB::Open(options, path, families, &handles, &db).ok())
+    {
+        return false;
+    }
+    rocksdb::WriteBatch batch;
+    for (size_t i = 1; i < families.size(); ++i)
+    {
+        auto it = columns.find(families[i].name);
+        if (columns.end() == it)
+        {
+            continue;
+        }
+        for (auto &item : it->second)
+        {
+            batch.Put(handles[i], item.first, item.second);
+        }
+    }
+    bool success = db->Write(rocksdb::WriteOptions(), &batch).ok();
+    for (auto handle : handles)
+    {
+        db->DestroyColumnFamilyHandle(handle);
+    }
+    delete db;
+    return success;
+}
@@ -0,0 +1,44 @@
+#include "index/tx_hash_index.h"
+#include "test_chain.h"
+#include <gtest/gtest.h>
+
+TEST(TxHashIndexTest, FindsTransactionsPastIndexZero)
+{
+    TestChain chain;
+    std::vector<std::string> hashes;
+    for (uint64_t number = 0; number < 4; ++number)
+    {
+        std::vector<TestTransaction> txs(3);
+        for (size_t i = 0; i < txs.size(); ++i)
+        {
+            txs[i].inputs.push_back(TestOutPoint(std::string(32, 'x'), number * 8 + i));
+            txs[i].outputs = {TestOutput(100 + i, TestScript('a', ""))};
+            txs[i].outputs_data = {""};
+            hashes.push_back(txs[i].Hash());
+        }
+        chain.AddBlock(txs);
+    }
+    TestDir dir;
+    ASSERT_TRUE(chain.Write(dir.Path("db")));
+    rocksdb::Status status;
+    RocksDBReadOnly db(dir.Path("db"), status);
+    ASSERT_TRUE(status.ok());
+    ASSERT_TRUE(BuildTxHashIndex(db, dir.Path("tx.idx"), 4));
+
+    TxHashIndex index;
+    ASSERT_TRUE(index.Open(dir.Path("tx.idx")));
+    // three transactions and the cellbase per block, and the genesis dep group transaction
+    EXPECT_EQ(index.Count(), 17u);
+    EXPECT_EQ(index.Tip(), 3u);
+    for (size_t i = 0; i < hashes.size(); ++i)
+    {
+        uint64_t number = 0;
+        uint32_t position = 0;
+        ASSERT_TRUE(index.Find(hashes[i], number, position));
+        EXPECT_EQ(number, i / 3);
+        EXPECT_EQ(position, i % 3 + (i < 3 ? 2 : 1));
+    }
+    uint64_t number = 0;
+    uint32_t position = 0;
+    EXPECT_FALSE(index.Find(std::string(32, 'y'), number, position));
+}
@@ -0,0 +1,101 @@
+#include "index/udt_holders.h"
+#include "test_chain.h"
+#include "utils/crypto_utils.h"
+#include "utils/file_utils.h"
+#include <gtest/gtest.h>
+
+static std::string Script(const std::string &code_hash_hex, uint8_t hash_type, const std::string &args)
+{
+    return MolTable({Hex2Bytes(code_hash_hex), std::string(1, (char)hash_type), MolBytes(args)});
+}
+
+// u128 little endian
+static std::string Amount(uint64_t high, uint64_t low)
+{
+    return Le64(low) + Le64(high);
+}
+
+static std::string Hash(const std::string &script)
+{
+    return Bytes2Hex(Blake2b256(script));
+}
+
+TEST(UdtHoldersTest, SumsHoldersAndSupplyPerToken)
+{
+    std::string sudt = Script("5e7a36a77e68eecc013dfa2fe6a23f3b6c344b04005808694ae6dd45eea4cfd5", 1, "owner");
+    std::string xudt = Script("50bd8d6680b8b9cf98b73f3c08faf8b2a21914311954118ad6609be6e78a1b95", 2, "owner");
+    std::string alice = TestScript('a', "alice"), bob = TestScript('b', "bob"), carol = TestScript('c', "carol");
+    TestTransaction tx;
+    tx.outputs = {TestOutput(100, alice, sudt), TestOutput(100, alice, sudt), TestOutput(100, bob, sudt),
+                  TestOutput(100, bob, xudt), TestOutput(100, carol, xudt), TestOutput(100, carol, sudt),
+                  TestOutput(100, carol, TestScript('t', "other")), TestOutput(100, carol)};
+    tx.outputs_data = {Amount(1, 5), Amount(0, 10), Amount(0, 7),
+                       Amount(UINT64_MAX, UINT64_MAX), Amount(0, 3) + "xudt extension", "short",
+                       Amount(0, 99), ""};
+    TestChain chain;
+    chain.AddBlock({});
+    chain.AddBlock({tx});
+    TestDir dir;
+    ASSERT_TRUE(chain.Write(dir.Path("db")));
+    rocksdb::Status status;
+    RocksDBReadOnly db(dir.Path("db"), status);
+    ASSERT_TRUE(status.ok());
+
+    ScriptFilter udts;
+    AddDefaultUdtScripts(udts);
+    std::vector<UdtHolding> holdings;
+    uint64_t invalid = 0;
+    ASSERT_TRUE(CollectUdtHoldings(db, udts, 4, holdings, invalid));
+    // carol's sUDT cell holds less than 16 bytes
+    EXPECT_EQ(invalid, 1u);
+    ASSERT_EQ(holdings.size(), 4u);
+    std::vector<std::string> rows;
+    for (auto &holding : holdings)
+    {
+        rows.push_back(Bytes2Hex(std::string(holding.token.data(), 32)) + "," + Bytes2Hex(std::string(holding.lock.data(), 32)) + "," +
+                       U128ToString(holding.amount) + "," + std::to_string(holding.cells));
+    }
+    // alice's two cells fold into one holding of 2^64 + 15, the larger holder comes first
+    std::vector<std::string> sudt_rows = {Hash(sudt) + "," + Hash(alice) + ",18446744073709551631,2",
+                                          Hash(sudt) + "," + Hash(bob) + ",7,1"};
+    std::vector<std::string> xudt_rows = {Hash(xudt) + "," + Hash(bob) + ",340282366920938463463374607431768211455,1",
+                                          Hash(xudt) + "," + Hash(carol) + ",3,1"};
+    // tokens come out grouped, in the order of their hashes
+    bool sudt_first = Bytes2Hex(std::string(holdings[0].token.data(), 32)) == Hash(sudt);
+    std::vector<std::string> expected = sudt_first ? sudt_rows : xudt_rows;
+    expected.insert(expected.end(), sudt_first ? xudt_rows.begin() : sudt_rows.begin(), sudt_first ? xudt_rows.end() : sudt_rows.end());
+    EXPECT_EQ(rows, expected);
+
+    std::vector<UdtSupply> supply;
+    SumUdtSupply(holdings, supply);
+    ASSERT_EQ(supply.size(), 2u);
+    for (auto &total : supply)
+    {
+        EXPECT_EQ(total.holders, 2u);
+        if (Blake2b256(sudt) == std::string(total.token.data(), 32))
+        {
+            EXPECT_EQ(total.cells, 3u);
+            EXPECT_EQ(U128ToString(total.amount), "18446744073709551638");
+        }
+        else
+        {
+            // bob holds the u128 maximum, the supply saturates
+            EXPECT_EQ(total.cells, 2u);
+            EXPECT_EQ(U128ToString(total.amount), "340282366920938463463374607431768211455");
+        }
+    }
+
+    ASSERT_TRUE(WriteUdtReports(dir.Path(""), holdings, supply));
+    std::string content;
+    ASSERT_TRUE(ReadFile(dir.Path("udt_holders.csv"), content));
+    std::string csv = "type_hash,lock_hash,amount,cells\n";
+    for (auto &row : expected)
+    {
+        csv += row + "\n";
+    }
+    EXPECT_EQ(content, csv);
+    ASSERT_TRUE(ReadFile(dir.Path("udt_supply.csv"), content));
+    EXPECT_NE(content.find(Hash(sudt) + ",2,3,18446744073709551638\n"), std::string::npos);
+    EXPECT_NE(content.find(Hash(xudt) + ",2,2,340282366920938463463374607431768211455\n"), std::string::npos);
+    EXPECT_EQ(U128ToString(0), "0");
+}
@@ -0,0 +1,45 @@
+#include "utils/varint.h"
+#include <gtest/gtest.h>
+
+TEST(VarintTest, RoundTripsAcrossByteBoundaries)
+{
+    std::vector<uint64_t> values = {0, 1, 0x7f, 0x80, 0x3fff, 0x4000, 1ULL << 35, UINT64_MAX};
+    std::string out;
+    for (auto value : values)
+    {
+        PutVarint64(out, value);
+    }
+    // 1 + 1 + 1 + 2 + 2 + 3 + 6 + 10 bytes
+    EXPECT_EQ(out.size(), 26u);
+    EXPECT_EQ(out.substr(3, 2), std::string("\x80\x01", 2));
+    const char *p = out.data();
+    for (auto value : values)
+    {
+        uint64_t decoded = 0;
+        ASSERT_TRUE(GetVarint64(p, out.data() + out.size(), decoded));
+        EXPECT_EQ(decoded, value);
+    }
+    EXPECT_EQ(p, out.data() + out.size());
+}
+
+TEST(VarintTest, RejectsTruncatedInput)
+{
+    std::string out;
+    PutVarint64(out, 1ULL << 40);
+    const char *p = out.data();
+    uint64_t value = 0;
+    EXPECT_FALSE(GetVarint64(p, out.data() + out.size() - 1, value));
+}
+
+TEST(ZigZagTest, SmallMagnitudesGetSmallCodes)
+{
+    EXPECT_EQ(ZigZagEncode(0), 0u);
+    EXPECT_EQ(ZigZagEncode(-1), 1u);
+    EXPECT_EQ(ZigZagEncode(1), 2u);
+    EXPECT_EQ(ZigZagEncode(-2), 3u);
+    EXPECT_EQ(ZigZagEncode(INT64_MIN), UINT64_MAX);
+    for (int64_t value : {0L, 1L, -1L, 63L, -64L, INT64_MAX, INT64_MIN})
+    {
+        EXPECT_EQ(ZigZagDecode(ZigZagEncode(value)), value);
+    }
+}
@@ -0,0 +1,82 @@
+#include "test_chain.h"
+#include "utils/file_utils.h"
+#include "utils/vectored_writer.h"
+#include <gtest/gtest.h>
+
+// Appends pieces of varying size, some larger than a buffer, and returns what was appended
+static std::string AppendPieces(VectoredWriter &writer, size_t pieces, char first)
+{
+    std::string expected;
+    for (size_t i = 0; i < pieces; ++i)
+    {
+        std::string piece((i * 997) % 9000 + 1, (char)(first + i % 26));
+        EXPECT_TRUE(writer.Append(piece.data(), piece.size()));
+        expected += piece;
+    }
+    return expected;
+}
+
+TEST(VectoredWriterTest, KeepsAppendOrderAcrossBuffers)
+{
+    TestDir dir;
+    WriterOptions options;
+    options.buffer_bytes = 4096;
+    options.max_pending = 2;
+    VectoredWriter writer(options);
+    ASSERT_TRUE(writer.Open(dir.Path("out"), false));
+    std::string expected = AppendPieces(writer, 200, 'a');
+    ASSERT_TRUE(writer.Flush(false));
+    std::string content;
+    ASSERT_TRUE(ReadFile(dir.Path("out"), content));
+    EXPECT_EQ(content, expected);
+    expected += AppendPieces(writer, 50, 'A');
+    ASSERT_TRUE(writer.Close());
+    EXPECT_EQ(writer.Size(), expected.size());
+    ASSERT_TRUE(ReadFile(dir.Path("out"), content));
+    EXPECT_EQ(content, expected);
+}
+
+TEST(VectoredWriterTest, AppendContinuesAtTheEnd)
+{
+    TestDir dir;
+    ASSERT_TRUE(WriteFile(dir.Path("out"), "head"));
+    VectoredWriter writer;
+    ASSERT_TRUE(writer.Open(dir.Path("out"), true));
+    ASSERT_TRUE(writer.Append("tail", 4));
+    ASSERT_TRUE(writer.Close());
+    std::string content;
+    ASSERT_TRUE(ReadFile(dir.Path("out"), content));
+    EXPECT_EQ(content, "headtail");
+}
+
+TEST(VectoredWriterTest, DirectIoWritesAnUnalignedTail)
+{
+    TestDir dir;
+    WriterOptions options;
+    options.buffer_bytes = 8192;
+    options.direct = true;
+    options.preallocate_bytes = 1 << 16;
+    options.fsync = FSYNC_CLOSE;
+    VectoredWriter writer(options);
+    ASSERT_TRUE(writer.Open(dir.Path("out"), false));
+    std::string expected = AppendPieces(writer, 30, 'a');
+    ASSERT_TRUE(writer.Close());
+    std::string content;
+    ASSERT_TRUE(ReadFile(dir.Path("out"), content));
+    EXPECT_EQ(content, expected);
+}
+
+TEST(VectoredWriterTest, ParsesFsyncPolicies)
+{
+    WriterOptions options;
+    EXPECT_TRUE(ParseFsyncPolicy("close", options));
+    EXPECT_EQ(options.fsync, FSYNC_CLOSE);
+    EXPECT_TRUE(ParseFsyncPolicy("1048576", options));
+    EXPECT_EQ(options.fsync, FSYNC_INTERVAL);
+    EXPECT_EQ(options.fsync_interval_bytes, 1048576u);
+    EXPECT_TRUE(ParseFsyncPolicy("none", options));
+    EXPECT_EQ(options.fsync, FSYNC_NONE);
+    EXPECT_FALSE(ParseFsyncPolicy("always", options));
+    EXPECT_FALSE(ParseFsyncPolicy("", options));
+    EXPECT_FALSE(ParseFsyncPolicy("99999999999999999999999", options));
+}
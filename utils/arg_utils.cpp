@@ -0,0 +1,61 @@
+#include "arg_utils.h"
+#include <errno.h>
+#include <stdlib.h>
+
+void ParseArgs(int argc, char **argv, std::vector<std::string> &positional, std::map<std::string, std::string> &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg(argv[i]);
+        if (arg.size() <= 2 || arg.compare(0, 2, "--") != 0)
+        {
+            positional.push_back(arg);
+            continue;
+        }
+        size_t pos = arg.find('=');
+        if (std::string::npos == pos)
+        {
+            options[arg.substr(2)] = "";
+        }
+        else
+        {
+            options[arg.substr(2, pos - 2)] = arg.substr(pos + 1);
+        }
+    }
+}
+
+std::string GetOption(const std::map<std::string, std::string> &options, const std::string &key, const std::string &default_value)
+{
+    auto it = options.find(key);
+    if (options.end() == it)
+    {
+        return default_value;
+    }
+    return it->second;
+}
+
+uint64_t GetOptionNumber(const std::map<std::string, std::string> &options, const std::string &key, uint64_t default_value)
+{
+    auto it = options.find(key);
+    if (options.end() == it || it->second.empty())
+    {
+        return default_value;
+    }
+    return strtoull(it->second.c_str(), nullptr, 0);
+}
+
+bool HasOption(const std::map<std::string, std::string> &options, const std::string &key)
+{
+    return options.end() != options.find(key);
+}
+
+bool ParseDecimal(const std::string &text, uint64_t &value)
+{
+    if (text.empty() || std::string::npos != text.find_first_not_of("0123456789"))
+    {
+        return false;
+    }
+    errno = 0;
+    value = strtoull(text.c_str(), nullptr, 10);
+    return 0 == errno;
+}
@@ -0,0 +1,17 @@
+#ifndef _UTILS_ARG_UTILS_H_
+#define _UTILS_ARG_UTILS_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+// "--key=value" and "--flag" go to options, everything else to positional
+void ParseArgs(int argc, char **argv, std::vector<std::string> &positional, std::map<std::string, std::string> &options);
+
+std::string GetOption(const std::map<std::string, std::string> &options, const std::string &key, const std::string &default_value = "");
+uint64_t GetOptionNumber(const std::map<std::string, std::string> &options, const std::string &key, uint64_t default_value);
+bool HasOption(const std::map<std::string, std::string> &options, const std::string &key);
+// A decimal u64, without the sign, space or overflow strtoull lets through
+bool ParseDecimal(const std::string &text, uint64_t &value);
+
+#endif
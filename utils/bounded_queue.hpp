@@ -0,0 +1,161 @@
+#ifndef _UTILS_BOUNDED_QUEUE_HPP_
+#define _UTILS_BOUNDED_QUEUE_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+// Lock-free multi producer multi consumer ring (Dmitry Vyukov's bounded queue).
+// Push/Pop back off by spinning, yielding and finally sleeping when the ring is full or empty,
+// and fail once the queue is closed (Pop still drains what was pushed before Close).
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+        mask_ = size - 1;
+        buffer_.reset(new Cell[size]);
+        for (size_t i = 0; i < size; ++i)
+        {
+            buffer_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueue_pos_.store(0, std::memory_order_relaxed);
+        dequeue_pos_.store(0, std::memory_order_relaxed);
+        closed_.store(false, std::memory_order_relaxed);
+    }
+
+    bool TryPush(T &value)
+    {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Cell *cell;
+        while (true)
+        {
+            cell = &buffer_[pos & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+            if (0 == diff)
+            {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPop(T &value)
+    {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Cell *cell;
+        while (true)
+        {
+            cell = &buffer_[pos & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+            if (0 == diff)
+            {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->data);
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Push(T value)
+    {
+        for (uint32_t spins = 0; !closed_.load(std::memory_order_acquire); ++spins)
+        {
+            if (TryPush(value))
+            {
+                return true;
+            }
+            Backoff(spins);
+        }
+        return false;
+    }
+
+    bool Pop(T &value)
+    {
+        for (uint32_t spins = 0;; ++spins)
+        {
+            if (TryPop(value))
+            {
+                return true;
+            }
+            if (closed_.load(std::memory_order_acquire))
+            {
+                return TryPop(value);
+            }
+            Backoff(spins);
+        }
+    }
+
+    void Close() { closed_.store(true, std::memory_order_release); }
+    bool IsClosed() const { return closed_.load(std::memory_order_acquire); }
+    size_t Capacity() const { return mask_ + 1; }
+    size_t Size() const
+    {
+        size_t enqueue = enqueue_pos_.load(std::memory_order_relaxed);
+        size_t dequeue = dequeue_pos_.load(std::memory_order_relaxed);
+        return enqueue > dequeue ? enqueue - dequeue : 0;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    static void Backoff(uint32_t spins)
+    {
+        if (spins < 64)
+        {
+            return;
+        }
+        if (spins < 128)
+        {
+            std::this_thread::yield();
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+
+    std::unique_ptr<Cell[]> buffer_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> enqueue_pos_;
+    alignas(64) std::atomic<size_t> dequeue_pos_;
+    alignas(64) std::atomic<bool> closed_;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#include "cbmt.h"
+#include "utils/crypto_utils.h"
+#include <string.h>
+
+void CbmtMerge(const uint8_t *left, const uint8_t *right, uint8_t *out)
+{
+    thread_local Blake2b256Hasher hasher;
+    hasher.Update(left, CKB_HASH_SIZE);
+    hasher.Update(right, CKB_HASH_SIZE);
+    hasher.Final(out);
+}
+
+void CbmtRoot(const uint8_t *leaves, size_t count, uint8_t *root, std::vector<uint8_t> &scratch)
+{
+    if (0 == count)
+    {
+        memset(root, 0, CKB_HASH_SIZE);
+        return;
+    }
+    if (1 == count)
+    {
+        memcpy(root, leaves, CKB_HASH_SIZE);
+        return;
+    }
+    // nodes are laid out as an array T of 2n-1 entries, T[i] = merge(T[2i+1], T[2i+2]) and
+    // T[n-1+i] = leaves[i]; only the n-1 inner nodes are stored in scratch
+    size_t inner = count - 1;
+    if (scratch.size() < inner * CKB_HASH_SIZE)
+    {
+        scratch.resize(inner * CKB_HASH_SIZE);
+    }
+    auto node = [&](size_t index) -> const uint8_t *
+    {
+        if (index >= inner)
+        {
+            return leaves + (index - inner) * CKB_HASH_SIZE;
+        }
+        return scratch.data() + index * CKB_HASH_SIZE;
+    };
+    for (size_t i = inner; i-- > 0;)
+    {
+        CbmtMerge(node(2 * i + 1), node(2 * i + 2), scratch.data() + i * CKB_HASH_SIZE);
+    }
+    memcpy(root, scratch.data(), CKB_HASH_SIZE);
+}
+
+void CalcTransactionsRoot(const uint8_t *tx_hashes, const uint8_t *witness_hashes, size_t count, uint8_t *root, std::vector<uint8_t> &scratch)
+{
+    uint8_t raw_root[CKB_HASH_SIZE];
+    uint8_t witness_root[CKB_HASH_SIZE];
+    CbmtRoot(tx_hashes, count, raw_root, scratch);
+    CbmtRoot(witness_hashes, count, witness_root, scratch);
+    CbmtMerge(raw_root, witness_root, root);
+}
@@ -0,0 +1,16 @@
+#ifndef _UTILS_CBMT_H_
+#define _UTILS_CBMT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Complete binary merkle tree (CKB RFC 0006) over 32 bytes hashes merged with ckb-default-hash.
+// leaves are count contiguous hashes; scratch is reused between calls so a warmed up caller never allocates.
+void CbmtMerge(const uint8_t *left, const uint8_t *right, uint8_t *out);
+void CbmtRoot(const uint8_t *leaves, size_t count, uint8_t *root, std::vector<uint8_t> &scratch);
+
+// transactions_root = merge(cbmt(tx_hashes), cbmt(witness_hashes))
+void CalcTransactionsRoot(const uint8_t *tx_hashes, const uint8_t *witness_hashes, size_t count, uint8_t *root, std::vector<uint8_t> &scratch);
+
+#endif
@@ -0,0 +1,190 @@
+#include "compress_utils.h"
+#include "log/logging.h"
+#include <algorithm>
+#include <zlib.h>
+#ifdef WITH_ZSTD
+#include <zstd.h>
+#endif
+
+bool ParseCompressType(const std::string &name, CompressType &type)
+{
+    if (name.empty() || "none" == name)
+    {
+        type = COMPRESS_NONE;
+        return true;
+    }
+    if ("gzip" == name)
+    {
+        type = COMPRESS_GZIP;
+        return true;
+    }
+#ifdef WITH_ZSTD
+    if ("zstd" == name)
+    {
+        type = COMPRESS_ZSTD;
+        return true;
+    }
+#endif
+    return false;
+}
+
+std::string CompressSuffix(CompressType type)
+{
+    switch (type)
+    {
+    case COMPRESS_GZIP:
+        return ".gz";
+    case COMPRESS_ZSTD:
+        return ".zst";
+    default:
+        return "";
+    }
+}
+
+int DefaultCompressLevel(CompressType type)
+{
+    return COMPRESS_ZSTD == type ? 3 : 6;
+}
+
+// zlib counts avail_in and avail_out in 32 bits, larger buffers are fed in pieces of this size
+static const size_t ZLIB_CHUNK = 1 << 30;
+
+static bool GzipFrame(int level, const std::string &input, std::string &output)
+{
+    z_stream stream = {};
+    // 16 + MAX_WBITS writes a gzip header and trailer instead of a zlib one
+    if (Z_OK != deflateInit2(&stream, level, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY))
+    {
+        ERRORLOG("deflateInit2 failed");
+        return false;
+    }
+    output.resize(deflateBound(&stream, input.size()) + 32);
+    size_t in = 0, out = 0;
+    int ret = Z_OK;
+    while (Z_OK == ret)
+    {
+        size_t in_chunk = std::min(input.size() - in, ZLIB_CHUNK);
+        size_t out_chunk = std::min(output.size() - out, ZLIB_CHUNK);
+        stream.next_in = (Bytef *)input.data() + in;
+        stream.avail_in = in_chunk;
+        stream.next_out = (Bytef *)&output[out];
+        stream.avail_out = out_chunk;
+        ret = deflate(&stream, in + in_chunk == input.size() ? Z_FINISH : Z_NO_FLUSH);
+        in += in_chunk - stream.avail_in;
+        out += out_chunk - stream.avail_out;
+    }
+    output.resize(out);
+    deflateEnd(&stream);
+    if (Z_STREAM_END != ret)
+    {
+        ERRORLOG("deflate failed:{}", ret);
+        return false;
+    }
+    return true;
+}
+
+static bool GunzipFrames(const std::string &input, std::string &output)
+{
+    output.clear();
+    size_t offset = 0;
+    char buffer[64 * 1024];
+    while (offset < input.size())
+    {
+        z_stream stream = {};
+        if (Z_OK != inflateInit2(&stream, 16 + MAX_WBITS))
+        {
+            return false;
+        }
+        size_t in = offset;
+        int ret = Z_OK;
+        while (Z_OK == ret)
+        {
+            if (0 == stream.avail_in)
+            {
+                stream.next_in = (Bytef *)input.data() + in;
+                stream.avail_in = std::min(input.size() - in, ZLIB_CHUNK);
+                in += stream.avail_in;
+            }
+            stream.next_out = (Bytef *)buffer;
+            stream.avail_out = sizeof(buffer);
+            ret = inflate(&stream, Z_NO_FLUSH);
+            output.append(buffer, sizeof(buffer) - stream.avail_out);
+        }
+        offset = in - stream.avail_in;
+        inflateEnd(&stream);
+        if (Z_STREAM_END != ret)
+        {
+            ERRORLOG("inflate failed:{}", ret);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CompressFrame(CompressType type, int level, const std::string &input, std::string &output)
+{
+    switch (type)
+    {
+    case COMPRESS_NONE:
+        output = input;
+        return true;
+    case COMPRESS_GZIP:
+        return GzipFrame(level, input, output);
+#ifdef WITH_ZSTD
+    case COMPRESS_ZSTD:
+    {
+        output.resize(ZSTD_compressBound(input.size()));
+        size_t size = ZSTD_compress(&output[0], output.size(), input.data(), input.size(), level);
+        if (ZSTD_isError(size))
+        {
+            ERRORLOG("ZSTD_compress failed:{}", ZSTD_getErrorName(size));
+            return false;
+        }
+        output.resize(size);
+        return true;
+    }
+#endif
+    default:
+        return false;
+    }
+}
+
+bool DecompressFrames(CompressType type, const std::string &input, std::string &output)
+{
+    switch (type)
+    {
+    case COMPRESS_NONE:
+        output = input;
+        return true;
+    case COMPRESS_GZIP:
+        return GunzipFrames(input, output);
+#ifdef WITH_ZSTD
+    case COMPRESS_ZSTD:
+    {
+        output.clear();
+        size_t offset = 0;
+        while (offset < input.size())
+        {
+            size_t frame_size = ZSTD_findFrameCompressedSize(input.data() + offset, input.size() - offset);
+            unsigned long long content_size = ZSTD_getFrameContentSize(input.data() + offset, frame_size);
+            if (ZSTD_isError(frame_size) || ZSTD_CONTENTSIZE_ERROR == content_size || ZSTD_CONTENTSIZE_UNKNOWN == content_size)
+            {
+                return false;
+            }
+            size_t old_size = output.size();
+            output.resize(old_size + content_size);
+            size_t size = ZSTD_decompress(&output[old_size], content_size, input.data() + offset, frame_size);
+            if (ZSTD_isError(size))
+            {
+                return false;
+            }
+            output.resize(old_size + size);
+            offset += frame_size;
+        }
+        return true;
+    }
+#endif
+    default:
+        return false;
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef _UTILS_COMPRESS_UTILS_H_
+#define _UTILS_COMPRESS_UTILS_H_
+
+#include <string>
+
+enum CompressType
+{
+    COMPRESS_NONE = 0,
+    COMPRESS_GZIP,
+    COMPRESS_ZSTD,
+};
+
+bool ParseCompressType(const std::string &name, CompressType &type);
+std::string CompressSuffix(CompressType type);
+int DefaultCompressLevel(CompressType type);
+
+// Compresses input into one self-contained gzip member or zstd frame, so that frames can be
+// concatenated into a valid stream and each one decompressed on its own
+bool CompressFrame(CompressType type, int level, const std::string &input, std::string &output);
+bool DecompressFrames(CompressType type, const std::string &input, std::string &output);
+
+#endif
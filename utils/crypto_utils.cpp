@@ -127,3 +127,41 @@ std::string GetRipemd160Hash(const std::string &bytes, bool to_uppercase)
     hashfilter.MessageEnd();
     return hash;
 }
+
+static const char CKB_HASH_PERSONALIZATION[] = "ckb-default-hash";
+
+Blake2b256Hasher::Blake2b256Hasher()
+    : hasher_(nullptr, 0, nullptr, 0, (const CryptoPP::byte *)CKB_HASH_PERSONALIZATION, sizeof(CKB_HASH_PERSONALIZATION) - 1, false, CKB_HASH_SIZE)
+{
+}
+
+void Blake2b256Hasher::Update(const void *data, size_t size)
+{
+    hasher_.Update((const CryptoPP::byte *)data, size);
+}
+
+void Blake2b256Hasher::Final(uint8_t *out)
+{
+    // Final() also restarts the hasher, so it can be reused for the next message
+    hasher_.Final(out);
+}
+
+void Blake2b256(const void *data, size_t size, uint8_t *out)
+{
+    // CryptoPP picks the SSE4.1/NEON compression function at runtime
+    thread_local Blake2b256Hasher hasher;
+    hasher.Update(data, size);
+    hasher.Final(out);
+}
+
+std::string Blake2b256(std::string_view bytes)
+{
+    std::string hash(CKB_HASH_SIZE, '\0');
+    Blake2b256(bytes.data(), bytes.size(), (uint8_t *)hash.data());
+    return hash;
+}
+
+std::string GetBlake2b256Hash(const std::string &bytes, bool to_uppercase)
+{
+    return Bytes2Hex(Blake2b256(bytes), to_uppercase);
+}
@@ -1,9 +1,11 @@
 #ifndef _UTILS_CRYPTO_UTILS_H__
 #define _UTILS_CRYPTO_UTILS_H__
 
+#include <cryptopp/blake2.h>
 #include <cryptopp/eccrypto.h>
 #include <cryptopp/sha.h>
 #include <string>
+#include <string_view>
 
 std::string Bytes2Hex(const std::string &bytes, bool to_uppercase = false);
 std::string Hex2Bytes(const std::string &hex);
@@ -19,4 +21,21 @@ std::string GetSha1Hash(const std::string &bytes, bool to_uppercase = false);
 std::string GetSha256Hash(const std::string &bytes, bool to_uppercase = false);
 std::string GetRipemd160Hash(const std::string &bytes, bool to_uppercase = false);
 
+// ckb-default-hash: blake2b with a 32 bytes digest and "ckb-default-hash" personalization
+const size_t CKB_HASH_SIZE = 32;
+std::string GetBlake2b256Hash(const std::string &bytes, bool to_uppercase = false);
+std::string Blake2b256(std::string_view bytes);
+void Blake2b256(const void *data, size_t size, uint8_t *out);
+
+class Blake2b256Hasher
+{
+public:
+    Blake2b256Hasher();
+    void Update(const void *data, size_t size);
+    void Final(uint8_t *out);
+
+private:
+    CryptoPP::BLAKE2b hasher_;
+};
+
 #endif
@@ -0,0 +1,91 @@
+#include "file_utils.h"
+#include "log/logging.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <fstream>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static bool WriteAll(int fd, const std::string &path, const std::string &content)
+{
+    size_t written = 0;
+    while (written < content.size())
+    {
+        ssize_t ret = write(fd, content.data() + written, content.size() - written);
+        if (ret < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            ERRORLOG("write {} failed", path);
+            return false;
+        }
+        written += ret;
+    }
+    return true;
+}
+
+bool WriteFile(const std::string &path, const std::string &content)
+{
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        ERRORLOG("open {} failed", path);
+        return false;
+    }
+    bool success = WriteAll(fd, path, content);
+    if (0 != close(fd))
+    {
+        ERRORLOG("close {} failed", path);
+        success = false;
+    }
+    return success;
+}
+
+bool WriteFileAtomic(const std::string &path, const std::string &content, const std::string &tmp_suffix)
+{
+    std::string tmp_path = path + tmp_suffix;
+    int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        ERRORLOG("open {} failed", tmp_path);
+        return false;
+    }
+    if (!WriteAll(fd, tmp_path, content))
+    {
+        close(fd);
+        return false;
+    }
+    if (0 != fsync(fd))
+    {
+        ERRORLOG("fsync {} failed", tmp_path);
+        close(fd);
+        return false;
+    }
+    close(fd);
+    if (0 != rename(tmp_path.c_str(), path.c_str()))
+    {
+        ERRORLOG("rename {} to {} failed", tmp_path, path);
+        return false;
+    }
+    return true;
+}
+
+bool ReadFile(const std::string &path, std::string &content)
+{
+    std::ifstream fin(path, std::ios::binary);
+    if (!fin.is_open())
+    {
+        return false;
+    }
+    content.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+    return !fin.bad();
+}
+
+bool FileExists(const std::string &path)
+{
+    struct stat st;
+    return 0 == stat(path.c_str(), &st);
+}
@@ -0,0 +1,14 @@
+#ifndef _UTILS_FILE_UTILS_H_
+#define _UTILS_FILE_UTILS_H_
+
+#include <string>
+
+// Writes to "<path><tmp_suffix>", syncs it and renames it over path, so readers see the old or
+// the new content but never a partial one. Writers racing on one path need distinct suffixes.
+bool WriteFileAtomic(const std::string &path, const std::string &content, const std::string &tmp_suffix = ".tmp");
+// Plain open/write/close, no stream buffers for small one shot files
+bool WriteFile(const std::string &path, const std::string &content);
+bool ReadFile(const std::string &path, std::string &content);
+bool FileExists(const std::string &path);
+
+#endif
@@ -0,0 +1,65 @@
+#include "mmap_file.h"
+#include "log/logging.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MmapFile::~MmapFile()
+{
+    Close();
+}
+
+bool MmapFile::Open(const std::string &path)
+{
+    Close();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        ERRORLOG("open {} failed", path);
+        return false;
+    }
+    struct stat st;
+    if (0 != fstat(fd, &st))
+    {
+        ERRORLOG("stat {} failed", path);
+        close(fd);
+        return false;
+    }
+    size_ = st.st_size;
+    // mmap rejects zero length mappings, an empty file is simply an empty view
+    if (size_ > 0)
+    {
+        void *data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        if (MAP_FAILED == data)
+        {
+            ERRORLOG("mmap {} failed", path);
+            close(fd);
+            size_ = 0;
+            return false;
+        }
+        data_ = (const char *)data;
+    }
+    close(fd);
+    is_open_ = true;
+    return true;
+}
+
+void MmapFile::Close()
+{
+    if (nullptr != data_)
+    {
+        munmap((void *)data_, size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    is_open_ = false;
+}
+
+void MmapFile::Advise(int advice) const
+{
+    if (nullptr != data_)
+    {
+        madvise((void *)data_, size_, advice);
+    }
+}
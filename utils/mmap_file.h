@@ -0,0 +1,32 @@
+#ifndef _UTILS_MMAP_FILE_H_
+#define _UTILS_MMAP_FILE_H_
+
+#include <string>
+#include <string_view>
+
+// Read only mapping of a whole file
+class MmapFile
+{
+public:
+    MmapFile() = default;
+    ~MmapFile();
+    bool Open(const std::string &path);
+    void Close();
+    // Forwards to madvise, e.g. MADV_SEQUENTIAL before a full scan
+    void Advise(int advice) const;
+
+    const char *Data() const { return data_; }
+    size_t Size() const { return size_; }
+    std::string_view View() const { return std::string_view(data_, size_); }
+    bool IsOpen() const { return is_open_; }
+
+private:
+    MmapFile(const MmapFile &) = delete;
+    MmapFile &operator=(const MmapFile &) = delete;
+
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+    bool is_open_ = false;
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef _UTILS_PARALLEL_FOR_HPP_
+#define _UTILS_PARALLEL_FOR_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+inline uint32_t DefaultThreadCount()
+{
+    uint32_t count = std::thread::hardware_concurrency();
+    return 0 == count ? 1 : count;
+}
+
+// Splits [start, end) into batches that threads claim from a shared cursor.
+// func(begin, end, worker) returns false to stop every worker.
+template <typename Func>
+bool ParallelFor(uint64_t start, uint64_t end, uint64_t batch, uint32_t threads, Func func)
+{
+    if (start >= end)
+    {
+        return true;
+    }
+    batch = std::max<uint64_t>(batch, 1);
+    threads = std::max<uint32_t>(std::min<uint64_t>(threads, (end - start + batch - 1) / batch), 1);
+    std::atomic<uint64_t> cursor(start);
+    std::atomic<bool> success(true);
+    auto worker = [&](uint32_t index)
+    {
+        while (success.load(std::memory_order_relaxed))
+        {
+            uint64_t begin = cursor.fetch_add(batch);
+            if (begin >= end)
+            {
+                break;
+            }
+            if (!func(begin, std::min(begin + batch, end), index))
+            {
+                success = false;
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (uint32_t i = 1; i < threads; ++i)
+    {
+        workers.emplace_back(worker, i);
+    }
+    worker(0);
+    for (auto &thread : workers)
+    {
+        thread.join();
+    }
+    return success;
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef _UTILS_THREAD_POOL_HPP_
+#define _UTILS_THREAD_POOL_HPP_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    explicit ThreadPool(uint32_t threads) : stop_(false)
+    {
+        for (uint32_t i = 0; i < std::max<uint32_t>(threads, 1); ++i)
+        {
+            threads_.emplace_back(&ThreadPool::Work, this);
+        }
+    }
+
+    // Runs the queued tasks to completion before joining
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto &thread : threads_)
+        {
+            thread.join();
+        }
+    }
+
+    template <typename Func>
+    auto Submit(Func func) -> std::future<decltype(func())>
+    {
+        auto task = std::make_shared<std::packaged_task<decltype(func())()>>(std::move(func));
+        auto future = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.emplace_back([task]()
+                                { (*task)(); });
+        }
+        cv_.notify_one();
+        return future;
+    }
+
+    size_t Size() const { return threads_.size(); }
+
+private:
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void Work()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this]()
+                         { return stop_ || !tasks_.empty(); });
+                if (tasks_.empty())
+                {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> tasks_;
+    std::vector<std::thread> threads_;
+    bool stop_;
+};
+
+#endif
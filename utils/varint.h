@@ -0,0 +1,44 @@
+#ifndef _UTILS_VARINT_H_
+#define _UTILS_VARINT_H_
+
+#include <stdint.h>
+#include <string>
+
+// LEB128 style unsigned varint, 7 bits per byte
+inline void PutVarint64(std::string &out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+}
+
+inline bool GetVarint64(const char *&p, const char *end, uint64_t &value)
+{
+    value = 0;
+    for (uint32_t shift = 0; shift < 64 && p < end; shift += 7)
+    {
+        uint64_t byte = (uint8_t)*p++;
+        value |= (byte & 0x7f) << shift;
+        if (0 == (byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Maps small negative deltas to small unsigned values
+inline uint64_t ZigZagEncode(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+inline int64_t ZigZagDecode(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+#endif
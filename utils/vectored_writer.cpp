@@ -0,0 +1,385 @@
+#include "vectored_writer.h"
+#include "log/logging.h"
+#include "utils/arg_utils.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// O_DIRECT needs buffer addresses, lengths and offsets aligned to the logical block size
+static const size_t DIRECT_ALIGNMENT = 4096;
+
+bool ParseFsyncPolicy(const std::string &value, WriterOptions &options)
+{
+    if ("none" == value)
+    {
+        options.fsync = FSYNC_NONE;
+    }
+    else if ("close" == value)
+    {
+        options.fsync = FSYNC_CLOSE;
+    }
+    else if (ParseDecimal(value, options.fsync_interval_bytes))
+    {
+        options.fsync = FSYNC_INTERVAL;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+VectoredWriter::VectoredWriter(const WriterOptions &options)
+    : options_(options), fd_(-1), capacity_(0), size_(0), allocated_(0), unsynced_bytes_(0),
+      buffers_(0), busy_(false), stop_(false), failed_(false)
+{
+}
+
+VectoredWriter::~VectoredWriter()
+{
+    Close();
+}
+
+bool VectoredWriter::Open(const std::string &path, bool append)
+{
+    Close();
+    path_ = path;
+    // Direct appends read the partial last block back, see below
+    int flags = O_CREAT | (append ? 0 : O_TRUNC) | (options_.direct ? O_RDWR | O_DIRECT : O_WRONLY);
+    fd_ = open(path_.c_str(), flags, 0644);
+    if (fd_ < 0 && options_.direct && EINVAL == errno)
+    {
+        WARNLOG("{} does not support O_DIRECT, continue with buffered writes", path_);
+        options_.direct = false;
+        fd_ = open(path_.c_str(), flags & ~O_DIRECT, 0644);
+    }
+    if (fd_ < 0)
+    {
+        ERRORLOG("open {} failed:{}", path_, strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if (0 != fstat(fd_, &st))
+    {
+        ERRORLOG("stat {} failed", path_);
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    size_ = st.st_size;
+    allocated_ = size_;
+    unsynced_bytes_ = 0;
+    capacity_ = std::max((options_.buffer_bytes + DIRECT_ALIGNMENT - 1) / DIRECT_ALIGNMENT, size_t(1)) * DIRECT_ALIGNMENT;
+    busy_ = false;
+    stop_ = false;
+    failed_ = false;
+    thread_ = std::thread(&VectoredWriter::Run, this);
+
+    // Direct writes restart at the block holding the end of the file
+    uint64_t tail = size_ % DIRECT_ALIGNMENT;
+    if (options_.direct && tail > 0)
+    {
+        if (!TakeBuffer())
+        {
+            return false;
+        }
+        current_.offset = size_ - tail;
+        if (pread(fd_, current_.data.get(), DIRECT_ALIGNMENT, current_.offset) != (ssize_t)tail)
+        {
+            ERRORLOG("read the tail of {} failed", path_);
+            Close();
+            return false;
+        }
+        current_.size = tail;
+    }
+    return true;
+}
+
+bool VectoredWriter::TakeBuffer()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this]()
+                  { return failed_ || !free_.empty() || buffers_ <= options_.max_pending; });
+    if (failed_)
+    {
+        return false;
+    }
+    if (!free_.empty())
+    {
+        current_ = std::move(free_.back());
+        free_.pop_back();
+    }
+    else
+    {
+        void *data = nullptr;
+        if (0 != posix_memalign(&data, DIRECT_ALIGNMENT, capacity_))
+        {
+            ERRORLOG("allocate a {} byte write buffer failed", capacity_);
+            return false;
+        }
+        current_.data.reset((char *)data);
+        ++buffers_;
+    }
+    current_.size = 0;
+    current_.offset = size_;
+    return true;
+}
+
+void VectoredWriter::Submit()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(current_));
+    }
+    current_ = Buffer();
+    cv_.notify_one();
+}
+
+bool VectoredWriter::Append(const char *data, size_t size)
+{
+    if (fd_ < 0)
+    {
+        return false;
+    }
+    while (size > 0)
+    {
+        if (nullptr == current_.data && !TakeBuffer())
+        {
+            return false;
+        }
+        size_t n = std::min(size, capacity_ - current_.size);
+        memcpy(current_.data.get() + current_.size, data, n);
+        current_.size += n;
+        size_ += n;
+        data += n;
+        size -= n;
+        if (current_.size == capacity_)
+        {
+            Submit();
+        }
+    }
+    return true;
+}
+
+void VectoredWriter::Run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        cv_.wait(lock, [this]()
+                 { return stop_ || !queue_.empty(); });
+        if (queue_.empty())
+        {
+            return;
+        }
+        std::vector<Buffer> batch;
+        while (!queue_.empty() && batch.size() < IOV_MAX)
+        {
+            batch.push_back(std::move(queue_.front()));
+            queue_.pop_front();
+        }
+        bool skip = failed_;
+        busy_ = true;
+        lock.unlock();
+        bool success = !skip && WriteBatch(batch);
+        lock.lock();
+        busy_ = false;
+        failed_ = failed_ || !success;
+        for (auto &buffer : batch)
+        {
+            free_.push_back(std::move(buffer));
+        }
+        done_cv_.notify_all();
+    }
+}
+
+bool VectoredWriter::WriteBatch(std::vector<Buffer> &batch)
+{
+    uint64_t offset = batch.front().offset;
+    uint64_t total = 0;
+    std::vector<iovec> iov;
+    for (auto &buffer : batch)
+    {
+        iov.push_back({buffer.data.get(), buffer.size});
+        total += buffer.size;
+    }
+    if (!Preallocate(offset + total))
+    {
+        return false;
+    }
+    size_t index = 0;
+    while (index < iov.size())
+    {
+        ssize_t ret = pwritev(fd_, &iov[index], iov.size() - index, offset);
+        if (ret < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            ERRORLOG("write {} at {} failed:{}", path_, offset, strerror(errno));
+            return false;
+        }
+        offset += ret;
+        // Skip what a short write already covered
+        while (ret > 0)
+        {
+            if ((size_t)ret >= iov[index].iov_len)
+            {
+                ret -= iov[index].iov_len;
+                ++index;
+            }
+            else
+            {
+                iov[index].iov_base = (char *)iov[index].iov_base + ret;
+                iov[index].iov_len -= ret;
+                ret = 0;
+            }
+        }
+    }
+    unsynced_bytes_ += total;
+    if (FSYNC_INTERVAL == options_.fsync && unsynced_bytes_ >= options_.fsync_interval_bytes)
+    {
+        if (0 != fdatasync(fd_))
+        {
+            ERRORLOG("fdatasync {} failed", path_);
+            return false;
+        }
+        unsynced_bytes_ = 0;
+    }
+    return true;
+}
+
+bool VectoredWriter::Preallocate(uint64_t end)
+{
+    if (0 == options_.preallocate_bytes || end <= allocated_)
+    {
+        return true;
+    }
+    uint64_t length = std::max(options_.preallocate_bytes, end - allocated_);
+    // KEEP_SIZE leaves the file size at what was written, the reserve is released on close
+    if (0 != fallocate(fd_, FALLOC_FL_KEEP_SIZE, allocated_, length))
+    {
+        WARNLOG("fallocate {} failed:{}, continue without preallocation", path_, strerror(errno));
+        options_.preallocate_bytes = 0;
+        return true;
+    }
+    allocated_ += length;
+    return true;
+}
+
+bool VectoredWriter::WriteTail(const Buffer &buffer)
+{
+    // The partial last block can not be written with O_DIRECT. It stays in the current buffer
+    // and is written again, aligned, once the buffer fills up.
+    int flags = fcntl(fd_, F_GETFL);
+    if (flags < 0 || 0 != fcntl(fd_, F_SETFL, flags & ~O_DIRECT))
+    {
+        ERRORLOG("clear O_DIRECT on {} failed", path_);
+        return false;
+    }
+    size_t written = 0;
+    while (written < buffer.size)
+    {
+        ssize_t ret = pwrite(fd_, buffer.data.get() + written, buffer.size - written, buffer.offset + written);
+        if (ret < 0 && EINTR != errno)
+        {
+            ERRORLOG("write {} at {} failed:{}", path_, buffer.offset + written, strerror(errno));
+            fcntl(fd_, F_SETFL, flags);
+            return false;
+        }
+        written += std::max<ssize_t>(ret, 0);
+    }
+    return 0 == fcntl(fd_, F_SETFL, flags);
+}
+
+bool VectoredWriter::Flush(bool sync)
+{
+    if (fd_ < 0)
+    {
+        return true;
+    }
+    if (current_.size > 0)
+    {
+        size_t aligned = options_.direct ? current_.size / DIRECT_ALIGNMENT * DIRECT_ALIGNMENT : current_.size;
+        if (aligned == current_.size)
+        {
+            Submit();
+        }
+        else if (aligned > 0)
+        {
+            Buffer head = std::move(current_);
+            if (!TakeBuffer())
+            {
+                return false;
+            }
+            current_.offset = head.offset + aligned;
+            current_.size = head.size - aligned;
+            memcpy(current_.data.get(), head.data.get() + aligned, current_.size);
+            head.size = aligned;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                queue_.push_back(std::move(head));
+            }
+            cv_.notify_one();
+        }
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [this]()
+                      { return queue_.empty() && !busy_; });
+        if (failed_)
+        {
+            return false;
+        }
+    }
+    if (current_.size > 0 && !WriteTail(current_))
+    {
+        return false;
+    }
+    if (sync)
+    {
+        if (0 != fdatasync(fd_))
+        {
+            ERRORLOG("fdatasync {} failed", path_);
+            return false;
+        }
+        unsynced_bytes_ = 0;
+    }
+    return true;
+}
+
+bool VectoredWriter::Close()
+{
+    if (fd_ < 0)
+    {
+        return true;
+    }
+    bool success = Flush(FSYNC_NONE != options_.fsync);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+    if (allocated_ > size_ && 0 != ftruncate(fd_, size_))
+    {
+        ERRORLOG("truncate {} to {} failed", path_, size_);
+        success = false;
+    }
+    if (0 != close(fd_))
+    {
+        ERRORLOG("close {} failed", path_);
+        success = false;
+    }
+    fd_ = -1;
+    current_ = Buffer();
+    queue_.clear();
+    free_.clear();
+    buffers_ = 0;
+    return success;
+}
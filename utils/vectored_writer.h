@@ -0,0 +1,91 @@
+#ifndef _UTILS_VECTORED_WRITER_H_
+#define _UTILS_VECTORED_WRITER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum FsyncPolicy
+{
+    FSYNC_NONE,     // leave it to the page cache
+    FSYNC_CLOSE,    // once when the file is closed
+    FSYNC_INTERVAL, // every interval_bytes and on close
+};
+
+struct WriterOptions
+{
+    size_t buffer_bytes = 8 * 1024 * 1024;
+    uint32_t max_pending = 2;       // full buffers queued for the writer thread
+    uint64_t preallocate_bytes = 0; // fallocate this far ahead of the write position
+    bool direct = false;            // O_DIRECT, for dumps much larger than the page cache
+    FsyncPolicy fsync = FSYNC_NONE;
+    uint64_t fsync_interval_bytes = 0;
+};
+
+// "none", "close" or a byte interval
+bool ParseFsyncPolicy(const std::string &value, WriterOptions &options);
+
+// Appends go into large aligned buffers. Full buffers move to a dedicated writer thread, which
+// writes everything queued with one pwritev, so the producer only pays for a memcpy.
+class VectoredWriter
+{
+public:
+    explicit VectoredWriter(const WriterOptions &options = WriterOptions());
+    ~VectoredWriter();
+    // append keeps the existing content and continues at its end
+    bool Open(const std::string &path, bool append);
+    bool Append(const char *data, size_t size);
+    // Returns once everything appended so far is in the file, sync also makes it durable
+    bool Flush(bool sync);
+    bool Close();
+    bool IsOpen() const { return fd_ >= 0; }
+    uint64_t Size() const { return size_; }
+
+private:
+    VectoredWriter(const VectoredWriter &) = delete;
+    VectoredWriter &operator=(const VectoredWriter &) = delete;
+
+    struct FreeDeleter
+    {
+        void operator()(char *p) const { free(p); }
+    };
+    struct Buffer
+    {
+        std::unique_ptr<char, FreeDeleter> data;
+        size_t size = 0;
+        uint64_t offset = 0; // file offset of the first byte
+    };
+
+    bool TakeBuffer();
+    void Submit();
+    void Run();
+    bool WriteBatch(std::vector<Buffer> &batch);
+    bool Preallocate(uint64_t end);
+    bool WriteTail(const Buffer &buffer);
+
+    WriterOptions options_;
+    std::string path_;
+    int fd_;
+    size_t capacity_;
+    uint64_t size_;
+    uint64_t allocated_;
+    uint64_t unsynced_bytes_;
+    Buffer current_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable done_cv_;
+    std::deque<Buffer> queue_;
+    std::vector<Buffer> free_;
+    uint32_t buffers_;
+    bool busy_;
+    bool stop_;
+    bool failed_;
+    std::thread thread_;
+};
+
+#endif